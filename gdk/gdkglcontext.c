@@ -142,12 +142,50 @@ gdk_gl_context_clear_old_updated_area (GdkGLContext *context)
 {
   int i;
 
-  for (i = 0; i < 2; i++)
+  for (i = 0; i < G_N_ELEMENTS (context->old_updated_area); i++)
     {
       g_clear_pointer (&context->old_updated_area[i], cairo_region_destroy);
     }
 }
 
+/*< private >
+ * gdk_gl_context_get_damage_for_buffer_age:
+ * @context: a #GdkGLContext
+ * @buffer_age: the age of the back buffer, as reported by
+ *   EGL_EXT_buffer_age or GLX_EXT_buffer_age
+ *
+ * Computes the area that changed since the back buffer was last
+ * drawn to, from the areas updated in the previous frames.
+ *
+ * Returns: (nullable): the damage, or %NULL if it is not known
+ *   and the whole surface needs to be redrawn
+ */
+cairo_region_t *
+gdk_gl_context_get_damage_for_buffer_age (GdkGLContext *context,
+                                          int           buffer_age)
+{
+  cairo_region_t *damage;
+  int i;
+
+  if (buffer_age < 1 || buffer_age > GDK_GL_MAX_TRACKED_BUFFERS)
+    return NULL;
+
+  damage = cairo_region_create ();
+
+  for (i = 0; i < buffer_age - 1; i++)
+    {
+      if (context->old_updated_area[i] == NULL)
+        {
+          cairo_region_destroy (damage);
+          return NULL;
+        }
+
+      cairo_region_union (damage, context->old_updated_area[i]);
+    }
+
+  return damage;
+}
+
 static void
 gdk_gl_context_dispose (GObject *gobject)
 {
@@ -301,6 +339,7 @@ gdk_gl_context_real_begin_frame (GdkDrawContext *draw_context,
   GdkGLContext *shared;
   cairo_region_t *damage;
   int ww, wh;
+  int i;
 
   shared = gdk_gl_context_get_shared_context (context);
   if (shared)
@@ -311,9 +350,11 @@ gdk_gl_context_real_begin_frame (GdkDrawContext *draw_context,
 
   damage = GDK_GL_CONTEXT_GET_CLASS (context)->get_damage (context);
 
-  if (context->old_updated_area[1])
-    cairo_region_destroy (context->old_updated_area[1]);
-  context->old_updated_area[1] = context->old_updated_area[0];
+  i = G_N_ELEMENTS (context->old_updated_area) - 1;
+  if (context->old_updated_area[i])
+    cairo_region_destroy (context->old_updated_area[i]);
+  for (; i > 0; i--)
+    context->old_updated_area[i] = context->old_updated_area[i - 1];
   context->old_updated_area[0] = cairo_region_copy (region);
 
   cairo_region_union (region, damage);
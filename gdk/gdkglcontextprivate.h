@@ -32,12 +32,15 @@ G_BEGIN_DECLS
 
 typedef struct _GdkGLContextClass       GdkGLContextClass;
 
+/* How many frames of buffer age we can reconstruct the damage for */
+#define GDK_GL_MAX_TRACKED_BUFFERS 4
+
 struct _GdkGLContext
 {
   GdkDrawContext parent_instance;
 
   /* We store the old drawn areas to support buffer-age optimizations */
-  cairo_region_t *old_updated_area[2];
+  cairo_region_t *old_updated_area[GDK_GL_MAX_TRACKED_BUFFERS - 1];
 };
 
 struct _GdkGLContextClass
@@ -85,6 +88,8 @@ void                    gdk_gl_context_upload_texture           (GdkGLContext
                                                                  int              height,
                                                                  int              stride,
                                                                  guint            texture_target);
+cairo_region_t *        gdk_gl_context_get_damage_for_buffer_age (GdkGLContext   *context,
+                                                                 int              buffer_age);
 GdkGLContextPaintData * gdk_gl_context_get_paint_data           (GdkGLContext    *context);
 gboolean                gdk_gl_context_use_texture_rectangle    (GdkGLContext    *context);
 gboolean                gdk_gl_context_has_framebuffer_blit     (GdkGLContext    *context);
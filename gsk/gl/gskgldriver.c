@@ -4,6 +4,8 @@
 
 #include "gskdebugprivate.h"
 #include "gskprofilerprivate.h"
+#include "gskrendernodeprivate.h"
+#include "gskroundedrectprivate.h"
 #include "gdk/gdkglcontextprivate.h"
 #include "gdk/gdktextureprivate.h"
 #include "gdk/gdkgltextureprivate.h"
@@ -11,6 +13,9 @@
 #include <gdk/gdk.h>
 #include <epoxy/gl.h>
 
+/* Cached node textures that have not been used for this many frames get dropped */
+#define MAX_NODE_TEXTURE_UNUSED_FRAMES 60
+
  typedef struct {
   GLuint fbo_id;
   GLuint depth_stencil_id;
@@ -32,6 +37,15 @@ typedef struct {
   guint n_slices;
 } Texture;
 
+/* Render nodes are immutable, so what they draw only depends on the
+ * key. We keep a reference on the node so its address can't be reused
+ * by a different node while the entry exists. */
+typedef struct {
+  GskNodeTextureKey key;
+  int texture_id;
+  guint unused_frames;
+} NodeTexture;
+
 struct _GskGLDriver
 {
   GObject parent_instance;
@@ -42,12 +56,14 @@ struct _GskGLDriver
     GQuark created_textures;
     GQuark reused_textures;
     GQuark surface_uploads;
+    GQuark node_texture_hits;
+    GQuark node_texture_misses;
   } counters;
 
   Fbo default_fbo;
 
   GHashTable *textures;         /* texture_id -> Texture */
-  GHashTable *pointer_textures; /* pointer -> texture_id */
+  GHashTable *node_textures;    /* GskNodeTextureKey -> NodeTexture */
 
   const Texture *bound_source_texture;
 
@@ -64,6 +80,39 @@ texture_new (void)
   return g_slice_new0 (Texture);
 }
 
+static guint
+node_texture_key_hash (gconstpointer v)
+{
+  const GskNodeTextureKey *k = v;
+
+  return g_direct_hash (k->node) ^
+         (guint) (k->scale * 1000) ^
+         (guint) (k->bounds.size.width * 100) ^
+         ((guint) (k->bounds.size.height * 100) << 16);
+}
+
+static gboolean
+node_texture_key_equal (gconstpointer x,
+                        gconstpointer y)
+{
+  const GskNodeTextureKey *a = x;
+  const GskNodeTextureKey *b = y;
+
+  return a->node == b->node &&
+         a->scale == b->scale &&
+         graphene_rect_equal (&a->bounds, &b->bounds) &&
+         gsk_rounded_rect_equal (&a->clip, &b->clip);
+}
+
+static void
+node_texture_free (gpointer data)
+{
+  NodeTexture *nt = data;
+
+  gsk_render_node_unref (nt->key.node);
+  g_slice_free (NodeTexture, nt);
+}
+
 static inline void
 fbo_clear (const Fbo *f)
 {
@@ -119,8 +168,8 @@ gsk_gl_driver_finalize (GObject *gobject)
 
   gdk_gl_context_make_current (self->gl_context);
 
+  g_clear_pointer (&self->node_textures, g_hash_table_unref);
   g_clear_pointer (&self->textures, g_hash_table_unref);
-  g_clear_pointer (&self->pointer_textures, g_hash_table_unref);
   g_clear_object (&self->profiler);
 
   if (self->gl_context == gdk_gl_context_get_current ())
@@ -141,6 +190,8 @@ static void
 gsk_gl_driver_init (GskGLDriver *self)
 {
   self->textures = g_hash_table_new_full (NULL, NULL, NULL, texture_free);
+  self->node_textures = g_hash_table_new_full (node_texture_key_hash, node_texture_key_equal,
+                                               NULL, node_texture_free);
 
   self->max_texture_size = -1;
 
@@ -158,6 +209,14 @@ gsk_gl_driver_init (GskGLDriver *self)
                                                              "surface_uploads",
                                                              "Texture uploads from surfaces this frame",
                                                              TRUE);
+  self->counters.node_texture_hits = gsk_profiler_add_counter (self->profiler,
+                                                               "node_texture_hits",
+                                                               "Node textures reused this frame",
+                                                               TRUE);
+  self->counters.node_texture_misses = gsk_profiler_add_counter (self->profiler,
+                                                                 "node_texture_misses",
+                                                                 "Node texture cache misses this frame",
+                                                                 TRUE);
 #endif
 }
 
@@ -173,6 +232,30 @@ gsk_gl_driver_new (GdkGLContext *context)
   return self;
 }
 
+static void
+gsk_gl_driver_age_node_textures (GskGLDriver *self)
+{
+  GHashTableIter iter;
+  NodeTexture *nt;
+
+  g_hash_table_iter_init (&iter, self->node_textures);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&nt))
+    {
+      /* A node that only we still hold a reference on can never
+       * be drawn again, so there is no point in keeping it around. */
+      if (nt->unused_frames > MAX_NODE_TEXTURE_UNUSED_FRAMES ||
+          nt->key.node->ref_count == 1)
+        {
+          gsk_gl_driver_destroy_texture (self, nt->texture_id);
+          g_hash_table_iter_remove (&iter);
+        }
+      else
+        {
+          nt->unused_frames ++;
+        }
+    }
+}
+
 void
 gsk_gl_driver_begin_frame (GskGLDriver *self)
 {
@@ -181,6 +264,8 @@ gsk_gl_driver_begin_frame (GskGLDriver *self)
 
   self->in_frame = TRUE;
 
+  gsk_gl_driver_age_node_textures (self);
+
   if (self->max_texture_size < 0)
     {
       glGetIntegerv (GL_MAX_TEXTURE_SIZE, (GLint *) &self->max_texture_size);
@@ -225,15 +310,20 @@ gsk_gl_driver_end_frame (GskGLDriver *self)
   GSK_NOTE (OPENGL,
             g_message ("Textures created: %" G_GINT64_FORMAT "\n"
                      " Textures reused: %" G_GINT64_FORMAT "\n"
-                     " Surface uploads: %" G_GINT64_FORMAT,
+                     " Surface uploads: %" G_GINT64_FORMAT "\n"
+                     " Node texture hits: %" G_GINT64_FORMAT "\n"
+                     " Node texture misses: %" G_GINT64_FORMAT,
                      gsk_profiler_counter_get (self->profiler, self->counters.created_textures),
                      gsk_profiler_counter_get (self->profiler, self->counters.reused_textures),
-                     gsk_profiler_counter_get (self->profiler, self->counters.surface_uploads)));
+                     gsk_profiler_counter_get (self->profiler, self->counters.surface_uploads),
+                     gsk_profiler_counter_get (self->profiler, self->counters.node_texture_hits),
+                     gsk_profiler_counter_get (self->profiler, self->counters.node_texture_misses)));
 #endif
 
   GSK_NOTE (OPENGL,
-            g_message ("*** Frame end: textures=%d",
-                     g_hash_table_size (self->textures)));
+            g_message ("*** Frame end: textures=%d, node textures=%d",
+                     g_hash_table_size (self->textures),
+                     g_hash_table_size (self->node_textures)));
 
   self->in_frame = FALSE;
 }
@@ -270,25 +360,6 @@ gsk_gl_driver_collect_textures (GskGLDriver *self)
         }
       else
         {
-          /* Remove from self->pointer_textures. */
-          /* TODO: Is there a better way for this? */
-          if (self->pointer_textures)
-            {
-              GHashTableIter pointer_iter;
-              gpointer value;
-              gpointer p;
-
-              g_hash_table_iter_init (&pointer_iter, self->pointer_textures);
-              while (g_hash_table_iter_next (&pointer_iter, &p, &value))
-                {
-                  if (GPOINTER_TO_INT (value) == t->texture_id)
-                    {
-                      g_hash_table_iter_remove (&pointer_iter);
-                      break;
-                    }
-                }
-            }
-
           g_hash_table_iter_remove (&iter);
         }
     }
@@ -541,39 +612,69 @@ gsk_gl_driver_get_texture_for_texture (GskGLDriver *self,
   return t->texture_id;
 }
 
+/* Returns the texture that was previously stored for @key via
+ * gsk_gl_driver_set_texture_for_node(), or 0. */
 int
-gsk_gl_driver_get_texture_for_pointer (GskGLDriver *self,
-                                       gpointer     pointer)
+gsk_gl_driver_get_texture_for_node (GskGLDriver             *self,
+                                    const GskNodeTextureKey *key)
 {
-  int id = 0;
+  NodeTexture *nt;
 
-  if (G_UNLIKELY (self->pointer_textures == NULL))
-    self->pointer_textures = g_hash_table_new (NULL, NULL);
+  g_return_val_if_fail (GSK_IS_GL_DRIVER (self), 0);
 
-  id = GPOINTER_TO_INT (g_hash_table_lookup (self->pointer_textures, pointer));
+  nt = g_hash_table_lookup (self->node_textures, key);
 
-  if (id != 0)
+  if (nt == NULL)
     {
-      Texture *t;
+#ifdef G_ENABLE_DEBUG
+      gsk_profiler_counter_inc (self->profiler, self->counters.node_texture_misses);
+#endif
+      return 0;
+    }
 
-      t = g_hash_table_lookup (self->textures, GINT_TO_POINTER (id));
+#ifdef G_ENABLE_DEBUG
+  gsk_profiler_counter_inc (self->profiler, self->counters.node_texture_hits);
+#endif
 
-      if (t != NULL)
-        t->in_use = TRUE;
-    }
+  nt->unused_frames = 0;
 
-  return id;
+  return nt->texture_id;
 }
 
+/* Stores @texture_id as the drawn contents of @key across frames.
+ * The driver takes ownership of the texture and destroys it once
+ * the node is gone or hasn't been used for a while. */
 void
-gsk_gl_driver_set_texture_for_pointer (GskGLDriver *self,
-                                       gpointer     pointer,
-                                       int          texture_id)
+gsk_gl_driver_set_texture_for_node (GskGLDriver             *self,
+                                    const GskNodeTextureKey *key,
+                                    int                      texture_id)
 {
-  if (G_UNLIKELY (self->pointer_textures == NULL))
-    self->pointer_textures = g_hash_table_new (NULL, NULL);
+  NodeTexture *nt;
+
+  g_return_if_fail (GSK_IS_GL_DRIVER (self));
+  g_return_if_fail (texture_id > 0);
+
+  nt = g_hash_table_lookup (self->node_textures, key);
+  if (nt != NULL)
+    {
+      nt->unused_frames = 0;
+
+      if (nt->texture_id == texture_id)
+        return;
+
+      gsk_gl_driver_destroy_texture (self, nt->texture_id);
+      g_hash_table_remove (self->node_textures, key);
+    }
+
+  gsk_gl_driver_mark_texture_permanent (self, texture_id);
+
+  nt = g_slice_new (NodeTexture);
+  nt->key = *key;
+  nt->key.node = gsk_render_node_ref (key->node);
+  nt->texture_id = texture_id;
+  nt->unused_frames = 0;
 
-  g_hash_table_insert (self->pointer_textures, pointer, GINT_TO_POINTER (texture_id));
+  g_hash_table_insert (self->node_textures, &nt->key, nt);
 }
 
 int
@@ -5,6 +5,8 @@
 #include <gdk/gdk.h>
 #include <graphene.h>
 
+#include "gskrendernode.h"
+
 G_BEGIN_DECLS
 
 #define GSK_TYPE_GL_DRIVER (gsk_gl_driver_get_type ())
@@ -16,11 +18,24 @@ typedef struct {
   float uv[2];
 } GskQuadVertex;
 
+typedef struct {
+  float rect[4]; /* x, y, width, height */
+  float uv[4];   /* x1, y1, x2, y2 */
+  float color[4];
+} GskQuadInstance;
+
 typedef struct {
   cairo_rectangle_int_t rect;
   guint texture_id;
 } TextureSlice;
 
+typedef struct {
+  GskRenderNode *node;
+  float scale;
+  graphene_rect_t bounds;  /* The area of the node in the texture */
+  GskRoundedRect clip;     /* The clip the node was drawn with */
+} GskNodeTextureKey;
+
 
 GskGLDriver *   gsk_gl_driver_new                       (GdkGLContext    *context);
 GdkGLContext   *gsk_gl_driver_get_gl_context            (GskGLDriver     *driver);
@@ -34,11 +49,11 @@ int             gsk_gl_driver_get_texture_for_texture   (GskGLDriver     *driver
                                                          GdkTexture      *texture,
                                                          int              min_filter,
                                                          int              mag_filter);
-int             gsk_gl_driver_get_texture_for_pointer   (GskGLDriver     *driver,
-                                                         gpointer         pointer);
-void            gsk_gl_driver_set_texture_for_pointer   (GskGLDriver     *driver,
-                                                         gpointer         pointer,
-                                                         int              texture_id);
+int             gsk_gl_driver_get_texture_for_node      (GskGLDriver             *driver,
+                                                         const GskNodeTextureKey *key);
+void            gsk_gl_driver_set_texture_for_node      (GskGLDriver             *driver,
+                                                         const GskNodeTextureKey *key,
+                                                         int                      texture_id);
 int             gsk_gl_driver_create_texture            (GskGLDriver     *driver,
                                                          float            width,
                                                          float            height);
@@ -4,6 +4,7 @@
 #include "gskgldriverprivate.h"
 #include "gskdebugprivate.h"
 #include "gskprivate.h"
+#include "gskglyphdiskcacheprivate.h"
 #include "gskgltextureatlasprivate.h"
 
 #include "gdk/gdkglcontextprivate.h"
@@ -15,14 +16,17 @@
 
 /* Cache eviction strategy
  *
- * We mark glyphs as accessed every time we use them.
- * Every few frames, we mark glyphs that haven't been
- * accessed since the last check as old.
+ * We keep glyphs in a list ordered by their last use. Every
+ * frame, the glyphs at the end of that list that haven't been
+ * used for a while are marked as old in their atlas and leave
+ * the list. They stay in the cache until their atlas gets
+ * dropped, and become used again if they are looked up.
  *
- * We keep count of the pixels of each atlas that are
- * taken up by old data. When the fraction of old pixels
- * gets too high, we drop the atlas and all the items it
- * contained.
+ * Once enough of an atlas is old, it gets retired, see
+ * gskgltextureatlas.c. Glyphs that are still in use are moved
+ * out of retired atlases when they are looked up, a few per
+ * frame, so that dropping the atlas later does not make us
+ * render all of them again at once.
  *
  * Big glyphs are not stored in the atlas, they get their
  * own texture, but they are still cached.
@@ -30,12 +34,22 @@
 
 #define MAX_FRAME_AGE (60)
 #define MAX_GLYPH_SIZE 128 /* Will get its own texture if bigger */
+#define MAX_MIGRATIONS_PER_FRAME 32
+
+/* Seconds after adding new glyphs, before we write them to the disk cache */
+#define DISK_CACHE_SAVE_DELAY 2
 
 static guint    glyph_cache_hash       (gconstpointer v);
 static gboolean glyph_cache_equal      (gconstpointer v1,
                                         gconstpointer v2);
 static void     glyph_cache_key_free   (gpointer      v);
 static void     glyph_cache_value_free (gpointer      v);
+static guint    disk_cache_key_hash    (gconstpointer v);
+static gboolean disk_cache_key_equal   (gconstpointer v1,
+                                        gconstpointer v2);
+static void     disk_cache_key_free    (gpointer      v);
+static void     disk_cache_free        (gpointer      v);
+static void     save_disk_caches       (GskGLGlyphCache *self);
 
 GskGLGlyphCache *
 gsk_gl_glyph_cache_new (GdkDisplay *display,
@@ -48,6 +62,10 @@ gsk_gl_glyph_cache_new (GdkDisplay *display,
   glyph_cache->display = display;
   glyph_cache->hash_table = g_hash_table_new_full (glyph_cache_hash, glyph_cache_equal,
                                                    glyph_cache_key_free, glyph_cache_value_free);
+  g_queue_init (&glyph_cache->lru);
+  glyph_cache->pending = g_ptr_array_new ();
+  glyph_cache->disk_caches = g_hash_table_new_full (disk_cache_key_hash, disk_cache_key_equal,
+                                                    disk_cache_key_free, disk_cache_free);
 
   glyph_cache->atlases = gsk_gl_texture_atlases_ref (atlases);
 
@@ -71,7 +89,14 @@ gsk_gl_glyph_cache_unref (GskGLGlyphCache *self)
 
   if (self->ref_count == 1)
     {
+      if (self->disk_cache_save_id)
+        {
+          g_source_remove (self->disk_cache_save_id);
+          save_disk_caches (self);
+        }
+      g_hash_table_unref (self->disk_caches);
       gsk_gl_texture_atlases_unref (self->atlases);
+      g_ptr_array_unref (self->pending);
       g_hash_table_unref (self->hash_table);
       g_free (self);
       return;
@@ -109,27 +134,141 @@ glyph_cache_value_free (gpointer v)
   g_free (v);
 }
 
+typedef struct {
+  PangoFont *font;
+  guint scale;
+} DiskCacheKey;
+
+static guint
+disk_cache_key_hash (gconstpointer v)
+{
+  const DiskCacheKey *key = v;
+
+  return GPOINTER_TO_UINT (key->font) ^ key->scale;
+}
+
 static gboolean
-render_glyph (GlyphCacheKey    *key,
-              GskGLCachedGlyph *value,
-              GskImageRegion   *region)
+disk_cache_key_equal (gconstpointer v1,
+                      gconstpointer v2)
+{
+  const DiskCacheKey *key1 = v1;
+  const DiskCacheKey *key2 = v2;
+
+  return key1->font == key2->font &&
+         key1->scale == key2->scale;
+}
+
+static void
+disk_cache_key_free (gpointer v)
+{
+  DiskCacheKey *key = v;
+
+  g_object_unref (key->font);
+  g_free (key);
+}
+
+static void
+disk_cache_free (gpointer v)
+{
+  if (v)
+    gsk_glyph_disk_cache_free (v);
+}
+
+/* May return NULL if the disk cache is not available */
+static GskGlyphDiskCache *
+get_disk_cache (GskGLGlyphCache     *self,
+                PangoFont           *font,
+                cairo_scaled_font_t *scaled_font,
+                guint                scale)
 {
+  DiskCacheKey lookup = { font, scale };
+  DiskCacheKey *key;
+  GskGlyphDiskCache *disk_cache;
+
+  if (g_hash_table_lookup_extended (self->disk_caches, &lookup, NULL, (gpointer *)&disk_cache))
+    return disk_cache;
+
+  disk_cache = gsk_glyph_disk_cache_new (font, scaled_font, scale);
+
+  key = g_new (DiskCacheKey, 1);
+  key->font = g_object_ref (font);
+  key->scale = scale;
+  g_hash_table_insert (self->disk_caches, key, disk_cache);
+
+  return disk_cache;
+}
+
+/* Writes out the glyphs we rendered, and closes the disk caches
+ * so that we don't keep fonts alive. They get opened again when
+ * we need to render more glyphs. */
+static void
+save_disk_caches (GskGLGlyphCache *self)
+{
+  GHashTableIter iter;
+  GskGlyphDiskCache *disk_cache;
+
+  g_hash_table_iter_init (&iter, self->disk_caches);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&disk_cache))
+    {
+      if (disk_cache)
+        gsk_glyph_disk_cache_save (disk_cache);
+    }
+
+  g_hash_table_remove_all (self->disk_caches);
+}
+
+static gboolean
+save_disk_caches_cb (gpointer data)
+{
+  GskGLGlyphCache *self = data;
+
+  self->disk_cache_save_id = 0;
+  save_disk_caches (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+typedef struct {
+  GskGLCachedGlyph *value;
+  cairo_scaled_font_t *scaled_font;
+  GskGlyphDiskCache *disk_cache;
+  GskImageRegion region;
+  guint from_disk : 1;
+} GlyphUpload;
+
+static void
+glyph_get_region_position (const GskGLCachedGlyph *value,
+                           GskImageRegion         *region)
+{
+  if (value->atlas)
+    {
+      region->x = (gsize)(value->tx * value->atlas->width);
+      region->y = (gsize)(value->ty * value->atlas->height);
+    }
+  else
+    {
+      region->x = 0;
+      region->y = 0;
+    }
+}
+
+/* Renders the glyph into region. This runs on a worker thread
+ * for most glyphs, so it must not touch the PangoFont. Only
+ * glyphs with PANGO_GLYPH_UNKNOWN_FLAG go through pango, and
+ * those are rendered on the render thread.
+ */
+static void
+render_glyph (GlyphUpload *upload)
+{
+  GskGLCachedGlyph *value = upload->value;
+  GlyphCacheKey *key = value->key;
+  GskImageRegion *region = &upload->region;
   cairo_surface_t *surface;
   cairo_t *cr;
-  cairo_scaled_font_t *scaled_font;
-  PangoGlyphString glyph_string;
-  PangoGlyphInfo glyph_info;
   int surface_width, surface_height;
   int stride;
   unsigned char *data;
 
-  scaled_font = pango_cairo_font_get_scaled_font ((PangoCairoFont *)key->data.font);
-  if (G_UNLIKELY (!scaled_font || cairo_scaled_font_status (scaled_font) != CAIRO_STATUS_SUCCESS))
-    {
-      g_warning ("Failed to get a font");
-      return FALSE;
-    }
-
   surface_width = value->draw_width * key->data.scale / 1024;
   surface_height = value->draw_height * key->data.scale / 1024;
 
@@ -142,21 +281,35 @@ render_glyph (GlyphCacheKey    *key,
 
   cr = cairo_create (surface);
 
-  cairo_set_scaled_font (cr, scaled_font);
+  cairo_set_scaled_font (cr, upload->scaled_font);
   cairo_set_source_rgba (cr, 1, 1, 1, 1);
 
-  glyph_info.glyph = key->data.glyph;
-  glyph_info.geometry.width = value->draw_width * 1024;
-  if (glyph_info.glyph & PANGO_GLYPH_UNKNOWN_FLAG)
-    glyph_info.geometry.x_offset = 0;
+  if (key->data.glyph & PANGO_GLYPH_UNKNOWN_FLAG)
+    {
+      PangoGlyphString glyph_string;
+      PangoGlyphInfo glyph_info;
+
+      glyph_info.glyph = key->data.glyph;
+      glyph_info.geometry.width = value->draw_width * 1024;
+      glyph_info.geometry.x_offset = 0;
+      glyph_info.geometry.y_offset = - value->draw_y * 1024;
+
+      glyph_string.num_glyphs = 1;
+      glyph_string.glyphs = &glyph_info;
+
+      pango_cairo_show_glyph_string (cr, key->data.font, &glyph_string);
+    }
   else
-    glyph_info.geometry.x_offset = - value->draw_x * 1024;
-  glyph_info.geometry.y_offset = - value->draw_y * 1024;
+    {
+      cairo_glyph_t glyph;
+
+      glyph.index = key->data.glyph;
+      glyph.x = - value->draw_x;
+      glyph.y = - value->draw_y;
 
-  glyph_string.num_glyphs = 1;
-  glyph_string.glyphs = &glyph_info;
+      cairo_show_glyphs (cr, &glyph, 1);
+    }
 
-  pango_cairo_show_glyph_string (cr, key->data.font, &glyph_string);
   cairo_destroy (cr);
 
   cairo_surface_flush (surface);
@@ -165,50 +318,96 @@ render_glyph (GlyphCacheKey    *key,
   region->height = cairo_image_surface_get_height (surface);
   region->stride = cairo_image_surface_get_stride (surface);
   region->data = data;
-  if (value->atlas)
-    {
-      region->x = (gsize)(value->tx * value->atlas->width);
-      region->y = (gsize)(value->ty * value->atlas->height);
-    }
-  else
-    {
-      region->x = 0;
-      region->y = 0;
-    }
+  glyph_get_region_position (value, region);
 
   cairo_surface_destroy (surface);
+}
 
-  return TRUE;
+static void
+render_glyph_func (guint    index,
+                   gpointer user_data)
+{
+  GlyphUpload *upload = &((GlyphUpload *) user_data)[index];
+
+  if (upload->scaled_font == NULL ||
+      upload->from_disk ||
+      upload->value->key->data.glyph & PANGO_GLYPH_UNKNOWN_FLAG)
+    return;
+
+  render_glyph (upload);
 }
 
 static void
-upload_glyph (GlyphCacheKey    *key,
-              GskGLCachedGlyph *value)
+upload_glyph (GskGLCachedGlyph     *value,
+              const GskImageRegion *r)
 {
-  GskImageRegion r;
+  glPixelStorei (GL_UNPACK_ROW_LENGTH, r->stride / 4);
+  glBindTexture (GL_TEXTURE_2D, value->texture_id);
 
-  gdk_gl_context_push_debug_group_printf (gdk_gl_context_get_current (),
-                                          "Uploading glyph %d",
-                                          key->data.glyph);
+  if (gdk_gl_context_get_use_es (gdk_gl_context_get_current ()))
+    glTexSubImage2D (GL_TEXTURE_2D, 0, r->x, r->y, r->width, r->height,
+                     GL_RGBA, GL_UNSIGNED_BYTE,
+                     r->data);
+  else
+    glTexSubImage2D (GL_TEXTURE_2D, 0, r->x, r->y, r->width, r->height,
+                     GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
+                     r->data);
+  glPixelStorei (GL_UNPACK_ROW_LENGTH, 0);
+}
+
+/* The size the glyph takes up in its atlas, including padding */
+static inline void
+glyph_get_atlas_size (const GskGLCachedGlyph *value,
+                      int                    *width,
+                      int                    *height)
+{
+  *width = value->draw_width * value->key->data.scale / 1024 + 2;
+  *height = value->draw_height * value->key->data.scale / 1024 + 2;
+}
+
+static void
+glyph_mark_used (GskGLCachedGlyph *value)
+{
+  int width, height;
+
+  if (value->atlas == NULL || value->used)
+    return;
+
+  glyph_get_atlas_size (value, &width, &height);
+  gsk_gl_texture_atlas_mark_used (value->atlas, width, height);
+  value->used = TRUE;
+}
+
+static void
+glyph_mark_unused (GskGLCachedGlyph *value)
+{
+  int width, height;
+
+  if (value->atlas == NULL || !value->used)
+    return;
+
+  glyph_get_atlas_size (value, &width, &height);
+  gsk_gl_texture_atlas_mark_unused (value->atlas, width, height);
+  value->used = FALSE;
+}
+
+/* Moves the glyph to the front of the LRU list */
+static void
+glyph_touch (GskGLGlyphCache  *self,
+             GskGLCachedGlyph *value)
+{
+  value->timestamp = self->timestamp;
 
-  if (render_glyph (key, value, &r))
+  if (value->in_lru)
     {
-      glPixelStorei (GL_UNPACK_ROW_LENGTH, r.stride / 4);
-      glBindTexture (GL_TEXTURE_2D, value->texture_id);
+      if (self->lru.head == &value->lru_link)
+        return;
 
-      if (gdk_gl_context_get_use_es (gdk_gl_context_get_current ()))
-        glTexSubImage2D (GL_TEXTURE_2D, 0, r.x, r.y, r.width, r.height,
-                         GL_RGBA, GL_UNSIGNED_BYTE,
-                         r.data);
-      else
-        glTexSubImage2D (GL_TEXTURE_2D, 0, r.x, r.y, r.width, r.height,
-                         GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
-                         r.data);
-      glPixelStorei (GL_UNPACK_ROW_LENGTH, 0);
-      g_free (r.data);
+      g_queue_unlink (&self->lru, &value->lru_link);
     }
 
-  gdk_gl_context_pop_debug_group (gdk_gl_context_get_current ());
+  g_queue_push_head_link (&self->lru, &value->lru_link);
+  value->in_lru = TRUE;
 }
 
 static void
@@ -252,7 +451,12 @@ add_to_cache (GskGLGlyphCache  *self,
       value->th = 1.0f;
     }
 
-  upload_glyph (key, value);
+  /* Rendered and uploaded in gsk_gl_glyph_cache_upload_pending() */
+  if (!value->pending)
+    {
+      g_ptr_array_add (self->pending, value);
+      value->pending = TRUE;
+    }
 }
 
 void
@@ -267,12 +471,21 @@ gsk_gl_glyph_cache_lookup_or_add (GskGLGlyphCache         *cache,
 
   if (value)
     {
-      if (value->atlas && !value->used)
+      if (value->atlas &&
+          cache->migrations_left > 0 &&
+          gsk_gl_texture_atlas_is_retired (value->atlas))
         {
-          gsk_gl_texture_atlas_mark_used (value->atlas, value->draw_width, value->draw_height);
-          value->used = TRUE;
+          /* Still in use, so render it again into an atlas that will stay */
+          glyph_mark_unused (value);
+          add_to_cache (cache, value->key, driver, value);
+          cache->migrations_left--;
+        }
+      else
+        {
+          glyph_mark_used (value);
         }
-      value->accessed = TRUE;
+
+      glyph_touch (cache, value);
 
       *cached_glyph_out = value;
       return;
@@ -295,8 +508,8 @@ gsk_gl_glyph_cache_lookup_or_add (GskGLGlyphCache         *cache,
     value->draw_y = ink_rect.y;
     value->draw_width = ink_rect.width;
     value->draw_height = ink_rect.height;
-    value->accessed = TRUE;
     value->atlas = NULL; /* For now */
+    value->lru_link.data = value;
 
     key = g_new0 (GlyphCacheKey, 1);
 
@@ -307,11 +520,15 @@ gsk_gl_glyph_cache_lookup_or_add (GskGLGlyphCache         *cache,
     key->data.scale = lookup->data.scale;
     key->hash = lookup->hash;
 
+    value->key = key;
+
     if (key->data.scale > 0 &&
         value->draw_width * key->data.scale / 1024 > 0 &&
         value->draw_height * key->data.scale / 1024 > 0)
       add_to_cache (cache, key, driver, value);
 
+    glyph_touch (cache, value);
+
     *cached_glyph_out = value;
     g_hash_table_insert (cache->hash_table, key, value);
   }
@@ -325,9 +542,13 @@ gsk_gl_glyph_cache_begin_frame (GskGLGlyphCache *self,
   GHashTableIter iter;
   GlyphCacheKey *key;
   GskGLCachedGlyph *value;
+  GList *link;
   guint dropped = 0;
 
+  g_assert (self->pending->len == 0);
+
   self->timestamp++;
+  self->migrations_left = MAX_MIGRATIONS_PER_FRAME;
 
   if (removed_atlases->len > 0)
     {
@@ -336,45 +557,165 @@ gsk_gl_glyph_cache_begin_frame (GskGLGlyphCache *self,
         {
           if (g_ptr_array_find (removed_atlases, value->atlas, NULL))
             {
+              if (value->in_lru)
+                g_queue_unlink (&self->lru, &value->lru_link);
+
               g_hash_table_iter_remove (&iter);
               dropped++;
             }
         }
     }
 
+  /* Age the glyphs that haven't been used for a while */
+  while ((link = g_queue_peek_tail_link (&self->lru)))
+    {
+      value = link->data;
+
+      if (self->timestamp - value->timestamp <= MAX_FRAME_AGE)
+        break;
+
+      g_queue_unlink (&self->lru, link);
+      value->in_lru = FALSE;
+
+      if (value->atlas)
+        {
+          glyph_mark_unused (value);
+        }
+      else
+        {
+          if (value->texture_id != 0)
+            gsk_gl_driver_destroy_texture (driver, value->texture_id);
+          g_hash_table_remove (self->hash_table, value->key);
+
+          /* Sadly, if we drop an atlas-less cached glyph, we
+           * have to treat it like a dropped atlas and purge
+           * text node render data.
+           */
+          dropped++;
+        }
+    }
+
   if (self->timestamp % MAX_FRAME_AGE == 30)
+    GSK_NOTE(GLYPH_CACHE, g_message ("%d glyphs cached, %d recently used",
+                                     g_hash_table_size (self->hash_table),
+                                     self->lru.length));
+
+  GSK_NOTE(GLYPH_CACHE, if (dropped > 0) g_message ("Dropped %d glyphs", dropped));
+}
+
+/* Renders all glyphs that have been added since the last call,
+ * spread over several threads, and uploads them in one go.
+ * Glyphs found in the disk cache are uploaded from there, and
+ * newly rendered ones get added to it.
+ * This has to be called before any of them get drawn.
+ */
+void
+gsk_gl_glyph_cache_upload_pending (GskGLGlyphCache *self)
+{
+  GlyphUpload *uploads;
+  guint n_uploads;
+  guint n_from_disk = 0;
+  guint n_to_disk = 0;
+  guint i;
+
+  n_uploads = self->pending->len;
+  if (n_uploads == 0)
+    return;
+
+  uploads = g_new0 (GlyphUpload, n_uploads);
+
+  for (i = 0; i < n_uploads; i++)
     {
-      g_hash_table_iter_init (&iter, self->hash_table);
-      while (g_hash_table_iter_next (&iter, (gpointer *)&key, (gpointer *)&value))
+      GskGLCachedGlyph *value = g_ptr_array_index (self->pending, i);
+      cairo_scaled_font_t *scaled_font;
+
+      scaled_font = pango_cairo_font_get_scaled_font ((PangoCairoFont *)value->key->data.font);
+      if (G_UNLIKELY (!scaled_font || cairo_scaled_font_status (scaled_font) != CAIRO_STATUS_SUCCESS))
         {
-          if (!value->accessed)
+          g_warning ("Failed to get a font");
+          scaled_font = NULL;
+        }
+
+      uploads[i].value = value;
+      uploads[i].scaled_font = scaled_font;
+      value->pending = FALSE;
+
+      if (scaled_font)
+        {
+          GlyphUpload *upload = &uploads[i];
+          GlyphCacheKey *key = value->key;
+          int width, height;
+          const guchar *data;
+          gsize stride;
+
+          width = value->draw_width * key->data.scale / 1024;
+          height = value->draw_height * key->data.scale / 1024;
+
+          upload->disk_cache = get_disk_cache (self, key->data.font, scaled_font, key->data.scale);
+          if (upload->disk_cache &&
+              gsk_glyph_disk_cache_lookup (upload->disk_cache,
+                                           key->data.glyph, key->data.xshift, key->data.yshift,
+                                           width, height,
+                                           &data, &stride))
             {
-              if (value->atlas)
-                {
-                  if (value->used)
-                    {
-                      gsk_gl_texture_atlas_mark_unused (value->atlas, value->draw_width, value->draw_height);
-                      value->used = FALSE;
-                    }
-                }
-              else
-                {
-                  gsk_gl_driver_destroy_texture (driver, value->texture_id);
-                  g_hash_table_iter_remove (&iter);
-
-                  /* Sadly, if we drop an atlas-less cached glyph, we
-                   * have to treat it like a dropped atlas and purge
-                   * text node render data.
-                   */
-                  dropped++;
-                }
+              upload->region.data = (guchar *) data;
+              upload->region.width = width;
+              upload->region.height = height;
+              upload->region.stride = stride;
+              glyph_get_region_position (value, &upload->region);
+              upload->from_disk = TRUE;
+              n_from_disk++;
             }
-          else
-            value->accessed = FALSE;
-       }
+        }
+    }
 
-      GSK_NOTE(GLYPH_CACHE, g_message ("%d glyphs cached", g_hash_table_size (self->hash_table)));
+  gsk_parallel_for (n_uploads, render_glyph_func, uploads);
+
+  gdk_gl_context_push_debug_group_printf (gdk_gl_context_get_current (),
+                                          "Uploading %u glyphs", n_uploads);
+
+  for (i = 0; i < n_uploads; i++)
+    {
+      GlyphUpload *upload = &uploads[i];
+
+      if (upload->scaled_font == NULL)
+        continue;
+
+      if (upload->from_disk)
+        {
+          upload_glyph (upload->value, &upload->region);
+          continue;
+        }
+
+      if (upload->value->key->data.glyph & PANGO_GLYPH_UNKNOWN_FLAG)
+        render_glyph (upload);
+
+      upload_glyph (upload->value, &upload->region);
+
+      if (upload->disk_cache)
+        {
+          GlyphCacheKey *key = upload->value->key;
+
+          gsk_glyph_disk_cache_add (upload->disk_cache,
+                                    key->data.glyph, key->data.xshift, key->data.yshift,
+                                    upload->region.width, upload->region.height,
+                                    upload->region.data, upload->region.stride);
+          n_to_disk++;
+        }
+
+      g_free (upload->region.data);
     }
 
-  GSK_NOTE(GLYPH_CACHE, if (dropped > 0) g_message ("Dropped %d glyphs", dropped));
+  gdk_gl_context_pop_debug_group (gdk_gl_context_get_current ());
+
+  GSK_NOTE(GLYPH_CACHE, g_message ("Uploaded %u glyphs, %u from the disk cache", n_uploads, n_from_disk));
+
+  if (n_to_disk > 0 && self->disk_cache_save_id == 0)
+    {
+      self->disk_cache_save_id = g_timeout_add_seconds (DISK_CACHE_SAVE_DELAY, save_disk_caches_cb, self);
+      g_source_set_name_by_id (self->disk_cache_save_id, "[gtk] save_disk_caches_cb");
+    }
+
+  g_ptr_array_set_size (self->pending, 0);
+  g_free (uploads);
 }
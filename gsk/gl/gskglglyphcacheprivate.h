@@ -15,6 +15,17 @@ typedef struct
   GHashTable *hash_table;
   GskGLTextureAtlases *atlases;
 
+  /* Recently used glyphs, most recent first */
+  GQueue lru;
+  /* How many glyphs we may still move out of retired atlases this frame */
+  int migrations_left;
+  /* Glyphs that have been packed, but not rendered and uploaded yet */
+  GPtrArray *pending;
+
+  /* (font, scale) => GskGlyphDiskCache, or NULL if not available */
+  GHashTable *disk_caches;
+  guint disk_cache_save_id;
+
   int timestamp;
 } GskGLGlyphCache;
 
@@ -72,8 +83,13 @@ struct _GskGLCachedGlyph
   int draw_width;
   int draw_height;
 
-  guint accessed : 1; /* accessed since last check */
-  guint used     : 1; /* accounted as used in the atlas */
+  GlyphCacheKey *key; /* owned by the hash table */
+  GList lru_link;
+  int timestamp;      /* of the frame the glyph was last used in */
+
+  guint in_lru  : 1;
+  guint used    : 1; /* accounted as used in the atlas */
+  guint pending : 1; /* still needs to be uploaded */
 };
 
 
@@ -88,5 +104,6 @@ void                     gsk_gl_glyph_cache_lookup_or_add   (GskGLGlyphCache
                                                              GlyphCacheKey          *lookup,
                                                              GskGLDriver            *driver,
                                                              const GskGLCachedGlyph **cached_glyph_out);
+void                     gsk_gl_glyph_cache_upload_pending  (GskGLGlyphCache        *self);
 
 #endif
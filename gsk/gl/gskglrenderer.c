@@ -23,6 +23,7 @@
 
 #include "gdk/gdkgltextureprivate.h"
 #include "gdk/gdkglcontextprivate.h"
+#include "gdk/gdkmemorytextureprivate.h"
 #include "gdk/gdkprofilerprivate.h"
 #include "gdk/gdkrgbaprivate.h"
 
@@ -53,6 +54,14 @@
                 g_assert_cmpint (self->program_name ## _program.program_name.uniform_basename ## _location, >, -1); \
               }G_STMT_END
 
+/* For programs that share their uniform layout with another program */
+#define INIT_SHARED_PROGRAM_UNIFORM_LOCATION(program_name, shared_name, uniform_basename) \
+              G_STMT_START{\
+                self->program_name ## _program.shared_name.uniform_basename ## _location = \
+                              glGetUniformLocation(self->program_name ## _program.id, "u_" #uniform_basename);\
+                g_assert_cmpint (self->program_name ## _program.shared_name.uniform_basename ## _location, >, -1); \
+              }G_STMT_END
+
 #define INIT_COMMON_UNIFORM_LOCATION(program_ptr, uniform_basename) \
               G_STMT_START{\
                 program_ptr->uniform_basename ## _location =  \
@@ -78,6 +87,14 @@ typedef struct
   float y2;
 } TextureRegion;
 
+typedef struct
+{
+  graphene_rect_t rect;
+  const GskTransform *modelview;
+  int render_target;
+  guint valid : 1;
+} Occluder;
+
 static inline void
 init_full_texture_region (TextureRegion *r,
                           int            texture_id)
@@ -280,6 +297,7 @@ node_supports_transform (GskRenderNode *node)
       case GSK_TRANSFORM_NODE:
       case GSK_CROSS_FADE_NODE:
       case GSK_LINEAR_GRADIENT_NODE:
+      case GSK_REPEATING_LINEAR_GRADIENT_NODE:
       case GSK_DEBUG_NODE:
       case GSK_TEXT_NODE:
         return TRUE;
@@ -417,6 +435,51 @@ load_offscreen_vertex_data (GskQuadVertex    vertex_data[GL_N_VERTICES],
   vertex_data[5].uv[1] = 1;
 }
 
+static inline void
+load_instance_color (float          color[4],
+                     const GdkRGBA *rgba)
+{
+  color[0] = rgba->red;
+  color[1] = rgba->green;
+  color[2] = rgba->blue;
+  color[3] = rgba->alpha;
+}
+
+/* Like load_vertex_data_with_region(), for the instanced programs.
+ * @r and @color may be %NULL if the program doesn't use them. */
+static inline void
+load_instance_data (GskQuadInstance     *instance,
+                    GskRenderNode       *node,
+                    RenderOpBuilder     *builder,
+                    const TextureRegion *r,
+                    const GdkRGBA       *color)
+{
+  instance->rect[0] = builder->dx + node->bounds.origin.x;
+  instance->rect[1] = builder->dy + node->bounds.origin.y;
+  instance->rect[2] = node->bounds.size.width;
+  instance->rect[3] = node->bounds.size.height;
+
+  if (r)
+    {
+      instance->uv[0] = r->x;
+      instance->uv[1] = r->y;
+      instance->uv[2] = r->x2;
+      instance->uv[3] = r->y2;
+    }
+  else
+    {
+      instance->uv[0] = 0;
+      instance->uv[1] = 0;
+      instance->uv[2] = 1;
+      instance->uv[3] = 1;
+    }
+
+  if (color)
+    load_instance_color (instance->color, color);
+  else
+    memset (instance->color, 0, sizeof (instance->color));
+}
+
 static void gsk_gl_renderer_setup_render_mode (GskGLRenderer   *self);
 static gboolean add_offscreen_ops             (GskGLRenderer   *self,
                                                RenderOpBuilder       *builder,
@@ -439,6 +502,9 @@ struct _GskGLRenderer
   GskGLDriver *gl_driver;
   GskGLProfiler *gl_profiler;
 
+  /* Whether we can expand quads from per-instance data */
+  guint has_instancing : 1;
+
   union {
     Program programs[GL_N_PROGRAMS];
     struct {
@@ -449,11 +515,18 @@ struct _GskGLRenderer
       Program color_matrix_program;
       Program color_program;
       Program coloring_program;
+      Program conic_gradient_program;
       Program cross_fade_program;
       Program inset_shadow_program;
+      Program instanced_blit_program;
+      Program instanced_color_program;
+      Program instanced_coloring_program;
       Program linear_gradient_program;
       Program outset_shadow_program;
+      Program radial_gradient_program;
       Program repeat_program;
+      Program repeating_linear_gradient_program;
+      Program repeating_radial_gradient_program;
       Program unblurred_outset_shadow_program;
     };
   };
@@ -465,9 +538,17 @@ struct _GskGLRenderer
   GskGLIconCache *icon_cache;
   GskGLShadowCache shadow_cache;
 
+  /* Opaque content drawn after the current subtree */
+  Occluder occluder;
+  /* Per-child occluders of the containers being rendered */
+  GArray *child_occluders;
+
 #ifdef G_ENABLE_DEBUG
   struct {
     GQuark frames;
+    GQuark draw_calls;
+    GQuark merged_draw_calls;
+    GQuark culled_nodes;
   } profile_counters;
   struct {
     GQuark cpu_time;
@@ -475,7 +556,10 @@ struct _GskGLRenderer
   } profile_timers;
 #endif
 
+  /* The area to redraw, or %NULL for the whole surface. Each of its
+   * rectangles is drawn separately, scissored to render_rect */
   cairo_region_t *render_region;
+  cairo_rectangle_int_t render_rect;
 };
 
 struct _GskGLRendererClass
@@ -549,35 +633,21 @@ transform_rect (GskGLRenderer        *self,
   return r;
 }
 
-static inline void
-render_fallback_node (GskGLRenderer   *self,
-                      GskRenderNode   *node,
-                      RenderOpBuilder *builder)
+/* Rasterizes @node with cairo and uploads the result to a new texture.
+ * The texture is flipped vertically, i.e. it needs to be drawn
+ * using load_offscreen_vertex_data(). */
+static int
+upload_fallback_texture (GskGLRenderer *self,
+                         GskRenderNode *node,
+                         float          scale,
+                         int            surface_width,
+                         int            surface_height)
 {
-  const float scale = ops_get_scale (builder);
-  const int surface_width = ceilf (node->bounds.size.width) * scale;
-  const int surface_height = ceilf (node->bounds.size.height) * scale;
   cairo_surface_t *surface;
   cairo_surface_t *rendered_surface;
   cairo_t *cr;
-  int cached_id;
   int texture_id;
 
-  if (surface_width <= 0 ||
-      surface_height <= 0)
-    return;
-
-  cached_id = gsk_gl_driver_get_texture_for_pointer (self->gl_driver, node);
-
-  if (cached_id != 0)
-    {
-      ops_set_program (builder, &self->blit_program);
-      ops_set_texture (builder, cached_id);
-      load_offscreen_vertex_data (ops_draw (builder, NULL), node, builder);
-      return;
-    }
-
-
   /* We first draw the recording surface on an image surface,
    * just because the scaleY(-1) later otherwise screws up the
    * rendering... */
@@ -645,7 +715,95 @@ render_fallback_node (GskGLRenderer   *self,
   cairo_surface_destroy (surface);
   cairo_surface_destroy (rendered_surface);
 
-  gsk_gl_driver_set_texture_for_pointer (self->gl_driver, node, texture_id);
+  return texture_id;
+}
+
+/* The drawn contents of @node only depend on the scale, the area
+ * covered by the texture and the clip. Pass %NULL as @clip if
+ * the node was drawn unclipped. */
+static inline void
+init_node_texture_key (GskNodeTextureKey     *key,
+                       GskRenderNode         *node,
+                       float                  scale,
+                       const graphene_rect_t *bounds,
+                       const GskRoundedRect  *clip)
+{
+  key->node = node;
+  key->scale = scale;
+  key->bounds = *bounds;
+
+  if (clip != NULL)
+    key->clip = *clip;
+  else
+    gsk_rounded_rect_init_from_rect (&key->clip, bounds, 0);
+}
+
+static inline void
+render_fallback_node (GskGLRenderer   *self,
+                      GskRenderNode   *node,
+                      RenderOpBuilder *builder)
+{
+  const float scale = ops_get_scale (builder);
+  const int surface_width = ceilf (node->bounds.size.width) * scale;
+  const int surface_height = ceilf (node->bounds.size.height) * scale;
+  GskNodeTextureKey key;
+  int cached_id;
+  int texture_id;
+
+  if (surface_width <= 0 ||
+      surface_height <= 0)
+    return;
+
+  init_node_texture_key (&key, node, scale, &node->bounds, NULL);
+  cached_id = gsk_gl_driver_get_texture_for_node (self->gl_driver, &key);
+
+  if (cached_id != 0)
+    {
+      ops_set_program (builder, &self->blit_program);
+      ops_set_texture (builder, cached_id);
+      load_offscreen_vertex_data (ops_draw (builder, NULL), node, builder);
+      return;
+    }
+
+  texture_id = upload_fallback_texture (self, node, scale, surface_width, surface_height);
+
+  gsk_gl_driver_set_texture_for_node (self->gl_driver, &key, texture_id);
+
+  ops_set_program (builder, &self->blit_program);
+  ops_set_texture (builder, texture_id);
+  load_offscreen_vertex_data (ops_draw (builder, NULL), node, builder);
+}
+
+static inline void
+render_cairo_node (GskGLRenderer   *self,
+                   GskRenderNode   *node,
+                   RenderOpBuilder *builder)
+{
+  const float scale = ops_get_scale (builder);
+  const int surface_width = ceilf (node->bounds.size.width) * scale;
+  const int surface_height = ceilf (node->bounds.size.height) * scale;
+  GskNodeTextureKey key;
+  int texture_id;
+
+  /* Nothing was ever drawn into this node */
+  if (gsk_cairo_node_peek_surface (node) == NULL)
+    return;
+
+  if (surface_width <= 0 ||
+      surface_height <= 0)
+    return;
+
+  /* Cairo nodes are immutable, so as long as the node is still alive, the
+   * texture we rasterized for it last time is still valid. */
+  init_node_texture_key (&key, node, scale, &node->bounds, NULL);
+  texture_id = gsk_gl_driver_get_texture_for_node (self->gl_driver, &key);
+
+  if (texture_id == 0)
+    {
+      texture_id = upload_fallback_texture (self, node, scale, surface_width, surface_height);
+
+      gsk_gl_driver_set_texture_for_node (self->gl_driver, &key, texture_id);
+    }
 
   ops_set_program (builder, &self->blit_program);
   ops_set_texture (builder, texture_id);
@@ -669,11 +827,19 @@ render_text_node (GskGLRenderer   *self,
   int i;
   int x_position = 0;
   GlyphCacheKey lookup;
+  float instance_color[4];
 
   /* If the font has color glyphs, we don't need to recolor anything */
   if (!force_color && gsk_text_node_has_color_glyphs (node))
     {
-      ops_set_program (builder, &self->blit_program);
+      if (self->has_instancing)
+        ops_set_program (builder, &self->instanced_blit_program);
+      else
+        ops_set_program (builder, &self->blit_program);
+    }
+  else if (self->has_instancing)
+    {
+      ops_set_program (builder, &self->instanced_coloring_program);
     }
   else
     {
@@ -681,6 +847,8 @@ render_text_node (GskGLRenderer   *self,
       ops_set_color (builder, color);
     }
 
+  load_instance_color (instance_color, color);
+
   memset (&lookup, 0, sizeof (CacheKeyData));
   lookup.data.font = (PangoFont *)font;
   lookup.data.scale = (guint) (text_scale * 1024);
@@ -721,6 +889,23 @@ render_text_node (GskGLRenderer   *self,
 
       glyph_x = floor (x + cx + 0.125) + glyph->draw_x;
       glyph_y = floor (y + cy + 0.125) + glyph->draw_y;
+
+      if (self->has_instancing)
+        {
+          GskQuadInstance *instance = ops_draw_instance (builder);
+
+          instance->rect[0] = glyph_x;
+          instance->rect[1] = glyph_y;
+          instance->rect[2] = glyph->draw_width;
+          instance->rect[3] = glyph->draw_height;
+          instance->uv[0] = tx;
+          instance->uv[1] = ty;
+          instance->uv[2] = tx2;
+          instance->uv[3] = ty2;
+          memcpy (instance->color, instance_color, sizeof (instance_color));
+          goto next;
+        }
+
       glyph_x2 = glyph_x + glyph->draw_width;
       glyph_y2 = glyph_y + glyph->draw_height;
 
@@ -895,9 +1080,18 @@ render_color_node (GskGLRenderer   *self,
                    GskRenderNode   *node,
                    RenderOpBuilder *builder)
 {
-  ops_set_program (builder, &self->color_program);
-  ops_set_color (builder, gsk_color_node_peek_color (node));
-  load_vertex_data (ops_draw (builder, NULL), node, builder);
+  if (self->has_instancing)
+    {
+      ops_set_program (builder, &self->instanced_color_program);
+      load_instance_data (ops_draw_instance (builder), node, builder,
+                          NULL, gsk_color_node_peek_color (node));
+    }
+  else
+    {
+      ops_set_program (builder, &self->color_program);
+      ops_set_color (builder, gsk_color_node_peek_color (node));
+      load_vertex_data (ops_draw (builder, NULL), node, builder);
+    }
 }
 
 static inline void
@@ -987,13 +1181,22 @@ render_texture_node (GskGLRenderer       *self,
 
       upload_texture (self, texture, &r);
 
-      ops_set_program (builder, &self->blit_program);
-      ops_set_texture (builder, r.texture_id);
+      if (self->has_instancing)
+        {
+          ops_set_program (builder, &self->instanced_blit_program);
+          ops_set_texture (builder, r.texture_id);
+          load_instance_data (ops_draw_instance (builder), node, builder, &r, NULL);
+        }
+      else
+        {
+          ops_set_program (builder, &self->blit_program);
+          ops_set_texture (builder, r.texture_id);
 
-      load_vertex_data_with_region (ops_draw (builder, NULL),
-                                    node, builder,
-                                    &r,
-                                    FALSE);
+          load_vertex_data_with_region (ops_draw (builder, NULL),
+                                        node, builder,
+                                        &r,
+                                        FALSE);
+        }
     }
 }
 
@@ -1140,6 +1343,101 @@ render_linear_gradient_node (GskGLRenderer   *self,
   load_vertex_data (ops_draw (builder, NULL), node, builder);
 }
 
+static inline void
+render_repeating_linear_gradient_node (GskGLRenderer   *self,
+                                       GskRenderNode   *node,
+                                       RenderOpBuilder *builder)
+{
+  const int n_color_stops = gsk_linear_gradient_node_get_n_color_stops (node);
+  const GskColorStop *stops = gsk_linear_gradient_node_peek_color_stops (node);
+  const graphene_point_t *start = gsk_linear_gradient_node_peek_start (node);
+  const graphene_point_t *end = gsk_linear_gradient_node_peek_end (node);
+  OpLinearGradient *op;
+
+  /* The shader only has room for 8 color stops, and degenerate gradients
+   * don't have a well-defined repeat interval. */
+  if (n_color_stops > 8 ||
+      graphene_point_equal (start, end))
+    {
+      render_fallback_node (self, node, builder);
+      return;
+    }
+
+  ops_set_program (builder, &self->repeating_linear_gradient_program);
+  op = ops_begin (builder, OP_CHANGE_LINEAR_GRADIENT);
+  op->color_stops = stops;
+  op->n_color_stops = n_color_stops;
+  op->start_point.x = start->x + builder->dx;
+  op->start_point.y = start->y + builder->dy;
+  op->end_point.x = end->x + builder->dx;
+  op->end_point.y = end->y + builder->dy;
+
+  load_vertex_data (ops_draw (builder, NULL), node, builder);
+}
+
+static inline void
+render_radial_gradient_node (GskGLRenderer   *self,
+                             GskRenderNode   *node,
+                             RenderOpBuilder *builder)
+{
+  const int n_color_stops = gsk_radial_gradient_node_get_n_color_stops (node);
+  const GskColorStop *stops = gsk_radial_gradient_node_peek_color_stops (node);
+  const graphene_point_t *center = gsk_radial_gradient_node_peek_center (node);
+  OpRadialGradient *op;
+
+  /* The shader only has room for 8 color stops */
+  if (n_color_stops > 8)
+    {
+      render_fallback_node (self, node, builder);
+      return;
+    }
+
+  if (gsk_render_node_get_node_type (node) == GSK_REPEATING_RADIAL_GRADIENT_NODE)
+    ops_set_program (builder, &self->repeating_radial_gradient_program);
+  else
+    ops_set_program (builder, &self->radial_gradient_program);
+
+  op = ops_begin (builder, OP_CHANGE_RADIAL_GRADIENT);
+  op->color_stops = stops;
+  op->n_color_stops = n_color_stops;
+  op->center.x = center->x + builder->dx;
+  op->center.y = center->y + builder->dy;
+  op->hradius = gsk_radial_gradient_node_get_hradius (node);
+  op->vradius = gsk_radial_gradient_node_get_vradius (node);
+  op->start = gsk_radial_gradient_node_get_start (node);
+  op->end = gsk_radial_gradient_node_get_end (node);
+
+  load_vertex_data (ops_draw (builder, NULL), node, builder);
+}
+
+static inline void
+render_conic_gradient_node (GskGLRenderer   *self,
+                            GskRenderNode   *node,
+                            RenderOpBuilder *builder)
+{
+  const int n_color_stops = gsk_conic_gradient_node_get_n_color_stops (node);
+  const GskColorStop *stops = gsk_conic_gradient_node_peek_color_stops (node);
+  const graphene_point_t *center = gsk_conic_gradient_node_peek_center (node);
+  OpConicGradient *op;
+
+  /* The shader only has room for 8 color stops */
+  if (n_color_stops > 8)
+    {
+      render_fallback_node (self, node, builder);
+      return;
+    }
+
+  ops_set_program (builder, &self->conic_gradient_program);
+  op = ops_begin (builder, OP_CHANGE_CONIC_GRADIENT);
+  op->color_stops = stops;
+  op->n_color_stops = n_color_stops;
+  op->center.x = center->x + builder->dx;
+  op->center.y = center->y + builder->dy;
+  op->rotation = gsk_conic_gradient_node_get_rotation (node) * G_PI / 180.f;
+
+  load_vertex_data (ops_draw (builder, NULL), node, builder);
+}
+
 static inline void
 render_clipped_child (GskGLRenderer         *self,
                       RenderOpBuilder       *builder,
@@ -1442,9 +1740,11 @@ render_blur_node (GskGLRenderer   *self,
                   GskRenderNode   *node,
                   RenderOpBuilder *builder)
 {
+  const float scale = ops_get_scale (builder);
   const float blur_radius = gsk_blur_node_get_radius (node);
   GskRenderNode *child = gsk_blur_node_get_child (node);
   TextureRegion blurred_region;
+  GskNodeTextureKey key;
 
   if (node_is_invisible (child))
     return;
@@ -1455,9 +1755,15 @@ render_blur_node (GskGLRenderer   *self,
       return;
     }
 
-  blurred_region.texture_id = gsk_gl_driver_get_texture_for_pointer (self->gl_driver, node);
+  init_node_texture_key (&key, node, scale, &node->bounds, NULL);
+  blurred_region.texture_id = gsk_gl_driver_get_texture_for_node (self->gl_driver, &key);
   if (blurred_region.texture_id == 0)
-    blur_node (self, child, builder, blur_radius, 0, &blurred_region, NULL);
+    {
+      blur_node (self, child, builder, blur_radius, 0, &blurred_region, NULL);
+
+      /* Add to cache for the blur node */
+      gsk_gl_driver_set_texture_for_node (self->gl_driver, &key, blurred_region.texture_id);
+    }
 
   g_assert (blurred_region.texture_id != 0);
 
@@ -1465,9 +1771,6 @@ render_blur_node (GskGLRenderer   *self,
   ops_set_program (builder, &self->blit_program);
   ops_set_texture (builder, blurred_region.texture_id);
   load_offscreen_vertex_data (ops_draw (builder, NULL), node, builder); /* Render result to screen */
-
-  /* Add to cache for the blur node */
-  gsk_gl_driver_set_texture_for_pointer (self->gl_driver, node, blurred_region.texture_id);
 }
 
 static inline void
@@ -1508,6 +1811,7 @@ render_inset_shadow_node (GskGLRenderer   *self,
   float texture_width;
   float texture_height;
   OpShadow *op;
+  GskNodeTextureKey key;
   int blurred_texture_id;
 
   g_assert (blur_radius > 0);
@@ -1515,7 +1819,8 @@ render_inset_shadow_node (GskGLRenderer   *self,
   texture_width = ceilf ((node_outline->bounds.size.width + blur_extra) * scale);
   texture_height = ceilf ((node_outline->bounds.size.height + blur_extra) * scale);
 
-  blurred_texture_id = gsk_gl_driver_get_texture_for_pointer (self->gl_driver, node);
+  init_node_texture_key (&key, node, scale, &node->bounds, NULL);
+  blurred_texture_id = gsk_gl_driver_get_texture_for_node (self->gl_driver, &key);
   if (blurred_texture_id == 0)
     {
       const float spread = gsk_inset_shadow_node_get_spread (node) + (blur_extra / 2.0);
@@ -1599,6 +1904,8 @@ render_inset_shadow_node (GskGLRenderer   *self,
                                          texture_width,
                                          texture_height,
                                          blur_radius * scale);
+
+      gsk_gl_driver_set_texture_for_node (self->gl_driver, &key, blurred_texture_id);
     }
 
   g_assert (blurred_texture_id != 0);
@@ -1612,8 +1919,6 @@ render_inset_shadow_node (GskGLRenderer   *self,
     const float ty1 = blur_extra / 2.0 * scale / texture_height;
     const float ty2 = 1.0 - ty1;
 
-    gsk_gl_driver_set_texture_for_pointer (self->gl_driver, node, blurred_texture_id);
-
     if (needs_clip)
       {
         const GskRoundedRect node_clip = transform_rect (self, builder, node_outline);
@@ -2301,6 +2606,271 @@ render_repeat_node (GskGLRenderer   *self,
                                 is_offscreen);
 }
 
+/* How deep we look into a node to find opaque content */
+#define MAX_OPAQUE_RECT_DEPTH 8
+
+static inline float
+rect_area (const graphene_rect_t *r)
+{
+  return r->size.width * r->size.height;
+}
+
+/* The largest axis-aligned rect inside @clip that isn't affected
+ * by its corners */
+static void
+rounded_rect_get_inner_rect (const GskRoundedRect *clip,
+                             graphene_rect_t      *out_rect)
+{
+  const graphene_rect_t *b = &clip->bounds;
+  const float top = MAX (clip->corner[GSK_CORNER_TOP_LEFT].height, clip->corner[GSK_CORNER_TOP_RIGHT].height);
+  const float right = MAX (clip->corner[GSK_CORNER_TOP_RIGHT].width, clip->corner[GSK_CORNER_BOTTOM_RIGHT].width);
+  const float bottom = MAX (clip->corner[GSK_CORNER_BOTTOM_LEFT].height, clip->corner[GSK_CORNER_BOTTOM_RIGHT].height);
+  const float left = MAX (clip->corner[GSK_CORNER_TOP_LEFT].width, clip->corner[GSK_CORNER_BOTTOM_LEFT].width);
+  graphene_rect_t horizontal, vertical;
+
+  graphene_rect_init (&horizontal,
+                      b->origin.x, b->origin.y + top,
+                      b->size.width, MAX (0, b->size.height - top - bottom));
+  graphene_rect_init (&vertical,
+                      b->origin.x + left, b->origin.y,
+                      MAX (0, b->size.width - left - right), b->size.height);
+
+  *out_rect = rect_area (&horizontal) >= rect_area (&vertical) ? horizontal : vertical;
+}
+
+/* Finds a rect in @node's coordinates that @node paints completely
+ * opaque. This is not necessarily the largest such rect. */
+static gboolean
+node_get_opaque_rect (GskRenderNode   *node,
+                      int              depth,
+                      graphene_rect_t *out_rect)
+{
+  if (depth > MAX_OPAQUE_RECT_DEPTH || node_is_invisible (node))
+    return FALSE;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_COLOR_NODE:
+      if (gsk_color_node_peek_color (node)->alpha < 1.0f)
+        return FALSE;
+
+      *out_rect = node->bounds;
+      return TRUE;
+
+    case GSK_TEXTURE_NODE:
+      {
+        GdkTexture *texture = gsk_texture_node_get_texture (node);
+        GdkMemoryFormat format;
+
+        if (!GDK_IS_MEMORY_TEXTURE (texture))
+          return FALSE;
+
+        format = gdk_memory_texture_get_format (GDK_MEMORY_TEXTURE (texture));
+        if (format != GDK_MEMORY_R8G8B8 && format != GDK_MEMORY_B8G8R8)
+          return FALSE;
+
+        *out_rect = node->bounds;
+        return TRUE;
+      }
+
+    case GSK_CONTAINER_NODE:
+      {
+        gboolean found = FALSE;
+        guint i, p;
+
+        for (i = 0, p = gsk_container_node_get_n_children (node); i < p; i ++)
+          {
+            graphene_rect_t child_rect;
+
+            if (node_get_opaque_rect (gsk_container_node_get_child (node, i), depth + 1, &child_rect) &&
+                (!found || rect_area (&child_rect) > rect_area (out_rect)))
+              {
+                *out_rect = child_rect;
+                found = TRUE;
+              }
+          }
+
+        return found;
+      }
+
+    case GSK_TRANSFORM_NODE:
+      {
+        GskTransform *transform = gsk_transform_node_get_transform (node);
+        graphene_rect_t child_rect;
+
+        /* Only scales and translations keep rects axis-aligned */
+        if (gsk_transform_get_category (transform) < GSK_TRANSFORM_CATEGORY_2D_AFFINE ||
+            !node_get_opaque_rect (gsk_transform_node_get_child (node), depth + 1, &child_rect))
+          return FALSE;
+
+        gsk_transform_transform_bounds (transform, &child_rect, out_rect);
+        return TRUE;
+      }
+
+    case GSK_CLIP_NODE:
+      {
+        graphene_rect_t child_rect;
+
+        if (!node_get_opaque_rect (gsk_clip_node_get_child (node), depth + 1, &child_rect))
+          return FALSE;
+
+        return graphene_rect_intersection (&child_rect, gsk_clip_node_peek_clip (node), out_rect);
+      }
+
+    case GSK_ROUNDED_CLIP_NODE:
+      {
+        graphene_rect_t child_rect, inner_rect;
+
+        if (!node_get_opaque_rect (gsk_rounded_clip_node_get_child (node), depth + 1, &child_rect))
+          return FALSE;
+
+        rounded_rect_get_inner_rect (gsk_rounded_clip_node_peek_clip (node), &inner_rect);
+
+        return graphene_rect_intersection (&child_rect, &inner_rect, out_rect);
+      }
+
+    case GSK_OPACITY_NODE:
+      if (gsk_opacity_node_get_opacity (node) < 1.0f)
+        return FALSE;
+
+      return node_get_opaque_rect (gsk_opacity_node_get_child (node), depth + 1, out_rect);
+
+    case GSK_SHADOW_NODE:
+      /* The child is drawn on top of its shadows */
+      return node_get_opaque_rect (gsk_shadow_node_get_child (node), depth + 1, out_rect);
+
+    case GSK_DEBUG_NODE:
+      return node_get_opaque_rect (gsk_debug_node_get_child (node), depth + 1, out_rect);
+
+    case GSK_NOT_A_RENDER_NODE:
+    case GSK_CAIRO_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+    case GSK_CONIC_GRADIENT_NODE:
+    case GSK_BORDER_NODE:
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+    case GSK_COLOR_MATRIX_NODE:
+    case GSK_REPEAT_NODE:
+    case GSK_BLEND_NODE:
+    case GSK_CROSS_FADE_NODE:
+    case GSK_TEXT_NODE:
+    case GSK_BLUR_NODE:
+    default:
+      return FALSE;
+    }
+}
+
+/* Children of a container that are completely covered by opaque
+ * content drawn after them - either by later siblings or by content
+ * drawn after an ancestor container - are not drawn at all.
+ *
+ * The occluder that applies to the current subtree is kept in the
+ * renderer, in the coordinates of the current modelview and offset.
+ * It is only valid for the modelview and render target it was
+ * created for. */
+static inline void
+render_container_node (GskGLRenderer   *self,
+                       GskRenderNode   *node,
+                       RenderOpBuilder *builder)
+{
+  const guint n_children = gsk_container_node_get_n_children (node);
+  const Occluder saved_occluder = self->occluder;
+  const guint first = self->child_occluders->len;
+  Occluder occluder = { 0, };
+  guint n_culled = 0;
+  guint i;
+
+  if (self->occluder.valid &&
+      self->occluder.modelview == builder->current_modelview &&
+      self->occluder.render_target == builder->current_render_target)
+    {
+      occluder.rect = self->occluder.rect;
+      graphene_rect_offset (&occluder.rect, - builder->dx, - builder->dy);
+      occluder.valid = TRUE;
+    }
+
+  /* Walk back to front to find out what covers each child. Children
+   * are drawn with the current opacity, so they can only cover
+   * other children if that is 1. */
+  g_array_set_size (self->child_occluders, first + n_children);
+  for (i = n_children; i > 0; i --)
+    {
+      GskRenderNode *child = gsk_container_node_get_child (node, i - 1);
+      Occluder *child_occluder = &g_array_index (self->child_occluders, Occluder, first + i - 1);
+      graphene_rect_t opaque_rect;
+
+      *child_occluder = occluder;
+
+      if (occluder.valid &&
+          graphene_rect_contains_rect (&occluder.rect, &child->bounds))
+        continue;
+
+      if (builder->current_opacity >= 1.0f &&
+          node_get_opaque_rect (child, 0, &opaque_rect) &&
+          (!occluder.valid || rect_area (&opaque_rect) > rect_area (&occluder.rect)))
+        {
+          occluder.rect = opaque_rect;
+          occluder.valid = TRUE;
+        }
+    }
+
+  for (i = 0; i < n_children; i ++)
+    {
+      GskRenderNode *child = gsk_container_node_get_child (node, i);
+      const Occluder *child_occluder = &g_array_index (self->child_occluders, Occluder, first + i);
+
+      if (child_occluder->valid &&
+          graphene_rect_contains_rect (&child_occluder->rect, &child->bounds))
+        {
+          n_culled ++;
+          continue;
+        }
+
+      self->occluder.valid = child_occluder->valid;
+      self->occluder.rect = child_occluder->rect;
+      graphene_rect_offset (&self->occluder.rect, builder->dx, builder->dy);
+      self->occluder.modelview = builder->current_modelview;
+      self->occluder.render_target = builder->current_render_target;
+
+      gsk_gl_renderer_add_render_ops (self, child, builder);
+    }
+
+  self->occluder = saved_occluder;
+
+  if (n_culled > 0 &&
+      GSK_RENDERER_DEBUG_CHECK (GSK_RENDERER (self), OCCLUSION))
+    {
+      static const GdkRGBA culled_color = { 1, 0, 1, 0.25 };
+
+      /* Tint the area of culled children on top of what covers them */
+      for (i = 0; i < n_children; i ++)
+        {
+          GskRenderNode *child = gsk_container_node_get_child (node, i);
+          const Occluder *child_occluder = &g_array_index (self->child_occluders, Occluder, first + i);
+
+          if (!child_occluder->valid ||
+              !graphene_rect_contains_rect (&child_occluder->rect, &child->bounds))
+            continue;
+
+          ops_set_program (builder, &self->color_program);
+          ops_set_color (builder, &culled_color);
+          load_vertex_data (ops_draw (builder, NULL), child, builder);
+        }
+    }
+
+  g_array_set_size (self->child_occluders, first);
+
+#ifdef G_ENABLE_DEBUG
+  if (n_culled > 0)
+    gsk_profiler_counter_add (gsk_renderer_get_profiler (GSK_RENDERER (self)),
+                              self->profile_counters.culled_nodes,
+                              n_culled);
+#endif
+}
+
 static inline void
 apply_viewport_op (const Program    *program,
                    const OpViewport *op)
@@ -2472,6 +3042,33 @@ apply_linear_gradient_op (const Program          *program,
   glUniform2f (program->linear_gradient.end_point_location, op->end_point.x, op->end_point.y);
 }
 
+static inline void
+apply_radial_gradient_op (const Program          *program,
+                          const OpRadialGradient *op)
+{
+  OP_PRINT (" -> Radial gradient");
+  glUniform1i (program->radial_gradient.num_color_stops_location, op->n_color_stops);
+  glUniform1fv (program->radial_gradient.color_stops_location,
+                op->n_color_stops * 5,
+                (float *)op->color_stops);
+  glUniform2f (program->radial_gradient.center_location, op->center.x, op->center.y);
+  glUniform2f (program->radial_gradient.radius_location, op->hradius, op->vradius);
+  glUniform2f (program->radial_gradient.range_location, op->start, op->end);
+}
+
+static inline void
+apply_conic_gradient_op (const Program         *program,
+                         const OpConicGradient *op)
+{
+  OP_PRINT (" -> Conic gradient");
+  glUniform1i (program->conic_gradient.num_color_stops_location, op->n_color_stops);
+  glUniform1fv (program->conic_gradient.color_stops_location,
+                op->n_color_stops * 5,
+                (float *)op->color_stops);
+  glUniform2f (program->conic_gradient.center_location, op->center.x, op->center.y);
+  glUniform1f (program->conic_gradient.rotation_location, op->rotation);
+}
+
 static inline void
 apply_border_op (const Program  *program,
                  const OpBorder *op)
@@ -2547,6 +3144,7 @@ gsk_gl_renderer_dispose (GObject *gobject)
   GskGLRenderer *self = GSK_GL_RENDERER (gobject);
 
   ops_free (&self->op_builder);
+  g_clear_pointer (&self->child_occluders, g_array_unref);
 
   G_OBJECT_CLASS (gsk_gl_renderer_parent_class)->dispose (gobject);
 }
@@ -2568,11 +3166,18 @@ gsk_gl_renderer_create_programs (GskGLRenderer  *self,
     { "/org/gtk/libgsk/glsl/color_matrix.glsl",              "color matrix" },
     { "/org/gtk/libgsk/glsl/color.glsl",                     "color" },
     { "/org/gtk/libgsk/glsl/coloring.glsl",                  "coloring" },
+    { "/org/gtk/libgsk/glsl/conic_gradient.glsl",            "conic gradient" },
     { "/org/gtk/libgsk/glsl/cross_fade.glsl",                "cross fade" },
     { "/org/gtk/libgsk/glsl/inset_shadow.glsl",              "inset shadow" },
+    { "/org/gtk/libgsk/glsl/instanced_blit.glsl",            "instanced blit" },
+    { "/org/gtk/libgsk/glsl/instanced_color.glsl",           "instanced color" },
+    { "/org/gtk/libgsk/glsl/instanced_coloring.glsl",        "instanced coloring" },
     { "/org/gtk/libgsk/glsl/linear_gradient.glsl",           "linear gradient" },
     { "/org/gtk/libgsk/glsl/outset_shadow.glsl",             "outset shadow" },
+    { "/org/gtk/libgsk/glsl/radial_gradient.glsl",           "radial gradient" },
     { "/org/gtk/libgsk/glsl/repeat.glsl",                    "repeat" },
+    { "/org/gtk/libgsk/glsl/repeating_linear_gradient.glsl", "repeating linear gradient" },
+    { "/org/gtk/libgsk/glsl/repeating_radial_gradient.glsl", "repeating radial gradient" },
     { "/org/gtk/libgsk/glsl/unblurred_outset_shadow.glsl",   "unblurred_outset shadow" },
   };
   gboolean success = TRUE;
@@ -2651,6 +3256,32 @@ gsk_gl_renderer_create_programs (GskGLRenderer  *self,
   INIT_PROGRAM_UNIFORM_LOCATION (linear_gradient, start_point);
   INIT_PROGRAM_UNIFORM_LOCATION (linear_gradient, end_point);
 
+  /* repeating linear gradient */
+  INIT_SHARED_PROGRAM_UNIFORM_LOCATION (repeating_linear_gradient, linear_gradient, color_stops);
+  INIT_SHARED_PROGRAM_UNIFORM_LOCATION (repeating_linear_gradient, linear_gradient, num_color_stops);
+  INIT_SHARED_PROGRAM_UNIFORM_LOCATION (repeating_linear_gradient, linear_gradient, start_point);
+  INIT_SHARED_PROGRAM_UNIFORM_LOCATION (repeating_linear_gradient, linear_gradient, end_point);
+
+  /* radial gradient */
+  INIT_PROGRAM_UNIFORM_LOCATION (radial_gradient, color_stops);
+  INIT_PROGRAM_UNIFORM_LOCATION (radial_gradient, num_color_stops);
+  INIT_PROGRAM_UNIFORM_LOCATION (radial_gradient, center);
+  INIT_PROGRAM_UNIFORM_LOCATION (radial_gradient, radius);
+  INIT_PROGRAM_UNIFORM_LOCATION (radial_gradient, range);
+
+  /* repeating radial gradient */
+  INIT_SHARED_PROGRAM_UNIFORM_LOCATION (repeating_radial_gradient, radial_gradient, color_stops);
+  INIT_SHARED_PROGRAM_UNIFORM_LOCATION (repeating_radial_gradient, radial_gradient, num_color_stops);
+  INIT_SHARED_PROGRAM_UNIFORM_LOCATION (repeating_radial_gradient, radial_gradient, center);
+  INIT_SHARED_PROGRAM_UNIFORM_LOCATION (repeating_radial_gradient, radial_gradient, radius);
+  INIT_SHARED_PROGRAM_UNIFORM_LOCATION (repeating_radial_gradient, radial_gradient, range);
+
+  /* conic gradient */
+  INIT_PROGRAM_UNIFORM_LOCATION (conic_gradient, color_stops);
+  INIT_PROGRAM_UNIFORM_LOCATION (conic_gradient, num_color_stops);
+  INIT_PROGRAM_UNIFORM_LOCATION (conic_gradient, center);
+  INIT_PROGRAM_UNIFORM_LOCATION (conic_gradient, rotation);
+
   /* blur */
   INIT_PROGRAM_UNIFORM_LOCATION (blur, blur_radius);
   INIT_PROGRAM_UNIFORM_LOCATION (blur, blur_size);
@@ -2794,6 +3425,22 @@ gsk_gl_renderer_realize (GskRenderer  *renderer,
   self->gl_profiler = gsk_gl_profiler_new (self->gl_context);
   self->gl_driver = gsk_gl_driver_new (self->gl_context);
 
+  if (gdk_gl_context_get_use_es (self->gl_context))
+    {
+      int maj, min;
+
+      gdk_gl_context_get_version (self->gl_context, &maj, &min);
+      self->has_instancing = maj >= 3;
+    }
+  else if (!gdk_gl_context_is_legacy (self->gl_context))
+    {
+      self->has_instancing = epoxy_gl_version () >= 33 ||
+                             epoxy_has_gl_extension ("GL_ARB_instanced_arrays");
+    }
+
+  GSK_RENDERER_NOTE (renderer, OPENGL, g_message ("Instanced quads: %s",
+                                                  self->has_instancing ? "yes" : "no"));
+
   GSK_RENDERER_NOTE (renderer, OPENGL, g_message ("Creating buffers and programs"));
   if (!gsk_gl_renderer_create_programs (self, error))
     return FALSE;
@@ -2876,13 +3523,10 @@ gsk_gl_renderer_setup_render_mode (GskGLRenderer *self)
   else
     {
       GdkSurface *surface = gsk_renderer_get_surface (GSK_RENDERER (self));
-      cairo_rectangle_int_t extents;
+      const cairo_rectangle_int_t extents = self->render_rect;
       int surface_height;
 
-      g_assert (cairo_region_num_rectangles (self->render_region) == 1);
-
       surface_height = gdk_surface_get_height (surface) * self->scale_factor;
-      cairo_region_get_rectangle (self->render_region, 0, &extents);
 
       glEnable (GL_SCISSOR_TEST);
       glScissor (extents.x * self->scale_factor,
@@ -2922,16 +3566,7 @@ gsk_gl_renderer_add_render_ops (GskGLRenderer   *self,
       g_assert_not_reached ();
 
     case GSK_CONTAINER_NODE:
-      {
-        guint i, p;
-
-        for (i = 0, p = gsk_container_node_get_n_children (node); i < p; i ++)
-          {
-            GskRenderNode *child = gsk_container_node_get_child (node, i);
-
-            gsk_gl_renderer_add_render_ops (self, child, builder);
-          }
-      }
+      render_container_node (self, node, builder);
     break;
 
     case GSK_DEBUG_NODE:
@@ -3023,7 +3658,22 @@ gsk_gl_renderer_add_render_ops (GskGLRenderer   *self,
     break;
 
     case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+      render_repeating_linear_gradient_node (self, node, builder);
+    break;
+
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+      render_radial_gradient_node (self, node, builder);
+    break;
+
+    case GSK_CONIC_GRADIENT_NODE:
+      render_conic_gradient_node (self, node, builder);
+    break;
+
     case GSK_CAIRO_NODE:
+      render_cairo_node (self, node, builder);
+    break;
+
     default:
       {
         render_fallback_node (self, node, builder);
@@ -3052,6 +3702,8 @@ add_offscreen_ops (GskGLRenderer         *self,
   graphene_matrix_t item_proj;
   float prev_opacity;
   int texture_id = 0;
+  GskNodeTextureKey key;
+  gboolean cache_texture;
 
   if (node_is_invisible (child_node))
     {
@@ -3073,18 +3725,28 @@ add_offscreen_ops (GskGLRenderer         *self,
       return TRUE;
     }
 
+  /* The current opacity ends up in the texture unless we reset it,
+   * and it is not part of the key. */
+  cache_texture = (flags & NO_CACHE_PLZ) == 0 &&
+                  (flags & RESET_OPACITY) != 0;
+
   /* Check if we've already cached the drawn texture. */
-  {
-    const int cached_id = gsk_gl_driver_get_texture_for_pointer (self->gl_driver, child_node);
+  if (cache_texture)
+    {
+      int cached_id;
 
-    if (cached_id != 0)
-      {
-        init_full_texture_region (texture_region_out, cached_id);
-        /* We didn't render it offscreen, but hand out an offscreen texture id */
-        *is_offscreen = TRUE;
-        return TRUE;
-      }
-  }
+      init_node_texture_key (&key, child_node, scale, bounds,
+                             (flags & RESET_CLIP) ? NULL : builder->current_clip);
+      cached_id = gsk_gl_driver_get_texture_for_node (self->gl_driver, &key);
+
+      if (cached_id != 0)
+        {
+          init_full_texture_region (texture_region_out, cached_id);
+          /* We didn't render it offscreen, but hand out an offscreen texture id */
+          *is_offscreen = TRUE;
+          return TRUE;
+        }
+    }
 
   gsk_gl_driver_create_render_target (self->gl_driver, width, height, &texture_id, &render_target);
   gdk_gl_context_label_object_printf (self->gl_context, GL_TEXTURE, texture_id,
@@ -3163,34 +3825,93 @@ add_offscreen_ops (GskGLRenderer         *self,
   *is_offscreen = TRUE;
   init_full_texture_region (texture_region_out, texture_id);
 
-  if ((flags & NO_CACHE_PLZ) == 0)
-    gsk_gl_driver_set_texture_for_pointer (self->gl_driver, child_node, texture_id);
+  if (cache_texture)
+    gsk_gl_driver_set_texture_for_node (self->gl_driver, &key, texture_id);
 
   return TRUE;
 }
 
+/* Without glDrawArraysInstancedBaseInstance(), we need to point
+ * the per-instance attributes at the first instance of each draw */
 static void
-gsk_gl_renderer_render_ops (GskGLRenderer *self)
+set_instance_attrib_pointers (gsize first_instance)
 {
-  const Program *program = NULL;
-  const gsize vertex_data_size = self->op_builder.vertices->len * sizeof (GskQuadVertex);
-  const float *vertex_data = (float *)self->op_builder.vertices->data;
-  OpBufferIter iter;
-  OpKind kind;
-  gpointer ptr;
-  GLuint buffer_id, vao_id;
+  const gsize offset = first_instance * sizeof (GskQuadInstance);
+
+  glVertexAttribPointer (2, 4, GL_FLOAT, GL_FALSE,
+                         sizeof (GskQuadInstance),
+                         (void *) (offset + G_STRUCT_OFFSET (GskQuadInstance, rect)));
+  glVertexAttribPointer (3, 4, GL_FLOAT, GL_FALSE,
+                         sizeof (GskQuadInstance),
+                         (void *) (offset + G_STRUCT_OFFSET (GskQuadInstance, uv)));
+  glVertexAttribPointer (4, 4, GL_FLOAT, GL_FALSE,
+                         sizeof (GskQuadInstance),
+                         (void *) (offset + G_STRUCT_OFFSET (GskQuadInstance, color)));
+}
 
-#if DEBUG_OPS
-  g_print ("============================================\n");
-#endif
+static void
+apply_draw_instanced_op (const Program         *program,
+                         const OpDrawInstanced *op,
+                         gsize                  unit_quad_offset)
+{
+  OP_PRINT (" -> draw %" G_GSIZE_FORMAT " instances from %" G_GSIZE_FORMAT ", program %d\n",
+            op->n_instances, op->instance_offset, program->index);
+
+  glEnableVertexAttribArray (2);
+  glEnableVertexAttribArray (3);
+  glEnableVertexAttribArray (4);
+  set_instance_attrib_pointers (op->instance_offset);
 
-  glGenVertexArrays (1, &vao_id);
-  glBindVertexArray (vao_id);
+  glDrawArraysInstanced (GL_TRIANGLES, unit_quad_offset, GL_N_VERTICES, op->n_instances);
 
-  glGenBuffers (1, &buffer_id);
-  glBindBuffer (GL_ARRAY_BUFFER, buffer_id);
+  glDisableVertexAttribArray (2);
+  glDisableVertexAttribArray (3);
+  glDisableVertexAttribArray (4);
+}
+
+/* Adds the quad all instances are expanded from to the vertex data
+ * and returns its offset */
+static gsize
+add_unit_quad (GskGLRenderer *self)
+{
+  static const GskQuadVertex unit_quad[GL_N_VERTICES] = {
+    { { 0, 0 }, { 0, 0 }, },
+    { { 0, 1 }, { 0, 1 }, },
+    { { 1, 0 }, { 1, 0 }, },
+
+    { { 1, 1 }, { 1, 1 }, },
+    { { 0, 1 }, { 0, 1 }, },
+    { { 1, 0 }, { 1, 0 }, },
+  };
+  const gsize offset = self->op_builder.vertices->len;
+
+  g_array_append_vals (self->op_builder.vertices, unit_quad, GL_N_VERTICES);
+
+  return offset;
+}
 
-  glBufferData (GL_ARRAY_BUFFER, vertex_data_size, vertex_data, GL_STATIC_DRAW);
+typedef struct {
+  GLuint vao_id;
+  GLuint buffer_id;
+  GLuint instance_buffer_id;
+} OpsBuffers;
+
+static void
+gsk_gl_renderer_upload_ops_buffers (GskGLRenderer *self,
+                                    OpsBuffers    *buffers)
+{
+  const gboolean has_instances = self->op_builder.instances->len > 0;
+
+  glGenVertexArrays (1, &buffers->vao_id);
+  glBindVertexArray (buffers->vao_id);
+
+  glGenBuffers (1, &buffers->buffer_id);
+  glBindBuffer (GL_ARRAY_BUFFER, buffers->buffer_id);
+
+  glBufferData (GL_ARRAY_BUFFER,
+                self->op_builder.vertices->len * sizeof (GskQuadVertex),
+                self->op_builder.vertices->data,
+                GL_STATIC_DRAW);
 
   /* 0 = position location */
   glEnableVertexAttribArray (0);
@@ -3203,12 +3924,73 @@ gsk_gl_renderer_render_ops (GskGLRenderer *self)
                          sizeof (GskQuadVertex),
                          (void *) G_STRUCT_OFFSET (GskQuadVertex, uv));
 
+  buffers->instance_buffer_id = 0;
+  if (has_instances)
+    {
+      glGenBuffers (1, &buffers->instance_buffer_id);
+      glBindBuffer (GL_ARRAY_BUFFER, buffers->instance_buffer_id);
+
+      glBufferData (GL_ARRAY_BUFFER,
+                    self->op_builder.instances->len * sizeof (GskQuadInstance),
+                    self->op_builder.instances->data,
+                    GL_STATIC_DRAW);
+
+      /* 2 = instance rect, 3 = instance uv, 4 = instance color location.
+       * They are only enabled for the instanced draws, the other draws
+       * use the same vertex array. */
+      glVertexAttribDivisor (2, 1);
+      glVertexAttribDivisor (3, 1);
+      glVertexAttribDivisor (4, 1);
+    }
+}
+
+static void
+gsk_gl_renderer_free_ops_buffers (GskGLRenderer *self,
+                                  OpsBuffers    *buffers)
+{
+  glDeleteVertexArrays (1, &buffers->vao_id);
+  glDeleteBuffers (1, &buffers->buffer_id);
+
+  if (buffers->instance_buffer_id != 0)
+    glDeleteBuffers (1, &buffers->instance_buffer_id);
+}
+
+/* Which draws gsk_gl_renderer_render_ops() executes. State changes
+ * are always applied, so that every pass sees the same state. */
+typedef enum {
+  RENDER_ALL,
+  RENDER_OFFSCREENS,  /* only draws into offscreen render targets */
+  RENDER_FRAMEBUFFER, /* only draws into @fbo_id */
+} RenderPass;
+
+static void
+gsk_gl_renderer_render_ops (GskGLRenderer *self,
+                            gsize          unit_quad_offset,
+                            int            fbo_id,
+                            RenderPass     pass)
+{
+  const Program *program = NULL;
+  gboolean offscreen = FALSE;
+  OpBufferIter iter;
+  OpKind kind;
+  gpointer ptr;
+
+#if DEBUG_OPS
+  g_print ("============================================\n");
+#endif
+
   op_buffer_iter_init (&iter, ops_get_buffer (&self->op_builder));
   while ((ptr = op_buffer_iter_next (&iter, &kind)))
     {
       if (kind == OP_NONE)
         continue;
 
+      if ((kind == OP_DRAW || kind == OP_DRAW_INSTANCED ||
+           kind == OP_CLEAR || kind == OP_DUMP_FRAMEBUFFER) &&
+          ((pass == RENDER_OFFSCREENS && !offscreen) ||
+           (pass == RENDER_FRAMEBUFFER && offscreen)))
+        continue;
+
       if (program == NULL &&
           kind != OP_PUSH_DEBUG_GROUP &&
           kind != OP_POP_DEBUG_GROUP &&
@@ -3238,8 +4020,17 @@ gsk_gl_renderer_render_ops (GskGLRenderer *self)
           }
 
         case OP_CHANGE_RENDER_TARGET:
-          apply_render_target_op (self, program, ptr);
-          break;
+          {
+            const OpRenderTarget *op = ptr;
+
+            offscreen = op->render_target_id != fbo_id;
+            /* Nothing gets drawn into offscreens in this pass */
+            if (pass == RENDER_FRAMEBUFFER && offscreen)
+              break;
+
+            apply_render_target_op (self, program, op);
+            break;
+          }
 
         case OP_CLEAR:
           glClearColor (0, 0, 0, 0);
@@ -3290,6 +4081,14 @@ gsk_gl_renderer_render_ops (GskGLRenderer *self)
           apply_linear_gradient_op (program, ptr);
           break;
 
+        case OP_CHANGE_RADIAL_GRADIENT:
+          apply_radial_gradient_op (program, ptr);
+          break;
+
+        case OP_CHANGE_CONIC_GRADIENT:
+          apply_conic_gradient_op (program, ptr);
+          break;
+
         case OP_CHANGE_BLUR:
           apply_blur_op (program, ptr);
           break;
@@ -3328,6 +4127,10 @@ gsk_gl_renderer_render_ops (GskGLRenderer *self)
             break;
           }
 
+        case OP_DRAW_INSTANCED:
+          apply_draw_instanced_op (program, ptr, unit_quad_offset);
+          break;
+
         case OP_DUMP_FRAMEBUFFER:
           {
             const OpDumpFrameBuffer *op = ptr;
@@ -3356,9 +4159,6 @@ gsk_gl_renderer_render_ops (GskGLRenderer *self)
 
       OP_PRINT ("\n");
     }
-
-  glDeleteVertexArrays (1, &vao_id);
-  glDeleteBuffers (1, &buffer_id);
 }
 
 static void
@@ -3375,6 +4175,11 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
   gint64 gpu_time, cpu_time, start_time;
 #endif
   GPtrArray *removed;
+  guint n_draws;
+  guint n_merged_draws G_GNUC_UNUSED;
+  gsize unit_quad_offset = 0;
+  OpsBuffers buffers;
+  int n_rects, i;
 
 #ifdef G_ENABLE_DEBUG
   profiler = gsk_renderer_get_profiler (renderer);
@@ -3445,12 +4250,21 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
   gsk_gl_renderer_add_render_ops (self, root, &self->op_builder);
   gdk_gl_context_pop_debug_group (self->gl_context);
 
+  /* Glyphs that were missing from the cache while adding the ops
+   * get rendered in parallel here, before anything uses them */
+  gsk_gl_glyph_cache_upload_pending (self->glyph_cache);
+
   /* We correctly reset the state everywhere */
   g_assert_cmpint (self->op_builder.current_render_target, ==, fbo_id);
   ops_pop_modelview (&self->op_builder);
   ops_pop_clip (&self->op_builder);
   ops_finish (&self->op_builder);
 
+  n_merged_draws = ops_merge_draws (&self->op_builder, &n_draws);
+
+  if (self->op_builder.instances->len > 0)
+    unit_quad_offset = add_unit_quad (self);
+
   /*g_message ("Ops: %u", self->render_ops->len);*/
 
   /* Now actually draw things... */
@@ -3459,13 +4273,7 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
   gsk_profiler_timer_begin (profiler, self->profile_timers.cpu_time);
 #endif
 
-  /* Actually do the rendering */
-  if (fbo_id != 0)
-    glBindFramebuffer (GL_FRAMEBUFFER, fbo_id);
-
-  glViewport (0, 0, ceilf (viewport->size.width), ceilf (viewport->size.height));
-  gsk_gl_renderer_setup_render_mode (self);
-  gsk_gl_renderer_clear (self);
+  gsk_gl_renderer_upload_ops_buffers (self, &buffers);
 
   glEnable (GL_DEPTH_TEST);
   glDepthFunc (GL_LEQUAL);
@@ -3475,12 +4283,41 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
   glBlendFunc (GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
   glBlendEquation (GL_FUNC_ADD);
 
-  gdk_gl_context_push_debug_group (self->gl_context, "Rendering ops");
-  gsk_gl_renderer_render_ops (self);
-  gdk_gl_context_pop_debug_group (self->gl_context);
+  /* Actually do the rendering. With several damaged rectangles, the
+   * offscreens are drawn once, and the draws into the framebuffer
+   * are repeated for each rectangle, scissored to it. */
+  n_rects = self->render_region ? cairo_region_num_rectangles (self->render_region) : 1;
+  if (n_rects > 1)
+    {
+      gdk_gl_context_push_debug_group (self->gl_context, "Rendering offscreens");
+      gsk_gl_renderer_render_ops (self, unit_quad_offset, fbo_id, RENDER_OFFSCREENS);
+      gdk_gl_context_pop_debug_group (self->gl_context);
+    }
+
+  for (i = 0; i < n_rects; i ++)
+    {
+      if (self->render_region)
+        cairo_region_get_rectangle (self->render_region, i, &self->render_rect);
+
+      if (fbo_id != 0)
+        glBindFramebuffer (GL_FRAMEBUFFER, fbo_id);
+
+      glViewport (0, 0, ceilf (viewport->size.width), ceilf (viewport->size.height));
+      gsk_gl_renderer_setup_render_mode (self);
+      gsk_gl_renderer_clear (self);
+
+      gdk_gl_context_push_debug_group (self->gl_context, "Rendering ops");
+      gsk_gl_renderer_render_ops (self, unit_quad_offset, fbo_id,
+                                  n_rects > 1 ? RENDER_FRAMEBUFFER : RENDER_ALL);
+      gdk_gl_context_pop_debug_group (self->gl_context);
+    }
+
+  gsk_gl_renderer_free_ops_buffers (self, &buffers);
 
 #ifdef G_ENABLE_DEBUG
   gsk_profiler_counter_inc (profiler, self->profile_counters.frames);
+  gsk_profiler_counter_set (profiler, self->profile_counters.draw_calls, n_draws);
+  gsk_profiler_counter_set (profiler, self->profile_counters.merged_draw_calls, n_merged_draws);
 
   start_time = gsk_profiler_timer_get_start (profiler, self->profile_timers.cpu_time);
   cpu_time = gsk_profiler_timer_end (profiler, self->profile_timers.cpu_time);
@@ -3556,6 +4393,32 @@ gsk_gl_renderer_render_texture (GskRenderer           *renderer,
   return texture;
 }
 
+/* Small damaged areas far apart, like a blinking cursor and a spinner,
+ * are cheaper to draw one by one than by drawing their extents */
+#define MAX_RENDER_RECTANGLES 4
+
+static gboolean
+should_render_rectangles_separately (const cairo_region_t        *damage,
+                                     const cairo_rectangle_int_t *extents)
+{
+  const int n_rects = cairo_region_num_rectangles (damage);
+  gint64 area = 0;
+  int i;
+
+  if (n_rects < 2 || n_rects > MAX_RENDER_RECTANGLES)
+    return FALSE;
+
+  for (i = 0; i < n_rects; i ++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (damage, i, &rect);
+      area += (gint64) rect.width * rect.height;
+    }
+
+  return area * 2 < (gint64) extents->width * extents->height;
+}
+
 static void
 gsk_gl_renderer_render (GskRenderer          *renderer,
                         GskRenderNode        *root,
@@ -3575,10 +4438,11 @@ gsk_gl_renderer_render (GskRenderer          *renderer,
                                           "Render root node %p", root);
 
   surface = gsk_renderer_get_surface (renderer);
+  /* The damage is in surface coordinates */
   whole_surface = (GdkRectangle) {
                       0, 0,
-                      gdk_surface_get_width (surface) * self->scale_factor,
-                      gdk_surface_get_height (surface) * self->scale_factor
+                      gdk_surface_get_width (surface),
+                      gdk_surface_get_height (surface)
                   };
 
   gdk_draw_context_begin_frame (GDK_DRAW_CONTEXT (self->gl_context),
@@ -3598,6 +4462,8 @@ gsk_gl_renderer_render (GskRenderer          *renderer,
 
       if (gdk_rectangle_equal (&extents, &whole_surface))
         self->render_region = NULL;
+      else if (should_render_rectangles_separately (damage, &extents))
+        self->render_region = cairo_region_copy (damage);
       else
         self->render_region = cairo_region_create_rectangle (&extents);
     }
@@ -3646,11 +4512,16 @@ gsk_gl_renderer_init (GskGLRenderer *self)
   ops_init (&self->op_builder);
   self->op_builder.renderer = self;
 
+  self->child_occluders = g_array_new (FALSE, FALSE, sizeof (Occluder));
+
 #ifdef G_ENABLE_DEBUG
   {
     GskProfiler *profiler = gsk_renderer_get_profiler (GSK_RENDERER (self));
 
     self->profile_counters.frames = gsk_profiler_add_counter (profiler, "frames", "Frames", FALSE);
+    self->profile_counters.draw_calls = gsk_profiler_add_counter (profiler, "draw-calls", "Draw calls before merging", TRUE);
+    self->profile_counters.merged_draw_calls = gsk_profiler_add_counter (profiler, "merged-draw-calls", "Draw calls after merging", TRUE);
+    self->profile_counters.culled_nodes = gsk_profiler_add_counter (profiler, "culled-nodes", "Occluded nodes", TRUE);
 
     self->profile_timers.cpu_time = gsk_profiler_add_timer (profiler, "cpu-time", "CPU time", FALSE, TRUE);
     self->profile_timers.gpu_time = gsk_profiler_add_timer (profiler, "gpu-time", "GPU time", FALSE, TRUE);
@@ -202,6 +202,7 @@ ops_init (RenderOpBuilder *builder)
 
   op_buffer_init (&builder->render_ops);
   builder->vertices = g_array_new (FALSE, TRUE, sizeof (GskQuadVertex));
+  builder->instances = g_array_new (FALSE, TRUE, sizeof (GskQuadInstance));
 
   for (i = 0; i < GL_N_PROGRAMS; i ++)
     {
@@ -220,6 +221,7 @@ ops_free (RenderOpBuilder *builder)
     }
 
   g_array_unref (builder->vertices);
+  g_array_unref (builder->instances);
   op_buffer_destroy (&builder->render_ops);
 }
 
@@ -726,6 +728,28 @@ ops_draw (RenderOpBuilder     *builder,
   return &g_array_index (builder->vertices, GskQuadVertex, builder->vertices->len - GL_N_VERTICES);
 }
 
+/* Adds one instance to the current instanced draw, the quad
+ * is expanded by the vertex shader of the current program. */
+GskQuadInstance *
+ops_draw_instance (RenderOpBuilder *builder)
+{
+  OpDrawInstanced *op;
+
+  if ((op = op_buffer_peek_tail_checked (&builder->render_ops, OP_DRAW_INSTANCED)))
+    {
+      op->n_instances ++;
+    }
+  else
+    {
+      op = op_buffer_add (&builder->render_ops, OP_DRAW_INSTANCED);
+      op->instance_offset = builder->instances->len;
+      op->n_instances = 1;
+    }
+
+  g_array_set_size (builder->instances, builder->instances->len + 1);
+  return &g_array_index (builder->instances, GskQuadInstance, builder->instances->len - 1);
+}
+
 /* The offset is only valid for the current modelview.
  * Setting a new modelview will add the offset to that matrix
  * and reset the internal offset to 0. */
@@ -750,6 +774,7 @@ ops_reset (RenderOpBuilder *builder)
 {
   op_buffer_clear (&builder->render_ops);
   g_array_set_size (builder->vertices, 0);
+  g_array_set_size (builder->instances, 0);
 }
 
 OpBuffer *
@@ -757,3 +782,509 @@ ops_get_buffer (RenderOpBuilder *builder)
 {
   return &builder->render_ops;
 }
+
+/* Draw merging
+ *
+ * Many nodes end up as a handful of quads drawn with their own program
+ * state, so a list of rows with different background colors alternates
+ * between a few states. After the ops for a frame have been collected,
+ * we look for earlier draws in the same render target that use the
+ * exact same GL state and move the vertices of later draws into them,
+ * as long as that doesn't move them across anything they overlap.
+ */
+
+/* How many earlier draws we look at when trying to merge a draw */
+#define MAX_MERGE_DISTANCE 64
+
+enum {
+  SLOT_PROJECTION,
+  SLOT_MODELVIEW,
+  SLOT_VIEWPORT,
+  SLOT_CLIP,
+  SLOT_OPACITY,
+  SLOT_COLOR,
+  SLOT_COLOR_MATRIX,
+  SLOT_GRADIENT,
+  SLOT_BLUR,
+  SLOT_SHADOW,
+  SLOT_BORDER,
+  SLOT_BORDER_COLOR,
+  SLOT_BORDER_WIDTH,
+  SLOT_CROSS_FADE,
+  SLOT_BLEND,
+  SLOT_REPEAT,
+  N_STATE_SLOTS
+};
+
+typedef struct
+{
+  OpKind kind;
+  gconstpointer data;
+} StateOp;
+
+typedef struct
+{
+  OpDraw *op;
+  int program;
+  int texture;
+  StateOp state[N_STATE_SLOTS];
+  graphene_rect_t bounds;
+  int next; /* Draw merged after this one, or -1 */
+  int last; /* Last draw merged into this one */
+  guint has_bounds : 1;
+  guint merged : 1;
+} DrawInfo;
+
+static int
+state_slot (OpKind kind)
+{
+  switch (kind)
+    {
+    case OP_CHANGE_PROJECTION:              return SLOT_PROJECTION;
+    case OP_CHANGE_MODELVIEW:               return SLOT_MODELVIEW;
+    case OP_CHANGE_VIEWPORT:                return SLOT_VIEWPORT;
+    case OP_CHANGE_CLIP:                    return SLOT_CLIP;
+    case OP_CHANGE_OPACITY:                 return SLOT_OPACITY;
+    case OP_CHANGE_COLOR:                   return SLOT_COLOR;
+    case OP_CHANGE_COLOR_MATRIX:            return SLOT_COLOR_MATRIX;
+    case OP_CHANGE_LINEAR_GRADIENT:
+    case OP_CHANGE_RADIAL_GRADIENT:
+    case OP_CHANGE_CONIC_GRADIENT:          return SLOT_GRADIENT;
+    case OP_CHANGE_BLUR:                    return SLOT_BLUR;
+    case OP_CHANGE_INSET_SHADOW:
+    case OP_CHANGE_OUTSET_SHADOW:
+    case OP_CHANGE_UNBLURRED_OUTSET_SHADOW: return SLOT_SHADOW;
+    case OP_CHANGE_BORDER:                  return SLOT_BORDER;
+    case OP_CHANGE_BORDER_COLOR:            return SLOT_BORDER_COLOR;
+    case OP_CHANGE_BORDER_WIDTH:            return SLOT_BORDER_WIDTH;
+    case OP_CHANGE_CROSS_FADE:              return SLOT_CROSS_FADE;
+    case OP_CHANGE_BLEND:                   return SLOT_BLEND;
+    case OP_CHANGE_REPEAT:                  return SLOT_REPEAT;
+    case OP_NONE:
+    case OP_CHANGE_PROGRAM:
+    case OP_CHANGE_RENDER_TARGET:
+    case OP_CHANGE_SOURCE_TEXTURE:
+    case OP_CLEAR:
+    case OP_DRAW:
+    case OP_DRAW_INSTANCED:
+    case OP_DUMP_FRAMEBUFFER:
+    case OP_PUSH_DEBUG_GROUP:
+    case OP_POP_DEBUG_GROUP:
+    case OP_LAST:
+    default:
+      return -1;
+    }
+}
+
+static gboolean
+color_stops_equal (const GskColorStop *stops1,
+                   const GskColorStop *stops2,
+                   int                 n_stops)
+{
+  return stops1 == stops2 ||
+         memcmp (stops1, stops2, sizeof (GskColorStop) * n_stops) == 0;
+}
+
+/* Whether the two ops result in the same GL state. Only the fields
+ * that are uploaded by the renderer are compared, the others might
+ * not be initialized. */
+static gboolean
+state_op_equal (const StateOp *s1,
+                const StateOp *s2)
+{
+  if (s1->data == s2->data)
+    return TRUE;
+
+  if (s1->data == NULL || s2->data == NULL || s1->kind != s2->kind)
+    return FALSE;
+
+  switch (s1->kind)
+    {
+    case OP_CHANGE_PROJECTION:
+    case OP_CHANGE_MODELVIEW:
+      return memcmp (&((const OpMatrix *)s1->data)->matrix,
+                     &((const OpMatrix *)s2->data)->matrix,
+                     sizeof (graphene_matrix_t)) == 0;
+
+    case OP_CHANGE_VIEWPORT:
+      return memcmp (&((const OpViewport *)s1->data)->viewport,
+                     &((const OpViewport *)s2->data)->viewport,
+                     sizeof (graphene_rect_t)) == 0;
+
+    case OP_CHANGE_CLIP:
+      /* Corners that aren't sent are known to be unchanged */
+      return memcmp (&((const OpClip *)s1->data)->clip,
+                     &((const OpClip *)s2->data)->clip,
+                     sizeof (GskRoundedRect)) == 0;
+
+    case OP_CHANGE_OPACITY:
+      return ((const OpOpacity *)s1->data)->opacity == ((const OpOpacity *)s2->data)->opacity;
+
+    case OP_CHANGE_COLOR:
+      return gdk_rgba_equal (((const OpColor *)s1->data)->rgba,
+                             ((const OpColor *)s2->data)->rgba);
+
+    case OP_CHANGE_COLOR_MATRIX:
+      {
+        const OpColorMatrix *op1 = s1->data;
+        const OpColorMatrix *op2 = s2->data;
+
+        return memcmp (op1->matrix, op2->matrix, sizeof (graphene_matrix_t)) == 0 &&
+               memcmp (op1->offset, op2->offset, sizeof (graphene_vec4_t)) == 0;
+      }
+
+    case OP_CHANGE_LINEAR_GRADIENT:
+      {
+        const OpLinearGradient *op1 = s1->data;
+        const OpLinearGradient *op2 = s2->data;
+
+        return op1->n_color_stops == op2->n_color_stops &&
+               graphene_point_equal (&op1->start_point, &op2->start_point) &&
+               graphene_point_equal (&op1->end_point, &op2->end_point) &&
+               color_stops_equal (op1->color_stops, op2->color_stops, op1->n_color_stops);
+      }
+
+    case OP_CHANGE_RADIAL_GRADIENT:
+      {
+        const OpRadialGradient *op1 = s1->data;
+        const OpRadialGradient *op2 = s2->data;
+
+        return op1->n_color_stops == op2->n_color_stops &&
+               graphene_point_equal (&op1->center, &op2->center) &&
+               op1->hradius == op2->hradius &&
+               op1->vradius == op2->vradius &&
+               op1->start == op2->start &&
+               op1->end == op2->end &&
+               color_stops_equal (op1->color_stops, op2->color_stops, op1->n_color_stops);
+      }
+
+    case OP_CHANGE_CONIC_GRADIENT:
+      {
+        const OpConicGradient *op1 = s1->data;
+        const OpConicGradient *op2 = s2->data;
+
+        return op1->n_color_stops == op2->n_color_stops &&
+               graphene_point_equal (&op1->center, &op2->center) &&
+               op1->rotation == op2->rotation &&
+               color_stops_equal (op1->color_stops, op2->color_stops, op1->n_color_stops);
+      }
+
+    case OP_CHANGE_BLUR:
+      {
+        const OpBlur *op1 = s1->data;
+        const OpBlur *op2 = s2->data;
+
+        return op1->radius == op2->radius &&
+               op1->size.width == op2->size.width &&
+               op1->size.height == op2->size.height &&
+               op1->dir[0] == op2->dir[0] &&
+               op1->dir[1] == op2->dir[1];
+      }
+
+    case OP_CHANGE_OUTSET_SHADOW:
+      return rounded_rect_equal (&((const OpShadow *)s1->data)->outline,
+                                 &((const OpShadow *)s2->data)->outline);
+
+    case OP_CHANGE_INSET_SHADOW:
+    case OP_CHANGE_UNBLURRED_OUTSET_SHADOW:
+      {
+        const OpShadow *op1 = s1->data;
+        const OpShadow *op2 = s2->data;
+
+        return rounded_rect_equal (&op1->outline, &op2->outline) &&
+               op1->spread == op2->spread &&
+               op1->offset[0] == op2->offset[0] &&
+               op1->offset[1] == op2->offset[1] &&
+               gdk_rgba_equal (op1->color, op2->color);
+      }
+
+    case OP_CHANGE_BORDER:
+      return rounded_rect_equal (&((const OpBorder *)s1->data)->outline,
+                                 &((const OpBorder *)s2->data)->outline);
+
+    case OP_CHANGE_BORDER_COLOR:
+      return gdk_rgba_equal (((const OpBorder *)s1->data)->color,
+                             ((const OpBorder *)s2->data)->color);
+
+    case OP_CHANGE_BORDER_WIDTH:
+      return memcmp (((const OpBorder *)s1->data)->widths,
+                     ((const OpBorder *)s2->data)->widths,
+                     sizeof (float) * 4) == 0;
+
+    case OP_CHANGE_CROSS_FADE:
+      {
+        const OpCrossFade *op1 = s1->data;
+        const OpCrossFade *op2 = s2->data;
+
+        return op1->progress == op2->progress && op1->source2 == op2->source2;
+      }
+
+    case OP_CHANGE_BLEND:
+      {
+        const OpBlend *op1 = s1->data;
+        const OpBlend *op2 = s2->data;
+
+        return op1->mode == op2->mode && op1->source2 == op2->source2;
+      }
+
+    case OP_CHANGE_REPEAT:
+      {
+        const OpRepeat *op1 = s1->data;
+        const OpRepeat *op2 = s2->data;
+
+        return memcmp (op1->child_bounds, op2->child_bounds, sizeof (float) * 4) == 0 &&
+               memcmp (op1->texture_rect, op2->texture_rect, sizeof (float) * 4) == 0;
+      }
+
+    case OP_NONE:
+    case OP_CHANGE_PROGRAM:
+    case OP_CHANGE_RENDER_TARGET:
+    case OP_CHANGE_SOURCE_TEXTURE:
+    case OP_CLEAR:
+    case OP_DRAW:
+    case OP_DRAW_INSTANCED:
+    case OP_DUMP_FRAMEBUFFER:
+    case OP_PUSH_DEBUG_GROUP:
+    case OP_POP_DEBUG_GROUP:
+    case OP_LAST:
+    default:
+      g_assert_not_reached ();
+      return FALSE;
+    }
+}
+
+static gboolean
+draw_state_equal (const DrawInfo *d1,
+                  const DrawInfo *d2)
+{
+  int i;
+
+  if (d1->program != d2->program ||
+      d1->texture != d2->texture)
+    return FALSE;
+
+  for (i = 0; i < N_STATE_SLOTS; i ++)
+    if (!state_op_equal (&d1->state[i], &d2->state[i]))
+      return FALSE;
+
+  return TRUE;
+}
+
+/* Computes the bounds of the draw in clip space, so draws
+ * with different transforms can be compared */
+static void
+draw_info_compute_bounds (DrawInfo            *draw,
+                          const GskQuadVertex *vertices)
+{
+  const StateOp *projection = &draw->state[SLOT_PROJECTION];
+  const StateOp *modelview = &draw->state[SLOT_MODELVIEW];
+  graphene_matrix_t transform;
+  graphene_rect_t bounds;
+  float min_x, min_y, max_x, max_y;
+  gsize i;
+
+  draw->has_bounds = FALSE;
+
+  if (projection->data == NULL || modelview->data == NULL)
+    return;
+
+  min_x = max_x = vertices[draw->op->vao_offset].position[0];
+  min_y = max_y = vertices[draw->op->vao_offset].position[1];
+
+  for (i = draw->op->vao_offset + 1; i < draw->op->vao_offset + draw->op->vao_size; i ++)
+    {
+      min_x = MIN (min_x, vertices[i].position[0]);
+      min_y = MIN (min_y, vertices[i].position[1]);
+      max_x = MAX (max_x, vertices[i].position[0]);
+      max_y = MAX (max_y, vertices[i].position[1]);
+    }
+
+  graphene_rect_init (&bounds, min_x, min_y, max_x - min_x, max_y - min_y);
+  graphene_matrix_multiply (&((const OpMatrix *)modelview->data)->matrix,
+                            &((const OpMatrix *)projection->data)->matrix,
+                            &transform);
+  graphene_matrix_transform_bounds (&transform, &bounds, &draw->bounds);
+
+  draw->has_bounds = TRUE;
+}
+
+static gboolean
+draws_overlap (const DrawInfo *d1,
+               const DrawInfo *d2)
+{
+  if (!d1->has_bounds || !d2->has_bounds)
+    return TRUE;
+
+  return graphene_rect_intersection (&d1->bounds, &d2->bounds, NULL);
+}
+
+/* Tries to move @draws[@n] into an earlier draw with the same state,
+ * not looking further back than @first. */
+static gboolean
+merge_draw (DrawInfo *draws,
+            int       first,
+            int       n)
+{
+  DrawInfo *draw = &draws[n];
+  int i;
+
+  for (i = n - 1; i >= MAX (first, n - MAX_MERGE_DISTANCE); i --)
+    {
+      DrawInfo *other = &draws[i];
+
+      if (other->merged)
+        continue;
+
+      if (draw_state_equal (other, draw))
+        {
+          draws[other->last].next = n;
+          other->last = n;
+          graphene_rect_union (&other->bounds, &draw->bounds, &other->bounds);
+          draw->merged = TRUE;
+          return TRUE;
+        }
+
+      /* We can't move the draw before something it draws on top of */
+      if (draws_overlap (other, draw))
+        return FALSE;
+    }
+
+  return FALSE;
+}
+
+/* Merges draws that share the same GL state into earlier ones and
+ * reorders the vertex data accordingly. Returns the number of draws
+ * left, the number of draws before merging is put in @out_n_draws. */
+guint
+ops_merge_draws (RenderOpBuilder *builder,
+                 guint           *out_n_draws)
+{
+  OpBuffer *buffer = &builder->render_ops;
+  const GskQuadVertex *vertices = (const GskQuadVertex *) builder->vertices->data;
+  StateOp program_state[GL_N_PROGRAMS][N_STATE_SLOTS] = { { { 0, } } };
+  GArray *draws;
+  GArray *new_vertices;
+  int program = -1;
+  int texture = 0;
+  int first_draw = 0;
+  guint n_instanced_draws = 0;
+  guint n_merged = 0;
+  guint i;
+
+  draws = g_array_new (FALSE, FALSE, sizeof (DrawInfo));
+
+  for (i = 1; i < buffer->index->len; i ++)
+    {
+      OpBufferEntry *entry = &g_array_index (buffer->index, OpBufferEntry, i);
+      gpointer data = &buffer->buf[entry->pos];
+      int slot;
+
+      switch (entry->kind)
+        {
+        case OP_CHANGE_PROGRAM:
+          program = ((const OpProgram *)data)->program->index;
+          break;
+
+        case OP_CHANGE_SOURCE_TEXTURE:
+          texture = ((const OpTexture *)data)->texture_id;
+          break;
+
+        case OP_DRAW_INSTANCED:
+          /* These already batch themselves, and we don't reorder
+           * instance data, so they are only counted */
+          n_instanced_draws ++;
+          first_draw = draws->len;
+          break;
+
+        case OP_CHANGE_RENDER_TARGET:
+        case OP_CLEAR:
+        case OP_DUMP_FRAMEBUFFER:
+          /* Never merge across these */
+          first_draw = draws->len;
+          break;
+
+        case OP_DRAW:
+          {
+            DrawInfo *draw;
+
+            if (program < 0)
+              break;
+
+            g_array_set_size (draws, draws->len + 1);
+            draw = &g_array_index (draws, DrawInfo, draws->len - 1);
+            draw->op = data;
+            draw->program = program;
+            draw->texture = texture;
+            memcpy (draw->state, program_state[program], sizeof (draw->state));
+            draw->next = -1;
+            draw->last = draws->len - 1;
+            draw->merged = FALSE;
+            draw_info_compute_bounds (draw, vertices);
+
+            if (merge_draw ((DrawInfo *) draws->data, first_draw, draws->len - 1))
+              {
+                entry->kind = OP_NONE;
+                n_merged ++;
+              }
+          }
+          break;
+
+        case OP_NONE:
+        case OP_PUSH_DEBUG_GROUP:
+        case OP_POP_DEBUG_GROUP:
+          break;
+
+        case OP_LAST:
+        default:
+          slot = state_slot (entry->kind);
+          g_assert (slot >= 0);
+          /* The renderer ignores state changes without a program */
+          if (program >= 0)
+            {
+              program_state[program][slot].kind = entry->kind;
+              program_state[program][slot].data = data;
+            }
+          break;
+        }
+    }
+
+  *out_n_draws = draws->len + n_instanced_draws;
+
+  if (n_merged == 0)
+    {
+      g_array_free (draws, TRUE);
+      return *out_n_draws;
+    }
+
+  /* Now put the vertices of every merged draw right after the
+   * ones of the draw it was merged into */
+  new_vertices = g_array_sized_new (FALSE, FALSE, sizeof (GskQuadVertex), builder->vertices->len);
+
+  for (i = 0; i < draws->len; i ++)
+    {
+      const DrawInfo *draw = &g_array_index (draws, DrawInfo, i);
+      const gsize offset = new_vertices->len;
+      int n;
+
+      if (draw->merged)
+        continue;
+
+      for (n = i; n >= 0; n = g_array_index (draws, DrawInfo, n).next)
+        {
+          const OpDraw *op = g_array_index (draws, DrawInfo, n).op;
+
+          g_array_append_vals (new_vertices, &vertices[op->vao_offset], op->vao_size);
+        }
+
+      draw->op->vao_offset = offset;
+      draw->op->vao_size = new_vertices->len - offset;
+    }
+
+  g_array_set_size (builder->vertices, 0);
+  g_array_append_vals (builder->vertices, new_vertices->data, new_vertices->len);
+
+  g_array_free (new_vertices, TRUE);
+  g_array_free (draws, TRUE);
+
+  return *out_n_draws - n_merged;
+}
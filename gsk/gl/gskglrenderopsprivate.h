@@ -13,7 +13,7 @@
 #include "opbuffer.h"
 
 #define GL_N_VERTICES 6
-#define GL_N_PROGRAMS 13
+#define GL_N_PROGRAMS 20
 
 typedef struct
 {
@@ -61,6 +61,19 @@ struct _Program
       int start_point_location;
       int end_point_location;
     } linear_gradient;
+    struct {
+      int num_color_stops_location;
+      int color_stops_location;
+      int center_location;
+      int radius_location;
+      int range_location;
+    } radial_gradient;
+    struct {
+      int num_color_stops_location;
+      int color_stops_location;
+      int center_location;
+      int rotation_location;
+    } conic_gradient;
     struct {
       int blur_radius_location;
       int blur_size_location;
@@ -140,6 +153,7 @@ typedef struct
 
   OpBuffer render_ops;
   GArray *vertices;
+  GArray *instances;
 
   GskGLRenderer *renderer;
 
@@ -216,6 +230,7 @@ void              ops_set_border_color   (RenderOpBuilder         *builder,
 
 GskQuadVertex *   ops_draw               (RenderOpBuilder        *builder,
                                           const GskQuadVertex     vertex_data[GL_N_VERTICES]);
+GskQuadInstance * ops_draw_instance      (RenderOpBuilder        *builder);
 
 void              ops_offset             (RenderOpBuilder        *builder,
                                           float                   x,
@@ -224,5 +239,7 @@ void              ops_offset             (RenderOpBuilder        *builder,
 gpointer          ops_begin              (RenderOpBuilder        *builder,
                                           OpKind                  kind);
 OpBuffer         *ops_get_buffer         (RenderOpBuilder        *builder);
+guint             ops_merge_draws        (RenderOpBuilder        *builder,
+                                          guint                  *out_n_draws);
 
 #endif
@@ -168,6 +168,14 @@ gsk_gl_shader_builder_create_program (GskGLShaderBuilder  *self,
   program_id = glCreateProgram ();
   glAttachShader (program_id, vertex_id);
   glAttachShader (program_id, fragment_id);
+
+  /* The renderer sets up its vertex attributes using these */
+  glBindAttribLocation (program_id, 0, "aPosition");
+  glBindAttribLocation (program_id, 1, "aUv");
+  glBindAttribLocation (program_id, 2, "aInstanceRect");
+  glBindAttribLocation (program_id, 3, "aInstanceUv");
+  glBindAttribLocation (program_id, 4, "aInstanceColor");
+
   glLinkProgram (program_id);
 
   glGetProgramiv (program_id, GL_LINK_STATUS, &status);
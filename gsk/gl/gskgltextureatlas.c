@@ -5,8 +5,18 @@
 #include "gdkglcontextprivate.h"
 #include <epoxy/gl.h>
 
+/* Atlas eviction strategy
+ *
+ * Once enough of an atlas is unused, it is retired: nothing new
+ * gets packed into it, and caches move the items they still use
+ * out of it over the next frames. The atlas is dropped when almost
+ * nothing in it is in use anymore, or when it is mostly unused.
+ */
+
 #define ATLAS_SIZE (512)
 #define MAX_OLD_RATIO 0.5
+#define RETIRED_RATIO 0.25
+#define MIN_LIVE_RATIO 0.05
 
 static void
 free_atlas (gpointer v)
@@ -82,8 +92,11 @@ gsk_gl_texture_atlases_begin_frame (GskGLTextureAtlases *self,
   for (i = self->atlases->len - 1; i >= 0; i--)
     {
       GskGLTextureAtlas *atlas = g_ptr_array_index (self->atlases, i);
+      const double live_ratio = (double)(atlas->packed_pixels - atlas->unused_pixels) /
+                                (double)(atlas->width * atlas->height);
 
-      if (gsk_gl_texture_atlas_get_unused_ratio (atlas) > MAX_OLD_RATIO)
+      if (gsk_gl_texture_atlas_get_unused_ratio (atlas) > MAX_OLD_RATIO ||
+          (gsk_gl_texture_atlas_is_retired (atlas) && live_ratio < MIN_LIVE_RATIO))
         {
           GSK_NOTE(GLYPH_CACHE,
                    g_message ("Dropping atlas %d (%g.2%% old)", i,
@@ -151,7 +164,8 @@ gsk_gl_texture_atlases_pack (GskGLTextureAtlases *self,
     {
       atlas = g_ptr_array_index (self->atlases, i);
 
-      if (gsk_gl_texture_atlas_pack (atlas, width, height, &x, &y))
+      if (!gsk_gl_texture_atlas_is_retired (atlas) &&
+          gsk_gl_texture_atlas_pack (atlas, width, height, &x, &y))
         break;
 
       atlas = NULL;
@@ -253,6 +267,7 @@ gsk_gl_texture_atlas_pack (GskGLTextureAtlas *self,
     {
       *out_x = rect.x;
       *out_y = rect.y;
+      self->packed_pixels += width * height;
     }
 
   return rect.was_packed;
@@ -267,6 +282,14 @@ gsk_gl_texture_atlas_get_unused_ratio (const GskGLTextureAtlas *self)
   return 0.0;
 }
 
+/* Retired atlases don't take new items, and the items
+ * still used in them should be moved elsewhere */
+gboolean
+gsk_gl_texture_atlas_is_retired (const GskGLTextureAtlas *self)
+{
+  return gsk_gl_texture_atlas_get_unused_ratio (self) > RETIRED_RATIO;
+}
+
 /* Not using gdk_gl_driver_create_texture here, since we want
  * this texture to survive the driver and stay around until
  * the display gets closed.
@@ -16,6 +16,7 @@ struct _GskGLTextureAtlas
 
   guint texture_id;
 
+  int packed_pixels; /* Pixels of all rects packed so far */
   int unused_pixels; /* Pixels of rects that have been used at some point,
                         But are now unused. */
 
@@ -68,5 +69,6 @@ gboolean    gsk_gl_texture_atlas_pack              (GskGLTextureAtlas       *sel
                                                     int                     *out_y);
 
 double      gsk_gl_texture_atlas_get_unused_ratio  (const GskGLTextureAtlas *self);
+gboolean    gsk_gl_texture_atlas_is_retired        (const GskGLTextureAtlas *self);
 
 #endif
@@ -30,6 +30,9 @@ static guint op_sizes[OP_LAST] = {
   sizeof (OpDebugGroup),
   0,
   sizeof (OpBlend),
+  sizeof (OpRadialGradient),
+  sizeof (OpConicGradient),
+  sizeof (OpDrawInstanced),
 };
 
 void
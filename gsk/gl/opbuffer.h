@@ -38,6 +38,9 @@ typedef enum
   OP_PUSH_DEBUG_GROUP                  = 24,
   OP_POP_DEBUG_GROUP                   = 25,
   OP_CHANGE_BLEND                      = 26,
+  OP_CHANGE_RADIAL_GRADIENT            = 27,
+  OP_CHANGE_CONIC_GRADIENT             = 28,
+  OP_DRAW_INSTANCED                    = 29,
   OP_LAST
 } OpKind;
 
@@ -107,6 +110,12 @@ typedef struct
   gsize vao_size;
 } OpDraw;
 
+typedef struct
+{
+  gsize instance_offset;
+  gsize n_instances;
+} OpDrawInstanced;
+
 typedef struct
 {
   const GskColorStop *color_stops;
@@ -115,6 +124,25 @@ typedef struct
   int n_color_stops;
 } OpLinearGradient;
 
+typedef struct
+{
+  const GskColorStop *color_stops;
+  graphene_point_t center;
+  float hradius;
+  float vradius;
+  float start;
+  float end;
+  int n_color_stops;
+} OpRadialGradient;
+
+typedef struct
+{
+  const GskColorStop *color_stops;
+  graphene_point_t center;
+  float rotation;
+  int n_color_stops;
+} OpConicGradient;
+
 typedef struct
 {
   const graphene_matrix_t *matrix;
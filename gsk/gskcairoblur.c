@@ -22,6 +22,8 @@
 
 #include "gskcairoblurprivate.h"
 
+#include "gskprivate.h"
+
 #include <math.h>
 #include <string.h>
 
@@ -38,153 +40,571 @@
 
 #define get_box_filter_size(radius) ((int)(GAUSSIAN_SCALE_FACTOR * (radius)))
 
-/* Sadly, clang is picky about get_box_filter_size(2) not being a
- * constant expression, thus we have to use precomputed values.
+/* The blur is done as three box blur passes in each direction. Instead
+ * of sliding the window along rows, we slide it down columns and treat
+ * BAND_WIDTH adjacent columns at once: the running sums for a band are
+ * independent of each other, which is what lets the SIMD kernels below
+ * process a whole band per instruction, and each band can be blurred on
+ * a different thread. The horizontal blur is done by flipping the buffer
+ * and blurring its columns.
+ */
+#define BAND_WIDTH 16
+
+/* Number of bands handed to a thread at once */
+#define BANDS_PER_ITEM 8
+
+/* Surfaces smaller than this are not worth distributing over threads */
+#define PARALLEL_MIN_PIXELS (256 * 256)
+
+/* The SIMD kernels divide by multiplying with 1/d in single precision,
+ * which gives the same result as the integer division as long as the
+ * sums are small enough. Beyond that, use the scalar kernel.
  */
-#define BOX_FILTER_SIZE_2 3
-#define BOX_FILTER_SIZE_3 5
-#define BOX_FILTER_SIZE_4 7
-#define BOX_FILTER_SIZE_5 9
-#define BOX_FILTER_SIZE_6 11
-#define BOX_FILTER_SIZE_7 13
-#define BOX_FILTER_SIZE_8 15
-#define BOX_FILTER_SIZE_9 16
-#define BOX_FILTER_SIZE_10 18
-
-/* This applies a single box blur pass to a horizontal range of pixels;
- * since the box blur has the same weight for all pixels, we can
- * implement an efficient sliding window algorithm where we add
- * in pixels coming into the window from the right and remove
- * them when they leave the windw to the left.
+#define SIMD_MAX_FILTER_SIZE 4096
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_BLUR_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HAVE_BLUR_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* Applies a single box blur pass to a band of BAND_WIDTH columns of
+ * height rows, reading from @src and writing to @dst. Since the box
+ * blur has the same weight for all pixels, we use a sliding window
+ * where we add in pixels coming into the window from below and remove
+ * them when they leave the window at the top.
  *
- * d is the filter width; for even d shift indicates how the blurred
- * result is aligned with the original - does ' x ' go to ' yy' (shift=1)
- * or 'yy ' (shift=-1)
+ * d is the filter width; offset is how far the blurred result is moved
+ * up relative to the window, which is d / 2 for odd d. For even d
+ * there is no center pixel, and the offset decides whether ' x ' goes
+ * to ' yy' or 'yy '.
  */
+typedef void (* BlurBandFunc) (const guchar *src,
+                               int           src_stride,
+                               guchar       *dst,
+                               int           dst_stride,
+                               int           height,
+                               int           d,
+                               int           offset);
+
 static void
-blur_xspan (guchar *row,
-            guchar *tmp_buffer,
-            int     row_width,
-            int     d,
-            int     shift)
+blur_band_generic (const guchar *src,
+                   int           src_stride,
+                   guchar       *dst,
+                   int           dst_stride,
+                   int           n_columns,
+                   int           height,
+                   int           d,
+                   int           offset)
 {
-  int offset;
-  int sum = 0;
+  int sums[BAND_WIDTH] = { 0, };
+  int i, x;
+
+  for (i = -d + offset; i < height + offset; i++)
+    {
+      if (i >= 0 && i < height)
+        {
+          const guchar *in = src + i * src_stride;
+
+          for (x = 0; x < n_columns; x++)
+            sums[x] += in[x];
+        }
+
+      if (i >= offset)
+        {
+          guchar *out = dst + (i - offset) * dst_stride;
+
+          if (i >= d)
+            {
+              const guchar *in = src + (i - d) * src_stride;
+
+              for (x = 0; x < n_columns; x++)
+                sums[x] -= in[x];
+            }
+
+          for (x = 0; x < n_columns; x++)
+            out[x] = (sums[x] + d / 2) / d;
+        }
+    }
+}
+
+static void
+blur_band_scalar (const guchar *src,
+                  int           src_stride,
+                  guchar       *dst,
+                  int           dst_stride,
+                  int           height,
+                  int           d,
+                  int           offset)
+{
+  blur_band_generic (src, src_stride, dst, dst_stride, BAND_WIDTH, height, d, offset);
+}
+
+#ifdef HAVE_BLUR_X86
+static inline __attribute__((target ("sse2"))) __m128i
+sse2_divide (__m128i sum,
+             __m128  bias,
+             __m128  scale)
+{
+  return _mm_cvttps_epi32 (_mm_mul_ps (_mm_add_ps (_mm_cvtepi32_ps (sum), bias), scale));
+}
+
+static __attribute__((target ("sse2"))) void
+blur_band_sse2 (const guchar *src,
+                int           src_stride,
+                guchar       *dst,
+                int           dst_stride,
+                int           height,
+                int           d,
+                int           offset)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128 bias = _mm_set1_ps (d / 2 + 0.5f);
+  const __m128 scale = _mm_set1_ps (1.0f / d);
+  __m128i s0 = zero, s1 = zero, s2 = zero, s3 = zero;
   int i;
 
-  if (d % 2 == 1)
-    offset = d / 2;
-  else
-    offset = (d - shift) / 2;
-
-  /* All the conditionals in here look slow, but the branches will
-   * be well predicted and there are enough different possibilities
-   * that trying to write this as a series of unconditional loops
-   * is hard and not an obvious win. The main slow down here seems
-   * to be the integer division per pixel; one possible optimization
-   * would be to accumulate into two 16-bit integer buffers and
-   * only divide down after all three passes. (SSE parallel implementation
-   * of the divide step is possible.)
-   */
+  for (i = -d + offset; i < height + offset; i++)
+    {
+      if (i >= 0 && i < height)
+        {
+          __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i * src_stride));
+          __m128i lo = _mm_unpacklo_epi8 (v, zero);
+          __m128i hi = _mm_unpackhi_epi8 (v, zero);
+
+          s0 = _mm_add_epi32 (s0, _mm_unpacklo_epi16 (lo, zero));
+          s1 = _mm_add_epi32 (s1, _mm_unpackhi_epi16 (lo, zero));
+          s2 = _mm_add_epi32 (s2, _mm_unpacklo_epi16 (hi, zero));
+          s3 = _mm_add_epi32 (s3, _mm_unpackhi_epi16 (hi, zero));
+        }
+
+      if (i >= offset)
+        {
+          __m128i q0, q1, q2, q3;
+
+          if (i >= d)
+            {
+              __m128i v = _mm_loadu_si128 ((const __m128i *) (src + (i - d) * src_stride));
+              __m128i lo = _mm_unpacklo_epi8 (v, zero);
+              __m128i hi = _mm_unpackhi_epi8 (v, zero);
+
+              s0 = _mm_sub_epi32 (s0, _mm_unpacklo_epi16 (lo, zero));
+              s1 = _mm_sub_epi32 (s1, _mm_unpackhi_epi16 (lo, zero));
+              s2 = _mm_sub_epi32 (s2, _mm_unpacklo_epi16 (hi, zero));
+              s3 = _mm_sub_epi32 (s3, _mm_unpackhi_epi16 (hi, zero));
+            }
+
+          q0 = sse2_divide (s0, bias, scale);
+          q1 = sse2_divide (s1, bias, scale);
+          q2 = sse2_divide (s2, bias, scale);
+          q3 = sse2_divide (s3, bias, scale);
+
+          _mm_storeu_si128 ((__m128i *) (dst + (i - offset) * dst_stride),
+                            _mm_packus_epi16 (_mm_packs_epi32 (q0, q1),
+                                              _mm_packs_epi32 (q2, q3)));
+        }
+    }
+}
+
+static inline __attribute__((target ("avx2"))) __m256i
+avx2_divide (__m256i sum,
+             __m256  bias,
+             __m256  scale)
+{
+  return _mm256_cvttps_epi32 (_mm256_mul_ps (_mm256_add_ps (_mm256_cvtepi32_ps (sum), bias), scale));
+}
+
+static __attribute__((target ("avx2"))) void
+blur_band_avx2 (const guchar *src,
+                int           src_stride,
+                guchar       *dst,
+                int           dst_stride,
+                int           height,
+                int           d,
+                int           offset)
+{
+  const __m256 bias = _mm256_set1_ps (d / 2 + 0.5f);
+  const __m256 scale = _mm256_set1_ps (1.0f / d);
+  __m256i s0 = _mm256_setzero_si256 ();
+  __m256i s1 = _mm256_setzero_si256 ();
+  int i;
 
-#define BLUR_ROW_KERNEL(D)                                      \
-  for (i = -(D) + offset; i < row_width + offset; i++)		\
-    {                                                           \
-      if (i >= 0 && i < row_width)                              \
-        sum += row[i];                                          \
-                                                                \
-      if (i >= offset)						\
-	{							\
-	  if (i >= (D))						\
-	    sum -= row[i - (D)];				\
-                                                                \
-	  tmp_buffer[i - offset] = (sum + (D) / 2) / (D);	\
-	}							\
-    }								\
-  break;
-
-  /* We unroll the values for d for radius 2-10 to avoid a generic
-   * divide operation (not radius 1, because its a no-op) */
-  switch (d)
+  for (i = -d + offset; i < height + offset; i++)
     {
-    case BOX_FILTER_SIZE_2: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_2);
-    case BOX_FILTER_SIZE_3: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_3);
-    case BOX_FILTER_SIZE_4: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_4);
-    case BOX_FILTER_SIZE_5: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_5);
-    case BOX_FILTER_SIZE_6: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_6);
-    case BOX_FILTER_SIZE_7: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_7);
-    case BOX_FILTER_SIZE_8: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_8);
-    case BOX_FILTER_SIZE_9: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_9);
-    case BOX_FILTER_SIZE_10: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_10);
-    default: BLUR_ROW_KERNEL (d);
+      if (i >= 0 && i < height)
+        {
+          __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i * src_stride));
+
+          s0 = _mm256_add_epi32 (s0, _mm256_cvtepu8_epi32 (v));
+          s1 = _mm256_add_epi32 (s1, _mm256_cvtepu8_epi32 (_mm_srli_si128 (v, 8)));
+        }
+
+      if (i >= offset)
+        {
+          __m256i packed;
+
+          if (i >= d)
+            {
+              __m128i v = _mm_loadu_si128 ((const __m128i *) (src + (i - d) * src_stride));
+
+              s0 = _mm256_sub_epi32 (s0, _mm256_cvtepu8_epi32 (v));
+              s1 = _mm256_sub_epi32 (s1, _mm256_cvtepu8_epi32 (_mm_srli_si128 (v, 8)));
+            }
+
+          /* The 256bit packs work per 128bit lane, so put the 64bit
+           * quarters back in order before the final pack.
+           */
+          packed = _mm256_packs_epi32 (avx2_divide (s0, bias, scale),
+                                       avx2_divide (s1, bias, scale));
+          packed = _mm256_permute4x64_epi64 (packed, _MM_SHUFFLE (3, 1, 2, 0));
+
+          _mm_storeu_si128 ((__m128i *) (dst + (i - offset) * dst_stride),
+                            _mm_packus_epi16 (_mm256_castsi256_si128 (packed),
+                                              _mm256_extracti128_si256 (packed, 1)));
+        }
     }
+}
 
-  memcpy (row, tmp_buffer, row_width);
+static gboolean
+cpu_has_sse2 (void)
+{
+  __builtin_cpu_init ();
+  return __builtin_cpu_supports ("sse2");
+}
+
+static gboolean
+cpu_has_avx2 (void)
+{
+  __builtin_cpu_init ();
+  return __builtin_cpu_supports ("avx2");
+}
+#endif /* HAVE_BLUR_X86 */
+
+#ifdef HAVE_BLUR_NEON
+static inline uint16x4_t
+neon_divide (uint32x4_t  sum,
+             float32x4_t bias,
+             float32x4_t scale)
+{
+  return vmovn_u32 (vcvtq_u32_f32 (vmulq_f32 (vaddq_f32 (vcvtq_f32_u32 (sum), bias), scale)));
 }
 
 static void
-blur_rows (guchar *dst_buffer,
-           guchar *tmp_buffer,
-           int     buffer_width,
-           int     buffer_height,
-           int     d)
+blur_band_neon (const guchar *src,
+                int           src_stride,
+                guchar       *dst,
+                int           dst_stride,
+                int           height,
+                int           d,
+                int           offset)
 {
+  const float32x4_t bias = vdupq_n_f32 (d / 2 + 0.5f);
+  const float32x4_t scale = vdupq_n_f32 (1.0f / d);
+  uint32x4_t s0 = vdupq_n_u32 (0), s1 = s0, s2 = s0, s3 = s0;
   int i;
 
-  for (i = 0; i < buffer_height; i++)
+  for (i = -d + offset; i < height + offset; i++)
+    {
+      if (i >= 0 && i < height)
+        {
+          uint8x16_t v = vld1q_u8 (src + i * src_stride);
+          uint16x8_t lo = vmovl_u8 (vget_low_u8 (v));
+          uint16x8_t hi = vmovl_u8 (vget_high_u8 (v));
+
+          s0 = vaddw_u16 (s0, vget_low_u16 (lo));
+          s1 = vaddw_u16 (s1, vget_high_u16 (lo));
+          s2 = vaddw_u16 (s2, vget_low_u16 (hi));
+          s3 = vaddw_u16 (s3, vget_high_u16 (hi));
+        }
+
+      if (i >= offset)
+        {
+          uint16x8_t lo, hi;
+
+          if (i >= d)
+            {
+              uint8x16_t v = vld1q_u8 (src + (i - d) * src_stride);
+
+              lo = vmovl_u8 (vget_low_u8 (v));
+              hi = vmovl_u8 (vget_high_u8 (v));
+
+              s0 = vsubw_u16 (s0, vget_low_u16 (lo));
+              s1 = vsubw_u16 (s1, vget_high_u16 (lo));
+              s2 = vsubw_u16 (s2, vget_low_u16 (hi));
+              s3 = vsubw_u16 (s3, vget_high_u16 (hi));
+            }
+
+          lo = vcombine_u16 (neon_divide (s0, bias, scale), neon_divide (s1, bias, scale));
+          hi = vcombine_u16 (neon_divide (s2, bias, scale), neon_divide (s3, bias, scale));
+
+          vst1q_u8 (dst + (i - offset) * dst_stride,
+                    vcombine_u8 (vmovn_u16 (lo), vmovn_u16 (hi)));
+        }
+    }
+}
+#endif /* HAVE_BLUR_NEON */
+
+typedef struct {
+  const char *name;
+  BlurBandFunc func;
+  gboolean (* is_supported) (void);
+} BlurImplementation;
+
+/* In order of preference */
+static const BlurImplementation blur_implementations[] = {
+#ifdef HAVE_BLUR_X86
+  { "avx2", blur_band_avx2, cpu_has_avx2 },
+  { "sse2", blur_band_sse2, cpu_has_sse2 },
+#endif
+#ifdef HAVE_BLUR_NEON
+  { "neon", blur_band_neon, NULL },
+#endif
+  { "scalar", blur_band_scalar, NULL },
+};
+
+static const BlurImplementation *blur_implementation;
+static gboolean blur_threaded = TRUE;
+
+static const BlurImplementation *
+get_blur_implementation (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      guint i;
+
+      for (i = 0; i < G_N_ELEMENTS (blur_implementations); i++)
+        {
+          if (blur_implementations[i].is_supported == NULL ||
+              blur_implementations[i].is_supported ())
+            {
+              blur_implementation = &blur_implementations[i];
+              break;
+            }
+        }
+
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return blur_implementation;
+}
+
+/*<private>
+ * gsk_cairo_blur_list_implementations:
+ *
+ * Returns the names of the blur kernels that can be used on this
+ * machine, the default one first.
+ *
+ * Returns: (transfer container): a %NULL-terminated array of names
+ */
+const char **
+gsk_cairo_blur_list_implementations (void)
+{
+  GPtrArray *names = g_ptr_array_new ();
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (blur_implementations); i++)
+    {
+      if (blur_implementations[i].is_supported == NULL ||
+          blur_implementations[i].is_supported ())
+        g_ptr_array_add (names, (gpointer) blur_implementations[i].name);
+    }
+
+  g_ptr_array_add (names, NULL);
+
+  return (const char **) g_ptr_array_free (names, FALSE);
+}
+
+/*<private>
+ * gsk_cairo_blur_set_implementation:
+ * @name: (nullable): the name of the kernel to use, or %NULL for the default
+ * @threaded: whether to blur large surfaces on several threads
+ *
+ * Selects how surfaces are blurred. This is meant for benchmarks and
+ * tests, and must not be called while a blur is in progress.
+ *
+ * Returns: %FALSE if @name is not supported on this machine
+ */
+gboolean
+gsk_cairo_blur_set_implementation (const char *name,
+                                   gboolean    threaded)
+{
+  guint i;
+
+  get_blur_implementation ();
+
+  for (i = 0; i < G_N_ELEMENTS (blur_implementations); i++)
+    {
+      if (blur_implementations[i].is_supported != NULL &&
+          !blur_implementations[i].is_supported ())
+        continue;
+
+      if (name == NULL || strcmp (name, blur_implementations[i].name) == 0)
+        {
+          blur_implementation = &blur_implementations[i];
+          blur_threaded = threaded;
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+typedef struct {
+  guchar *buffer;
+  int width;
+  int height;
+  int d;
+  BlurBandFunc func;
+} BlurColumnsData;
+
+static void
+blur_band (const BlurColumnsData *data,
+           const guchar          *src,
+           int                    src_stride,
+           guchar                *dst,
+           int                    dst_stride,
+           int                    n_columns,
+           int                    d,
+           int                    offset)
+{
+  if (n_columns == BAND_WIDTH && d < SIMD_MAX_FILTER_SIZE)
+    data->func (src, src_stride, dst, dst_stride, data->height, d, offset);
+  else
+    blur_band_generic (src, src_stride, dst, dst_stride, n_columns, data->height, d, offset);
+}
+
+static void
+blur_columns_item (guint    item,
+                   gpointer user_data)
+{
+  const BlurColumnsData *data = user_data;
+  int d = data->d;
+  int first = item * BANDS_PER_ITEM * BAND_WIDTH;
+  guchar *tmp1, *tmp2;
+  int x, x_end;
+
+  tmp1 = g_malloc (BAND_WIDTH * data->height * 2);
+  tmp2 = tmp1 + BAND_WIDTH * data->height;
+
+  x_end = MIN (data->width, first + BANDS_PER_ITEM * BAND_WIDTH);
+
+  for (x = first; x < x_end; x += BAND_WIDTH)
     {
-      guchar *row = dst_buffer + i * buffer_width;
+      guchar *column = data->buffer + x;
+      int n = MIN (BAND_WIDTH, data->width - x);
 
       /* We want to produce a symmetric blur that spreads a pixel
-       * equally far to the left and right. If d is odd that happens
+       * equally far up and down. If d is odd that happens
        * naturally, but for d even, we approximate by using a blur
        * on either side and then a centered blur of size d + 1.
        * (technique also from the SVG specification)
        */
       if (d % 2 == 1)
         {
-          blur_xspan (row, tmp_buffer, buffer_width, d, 0);
-          blur_xspan (row, tmp_buffer, buffer_width, d, 0);
-          blur_xspan (row, tmp_buffer, buffer_width, d, 0);
+          blur_band (data, column, data->width, tmp1, BAND_WIDTH, n, d, d / 2);
+          blur_band (data, tmp1, BAND_WIDTH, tmp2, BAND_WIDTH, n, d, d / 2);
+          blur_band (data, tmp2, BAND_WIDTH, column, data->width, n, d, d / 2);
         }
       else
         {
-          blur_xspan (row, tmp_buffer, buffer_width, d, 1);
-          blur_xspan (row, tmp_buffer, buffer_width, d, -1);
-          blur_xspan (row, tmp_buffer, buffer_width, d + 1, 0);
+          blur_band (data, column, data->width, tmp1, BAND_WIDTH, n, d, (d - 1) / 2);
+          blur_band (data, tmp1, BAND_WIDTH, tmp2, BAND_WIDTH, n, d, (d + 1) / 2);
+          blur_band (data, tmp2, BAND_WIDTH, column, data->width, n, d + 1, (d + 1) / 2);
         }
     }
+
+  g_free (tmp1);
+}
+
+static void
+blur_columns (guchar                   *buffer,
+              int                       width,
+              int                       height,
+              int                       d,
+              const BlurImplementation *implementation,
+              gboolean                  threaded)
+{
+  BlurColumnsData data = { buffer, width, height, d, implementation->func };
+  guint n_items, i;
+
+  n_items = (width + BANDS_PER_ITEM * BAND_WIDTH - 1) / (BANDS_PER_ITEM * BAND_WIDTH);
+
+  if (threaded)
+    gsk_parallel_for (n_items, blur_columns_item, &data);
+  else
+    for (i = 0; i < n_items; i++)
+      blur_columns_item (i, &data);
 }
 
+typedef struct {
+  guchar *dst_buffer;
+  const guchar *src_buffer;
+  int width;
+  int height;
+} FlipData;
+
+/* Number of source columns handed to a thread at once */
+#define FLIP_COLUMNS_PER_ITEM 64
+
 /* Swaps width and height.
  */
 static void
-flip_buffer (guchar *dst_buffer,
-             guchar *src_buffer,
-             int     width,
-             int     height)
+flip_buffer_item (guint    item,
+                  gpointer user_data)
 {
+  const FlipData *data = user_data;
+  int width = data->width;
+  int height = data->height;
+
   /* Working in blocks increases cache efficiency, compared to reading
    * or writing an entire column at once
    */
 #define BLOCK_SIZE 16
 
-  int i0, j0;
+  int first = item * FLIP_COLUMNS_PER_ITEM;
+  int i0, j0, i_end;
 
-  for (i0 = 0; i0 < width; i0 += BLOCK_SIZE)
+  i_end = MIN (width, first + FLIP_COLUMNS_PER_ITEM);
+
+  for (i0 = first; i0 < i_end; i0 += BLOCK_SIZE)
     for (j0 = 0; j0 < height; j0 += BLOCK_SIZE)
       {
         int max_j = MIN(j0 + BLOCK_SIZE, height);
-        int max_i = MIN(i0 + BLOCK_SIZE, width);
+        int max_i = MIN(i0 + BLOCK_SIZE, i_end);
         int i, j;
 
         for (i = i0; i < max_i; i++)
           for (j = j0; j < max_j; j++)
-            dst_buffer[i * height + j] = src_buffer[j * width + i];
+            data->dst_buffer[i * height + j] = data->src_buffer[j * width + i];
       }
 #undef BLOCK_SIZE
 }
 
+static void
+flip_buffer (guchar       *dst_buffer,
+             const guchar *src_buffer,
+             int           width,
+             int           height,
+             gboolean      threaded)
+{
+  FlipData data = { dst_buffer, src_buffer, width, height };
+  guint n_items, i;
+
+  n_items = (width + FLIP_COLUMNS_PER_ITEM - 1) / FLIP_COLUMNS_PER_ITEM;
+
+  if (threaded)
+    gsk_parallel_for (n_items, flip_buffer_item, &data);
+  else
+    for (i = 0; i < n_items; i++)
+      flip_buffer_item (i, &data);
+}
+
 static void
 _boxblur (guchar      *buffer,
           int          width,
@@ -192,30 +612,33 @@ _boxblur (guchar      *buffer,
           int          radius,
           GskBlurFlags flags)
 {
-  guchar *flipped_buffer;
+  const BlurImplementation *implementation = get_blur_implementation ();
   int d = get_box_filter_size (radius);
+  gboolean threaded;
 
-  flipped_buffer = g_malloc (width * height);
+  threaded = blur_threaded && width * height >= PARALLEL_MIN_PIXELS;
 
   if (flags & GSK_BLUR_Y)
     {
-      /* Step 1: swap rows and columns */
-      flip_buffer (flipped_buffer, buffer, width, height);
-
-      /* Step 2: blur rows (really columns) */
-      blur_rows (flipped_buffer, buffer, height, width, d);
-
-      /* Step 3: swap rows and columns */
-      flip_buffer (buffer, flipped_buffer, height, width);
+      /* Step 1: blur columns */
+      blur_columns (buffer, width, height, d, implementation, threaded);
     }
 
   if (flags & GSK_BLUR_X)
     {
-      /* Step 4: blur rows */
-      blur_rows (buffer, flipped_buffer, width, height, d);
-    }
+      guchar *flipped_buffer = g_malloc (width * height);
 
-  g_free (flipped_buffer);
+      /* Step 2: swap rows and columns */
+      flip_buffer (flipped_buffer, buffer, width, height, threaded);
+
+      /* Step 3: blur columns (really rows) */
+      blur_columns (flipped_buffer, height, width, d, implementation, threaded);
+
+      /* Step 4: swap rows and columns */
+      flip_buffer (buffer, flipped_buffer, height, width, threaded);
+
+      g_free (flipped_buffer);
+    }
 }
 
 /*
@@ -49,6 +49,10 @@ cairo_t *       gsk_cairo_blur_finish_drawing   (cairo_t         *cr,
                                                  const GdkRGBA   *color,
                                                  GskBlurFlags     blur_flags);
 
+const char **   gsk_cairo_blur_list_implementations (void);
+gboolean        gsk_cairo_blur_set_implementation   (const char      *name,
+                                                     gboolean         threaded);
+
 G_END_DECLS
 
 #endif /* _GSK_CAIRO_BLUR_H */
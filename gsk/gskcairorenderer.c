@@ -23,10 +23,18 @@
 #include "gskcairorenderer.h"
 
 #include "gskdebugprivate.h"
+#include "gskprivate.h"
 #include "gskrendererprivate.h"
 #include "gskrendernodeprivate.h"
+#include "gdk/gdkgltextureprivate.h"
 #include "gdk/gdktextureprivate.h"
 
+#include <pango/pangocairo.h>
+
+/* Size of the tiles, in device pixels, that large frames are split
+ * into so that they can be drawn by multiple threads */
+#define TILE_SIZE 256
+
 #ifdef G_ENABLE_DEBUG
 typedef struct {
   GQuark cpu_time;
@@ -72,10 +80,289 @@ gsk_cairo_renderer_unrealize (GskRenderer *renderer)
   g_clear_object (&self->cairo_context);
 }
 
+/* Checks that @node can be drawn from multiple threads at once, and
+ * does the lazy initialization that would otherwise race. */
+static gboolean
+gsk_cairo_renderer_prepare_threaded (GskRenderNode *node)
+{
+  guint i;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CONTAINER_NODE:
+      for (i = 0; i < gsk_container_node_get_n_children (node); i++)
+        {
+          if (!gsk_cairo_renderer_prepare_threaded (gsk_container_node_get_child (node, i)))
+            return FALSE;
+        }
+      return TRUE;
+
+    case GSK_TEXTURE_NODE:
+      /* Downloading GL textures needs the GL context */
+      return !GDK_IS_GL_TEXTURE (gsk_texture_node_get_texture (node));
+
+    case GSK_TEXT_NODE:
+      pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (gsk_text_node_peek_font (node)));
+      return TRUE;
+
+    case GSK_TRANSFORM_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_transform_node_get_child (node));
+
+    case GSK_OPACITY_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_opacity_node_get_child (node));
+
+    case GSK_COLOR_MATRIX_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_color_matrix_node_get_child (node));
+
+    case GSK_REPEAT_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_repeat_node_get_child (node));
+
+    case GSK_CLIP_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_clip_node_get_child (node));
+
+    case GSK_ROUNDED_CLIP_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_rounded_clip_node_get_child (node));
+
+    case GSK_SHADOW_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_shadow_node_get_child (node));
+
+    case GSK_BLUR_NODE:
+      /* The blur is clipped to the tile, so pixels near its edges
+       * would be blurred with transparency instead of their neighbours */
+      return FALSE;
+
+    case GSK_DEBUG_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_debug_node_get_child (node));
+
+    case GSK_BLEND_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_blend_node_get_bottom_child (node)) &&
+             gsk_cairo_renderer_prepare_threaded (gsk_blend_node_get_top_child (node));
+
+    case GSK_CROSS_FADE_NODE:
+      return gsk_cairo_renderer_prepare_threaded (gsk_cross_fade_node_get_start_child (node)) &&
+             gsk_cairo_renderer_prepare_threaded (gsk_cross_fade_node_get_end_child (node));
+
+    case GSK_CAIRO_NODE:
+      {
+        cairo_surface_t *surface = gsk_cairo_node_peek_surface (node);
+
+        /* Replaying a recording surface under a clip sets up its
+         * indices on first use, without any locking */
+        return surface == NULL ||
+               cairo_surface_get_type (surface) == CAIRO_SURFACE_TYPE_IMAGE;
+      }
+
+    case GSK_COLOR_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+    case GSK_CONIC_GRADIENT_NODE:
+    case GSK_BORDER_NODE:
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+      return TRUE;
+
+    case GSK_NOT_A_RENDER_NODE:
+    default:
+      g_assert_not_reached ();
+      return FALSE;
+    }
+}
+
+typedef struct {
+  GskRenderNode *root;
+  const cairo_region_t *region;
+  cairo_matrix_t matrix;
+
+  /* The image surface the tiles are drawn to */
+  guchar *data;
+  int stride;
+  double x_scale, y_scale;
+  double x_offset, y_offset;
+
+  /* The area covered by the tiles, in device pixels of the image */
+  cairo_rectangle_int_t extents;
+  guint n_columns;
+} TiledDraw;
+
+static void
+gsk_cairo_renderer_draw_tile (guint    i,
+                              gpointer user_data)
+{
+  TiledDraw *tiled = user_data;
+  cairo_rectangle_int_t tile;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  tile.x = tiled->extents.x + (i % tiled->n_columns) * TILE_SIZE;
+  tile.y = tiled->extents.y + (i / tiled->n_columns) * TILE_SIZE;
+  tile.width = MIN (TILE_SIZE, tiled->extents.x + tiled->extents.width - tile.x);
+  tile.height = MIN (TILE_SIZE, tiled->extents.y + tiled->extents.height - tile.y);
+
+  /* A view of the tile's pixels that maps user space the same way
+   * as the target, so the tile gets exactly the pixels it would get
+   * when drawing the whole frame in one go. */
+  surface = cairo_image_surface_create_for_data (tiled->data + tile.y * tiled->stride + tile.x * 4,
+                                                 CAIRO_FORMAT_ARGB32,
+                                                 tile.width, tile.height,
+                                                 tiled->stride);
+  cairo_surface_set_device_scale (surface, tiled->x_scale, tiled->y_scale);
+  cairo_surface_set_device_offset (surface, tiled->x_offset - tile.x, tiled->y_offset - tile.y);
+
+  cr = cairo_create (surface);
+
+  if (tiled->region)
+    {
+      gdk_cairo_region (cr, tiled->region);
+      cairo_clip (cr);
+    }
+
+  cairo_set_matrix (cr, &tiled->matrix);
+
+  gsk_render_node_draw (tiled->root, cr);
+
+  cairo_destroy (cr);
+  cairo_surface_destroy (surface);
+}
+
+static void
+gsk_cairo_renderer_draw_tiled (TiledDraw *tiled)
+{
+  guint n_rows;
+
+  tiled->n_columns = (tiled->extents.width + TILE_SIZE - 1) / TILE_SIZE;
+  n_rows = (tiled->extents.height + TILE_SIZE - 1) / TILE_SIZE;
+
+  gsk_parallel_for (tiled->n_columns * n_rows, gsk_cairo_renderer_draw_tile, tiled);
+}
+
+/* Draws @root by splitting the frame into tiles that are drawn in
+ * parallel. Returns %FALSE if that is not possible or not worth it. */
+static gboolean
+gsk_cairo_renderer_try_render_tiled (GskRenderer          *renderer,
+                                     cairo_t              *cr,
+                                     const cairo_region_t *region,
+                                     GskRenderNode        *root)
+{
+  cairo_surface_t *target, *image;
+  cairo_rectangle_int_t extents;
+  TiledDraw tiled;
+  gboolean direct;
+  int width, height;
+
+#ifdef G_ENABLE_DEBUG
+  if (GSK_RENDERER_DEBUG_CHECK (renderer, NO_TILES))
+    return FALSE;
+#endif
+
+  if (g_get_num_processors () < 2)
+    return FALSE;
+
+  target = cairo_get_target (cr);
+  cairo_surface_get_device_scale (target, &tiled.x_scale, &tiled.y_scale);
+  cairo_surface_get_device_offset (target, &tiled.x_offset, &tiled.y_offset);
+
+  direct = cairo_surface_get_type (target) == CAIRO_SURFACE_TYPE_IMAGE &&
+           cairo_image_surface_get_format (target) == CAIRO_FORMAT_ARGB32;
+
+  if (direct)
+    {
+      width = cairo_image_surface_get_width (target);
+      height = cairo_image_surface_get_height (target);
+    }
+  else if (region != NULL)
+    {
+      width = height = G_MAXINT;
+    }
+  else
+    return FALSE;
+
+  /* Find the device pixels that need to be drawn */
+  if (region)
+    {
+      cairo_region_get_extents (region, &extents);
+      tiled.extents.x = MAX (0, floor (extents.x * tiled.x_scale + tiled.x_offset));
+      tiled.extents.y = MAX (0, floor (extents.y * tiled.y_scale + tiled.y_offset));
+      tiled.extents.width = MIN (width, ceil ((extents.x + extents.width) * tiled.x_scale + tiled.x_offset)) - tiled.extents.x;
+      tiled.extents.height = MIN (height, ceil ((extents.y + extents.height) * tiled.y_scale + tiled.y_offset)) - tiled.extents.y;
+    }
+  else
+    {
+      tiled.extents.x = 0;
+      tiled.extents.y = 0;
+      tiled.extents.width = width;
+      tiled.extents.height = height;
+    }
+
+  if (tiled.extents.width <= 0 || tiled.extents.height <= 0 ||
+      tiled.extents.width * tiled.extents.height < 2 * TILE_SIZE * TILE_SIZE)
+    return FALSE;
+
+  if (!gsk_cairo_renderer_prepare_threaded (root))
+    return FALSE;
+
+  tiled.root = root;
+  tiled.region = region;
+  cairo_get_matrix (cr, &tiled.matrix);
+
+  if (direct)
+    {
+      /* Draw straight into the pixels of the target */
+      cairo_surface_flush (target);
+
+      tiled.data = cairo_image_surface_get_data (target);
+      tiled.stride = cairo_image_surface_get_stride (target);
+
+      gsk_cairo_renderer_draw_tiled (&tiled);
+
+      cairo_surface_mark_dirty (target);
+    }
+  else
+    {
+      /* Draw into an image first and put that onto the target.
+       * The target is expected to be cleared, as the frame would
+       * otherwise not be drawn correctly by a single thread either. */
+      image = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                          tiled.extents.width,
+                                          tiled.extents.height);
+      tiled.data = cairo_image_surface_get_data (image);
+      tiled.stride = cairo_image_surface_get_stride (image);
+      tiled.x_offset -= tiled.extents.x;
+      tiled.y_offset -= tiled.extents.y;
+      tiled.extents.x = 0;
+      tiled.extents.y = 0;
+
+      gsk_cairo_renderer_draw_tiled (&tiled);
+
+      cairo_surface_mark_dirty (image);
+      cairo_surface_set_device_scale (image, tiled.x_scale, tiled.y_scale);
+      cairo_surface_set_device_offset (image, tiled.x_offset, tiled.y_offset);
+
+      cairo_save (cr);
+      cairo_identity_matrix (cr);
+      gdk_cairo_region (cr, region);
+      cairo_clip (cr);
+      cairo_set_source_surface (cr, image, 0, 0);
+      cairo_paint (cr);
+      cairo_restore (cr);
+
+      cairo_surface_destroy (image);
+    }
+
+  GSK_RENDERER_NOTE (renderer, CAIRO,
+                     g_message ("Drew %d x %d pixels in %u tiles",
+                                tiled.extents.width, tiled.extents.height,
+                                tiled.n_columns * ((tiled.extents.height + TILE_SIZE - 1) / TILE_SIZE)));
+
+  return TRUE;
+}
+
 static void
-gsk_cairo_renderer_do_render (GskRenderer   *renderer,
-                              cairo_t       *cr,
-                              GskRenderNode *root)
+gsk_cairo_renderer_do_render (GskRenderer          *renderer,
+                              cairo_t              *cr,
+                              const cairo_region_t *region,
+                              GskRenderNode        *root)
 {
 #ifdef G_ENABLE_DEBUG
   GskCairoRenderer *self = GSK_CAIRO_RENDERER (renderer);
@@ -88,7 +375,8 @@ gsk_cairo_renderer_do_render (GskRenderer   *renderer,
   gsk_profiler_timer_begin (profiler, self->profile_timers.cpu_time);
 #endif
 
-  gsk_render_node_draw (root, cr);
+  if (!gsk_cairo_renderer_try_render_tiled (renderer, cr, region, root))
+    gsk_render_node_draw (root, cr);
 
 #ifdef G_ENABLE_DEBUG
   cpu_time = gsk_profiler_timer_end (profiler, self->profile_timers.cpu_time);
@@ -112,7 +400,7 @@ gsk_cairo_renderer_render_texture (GskRenderer           *renderer,
 
   cairo_translate (cr, - viewport->origin.x, - viewport->origin.y);
 
-  gsk_cairo_renderer_do_render (renderer, cr, root);
+  gsk_cairo_renderer_do_render (renderer, cr, NULL, root);
 
   cairo_destroy (cr);
 
@@ -152,7 +440,10 @@ gsk_cairo_renderer_render (GskRenderer          *renderer,
     }
 #endif
 
-  gsk_cairo_renderer_do_render (renderer, cr, root);
+  gsk_cairo_renderer_do_render (renderer,
+                                cr,
+                                gdk_draw_context_get_frame_region (GDK_DRAW_CONTEXT (self->cairo_context)),
+                                root);
 
   cairo_destroy (cr);
 
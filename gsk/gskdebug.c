@@ -15,8 +15,42 @@ static const GDebugKey gsk_debug_keys[] = {
   { "full-redraw", GSK_DEBUG_FULL_REDRAW},
   { "sync", GSK_DEBUG_SYNC },
   { "vulkan-staging-image", GSK_DEBUG_VULKAN_STAGING_IMAGE },
-  { "vulkan-staging-buffer", GSK_DEBUG_VULKAN_STAGING_BUFFER }
+  { "vulkan-staging-buffer", GSK_DEBUG_VULKAN_STAGING_BUFFER },
+  { "occlusion", GSK_DEBUG_OCCLUSION }
 };
+
+/* These write files or change how frames are drawn, so they are not
+ * part of "all" and have to be given by name. */
+static const GDebugKey gsk_explicit_debug_keys[] = {
+  { "record", GSK_DEBUG_RECORD },
+  { "no-tiles", GSK_DEBUG_NO_TILES }
+};
+
+static guint
+parse_explicit_debug_flags (const char *env)
+{
+  char **names;
+  guint flags = 0;
+  guint i, j;
+
+  if (env == NULL)
+    return 0;
+
+  names = g_strsplit_set (env, ":;, \t", -1);
+  for (i = 0; names[i] != NULL; i++)
+    {
+      g_strdelimit (names[i], "_", '-');
+
+      for (j = 0; j < G_N_ELEMENTS (gsk_explicit_debug_keys); j++)
+        {
+          if (g_ascii_strcasecmp (names[i], gsk_explicit_debug_keys[j].key) == 0)
+            flags |= gsk_explicit_debug_keys[j].value;
+        }
+    }
+  g_strfreev (names);
+
+  return flags;
+}
 #endif
 
 static guint gsk_debug_flags;
@@ -34,6 +68,7 @@ init_debug_flags (void)
       gsk_debug_flags = g_parse_debug_string (env,
                                               (GDebugKey *) gsk_debug_keys,
                                               G_N_ELEMENTS (gsk_debug_keys));
+      gsk_debug_flags |= parse_explicit_debug_flags (env);
 
       g_once_init_leave (&gsk_debug_flags__set, TRUE);
     }
@@ -0,0 +1,563 @@
+#include "config.h"
+
+#include "gskglyphdiskcacheprivate.h"
+#include "gskdebugprivate.h"
+
+#include <glib/gstdio.h>
+#include <string.h>
+
+#ifdef HAVE_PANGOFT
+#include <pango/pangofc-font.h>
+#endif
+
+/* An on-disk cache of rendered glyphs, so that new processes don't
+ * have to render every glyph again before they can show their first
+ * frame.
+ *
+ * There is one file per font and scale, below the user cache dir.
+ * The file name is a checksum over everything that affects how the
+ * glyphs look: the font description, the font file (where we can get
+ * at it), the font options and the cairo version. Files are mapped
+ * when the font is first used, and rewritten with the glyphs that
+ * were added since, when gsk_glyph_disk_cache_save() is called.
+ *
+ * The files are only meant to be read on the same machine, so all
+ * numbers are stored in host byte order.
+ *
+ * Loading a file updates its modification time, so it tells when the
+ * file was last used. Once per process, files that haven't been used
+ * for a month are removed, and then the least recently used ones until
+ * all of them fit into MAX_CACHE_SIZE.
+ *
+ * Setting GSK_GLYPH_DISK_CACHE=0 in the environment turns the cache off.
+ */
+
+#define GSK_GLYPH_DISK_CACHE_MAGIC "GskGlyphCache"
+#define GSK_GLYPH_DISK_CACHE_VERSION 1
+#define GSK_GLYPH_DISK_CACHE_BYTE_ORDER 0x01020304
+
+#define MAX_GLYPH_SIZE 4096
+#define MAX_FILE_SIZE (16 * 1024 * 1024)
+#define MAX_CACHE_SIZE (128 * 1024 * 1024)
+#define MAX_UNUSED_TIME (30 * 24 * 60 * 60) /* in seconds */
+
+typedef struct {
+  char magic[16];
+  guint32 version;
+  guint32 byte_order;
+  guint32 n_entries;
+  guint32 reserved;
+} FileHeader;
+
+typedef struct {
+  guint32 glyph;
+  guint16 xshift;
+  guint16 yshift;
+  guint32 width;
+  guint32 height;
+  guint64 offset; /* of the pixels, with a stride of width * 4 */
+} FileEntry;
+
+typedef struct {
+  guint32 glyph;
+  guint16 xshift;
+  guint16 yshift;
+  guint32 width;
+  guint32 height;
+  const guchar *data; /* points into the mapped file or owned_data */
+  guchar *owned_data;
+} Entry;
+
+struct _GskGlyphDiskCache
+{
+  char *path;
+  GMappedFile *mapped;
+  GHashTable *entries;
+  gsize size;
+  guint dirty : 1;
+};
+
+static guint
+entry_hash (gconstpointer v)
+{
+  const Entry *entry = v;
+
+  return entry->glyph ^ (entry->xshift << 24) ^ (entry->yshift << 26);
+}
+
+static gboolean
+entry_equal (gconstpointer v1,
+             gconstpointer v2)
+{
+  const Entry *entry1 = v1;
+  const Entry *entry2 = v2;
+
+  return entry1->glyph == entry2->glyph &&
+         entry1->xshift == entry2->xshift &&
+         entry1->yshift == entry2->yshift;
+}
+
+static void
+entry_free (gpointer v)
+{
+  Entry *entry = v;
+
+  g_free (entry->owned_data);
+  g_free (entry);
+}
+
+static gboolean
+is_enabled (void)
+{
+  static int enabled = -1;
+
+  if (enabled < 0)
+    {
+      const char *env = g_getenv ("GSK_GLYPH_DISK_CACHE");
+
+      enabled = env == NULL || strcmp (env, "0") != 0;
+    }
+
+  return enabled;
+}
+
+static char *
+get_cache_dir (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "gtk-4.0", "glyphs", NULL);
+}
+
+typedef struct {
+  char *path;
+  gint64 mtime;
+  gint64 size;
+} CacheFile;
+
+static int
+compare_cache_files (gconstpointer a,
+                     gconstpointer b)
+{
+  const CacheFile *file1 = a;
+  const CacheFile *file2 = b;
+
+  return file1->mtime < file2->mtime ? -1 : (file1->mtime > file2->mtime ? 1 : 0);
+}
+
+/*
+ * gsk_glyph_disk_cache_remove_stale:
+ *
+ * Removes the cache files that haven't been used for a long time,
+ * and then the least recently used ones, until the remaining files
+ * fit into the size limit for the cache.
+ */
+void
+gsk_glyph_disk_cache_remove_stale (void)
+{
+  GArray *files;
+  const char *name;
+  gint64 now, total_size;
+  char *dir;
+  GDir *gdir;
+  guint i;
+
+  dir = get_cache_dir ();
+  gdir = g_dir_open (dir, 0, NULL);
+  if (gdir == NULL)
+    {
+      g_free (dir);
+      return;
+    }
+
+  files = g_array_new (FALSE, FALSE, sizeof (CacheFile));
+  now = g_get_real_time () / G_USEC_PER_SEC;
+  total_size = 0;
+
+  while ((name = g_dir_read_name (gdir)))
+    {
+      CacheFile file;
+      GStatBuf buf;
+
+      if (!g_str_has_suffix (name, ".cache"))
+        continue;
+
+      file.path = g_build_filename (dir, name, NULL);
+      if (g_stat (file.path, &buf) != 0)
+        {
+          g_free (file.path);
+          continue;
+        }
+
+      if (now - (gint64) buf.st_mtime > MAX_UNUSED_TIME)
+        {
+          GSK_NOTE (GLYPH_CACHE, g_message ("Removing unused glyph cache %s", file.path));
+          g_remove (file.path);
+          g_free (file.path);
+          continue;
+        }
+
+      file.mtime = buf.st_mtime;
+      file.size = buf.st_size;
+      total_size += file.size;
+      g_array_append_val (files, file);
+    }
+
+  g_array_sort (files, compare_cache_files);
+
+  for (i = 0; i < files->len; i++)
+    {
+      CacheFile *file = &g_array_index (files, CacheFile, i);
+
+      if (total_size > MAX_CACHE_SIZE)
+        {
+          GSK_NOTE (GLYPH_CACHE, g_message ("Removing glyph cache %s to make room", file->path));
+          g_remove (file->path);
+          total_size -= file->size;
+        }
+
+      g_free (file->path);
+    }
+
+  g_array_free (files, TRUE);
+  g_dir_close (gdir);
+  g_free (dir);
+}
+
+static char *
+get_cache_path (PangoFont           *font,
+                cairo_scaled_font_t *scaled_font,
+                guint                scale)
+{
+  PangoFontDescription *desc;
+  cairo_font_options_t *options;
+  GChecksum *checksum;
+  GString *id;
+  char *dir;
+  char *basename;
+  char *path;
+
+  id = g_string_new (NULL);
+
+  desc = pango_font_describe_with_absolute_size (font);
+  basename = pango_font_description_to_string (desc);
+  g_string_append (id, basename);
+  g_free (basename);
+  pango_font_description_free (desc);
+
+#ifdef HAVE_PANGOFT
+  if (PANGO_IS_FC_FONT (font))
+    {
+      FcPattern *pattern = PANGO_FC_FONT (font)->font_pattern;
+      FcChar8 *file;
+      int index;
+      GStatBuf buf;
+
+      if (FcPatternGetString (pattern, FC_FILE, 0, &file) == FcResultMatch &&
+          g_stat ((const char *) file, &buf) == 0)
+        {
+          if (FcPatternGetInteger (pattern, FC_INDEX, 0, &index) != FcResultMatch)
+            index = 0;
+
+          g_string_append_printf (id, "|%s|%d|%" G_GINT64_FORMAT "|%" G_GINT64_FORMAT,
+                                  file, index,
+                                  (gint64) buf.st_mtime, (gint64) buf.st_size);
+        }
+    }
+#endif
+
+  options = cairo_font_options_create ();
+  cairo_scaled_font_get_font_options (scaled_font, options);
+  g_string_append_printf (id, "|%lx|%u|%s",
+                          cairo_font_options_hash (options),
+                          scale,
+                          cairo_version_string ());
+  cairo_font_options_destroy (options);
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA256);
+  g_checksum_update (checksum, (const guchar *) id->str, id->len);
+  basename = g_strdup_printf ("%s.cache", g_checksum_get_string (checksum));
+  g_checksum_free (checksum);
+  g_string_free (id, TRUE);
+
+  dir = get_cache_dir ();
+  path = g_build_filename (dir, basename, NULL);
+  if (g_mkdir_with_parents (dir, 0755) != 0)
+    {
+      g_warning ("Failed to mkdir %s", dir);
+      g_free (path);
+      path = NULL;
+    }
+
+  g_free (dir);
+  g_free (basename);
+
+  return path;
+}
+
+static void
+load_file (GskGlyphDiskCache *self)
+{
+  const FileHeader *header;
+  const FileEntry *file_entries;
+  const char *contents;
+  GStatBuf buf;
+  gsize length;
+  guint32 i;
+
+  self->mapped = g_mapped_file_new (self->path, FALSE, NULL);
+  if (self->mapped == NULL)
+    return;
+
+  /* Mark the file as used, see gsk_glyph_disk_cache_remove_stale() */
+  if (g_stat (self->path, &buf) == 0 &&
+      g_get_real_time () / G_USEC_PER_SEC - (gint64) buf.st_mtime > 24 * 60 * 60)
+    g_utime (self->path, NULL);
+
+  contents = g_mapped_file_get_contents (self->mapped);
+  length = g_mapped_file_get_length (self->mapped);
+  header = (const FileHeader *) contents;
+
+  if (length < sizeof (FileHeader) ||
+      strncmp (header->magic, GSK_GLYPH_DISK_CACHE_MAGIC, sizeof (header->magic)) != 0 ||
+      header->version != GSK_GLYPH_DISK_CACHE_VERSION ||
+      header->byte_order != GSK_GLYPH_DISK_CACHE_BYTE_ORDER ||
+      header->n_entries > (length - sizeof (FileHeader)) / sizeof (FileEntry))
+    goto broken;
+
+  file_entries = (const FileEntry *) (contents + sizeof (FileHeader));
+
+  for (i = 0; i < header->n_entries; i++)
+    {
+      const FileEntry *file_entry = &file_entries[i];
+      Entry *entry;
+
+      if (file_entry->width == 0 || file_entry->width > MAX_GLYPH_SIZE ||
+          file_entry->height == 0 || file_entry->height > MAX_GLYPH_SIZE ||
+          file_entry->offset > length ||
+          (guint64) file_entry->width * file_entry->height * 4 > length - file_entry->offset)
+        goto broken;
+
+      entry = g_new0 (Entry, 1);
+      entry->glyph = file_entry->glyph;
+      entry->xshift = file_entry->xshift;
+      entry->yshift = file_entry->yshift;
+      entry->width = file_entry->width;
+      entry->height = file_entry->height;
+      entry->data = (const guchar *) contents + file_entry->offset;
+
+      g_hash_table_add (self->entries, entry);
+    }
+
+  self->size = length;
+
+  GSK_NOTE (GLYPH_CACHE, g_message ("Loaded %u glyphs from %s", header->n_entries, self->path));
+
+  return;
+
+broken:
+  GSK_NOTE (GLYPH_CACHE, g_message ("Ignoring broken glyph cache %s", self->path));
+  g_hash_table_remove_all (self->entries);
+  g_clear_pointer (&self->mapped, g_mapped_file_unref);
+}
+
+/*
+ * gsk_glyph_disk_cache_new:
+ * @font: the font
+ * @scaled_font: the cairo font that will be used to render @font
+ * @scale: the scale, times 1024
+ *
+ * Opens the on-disk cache for the glyphs of @font at @scale.
+ *
+ * Returns: (nullable): the cache, or %NULL if it is turned off
+ *   or not available
+ */
+GskGlyphDiskCache *
+gsk_glyph_disk_cache_new (PangoFont           *font,
+                          cairo_scaled_font_t *scaled_font,
+                          guint                scale)
+{
+  static gsize stale_removed = 0;
+  GskGlyphDiskCache *self;
+  char *path;
+
+  if (!is_enabled ())
+    return NULL;
+
+  if (g_once_init_enter (&stale_removed))
+    {
+      gsk_glyph_disk_cache_remove_stale ();
+      g_once_init_leave (&stale_removed, 1);
+    }
+
+  path = get_cache_path (font, scaled_font, scale);
+  if (path == NULL)
+    return NULL;
+
+  self = g_new0 (GskGlyphDiskCache, 1);
+  self->path = path;
+  self->entries = g_hash_table_new_full (entry_hash, entry_equal, entry_free, NULL);
+  self->size = sizeof (FileHeader);
+
+  load_file (self);
+
+  return self;
+}
+
+void
+gsk_glyph_disk_cache_free (GskGlyphDiskCache *self)
+{
+  /* The entries point into the mapping */
+  g_hash_table_unref (self->entries);
+  g_clear_pointer (&self->mapped, g_mapped_file_unref);
+  g_free (self->path);
+  g_free (self);
+}
+
+/* Looks up the pixels of a glyph, in the ARGB32 format
+ * that cairo renders glyphs in. Entries with a different
+ * size are treated as missing. */
+gboolean
+gsk_glyph_disk_cache_lookup (GskGlyphDiskCache  *self,
+                             PangoGlyph          glyph,
+                             guint               xshift,
+                             guint               yshift,
+                             int                 width,
+                             int                 height,
+                             const guchar      **data,
+                             gsize              *stride)
+{
+  Entry lookup;
+  Entry *entry;
+
+  lookup.glyph = glyph;
+  lookup.xshift = xshift;
+  lookup.yshift = yshift;
+
+  entry = g_hash_table_lookup (self->entries, &lookup);
+  if (entry == NULL ||
+      entry->width != (guint32) width ||
+      entry->height != (guint32) height)
+    return FALSE;
+
+  *data = entry->data;
+  *stride = entry->width * 4;
+
+  return TRUE;
+}
+
+void
+gsk_glyph_disk_cache_add (GskGlyphDiskCache *self,
+                          PangoGlyph         glyph,
+                          guint              xshift,
+                          guint              yshift,
+                          int                width,
+                          int                height,
+                          const guchar      *data,
+                          gsize              stride)
+{
+  gsize size;
+  Entry *entry, *old_entry;
+  int y;
+
+  if (width <= 0 || width > MAX_GLYPH_SIZE ||
+      height <= 0 || height > MAX_GLYPH_SIZE)
+    return;
+
+  size = sizeof (FileEntry) + width * height * 4;
+  if (self->size + size > MAX_FILE_SIZE)
+    return;
+
+  entry = g_new0 (Entry, 1);
+  entry->glyph = glyph;
+  entry->xshift = xshift;
+  entry->yshift = yshift;
+  entry->width = width;
+  entry->height = height;
+  entry->owned_data = g_malloc (width * height * 4);
+  entry->data = entry->owned_data;
+
+  for (y = 0; y < height; y++)
+    memcpy (entry->owned_data + y * width * 4, data + y * stride, width * 4);
+
+  /* Replaces an entry of a different size */
+  old_entry = g_hash_table_lookup (self->entries, entry);
+  if (old_entry)
+    self->size -= sizeof (FileEntry) + old_entry->width * old_entry->height * 4;
+
+  g_hash_table_add (self->entries, entry);
+  self->size += size;
+
+  self->dirty = TRUE;
+}
+
+gboolean
+gsk_glyph_disk_cache_is_dirty (GskGlyphDiskCache *self)
+{
+  return self->dirty;
+}
+
+/* Writes all glyphs to a new file, that replaces the old one */
+void
+gsk_glyph_disk_cache_save (GskGlyphDiskCache *self)
+{
+  GHashTableIter iter;
+  FileHeader *header;
+  FileEntry *file_entry;
+  Entry *entry;
+  guchar *contents;
+  gsize length;
+  gsize offset;
+  GError *error = NULL;
+
+  if (!self->dirty)
+    return;
+
+  length = sizeof (FileHeader) + g_hash_table_size (self->entries) * sizeof (FileEntry);
+  offset = length;
+
+  g_hash_table_iter_init (&iter, self->entries);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &entry, NULL))
+    length += entry->width * entry->height * 4;
+
+  contents = g_malloc0 (length);
+
+  header = (FileHeader *) contents;
+  strncpy (header->magic, GSK_GLYPH_DISK_CACHE_MAGIC, sizeof (header->magic));
+  header->version = GSK_GLYPH_DISK_CACHE_VERSION;
+  header->byte_order = GSK_GLYPH_DISK_CACHE_BYTE_ORDER;
+  header->n_entries = g_hash_table_size (self->entries);
+
+  file_entry = (FileEntry *) (contents + sizeof (FileHeader));
+
+  g_hash_table_iter_init (&iter, self->entries);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &entry, NULL))
+    {
+      gsize size = entry->width * entry->height * 4;
+
+      file_entry->glyph = entry->glyph;
+      file_entry->xshift = entry->xshift;
+      file_entry->yshift = entry->yshift;
+      file_entry->width = entry->width;
+      file_entry->height = entry->height;
+      file_entry->offset = offset;
+      memcpy (contents + offset, entry->data, size);
+
+      offset += size;
+      file_entry++;
+    }
+
+  /* This replaces the file, so our mapping of the old one stays valid */
+  if (!g_file_set_contents (self->path, (const char *) contents, length, &error))
+    {
+      g_warning ("Failed to save glyph cache %s: %s", self->path, error->message);
+      g_error_free (error);
+    }
+  else
+    {
+      GSK_NOTE (GLYPH_CACHE, g_message ("Saved %u glyphs to %s", header->n_entries, self->path));
+    }
+
+  self->size = length;
+  self->dirty = FALSE;
+
+  g_free (contents);
+}
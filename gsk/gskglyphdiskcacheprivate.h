@@ -0,0 +1,38 @@
+#ifndef __GSK_GLYPH_DISK_CACHE_PRIVATE_H__
+#define __GSK_GLYPH_DISK_CACHE_PRIVATE_H__
+
+#include <pango/pangocairo.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GskGlyphDiskCache GskGlyphDiskCache;
+
+GskGlyphDiskCache *     gsk_glyph_disk_cache_new        (PangoFont           *font,
+                                                         cairo_scaled_font_t *scaled_font,
+                                                         guint                scale);
+void                    gsk_glyph_disk_cache_free       (GskGlyphDiskCache   *self);
+
+gboolean                gsk_glyph_disk_cache_lookup     (GskGlyphDiskCache   *self,
+                                                         PangoGlyph           glyph,
+                                                         guint                xshift,
+                                                         guint                yshift,
+                                                         int                  width,
+                                                         int                  height,
+                                                         const guchar       **data,
+                                                         gsize               *stride);
+void                    gsk_glyph_disk_cache_add        (GskGlyphDiskCache   *self,
+                                                         PangoGlyph           glyph,
+                                                         guint                xshift,
+                                                         guint                yshift,
+                                                         int                  width,
+                                                         int                  height,
+                                                         const guchar        *data,
+                                                         gsize                stride);
+gboolean                gsk_glyph_disk_cache_is_dirty   (GskGlyphDiskCache   *self);
+void                    gsk_glyph_disk_cache_save       (GskGlyphDiskCache   *self);
+
+void                    gsk_glyph_disk_cache_remove_stale (void);
+
+G_END_DECLS
+
+#endif /* __GSK_GLYPH_DISK_CACHE_PRIVATE_H__ */
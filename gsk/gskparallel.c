@@ -0,0 +1,130 @@
+#include "config.h"
+
+#include "gskprivate.h"
+
+/* A minimal parallel for loop on top of a shared thread pool.
+ *
+ * The calling thread takes part in the work, and only waits for
+ * items that have been picked up by a worker, so this does not
+ * deadlock when the pool is busy or when called from a worker.
+ */
+typedef struct {
+  GskParallelFunc func;
+  gpointer user_data;
+  guint n_items;
+
+  int next;      /* atomic */
+  int ref_count; /* atomic */
+
+  GMutex mutex;
+  GCond cond;
+  guint n_done;
+} ParallelJob;
+
+static void
+parallel_job_unref (ParallelJob *job)
+{
+  if (g_atomic_int_dec_and_test (&job->ref_count))
+    {
+      g_mutex_clear (&job->mutex);
+      g_cond_clear (&job->cond);
+      g_free (job);
+    }
+}
+
+static void
+parallel_job_run (ParallelJob *job)
+{
+  guint done = 0;
+  guint i;
+
+  while ((i = (guint) g_atomic_int_add (&job->next, 1)) < job->n_items)
+    {
+      job->func (i, job->user_data);
+      done++;
+    }
+
+  if (done == 0)
+    return;
+
+  g_mutex_lock (&job->mutex);
+  job->n_done += done;
+  if (job->n_done == job->n_items)
+    g_cond_signal (&job->cond);
+  g_mutex_unlock (&job->mutex);
+}
+
+static void
+parallel_worker (gpointer data,
+                 gpointer pool_data)
+{
+  ParallelJob *job = data;
+
+  parallel_job_run (job);
+  parallel_job_unref (job);
+}
+
+static gpointer
+create_thread_pool (gpointer data)
+{
+  guint n_threads = g_get_num_processors ();
+
+  if (n_threads < 2)
+    return NULL;
+
+  return g_thread_pool_new (parallel_worker, NULL, n_threads - 1, FALSE, NULL);
+}
+
+/*
+ * gsk_parallel_for:
+ * @n_items: the number of items
+ * @func: function to call for each item
+ * @user_data: data to pass to @func
+ *
+ * Calls @func for every index from 0 to @n_items - 1, spread
+ * over the available processors, and returns once all calls
+ * have finished. The order of the calls is undefined, so
+ * @func must only touch data belonging to its item.
+ */
+void
+gsk_parallel_for (guint           n_items,
+                  GskParallelFunc func,
+                  gpointer        user_data)
+{
+  static GOnce pool_once = G_ONCE_INIT;
+  GThreadPool *pool;
+  ParallelJob *job;
+  guint n_helpers;
+  guint i;
+
+  pool = g_once (&pool_once, create_thread_pool, NULL);
+
+  if (pool == NULL || n_items < 2)
+    {
+      for (i = 0; i < n_items; i++)
+        func (i, user_data);
+      return;
+    }
+
+  n_helpers = MIN (n_items, (guint) g_thread_pool_get_max_threads (pool) + 1) - 1;
+
+  job = g_new0 (ParallelJob, 1);
+  job->func = func;
+  job->user_data = user_data;
+  job->n_items = n_items;
+  job->ref_count = n_helpers + 1;
+  g_mutex_init (&job->mutex);
+  g_cond_init (&job->cond);
+
+  for (i = 0; i < n_helpers; i++)
+    g_thread_pool_push (pool, job, NULL);
+
+  parallel_job_run (job);
+
+  g_mutex_lock (&job->mutex);
+  while (job->n_done < job->n_items)
+    g_cond_wait (&job->cond, &job->mutex);
+  g_mutex_unlock (&job->mutex);
+
+  parallel_job_unref (job);
+}
@@ -10,6 +10,13 @@ void gsk_ensure_resources (void);
 
 int pango_glyph_string_num_glyphs (PangoGlyphString *glyphs);
 
+typedef void (* GskParallelFunc) (guint    index,
+                                  gpointer user_data);
+
+void gsk_parallel_for (guint           n_items,
+                       GskParallelFunc func,
+                       gpointer        user_data);
+
 typedef struct _GskVulkanRender GskVulkanRender;
 typedef struct _GskVulkanRenderPass GskVulkanRenderPass;
 
@@ -41,6 +41,7 @@
 #include "gl/gskglrenderer.h"
 #include "gskprofilerprivate.h"
 #include "gskrendernodeprivate.h"
+#include "gsktraceprivate.h"
 
 #include "gskenumtypes.h"
 
@@ -73,6 +74,8 @@ typedef struct
 
   GskDebugFlags debug_flags;
 
+  GskTraceWriter *trace;
+
   gboolean is_realized : 1;
 } GskRendererPrivate;
 
@@ -309,6 +312,7 @@ gsk_renderer_unrealize (GskRenderer *renderer)
   GSK_RENDERER_GET_CLASS (renderer)->unrealize (renderer);
 
   g_clear_pointer (&priv->prev_node, gsk_render_node_unref);
+  g_clear_pointer (&priv->trace, gsk_trace_writer_free);
 
   priv->is_realized = FALSE;
 }
@@ -376,6 +380,38 @@ gsk_renderer_render_texture (GskRenderer           *renderer,
   return texture;
 }
 
+#ifdef G_ENABLE_DEBUG
+static void
+gsk_renderer_record_frame (GskRenderer   *renderer,
+                           GskRenderNode *root)
+{
+  GskRendererPrivate *priv = gsk_renderer_get_instance_private (renderer);
+  GError *error = NULL;
+
+  if (priv->trace == NULL)
+    {
+      char *filename;
+
+      filename = g_strdup_printf ("%s-%" G_GINT64_FORMAT ".gsktrace",
+                                  g_get_prgname () ? g_get_prgname () : "gsk",
+                                  g_get_real_time ());
+      priv->trace = gsk_trace_writer_new (filename, &error);
+      if (priv->trace)
+        g_message ("Recording frames of %s to %s", G_OBJECT_TYPE_NAME (renderer), filename);
+      g_free (filename);
+    }
+
+  if (priv->trace == NULL ||
+      !gsk_trace_writer_add_frame (priv->trace, root, g_get_monotonic_time (), &error))
+    {
+      g_warning ("Stopped recording frames: %s", error->message);
+      g_error_free (error);
+      g_clear_pointer (&priv->trace, gsk_trace_writer_free);
+      priv->debug_flags &= ~GSK_DEBUG_RECORD;
+    }
+}
+#endif
+
 /**
  * gsk_renderer_render:
  * @renderer: a #GskRenderer
@@ -407,6 +443,11 @@ gsk_renderer_render (GskRenderer          *renderer,
   g_return_if_fail (GSK_IS_RENDER_NODE (root));
   g_return_if_fail (priv->root_node == NULL);
 
+#ifdef G_ENABLE_DEBUG
+  if (GSK_RENDERER_DEBUG_CHECK (renderer, RECORD))
+    gsk_renderer_record_frame (renderer, root);
+#endif
+
   if (region == NULL || priv->prev_node == NULL || GSK_RENDERER_DEBUG_CHECK (renderer, FULL_REDRAW))
     {
       clip = cairo_region_create_rectangle (&(GdkRectangle) {
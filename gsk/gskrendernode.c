@@ -62,12 +62,232 @@ G_DEFINE_BOXED_TYPE (GskRenderNode, gsk_render_node,
 
 G_DEFINE_QUARK (gsk-serialization-error-quark, gsk_serialization_error)
 
+/* Nodes created while a frame is being snapshot are short-lived and
+ * created in large numbers, so they are carved out of big chunks of
+ * memory owned by a #GskRenderNodeArena instead of being allocated one
+ * by one. The arena keeps a reference for every node it handed out and
+ * frees all chunks at once when the last of them is gone.
+ *
+ * Nodes that are kept around beyond the frame would keep the whole
+ * arena alive. Code that creates nodes it expects to keep, like widgets
+ * that are not redrawn every frame, turns the arena off for them with
+ * gsk_render_node_arena_set_enabled(), and draws them once more outside
+ * of the arena when they stop being redrawn. Nodes that only turn out to be
+ * kept later are moved to the heap with gsk_render_node_promote() at
+ * the point where they leave the frame. Promoting creates new nodes,
+ * so it must not be used for nodes that may be drawn again, as that
+ * defeats diffing and the renderers' caches.
+ */
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_MAX_NODE_SIZE (ARENA_CHUNK_SIZE / 8)
+#define ARENA_ALIGN(size) (((size) + 15) & ~(gsize) 15)
+
+typedef struct _GskRenderNodeArenaHeader GskRenderNodeArenaHeader;
+
+struct _GskRenderNodeArena
+{
+  int ref_count;
+  int n_nodes;
+
+  /* The arena that was current before this one was pushed */
+  GskRenderNodeArena *previous;
+
+  /* Each chunk starts with a pointer to the previous chunk */
+  guchar *chunks;
+  guchar *pos;
+  guchar *end;
+};
+
+struct _GskRenderNodeArenaHeader
+{
+  GskRenderNodeArena *arena;
+  gsize size;
+};
+
+#define ARENA_HEADER_SIZE ARENA_ALIGN (sizeof (GskRenderNodeArenaHeader))
+#define ARENA_CHUNK_HEADER_SIZE ARENA_ALIGN (sizeof (guchar *))
+
+static GPrivate current_arena;
+static GPrivate arena_disabled;
+
+static inline GskRenderNodeArenaHeader *
+gsk_render_node_get_arena_header (GskRenderNode *node)
+{
+  return (GskRenderNodeArenaHeader *) ((guchar *) node - ARENA_HEADER_SIZE);
+}
+
+/*< private >
+ * gsk_render_node_arena_new:
+ *
+ * Creates a new arena to allocate the nodes of a frame from.
+ * Use gsk_render_node_arena_push() to make it allocate the nodes
+ * created by the current thread.
+ *
+ * Returns: (transfer full): a new #GskRenderNodeArena
+ */
+GskRenderNodeArena *
+gsk_render_node_arena_new (void)
+{
+  GskRenderNodeArena *arena;
+
+  arena = g_slice_new0 (GskRenderNodeArena);
+  arena->ref_count = 1;
+
+  return arena;
+}
+
+/*< private >
+ * gsk_render_node_arena_ref:
+ * @arena: a #GskRenderNodeArena
+ *
+ * Acquires a reference on @arena.
+ *
+ * Returns: (transfer full): @arena
+ */
+GskRenderNodeArena *
+gsk_render_node_arena_ref (GskRenderNodeArena *arena)
+{
+  g_atomic_int_inc (&arena->ref_count);
+
+  return arena;
+}
+
+/*< private >
+ * gsk_render_node_arena_unref:
+ * @arena: (transfer full): a #GskRenderNodeArena
+ *
+ * Drops the reference to @arena that was returned by
+ * gsk_render_node_arena_new(). The memory of the arena is freed once
+ * all nodes that were allocated from it have been finalized.
+ */
+void
+gsk_render_node_arena_unref (GskRenderNodeArena *arena)
+{
+  guchar *chunk, *next;
+
+  if (!g_atomic_int_dec_and_test (&arena->ref_count))
+    return;
+
+  for (chunk = arena->chunks; chunk; chunk = next)
+    {
+      next = *(guchar **) chunk;
+      g_free (chunk);
+    }
+
+  g_slice_free (GskRenderNodeArena, arena);
+}
+
+/*< private >
+ * gsk_render_node_arena_get_n_nodes:
+ * @arena: a #GskRenderNodeArena
+ *
+ * Returns: the number of nodes allocated from @arena that are
+ *   still alive
+ */
+guint
+gsk_render_node_arena_get_n_nodes (GskRenderNodeArena *arena)
+{
+  return g_atomic_int_get (&arena->n_nodes);
+}
+
+/*< private >
+ * gsk_render_node_arena_push:
+ * @arena: a #GskRenderNodeArena
+ *
+ * Makes @arena the arena that nodes created by the current thread are
+ * allocated from, until gsk_render_node_arena_pop() is called.
+ */
+void
+gsk_render_node_arena_push (GskRenderNodeArena *arena)
+{
+  arena->previous = g_private_get (&current_arena);
+  g_private_set (&current_arena, arena);
+}
+
+/*< private >
+ * gsk_render_node_arena_pop:
+ * @arena: a #GskRenderNodeArena
+ *
+ * Undoes the effect of gsk_render_node_arena_push().
+ */
+void
+gsk_render_node_arena_pop (GskRenderNodeArena *arena)
+{
+  g_return_if_fail (g_private_get (&current_arena) == arena);
+
+  g_private_set (&current_arena, arena->previous);
+  arena->previous = NULL;
+}
+
+/*< private >
+ * gsk_render_node_arena_set_enabled:
+ * @enabled: whether nodes should be allocated from the current arena
+ *
+ * Turns allocating nodes from the current arena of this thread on or
+ * off, without popping it. Use this around code that creates nodes
+ * that are expected to outlive the frame.
+ *
+ * Returns: whether the arena was enabled before, to restore it with
+ */
+gboolean
+gsk_render_node_arena_set_enabled (gboolean enabled)
+{
+  gboolean was_enabled = !GPOINTER_TO_INT (g_private_get (&arena_disabled));
+
+  g_private_set (&arena_disabled, GINT_TO_POINTER (!enabled));
+
+  return was_enabled;
+}
+
+static GskRenderNode *
+gsk_render_node_arena_alloc (GskRenderNodeArena *arena,
+                             gsize               size)
+{
+  GskRenderNodeArenaHeader *header;
+  gsize needed;
+
+  needed = ARENA_HEADER_SIZE + ARENA_ALIGN (size);
+
+  if ((gsize) (arena->end - arena->pos) < needed)
+    {
+      guchar *chunk;
+
+      /* Chunks are never reused, so zeroing them once is enough to
+       * give the same guarantees as g_malloc0() */
+      chunk = g_malloc0 (ARENA_CHUNK_SIZE);
+      *(guchar **) chunk = arena->chunks;
+
+      arena->chunks = chunk;
+      arena->pos = chunk + ARENA_CHUNK_HEADER_SIZE;
+      arena->end = chunk + ARENA_CHUNK_SIZE;
+    }
+
+  header = (GskRenderNodeArenaHeader *) arena->pos;
+  header->arena = arena;
+  header->size = size;
+
+  arena->pos += needed;
+
+  g_atomic_int_inc (&arena->ref_count);
+  g_atomic_int_inc (&arena->n_nodes);
+
+  return (GskRenderNode *) ((guchar *) header + ARENA_HEADER_SIZE);
+}
+
 static void
 gsk_render_node_finalize (GskRenderNode *self)
 {
   self->node_class->finalize (self);
 
-  g_free (self);
+  if (self->in_arena)
+    {
+      GskRenderNodeArena *arena = gsk_render_node_get_arena_header (self)->arena;
+
+      g_atomic_int_add (&arena->n_nodes, -1);
+      gsk_render_node_arena_unref (arena);
+    }
+  else
+    g_free (self);
 }
 
 /*< private >
@@ -79,12 +299,26 @@ gsk_render_node_finalize (GskRenderNode *self)
 GskRenderNode *
 gsk_render_node_new (const GskRenderNodeClass *node_class, gsize extra_size)
 {
+  GskRenderNodeArena *arena;
   GskRenderNode *self;
+  gsize size;
 
   g_return_val_if_fail (node_class != NULL, NULL);
   g_return_val_if_fail (node_class->node_type != GSK_NOT_A_RENDER_NODE, NULL);
 
-  self = g_malloc0 (node_class->struct_size + extra_size);
+  arena = g_private_get (&current_arena);
+  size = node_class->struct_size + extra_size;
+
+  if (arena != NULL && size <= ARENA_MAX_NODE_SIZE &&
+      !GPOINTER_TO_INT (g_private_get (&arena_disabled)))
+    {
+      self = gsk_render_node_arena_alloc (arena, size);
+      self->in_arena = TRUE;
+    }
+  else
+    {
+      self = g_malloc0 (size);
+    }
 
   self->node_class = node_class;
 
@@ -93,6 +327,38 @@ gsk_render_node_new (const GskRenderNodeClass *node_class, gsize extra_size)
   return self;
 }
 
+/*< private >
+ * gsk_render_node_promote:
+ * @node: (transfer full): a #GskRenderNode
+ *
+ * Makes sure that @node and its children do not keep the arena they
+ * were allocated from alive, by copying them to the heap if necessary.
+ *
+ * Call this when holding on to a node beyond the frame it was
+ * created in.
+ *
+ * Returns: (transfer full): a #GskRenderNode that is equivalent to @node
+ */
+GskRenderNode *
+gsk_render_node_promote (GskRenderNode *node)
+{
+  GskRenderNode *copy;
+
+  g_return_val_if_fail (GSK_IS_RENDER_NODE (node), NULL);
+
+  if (!node->in_arena)
+    return node;
+
+  copy = g_memdup (node, gsk_render_node_get_arena_header (node)->size);
+  copy->ref_count = 1;
+  copy->in_arena = FALSE;
+  gsk_render_node_promote_contents (copy);
+
+  gsk_render_node_unref (node);
+
+  return copy;
+}
+
 /**
  * gsk_render_node_ref:
  * @node: a #GskRenderNode
@@ -357,8 +623,10 @@ gsk_render_node_write_to_file (GskRenderNode *node,
  * @error_func: (nullable) (scope call): Callback on parsing errors or %NULL
  * @user_data: (closure error_func): user_data for @error_func
  *
- * Loads data previously created via gsk_render_node_serialize(). For a
- * discussion of the supported format, see that function.
+ * Loads data previously created via gsk_render_node_serialize() or
+ * gsk_render_node_serialize_binary(). The format is detected
+ * automatically. For a discussion of the supported formats, see
+ * those functions.
  *
  * Returns: (nullable) (transfer full): a new #GskRenderNode or %NULL on
  *     error.
@@ -370,7 +638,10 @@ gsk_render_node_deserialize (GBytes            *bytes,
 {
   GskRenderNode *node = NULL;
 
-  node = gsk_render_node_deserialize_from_bytes (bytes, error_func, user_data);
+  if (gsk_render_node_is_binary (bytes))
+    node = gsk_render_node_deserialize_binary (bytes, error_func, user_data);
+  else
+    node = gsk_render_node_deserialize_from_bytes (bytes, error_func, user_data);
 
   return node;
 }
@@ -91,6 +91,8 @@ void                    gsk_render_node_draw                    (GskRenderNode *
 GDK_AVAILABLE_IN_ALL
 GBytes *                gsk_render_node_serialize               (GskRenderNode *node);
 GDK_AVAILABLE_IN_ALL
+GBytes *                gsk_render_node_serialize_binary        (GskRenderNode *node);
+GDK_AVAILABLE_IN_ALL
 gboolean                gsk_render_node_write_to_file           (GskRenderNode *node,
                                                                  const char    *filename,
                                                                  GError       **error);
@@ -141,6 +143,54 @@ GskRenderNode *         gsk_repeating_linear_gradient_node_new      (const graph
                                                                      const GskColorStop       *color_stops,
                                                                      gsize                     n_color_stops);
 
+GDK_AVAILABLE_IN_ALL
+GskRenderNode *         gsk_radial_gradient_node_new                (const graphene_rect_t    *bounds,
+                                                                     const graphene_point_t   *center,
+                                                                     float                     hradius,
+                                                                     float                     vradius,
+                                                                     float                     start,
+                                                                     float                     end,
+                                                                     const GskColorStop       *color_stops,
+                                                                     gsize                     n_color_stops);
+GDK_AVAILABLE_IN_ALL
+GskRenderNode *         gsk_repeating_radial_gradient_node_new      (const graphene_rect_t    *bounds,
+                                                                     const graphene_point_t   *center,
+                                                                     float                     hradius,
+                                                                     float                     vradius,
+                                                                     float                     start,
+                                                                     float                     end,
+                                                                     const GskColorStop       *color_stops,
+                                                                     gsize                     n_color_stops);
+GDK_AVAILABLE_IN_ALL
+gsize                    gsk_radial_gradient_node_get_n_color_stops (GskRenderNode            *node);
+GDK_AVAILABLE_IN_ALL
+const GskColorStop *     gsk_radial_gradient_node_peek_color_stops  (GskRenderNode            *node);
+GDK_AVAILABLE_IN_ALL
+const graphene_point_t * gsk_radial_gradient_node_peek_center       (GskRenderNode            *node);
+GDK_AVAILABLE_IN_ALL
+float                    gsk_radial_gradient_node_get_hradius       (GskRenderNode            *node);
+GDK_AVAILABLE_IN_ALL
+float                    gsk_radial_gradient_node_get_vradius       (GskRenderNode            *node);
+GDK_AVAILABLE_IN_ALL
+float                    gsk_radial_gradient_node_get_start         (GskRenderNode            *node);
+GDK_AVAILABLE_IN_ALL
+float                    gsk_radial_gradient_node_get_end           (GskRenderNode            *node);
+
+GDK_AVAILABLE_IN_ALL
+GskRenderNode *         gsk_conic_gradient_node_new                 (const graphene_rect_t    *bounds,
+                                                                     const graphene_point_t   *center,
+                                                                     float                     rotation,
+                                                                     const GskColorStop       *color_stops,
+                                                                     gsize                     n_color_stops);
+GDK_AVAILABLE_IN_ALL
+gsize                    gsk_conic_gradient_node_get_n_color_stops  (GskRenderNode            *node);
+GDK_AVAILABLE_IN_ALL
+const GskColorStop *     gsk_conic_gradient_node_peek_color_stops   (GskRenderNode            *node);
+GDK_AVAILABLE_IN_ALL
+const graphene_point_t * gsk_conic_gradient_node_peek_center        (GskRenderNode            *node);
+GDK_AVAILABLE_IN_ALL
+float                    gsk_conic_gradient_node_get_rotation       (GskRenderNode            *node);
+
 GDK_AVAILABLE_IN_ALL
 GskRenderNode *         gsk_border_node_new                     (const GskRoundedRect     *outline,
                                                                  const float               border_width[4],
@@ -0,0 +1,1705 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gskrendernodeparserprivate.h"
+
+#include "gskrendernodeprivate.h"
+#include "gsktransformprivate.h"
+
+#include "gdk/gdktextureprivate.h"
+#include <gtk/css/gtkcss.h>
+
+#include <math.h>
+#include <string.h>
+
+/* The binary node format.
+ *
+ * It is meant to be written at frame rate and to be read straight
+ * out of a mapped file, so everything is stored as little-endian
+ * 32bit words at 4 byte aligned offsets and nothing is compressed.
+ *
+ * The file starts with a header:
+ *
+ *   magic           8 bytes, GSK_BINARY_NODE_MAGIC
+ *   version         GSK_BINARY_NODE_VERSION
+ *   n_strings
+ *   n_textures
+ *   n_nodes
+ *   strings_offset  n_strings x { offset, length }
+ *   textures_offset n_textures x { width, height, stride, offset }
+ *   nodes_offset
+ *   nodes_size
+ *
+ * Strings (font descriptions and debug messages) and textures are
+ * stored once, no matter how many nodes use them. String data is
+ * nul-terminated; texture data is premultiplied ARGB32 in native
+ * cairo layout, aligned to 16 bytes, so the texture can reference
+ * the file contents directly.
+ *
+ * Nodes are stored in post-order, each one as its type followed by
+ * its fields. Children are referred to by their index in the node
+ * list, so a node can only refer to nodes stored before it, and
+ * nodes that are used in multiple places are only stored once.
+ * The last node is the root.
+ *
+ * Readers refuse files with a newer version than they know about.
+ */
+
+#define GSK_BINARY_NODE_MAGIC "\211GSKNODE"
+#define GSK_BINARY_NODE_MAGIC_SIZE 8
+#define GSK_BINARY_NODE_VERSION 1
+#define GSK_BINARY_NODE_HEADER_SIZE (GSK_BINARY_NODE_MAGIC_SIZE + 8 * 4)
+
+#define NO_INDEX G_MAXUINT32
+
+/* Texture data alignment */
+#define DATA_ALIGNMENT 16
+
+typedef enum {
+  TRANSFORM_IDENTITY,
+  TRANSFORM_TRANSLATE,
+  TRANSFORM_AFFINE,
+  TRANSFORM_MATRIX
+} TransformKind;
+
+static PangoFont *
+font_from_string (const char *string)
+{
+  PangoFontDescription *desc;
+  PangoFontMap *font_map;
+  PangoContext *context;
+  PangoFont *font;
+
+  desc = pango_font_description_from_string (string);
+  font_map = pango_cairo_font_map_get_default ();
+  context = pango_font_map_create_context (font_map);
+  font = pango_font_map_load_font (font_map, context, desc);
+
+  pango_font_description_free (desc);
+  g_object_unref (context);
+
+  return font;
+}
+
+/*** WRITER ***/
+
+typedef struct {
+  int width;
+  int height;
+  guchar *data;
+} WriterTexture;
+
+typedef struct {
+  GByteArray *nodes;
+  guint n_nodes;
+  GHashTable *node_indexes;
+  GPtrArray *strings;
+  GHashTable *string_indexes;
+  GPtrArray *textures;
+  GHashTable *texture_indexes;
+} Writer;
+
+static void
+writer_texture_free (gpointer data)
+{
+  WriterTexture *texture = data;
+
+  g_free (texture->data);
+  g_slice_free (WriterTexture, texture);
+}
+
+static void
+writer_init (Writer *self)
+{
+  self->nodes = g_byte_array_new ();
+  self->n_nodes = 0;
+  self->node_indexes = g_hash_table_new (NULL, NULL);
+  self->strings = g_ptr_array_new_with_free_func (g_free);
+  self->string_indexes = g_hash_table_new (g_str_hash, g_str_equal);
+  self->textures = g_ptr_array_new_with_free_func (writer_texture_free);
+  self->texture_indexes = g_hash_table_new (NULL, NULL);
+}
+
+static void
+writer_clear (Writer *self)
+{
+  g_byte_array_unref (self->nodes);
+  g_hash_table_unref (self->node_indexes);
+  g_hash_table_unref (self->string_indexes);
+  g_ptr_array_unref (self->strings);
+  g_hash_table_unref (self->texture_indexes);
+  g_ptr_array_unref (self->textures);
+}
+
+static void
+append_uint (GByteArray *array,
+             guint32     value)
+{
+  value = GUINT32_TO_LE (value);
+  g_byte_array_append (array, (guchar *) &value, sizeof (value));
+}
+
+static void
+append_float (GByteArray *array,
+              float       value)
+{
+  union { float f; guint32 u; } u = { value };
+
+  append_uint (array, u.u);
+}
+
+static void
+append_padding (GByteArray *array,
+                guint       alignment)
+{
+  static const guchar zeros[DATA_ALIGNMENT] = { 0, };
+
+  if (array->len % alignment)
+    g_byte_array_append (array, zeros, alignment - array->len % alignment);
+}
+
+static void
+write_uint (Writer  *self,
+            guint32  value)
+{
+  append_uint (self->nodes, value);
+}
+
+static void
+write_float (Writer *self,
+             float   value)
+{
+  append_float (self->nodes, value);
+}
+
+static void
+write_point (Writer                 *self,
+             const graphene_point_t *point)
+{
+  write_float (self, point->x);
+  write_float (self, point->y);
+}
+
+static void
+write_rect (Writer                *self,
+            const graphene_rect_t *rect)
+{
+  write_float (self, rect->origin.x);
+  write_float (self, rect->origin.y);
+  write_float (self, rect->size.width);
+  write_float (self, rect->size.height);
+}
+
+static void
+write_rounded_rect (Writer               *self,
+                    const GskRoundedRect *rect)
+{
+  guint i;
+
+  write_rect (self, &rect->bounds);
+  for (i = 0; i < 4; i++)
+    {
+      write_float (self, rect->corner[i].width);
+      write_float (self, rect->corner[i].height);
+    }
+}
+
+static void
+write_rgba (Writer        *self,
+            const GdkRGBA *rgba)
+{
+  write_float (self, rgba->red);
+  write_float (self, rgba->green);
+  write_float (self, rgba->blue);
+  write_float (self, rgba->alpha);
+}
+
+static void
+write_stops (Writer             *self,
+             const GskColorStop *stops,
+             gsize               n_stops)
+{
+  gsize i;
+
+  write_uint (self, n_stops);
+  for (i = 0; i < n_stops; i++)
+    {
+      write_float (self, stops[i].offset);
+      write_rgba (self, &stops[i].color);
+    }
+}
+
+static void
+write_matrix (Writer                  *self,
+              const graphene_matrix_t *matrix)
+{
+  float v[16];
+  guint i;
+
+  graphene_matrix_to_float (matrix, v);
+  for (i = 0; i < 16; i++)
+    write_float (self, v[i]);
+}
+
+static void
+write_transform (Writer       *self,
+                 GskTransform *transform)
+{
+  switch (gsk_transform_get_category (transform))
+    {
+    case GSK_TRANSFORM_CATEGORY_IDENTITY:
+      write_uint (self, TRANSFORM_IDENTITY);
+      break;
+
+    case GSK_TRANSFORM_CATEGORY_2D_TRANSLATE:
+      {
+        float dx, dy;
+
+        gsk_transform_to_translate (transform, &dx, &dy);
+        write_uint (self, TRANSFORM_TRANSLATE);
+        write_float (self, dx);
+        write_float (self, dy);
+      }
+      break;
+
+    case GSK_TRANSFORM_CATEGORY_2D_AFFINE:
+      {
+        float scale_x, scale_y, dx, dy;
+
+        gsk_transform_to_affine (transform, &scale_x, &scale_y, &dx, &dy);
+        write_uint (self, TRANSFORM_AFFINE);
+        write_float (self, scale_x);
+        write_float (self, scale_y);
+        write_float (self, dx);
+        write_float (self, dy);
+      }
+      break;
+
+    case GSK_TRANSFORM_CATEGORY_UNKNOWN:
+    case GSK_TRANSFORM_CATEGORY_ANY:
+    case GSK_TRANSFORM_CATEGORY_3D:
+    case GSK_TRANSFORM_CATEGORY_2D:
+    default:
+      {
+        graphene_matrix_t matrix;
+
+        gsk_transform_to_matrix (transform, &matrix);
+        write_uint (self, TRANSFORM_MATRIX);
+        write_matrix (self, &matrix);
+      }
+      break;
+    }
+}
+
+static void
+write_string (Writer     *self,
+              const char *string)
+{
+  gpointer index;
+
+  if (string == NULL)
+    {
+      write_uint (self, NO_INDEX);
+      return;
+    }
+
+  index = g_hash_table_lookup (self->string_indexes, string);
+  if (index == NULL)
+    {
+      char *copy = g_strdup (string);
+
+      g_ptr_array_add (self->strings, copy);
+      index = GUINT_TO_POINTER (self->strings->len);
+      g_hash_table_insert (self->string_indexes, copy, index);
+    }
+
+  write_uint (self, GPOINTER_TO_UINT (index) - 1);
+}
+
+static guint
+writer_add_texture (Writer        *self,
+                    gconstpointer  key,
+                    WriterTexture *texture)
+{
+  g_ptr_array_add (self->textures, texture);
+  g_hash_table_insert (self->texture_indexes, (gpointer) key, GUINT_TO_POINTER (self->textures->len));
+
+  return self->textures->len - 1;
+}
+
+static void
+write_texture (Writer     *self,
+               GdkTexture *texture)
+{
+  WriterTexture *data;
+  gpointer index;
+
+  index = g_hash_table_lookup (self->texture_indexes, texture);
+  if (index != NULL)
+    {
+      write_uint (self, GPOINTER_TO_UINT (index) - 1);
+      return;
+    }
+
+  data = g_slice_new (WriterTexture);
+  data->width = gdk_texture_get_width (texture);
+  data->height = gdk_texture_get_height (texture);
+  data->data = g_malloc ((gsize) data->width * data->height * 4);
+  gdk_texture_download (texture, data->data, data->width * 4);
+
+  write_uint (self, writer_add_texture (self, texture, data));
+}
+
+/* Cairo nodes are stored as the pixels they draw, like in the
+ * text format, as we can not store the drawing commands.
+ */
+static void
+write_cairo_surface (Writer                *self,
+                     cairo_surface_t       *surface,
+                     const graphene_rect_t *bounds)
+{
+  WriterTexture *data;
+  cairo_surface_t *image;
+  cairo_t *cr;
+  gpointer index;
+  int y;
+
+  if (surface == NULL || ceilf (bounds->size.width) <= 0 || ceilf (bounds->size.height) <= 0)
+    {
+      write_uint (self, NO_INDEX);
+      return;
+    }
+
+  index = g_hash_table_lookup (self->texture_indexes, surface);
+  if (index != NULL)
+    {
+      write_uint (self, GPOINTER_TO_UINT (index) - 1);
+      return;
+    }
+
+  data = g_slice_new (WriterTexture);
+  data->width = ceilf (bounds->size.width);
+  data->height = ceilf (bounds->size.height);
+  data->data = g_malloc ((gsize) data->width * data->height * 4);
+
+  image = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, data->width, data->height);
+  cr = cairo_create (image);
+  cairo_translate (cr, - bounds->origin.x, - bounds->origin.y);
+  cairo_set_source_surface (cr, surface, 0, 0);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+  cairo_surface_flush (image);
+
+  for (y = 0; y < data->height; y++)
+    memcpy (data->data + y * data->width * 4,
+            cairo_image_surface_get_data (image) + y * cairo_image_surface_get_stride (image),
+            data->width * 4);
+
+  cairo_surface_destroy (image);
+
+  write_uint (self, writer_add_texture (self, surface, data));
+}
+
+static guint
+writer_add_node (Writer        *self,
+                 GskRenderNode *node)
+{
+  GskRenderNodeType type = gsk_render_node_get_node_type (node);
+  guint *children = NULL;
+  guint n_children = 0;
+  gpointer index;
+  guint i;
+
+  index = g_hash_table_lookup (self->node_indexes, node);
+  if (index != NULL)
+    return GPOINTER_TO_UINT (index) - 1;
+
+  /* Children go first, so the reader has them available when it
+   * reaches the parent.
+   */
+  switch (type)
+    {
+    case GSK_CONTAINER_NODE:
+      n_children = gsk_container_node_get_n_children (node);
+      children = g_new (guint, n_children);
+      for (i = 0; i < n_children; i++)
+        children[i] = writer_add_node (self, gsk_container_node_get_child (node, i));
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      n_children = 1;
+      children = g_new (guint, 1);
+      children[0] = writer_add_node (self, gsk_transform_node_get_child (node));
+      break;
+
+    case GSK_OPACITY_NODE:
+      n_children = 1;
+      children = g_new (guint, 1);
+      children[0] = writer_add_node (self, gsk_opacity_node_get_child (node));
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      n_children = 1;
+      children = g_new (guint, 1);
+      children[0] = writer_add_node (self, gsk_color_matrix_node_get_child (node));
+      break;
+
+    case GSK_REPEAT_NODE:
+      n_children = 1;
+      children = g_new (guint, 1);
+      children[0] = writer_add_node (self, gsk_repeat_node_get_child (node));
+      break;
+
+    case GSK_CLIP_NODE:
+      n_children = 1;
+      children = g_new (guint, 1);
+      children[0] = writer_add_node (self, gsk_clip_node_get_child (node));
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      n_children = 1;
+      children = g_new (guint, 1);
+      children[0] = writer_add_node (self, gsk_rounded_clip_node_get_child (node));
+      break;
+
+    case GSK_SHADOW_NODE:
+      n_children = 1;
+      children = g_new (guint, 1);
+      children[0] = writer_add_node (self, gsk_shadow_node_get_child (node));
+      break;
+
+    case GSK_BLUR_NODE:
+      n_children = 1;
+      children = g_new (guint, 1);
+      children[0] = writer_add_node (self, gsk_blur_node_get_child (node));
+      break;
+
+    case GSK_DEBUG_NODE:
+      n_children = 1;
+      children = g_new (guint, 1);
+      children[0] = writer_add_node (self, gsk_debug_node_get_child (node));
+      break;
+
+    case GSK_BLEND_NODE:
+      n_children = 2;
+      children = g_new (guint, 2);
+      children[0] = writer_add_node (self, gsk_blend_node_get_bottom_child (node));
+      children[1] = writer_add_node (self, gsk_blend_node_get_top_child (node));
+      break;
+
+    case GSK_CROSS_FADE_NODE:
+      n_children = 2;
+      children = g_new (guint, 2);
+      children[0] = writer_add_node (self, gsk_cross_fade_node_get_start_child (node));
+      children[1] = writer_add_node (self, gsk_cross_fade_node_get_end_child (node));
+      break;
+
+    case GSK_NOT_A_RENDER_NODE:
+      g_assert_not_reached ();
+      break;
+
+    case GSK_CAIRO_NODE:
+    case GSK_COLOR_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+    case GSK_CONIC_GRADIENT_NODE:
+    case GSK_BORDER_NODE:
+    case GSK_TEXTURE_NODE:
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+    case GSK_TEXT_NODE:
+    default:
+      break;
+    }
+
+  write_uint (self, type);
+
+  if (type == GSK_CONTAINER_NODE)
+    write_uint (self, n_children);
+  for (i = 0; i < n_children; i++)
+    write_uint (self, children[i]);
+  g_free (children);
+
+  switch (type)
+    {
+    case GSK_CONTAINER_NODE:
+      break;
+
+    case GSK_BLEND_NODE:
+      write_uint (self, gsk_blend_node_get_blend_mode (node));
+      break;
+
+    case GSK_CAIRO_NODE:
+      write_rect (self, &node->bounds);
+      write_cairo_surface (self, gsk_cairo_node_peek_surface (node), &node->bounds);
+      break;
+
+    case GSK_COLOR_NODE:
+      write_rect (self, &node->bounds);
+      write_rgba (self, gsk_color_node_peek_color (node));
+      break;
+
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+      write_rect (self, &node->bounds);
+      write_point (self, gsk_linear_gradient_node_peek_start (node));
+      write_point (self, gsk_linear_gradient_node_peek_end (node));
+      write_stops (self,
+                   gsk_linear_gradient_node_peek_color_stops (node),
+                   gsk_linear_gradient_node_get_n_color_stops (node));
+      break;
+
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+      write_rect (self, &node->bounds);
+      write_point (self, gsk_radial_gradient_node_peek_center (node));
+      write_float (self, gsk_radial_gradient_node_get_hradius (node));
+      write_float (self, gsk_radial_gradient_node_get_vradius (node));
+      write_float (self, gsk_radial_gradient_node_get_start (node));
+      write_float (self, gsk_radial_gradient_node_get_end (node));
+      write_stops (self,
+                   gsk_radial_gradient_node_peek_color_stops (node),
+                   gsk_radial_gradient_node_get_n_color_stops (node));
+      break;
+
+    case GSK_CONIC_GRADIENT_NODE:
+      write_rect (self, &node->bounds);
+      write_point (self, gsk_conic_gradient_node_peek_center (node));
+      write_float (self, gsk_conic_gradient_node_get_rotation (node));
+      write_stops (self,
+                   gsk_conic_gradient_node_peek_color_stops (node),
+                   gsk_conic_gradient_node_get_n_color_stops (node));
+      break;
+
+    case GSK_BORDER_NODE:
+      {
+        const float *widths = gsk_border_node_peek_widths (node);
+        const GdkRGBA *colors = gsk_border_node_peek_colors (node);
+
+        write_rounded_rect (self, gsk_border_node_peek_outline (node));
+        for (i = 0; i < 4; i++)
+          write_float (self, widths[i]);
+        for (i = 0; i < 4; i++)
+          write_rgba (self, &colors[i]);
+      }
+      break;
+
+    case GSK_TEXTURE_NODE:
+      write_rect (self, &node->bounds);
+      write_texture (self, gsk_texture_node_get_texture (node));
+      break;
+
+    case GSK_INSET_SHADOW_NODE:
+      write_rounded_rect (self, gsk_inset_shadow_node_peek_outline (node));
+      write_rgba (self, gsk_inset_shadow_node_peek_color (node));
+      write_float (self, gsk_inset_shadow_node_get_dx (node));
+      write_float (self, gsk_inset_shadow_node_get_dy (node));
+      write_float (self, gsk_inset_shadow_node_get_spread (node));
+      write_float (self, gsk_inset_shadow_node_get_blur_radius (node));
+      break;
+
+    case GSK_OUTSET_SHADOW_NODE:
+      write_rounded_rect (self, gsk_outset_shadow_node_peek_outline (node));
+      write_rgba (self, gsk_outset_shadow_node_peek_color (node));
+      write_float (self, gsk_outset_shadow_node_get_dx (node));
+      write_float (self, gsk_outset_shadow_node_get_dy (node));
+      write_float (self, gsk_outset_shadow_node_get_spread (node));
+      write_float (self, gsk_outset_shadow_node_get_blur_radius (node));
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      write_transform (self, gsk_transform_node_get_transform (node));
+      break;
+
+    case GSK_OPACITY_NODE:
+      write_float (self, gsk_opacity_node_get_opacity (node));
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      {
+        float v[4];
+
+        write_matrix (self, gsk_color_matrix_node_peek_color_matrix (node));
+        graphene_vec4_to_float (gsk_color_matrix_node_peek_color_offset (node), v);
+        for (i = 0; i < 4; i++)
+          write_float (self, v[i]);
+      }
+      break;
+
+    case GSK_REPEAT_NODE:
+      write_rect (self, &node->bounds);
+      write_rect (self, gsk_repeat_node_peek_child_bounds (node));
+      break;
+
+    case GSK_CLIP_NODE:
+      write_rect (self, gsk_clip_node_peek_clip (node));
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      write_rounded_rect (self, gsk_rounded_clip_node_peek_clip (node));
+      break;
+
+    case GSK_SHADOW_NODE:
+      {
+        gsize n_shadows = gsk_shadow_node_get_n_shadows (node);
+
+        write_uint (self, n_shadows);
+        for (i = 0; i < n_shadows; i++)
+          {
+            const GskShadow *shadow = gsk_shadow_node_peek_shadow (node, i);
+
+            write_rgba (self, &shadow->color);
+            write_float (self, shadow->dx);
+            write_float (self, shadow->dy);
+            write_float (self, shadow->radius);
+          }
+      }
+      break;
+
+    case GSK_CROSS_FADE_NODE:
+      write_float (self, gsk_cross_fade_node_get_progress (node));
+      break;
+
+    case GSK_TEXT_NODE:
+      {
+        const PangoGlyphInfo *glyphs = gsk_text_node_peek_glyphs (node);
+        guint n_glyphs = gsk_text_node_get_num_glyphs (node);
+        PangoFontDescription *desc;
+        char *font_name;
+
+        desc = pango_font_describe (gsk_text_node_peek_font (node));
+        font_name = pango_font_description_to_string (desc);
+        write_string (self, font_name);
+        g_free (font_name);
+        pango_font_description_free (desc);
+
+        write_rgba (self, gsk_text_node_peek_color (node));
+        write_point (self, gsk_text_node_get_offset (node));
+        write_uint (self, n_glyphs);
+        for (i = 0; i < n_glyphs; i++)
+          {
+            write_uint (self, glyphs[i].glyph);
+            write_uint (self, glyphs[i].geometry.width);
+            write_uint (self, glyphs[i].geometry.x_offset);
+            write_uint (self, glyphs[i].geometry.y_offset);
+            write_uint (self, glyphs[i].attr.is_cluster_start);
+          }
+      }
+      break;
+
+    case GSK_BLUR_NODE:
+      write_float (self, gsk_blur_node_get_radius (node));
+      break;
+
+    case GSK_DEBUG_NODE:
+      write_string (self, gsk_debug_node_get_message (node));
+      break;
+
+    case GSK_NOT_A_RENDER_NODE:
+    default:
+      g_assert_not_reached ();
+      break;
+    }
+
+  g_hash_table_insert (self->node_indexes, node, GUINT_TO_POINTER (self->n_nodes + 1));
+
+  return self->n_nodes++;
+}
+
+static GBytes *
+writer_finish (Writer *self)
+{
+  GByteArray *result;
+  GByteArray *strings;
+  guint strings_offset, textures_offset, nodes_offset;
+  guint string_data_offset, texture_data_offset;
+  guint i;
+
+  strings_offset = GSK_BINARY_NODE_HEADER_SIZE;
+  textures_offset = strings_offset + self->strings->len * 2 * 4;
+  nodes_offset = textures_offset + self->textures->len * 4 * 4;
+  string_data_offset = nodes_offset + self->nodes->len;
+
+  strings = g_byte_array_new ();
+  for (i = 0; i < self->strings->len; i++)
+    {
+      const char *s = g_ptr_array_index (self->strings, i);
+
+      g_byte_array_append (strings, (const guchar *) s, strlen (s) + 1);
+    }
+  /* The padding depends on where the strings are in the file */
+  while ((string_data_offset + strings->len) % DATA_ALIGNMENT)
+    g_byte_array_append (strings, (const guchar *) "", 1);
+  texture_data_offset = string_data_offset + strings->len;
+
+  result = g_byte_array_new ();
+
+  g_byte_array_append (result, (const guchar *) GSK_BINARY_NODE_MAGIC, GSK_BINARY_NODE_MAGIC_SIZE);
+  append_uint (result, GSK_BINARY_NODE_VERSION);
+  append_uint (result, self->strings->len);
+  append_uint (result, self->textures->len);
+  append_uint (result, self->n_nodes);
+  append_uint (result, strings_offset);
+  append_uint (result, textures_offset);
+  append_uint (result, nodes_offset);
+  append_uint (result, self->nodes->len);
+  g_assert (result->len == strings_offset);
+
+  for (i = 0; i < self->strings->len; i++)
+    {
+      const char *s = g_ptr_array_index (self->strings, i);
+
+      append_uint (result, string_data_offset);
+      append_uint (result, strlen (s));
+      string_data_offset += strlen (s) + 1;
+    }
+
+  for (i = 0; i < self->textures->len; i++)
+    {
+      const WriterTexture *texture = g_ptr_array_index (self->textures, i);
+
+      append_uint (result, texture->width);
+      append_uint (result, texture->height);
+      append_uint (result, texture->width * 4);
+      append_uint (result, texture_data_offset);
+      texture_data_offset += texture->width * texture->height * 4;
+      texture_data_offset += (DATA_ALIGNMENT - texture_data_offset % DATA_ALIGNMENT) % DATA_ALIGNMENT;
+    }
+
+  g_byte_array_append (result, self->nodes->data, self->nodes->len);
+  g_byte_array_append (result, strings->data, strings->len);
+  g_byte_array_unref (strings);
+
+  for (i = 0; i < self->textures->len; i++)
+    {
+      const WriterTexture *texture = g_ptr_array_index (self->textures, i);
+
+      g_byte_array_append (result, texture->data, texture->width * texture->height * 4);
+      append_padding (result, DATA_ALIGNMENT);
+    }
+
+  return g_byte_array_free_to_bytes (result);
+}
+
+/**
+ * gsk_render_node_serialize_binary:
+ * @node: a #GskRenderNode
+ *
+ * Serializes the @node in a compact binary format for later
+ * deserialization via gsk_render_node_deserialize().
+ *
+ * Compared to gsk_render_node_serialize(), this is much faster to
+ * write and to read, and stores textures and strings only once, but
+ * it is not human readable. The same guarantees about the format
+ * apply: only the same version of GTK+ is sure to be able to read it,
+ * and files with a newer version are rejected.
+ *
+ * The intended use of this function is recording render node traces
+ * for testing, benchmarking and debugging.
+ *
+ * Returns: a #GBytes representing the node.
+ **/
+GBytes *
+gsk_render_node_serialize_binary (GskRenderNode *node)
+{
+  Writer writer;
+  GBytes *result;
+
+  g_return_val_if_fail (GSK_IS_RENDER_NODE (node), NULL);
+
+  writer_init (&writer);
+  writer_add_node (&writer, node);
+  result = writer_finish (&writer);
+  writer_clear (&writer);
+
+  return result;
+}
+
+/*** READER ***/
+
+typedef struct {
+  GBytes *bytes;
+  const guchar *data;
+  gsize size;
+
+  GskParseErrorFunc error_func;
+  gpointer user_data;
+
+  guint n_strings;
+  gsize strings_offset;
+  guint n_textures;
+  gsize textures_offset;
+  GdkTexture **textures;
+  PangoFont **fonts;
+
+  guint n_nodes;
+  GskRenderNode **nodes;
+
+  gsize pos;
+  gsize end;
+  gboolean failed;
+} Reader;
+
+static void
+reader_error (Reader                 *self,
+              GskSerializationError   code,
+              const char             *format,
+              ...) G_GNUC_PRINTF (3, 4);
+
+static void
+reader_error (Reader                *self,
+              GskSerializationError  code,
+              const char            *format,
+              ...)
+{
+  GtkCssLocation location = { 0, };
+  GtkCssSection *section;
+  GError *error;
+  va_list args;
+
+  self->failed = TRUE;
+
+  if (self->error_func == NULL)
+    return;
+
+  va_start (args, format);
+  error = g_error_new_valist (GSK_SERIALIZATION_ERROR, code, format, args);
+  va_end (args);
+
+  location.bytes = self->pos;
+  location.chars = self->pos;
+  section = gtk_css_section_new (NULL, &location, &location);
+
+  self->error_func (section, error, self->user_data);
+
+  gtk_css_section_unref (section);
+  g_error_free (error);
+}
+
+static guint32
+peek_uint (const Reader *self,
+           gsize         offset)
+{
+  guint32 value;
+
+  memcpy (&value, self->data + offset, sizeof (value));
+
+  return GUINT32_FROM_LE (value);
+}
+
+static guint32
+read_uint (Reader *self)
+{
+  guint32 value;
+
+  if (self->failed)
+    return 0;
+
+  if (self->end - self->pos < 4)
+    {
+      reader_error (self, GSK_SERIALIZATION_INVALID_DATA, "Unexpected end of node data");
+      return 0;
+    }
+
+  value = peek_uint (self, self->pos);
+  self->pos += 4;
+
+  return value;
+}
+
+static float
+read_float (Reader *self)
+{
+  union { guint32 u; float f; } u = { read_uint (self) };
+
+  return u.f;
+}
+
+/* Checks that @n_items items of @item_size words can still be read,
+ * before we allocate anything for them.
+ */
+static gboolean
+check_count (Reader *self,
+             guint   n_items,
+             guint   item_size)
+{
+  if (self->failed)
+    return FALSE;
+
+  if ((guint64) n_items * item_size * 4 > self->end - self->pos)
+    {
+      reader_error (self, GSK_SERIALIZATION_INVALID_DATA, "Invalid number of items: %u", n_items);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+read_point (Reader           *self,
+            graphene_point_t *point)
+{
+  point->x = read_float (self);
+  point->y = read_float (self);
+}
+
+static void
+read_rect (Reader          *self,
+           graphene_rect_t *rect)
+{
+  rect->origin.x = read_float (self);
+  rect->origin.y = read_float (self);
+  rect->size.width = read_float (self);
+  rect->size.height = read_float (self);
+}
+
+static void
+read_rounded_rect (Reader         *self,
+                   GskRoundedRect *rect)
+{
+  guint i;
+
+  read_rect (self, &rect->bounds);
+  for (i = 0; i < 4; i++)
+    {
+      rect->corner[i].width = read_float (self);
+      rect->corner[i].height = read_float (self);
+    }
+}
+
+static void
+read_rgba (Reader  *self,
+           GdkRGBA *rgba)
+{
+  rgba->red = read_float (self);
+  rgba->green = read_float (self);
+  rgba->blue = read_float (self);
+  rgba->alpha = read_float (self);
+}
+
+static GskColorStop *
+read_stops (Reader *self,
+            gsize  *n_stops)
+{
+  GskColorStop *stops;
+  guint i;
+
+  *n_stops = read_uint (self);
+  if (!check_count (self, *n_stops, 5) || *n_stops < 2)
+    {
+      if (!self->failed)
+        reader_error (self, GSK_SERIALIZATION_INVALID_DATA, "Gradients need at least 2 color stops");
+      return NULL;
+    }
+
+  stops = g_new (GskColorStop, *n_stops);
+  for (i = 0; i < *n_stops; i++)
+    {
+      stops[i].offset = read_float (self);
+      read_rgba (self, &stops[i].color);
+    }
+
+  return stops;
+}
+
+static void
+read_matrix (Reader            *self,
+             graphene_matrix_t *matrix)
+{
+  float v[16];
+  guint i;
+
+  for (i = 0; i < 16; i++)
+    v[i] = read_float (self);
+
+  graphene_matrix_init_from_float (matrix, v);
+}
+
+static GskTransform *
+read_transform (Reader *self)
+{
+  switch (read_uint (self))
+    {
+    case TRANSFORM_IDENTITY:
+      return gsk_transform_new ();
+
+    case TRANSFORM_TRANSLATE:
+      {
+        graphene_point_t offset;
+
+        read_point (self, &offset);
+
+        return gsk_transform_translate (NULL, &offset);
+      }
+
+    case TRANSFORM_AFFINE:
+      {
+        float scale_x, scale_y;
+        graphene_point_t offset;
+
+        scale_x = read_float (self);
+        scale_y = read_float (self);
+        read_point (self, &offset);
+
+        return gsk_transform_scale (gsk_transform_translate (NULL, &offset), scale_x, scale_y);
+      }
+
+    case TRANSFORM_MATRIX:
+      {
+        graphene_matrix_t matrix;
+
+        read_matrix (self, &matrix);
+
+        return gsk_transform_matrix (NULL, &matrix);
+      }
+
+    default:
+      reader_error (self, GSK_SERIALIZATION_INVALID_DATA, "Unknown transform");
+      return NULL;
+    }
+}
+
+static const char *
+lookup_string (Reader  *self,
+               guint32  index)
+{
+  guint32 offset, length;
+
+  if (index >= self->n_strings)
+    {
+      reader_error (self, GSK_SERIALIZATION_INVALID_DATA, "Invalid string %u", index);
+      return NULL;
+    }
+
+  offset = peek_uint (self, self->strings_offset + index * 8);
+  length = peek_uint (self, self->strings_offset + index * 8 + 4);
+
+  if (offset > self->size || length >= self->size - offset || self->data[offset + length] != '\0')
+    {
+      reader_error (self, GSK_SERIALIZATION_INVALID_DATA, "Invalid string %u", index);
+      return NULL;
+    }
+
+  return (const char *) self->data + offset;
+}
+
+static const char *
+read_string (Reader *self)
+{
+  guint32 index = read_uint (self);
+
+  if (self->failed || index == NO_INDEX)
+    return NULL;
+
+  return lookup_string (self, index);
+}
+
+/* Fonts are loaded once per font description */
+static PangoFont *
+read_font (Reader *self)
+{
+  guint32 index = read_uint (self);
+  const char *name;
+
+  if (self->failed)
+    return NULL;
+
+  name = lookup_string (self, index);
+  if (name == NULL)
+    return NULL;
+
+  if (self->fonts[index] == NULL)
+    {
+      self->fonts[index] = font_from_string (name);
+      if (self->fonts[index] == NULL)
+        {
+          reader_error (self, GSK_SERIALIZATION_INVALID_DATA, "Font \"%s\" does not exist", name);
+          return NULL;
+        }
+    }
+
+  return self->fonts[index];
+}
+
+/* Returns a texture referencing the data in the file */
+static GdkTexture *
+read_texture (Reader *self)
+{
+  guint32 index, width, height, stride, offset;
+  gsize entry;
+  GBytes *bytes;
+
+  index = read_uint (self);
+  if (self->failed || index == NO_INDEX)
+    return NULL;
+
+  if (index >= self->n_textures)
+    {
+      reader_error (self, GSK_SERIALIZATION_INVALID_DATA, "Invalid texture %u", index);
+      return NULL;
+    }
+
+  if (self->textures[index])
+    return self->textures[index];
+
+  entry = self->textures_offset + index * 16;
+  width = peek_uint (self, entry);
+  height = peek_uint (self, entry + 4);
+  stride = peek_uint (self, entry + 8);
+  offset = peek_uint (self, entry + 12);
+
+  if (width == 0 || height == 0 ||
+      width > G_MAXINT / 4 || height > G_MAXINT ||
+      stride < width * 4 ||
+      offset > self->size ||
+      (guint64) stride * (height - 1) + width * 4 > self->size - offset)
+    {
+      reader_error (self, GSK_SERIALIZATION_INVALID_DATA, "Invalid texture %u", index);
+      return NULL;
+    }
+
+  bytes = g_bytes_new_from_bytes (self->bytes, offset, (gsize) stride * (height - 1) + width * 4);
+  self->textures[index] = gdk_memory_texture_new (width, height, GDK_MEMORY_DEFAULT, bytes, stride);
+  g_bytes_unref (bytes);
+
+  return self->textures[index];
+}
+
+static GskRenderNode *
+read_child (Reader *self)
+{
+  guint index = read_uint (self);
+
+  if (self->failed)
+    return NULL;
+
+  if (index >= self->n_nodes)
+    {
+      reader_error (self, GSK_SERIALIZATION_INVALID_DATA, "Invalid child node %u", index);
+      return NULL;
+    }
+
+  return self->nodes[index];
+}
+
+static GskRenderNode *
+read_node (Reader *self)
+{
+  GskRenderNodeType type = read_uint (self);
+  GskRenderNode *node = NULL;
+
+  if (self->failed)
+    return NULL;
+
+  switch (type)
+    {
+    case GSK_CONTAINER_NODE:
+      {
+        GskRenderNode **children;
+        guint i, n_children;
+
+        n_children = read_uint (self);
+        if (!check_count (self, n_children, 1))
+          return NULL;
+
+        children = g_new (GskRenderNode *, n_children);
+        for (i = 0; i < n_children; i++)
+          children[i] = read_child (self);
+
+        if (!self->failed)
+          node = gsk_container_node_new (children, n_children);
+        g_free (children);
+      }
+      break;
+
+    case GSK_CAIRO_NODE:
+      {
+        graphene_rect_t bounds;
+        GdkTexture *pixels;
+
+        read_rect (self, &bounds);
+        pixels = read_texture (self);
+        if (self->failed)
+          return NULL;
+
+        node = gsk_cairo_node_new (&bounds);
+        if (pixels)
+          {
+            cairo_t *cr = gsk_cairo_node_get_draw_context (node);
+            cairo_surface_t *surface = gdk_texture_download_surface (pixels);
+
+            cairo_set_source_surface (cr, surface, bounds.origin.x, bounds.origin.y);
+            cairo_paint (cr);
+            cairo_destroy (cr);
+            cairo_surface_destroy (surface);
+          }
+      }
+      break;
+
+    case GSK_COLOR_NODE:
+      {
+        graphene_rect_t bounds;
+        GdkRGBA color;
+
+        read_rect (self, &bounds);
+        read_rgba (self, &color);
+        if (!self->failed)
+          node = gsk_color_node_new (&color, &bounds);
+      }
+      break;
+
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+      {
+        graphene_rect_t bounds;
+        graphene_point_t start, end;
+        GskColorStop *stops;
+        gsize n_stops;
+
+        read_rect (self, &bounds);
+        read_point (self, &start);
+        read_point (self, &end);
+        stops = read_stops (self, &n_stops);
+        if (self->failed)
+          return NULL;
+
+        if (type == GSK_REPEATING_LINEAR_GRADIENT_NODE)
+          node = gsk_repeating_linear_gradient_node_new (&bounds, &start, &end, stops, n_stops);
+        else
+          node = gsk_linear_gradient_node_new (&bounds, &start, &end, stops, n_stops);
+        g_free (stops);
+      }
+      break;
+
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+      {
+        graphene_rect_t bounds;
+        graphene_point_t center;
+        float hradius, vradius, start, end;
+        GskColorStop *stops;
+        gsize n_stops;
+
+        read_rect (self, &bounds);
+        read_point (self, &center);
+        hradius = read_float (self);
+        vradius = read_float (self);
+        start = read_float (self);
+        end = read_float (self);
+        stops = read_stops (self, &n_stops);
+        if (self->failed)
+          return NULL;
+
+        if (type == GSK_REPEATING_RADIAL_GRADIENT_NODE)
+          node = gsk_repeating_radial_gradient_node_new (&bounds, &center, hradius, vradius, start, end, stops, n_stops);
+        else
+          node = gsk_radial_gradient_node_new (&bounds, &center, hradius, vradius, start, end, stops, n_stops);
+        g_free (stops);
+      }
+      break;
+
+    case GSK_CONIC_GRADIENT_NODE:
+      {
+        graphene_rect_t bounds;
+        graphene_point_t center;
+        float rotation;
+        GskColorStop *stops;
+        gsize n_stops;
+
+        read_rect (self, &bounds);
+        read_point (self, &center);
+        rotation = read_float (self);
+        stops = read_stops (self, &n_stops);
+        if (self->failed)
+          return NULL;
+
+        node = gsk_conic_gradient_node_new (&bounds, &center, rotation, stops, n_stops);
+        g_free (stops);
+      }
+      break;
+
+    case GSK_BORDER_NODE:
+      {
+        GskRoundedRect outline;
+        float widths[4];
+        GdkRGBA colors[4];
+        guint i;
+
+        read_rounded_rect (self, &outline);
+        for (i = 0; i < 4; i++)
+          widths[i] = read_float (self);
+        for (i = 0; i < 4; i++)
+          read_rgba (self, &colors[i]);
+        if (!self->failed)
+          node = gsk_border_node_new (&outline, widths, colors);
+      }
+      break;
+
+    case GSK_TEXTURE_NODE:
+      {
+        graphene_rect_t bounds;
+        GdkTexture *texture;
+
+        read_rect (self, &bounds);
+        texture = read_texture (self);
+        if (self->failed)
+          return NULL;
+
+        if (texture == NULL)
+          {
+            reader_error (self, GSK_SERIALIZATION_INVALID_DATA, "Texture node without a texture");
+            return NULL;
+          }
+
+        node = gsk_texture_node_new (texture, &bounds);
+      }
+      break;
+
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+      {
+        GskRoundedRect outline;
+        GdkRGBA color;
+        float dx, dy, spread, blur_radius;
+
+        read_rounded_rect (self, &outline);
+        read_rgba (self, &color);
+        dx = read_float (self);
+        dy = read_float (self);
+        spread = read_float (self);
+        blur_radius = read_float (self);
+        if (self->failed)
+          return NULL;
+
+        if (type == GSK_INSET_SHADOW_NODE)
+          node = gsk_inset_shadow_node_new (&outline, &color, dx, dy, spread, blur_radius);
+        else
+          node = gsk_outset_shadow_node_new (&outline, &color, dx, dy, spread, blur_radius);
+      }
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      {
+        GskRenderNode *child = read_child (self);
+        GskTransform *transform = read_transform (self);
+
+        if (!self->failed)
+          node = gsk_transform_node_new (child, transform);
+        gsk_transform_unref (transform);
+      }
+      break;
+
+    case GSK_OPACITY_NODE:
+      {
+        GskRenderNode *child = read_child (self);
+        float opacity = read_float (self);
+
+        if (!self->failed)
+          node = gsk_opacity_node_new (child, opacity);
+      }
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      {
+        GskRenderNode *child = read_child (self);
+        graphene_matrix_t matrix;
+        graphene_vec4_t offset;
+        float v[4];
+        guint i;
+
+        read_matrix (self, &matrix);
+        for (i = 0; i < 4; i++)
+          v[i] = read_float (self);
+        graphene_vec4_init_from_float (&offset, v);
+        if (!self->failed)
+          node = gsk_color_matrix_node_new (child, &matrix, &offset);
+      }
+      break;
+
+    case GSK_REPEAT_NODE:
+      {
+        GskRenderNode *child = read_child (self);
+        graphene_rect_t bounds, child_bounds;
+
+        read_rect (self, &bounds);
+        read_rect (self, &child_bounds);
+        if (!self->failed)
+          node = gsk_repeat_node_new (&bounds, child, &child_bounds);
+      }
+      break;
+
+    case GSK_CLIP_NODE:
+      {
+        GskRenderNode *child = read_child (self);
+        graphene_rect_t clip;
+
+        read_rect (self, &clip);
+        if (!self->failed)
+          node = gsk_clip_node_new (child, &clip);
+      }
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      {
+        GskRenderNode *child = read_child (self);
+        GskRoundedRect clip;
+
+        read_rounded_rect (self, &clip);
+        if (!self->failed)
+          node = gsk_rounded_clip_node_new (child, &clip);
+      }
+      break;
+
+    case GSK_SHADOW_NODE:
+      {
+        GskRenderNode *child = read_child (self);
+        GskShadow *shadows;
+        guint i, n_shadows;
+
+        n_shadows = read_uint (self);
+        if (!check_count (self, n_shadows, 7))
+          return NULL;
+
+        shadows = g_new (GskShadow, n_shadows);
+        for (i = 0; i < n_shadows; i++)
+          {
+            read_rgba (self, &shadows[i].color);
+            shadows[i].dx = read_float (self);
+            shadows[i].dy = read_float (self);
+            shadows[i].radius = read_float (self);
+          }
+
+        if (!self->failed)
+          node = gsk_shadow_node_new (child, shadows, n_shadows);
+        g_free (shadows);
+      }
+      break;
+
+    case GSK_BLEND_NODE:
+      {
+        GskRenderNode *bottom = read_child (self);
+        GskRenderNode *top = read_child (self);
+        guint32 mode = read_uint (self);
+
+        if (self->failed)
+          return NULL;
+
+        if (mode > GSK_BLEND_MODE_LUMINOSITY)
+          {
+            reader_error (self, GSK_SERIALIZATION_INVALID_DATA, "Unknown blend mode %u", mode);
+            return NULL;
+          }
+
+        node = gsk_blend_node_new (bottom, top, mode);
+      }
+      break;
+
+    case GSK_CROSS_FADE_NODE:
+      {
+        GskRenderNode *start = read_child (self);
+        GskRenderNode *end = read_child (self);
+        float progress = read_float (self);
+
+        if (!self->failed)
+          node = gsk_cross_fade_node_new (start, end, progress);
+      }
+      break;
+
+    case GSK_TEXT_NODE:
+      {
+        PangoFont *font = read_font (self);
+        PangoGlyphString *glyphs;
+        graphene_point_t offset;
+        GdkRGBA color;
+        guint i, n_glyphs;
+
+        read_rgba (self, &color);
+        read_point (self, &offset);
+        n_glyphs = read_uint (self);
+        if (!check_count (self, n_glyphs, 5))
+          return NULL;
+
+        glyphs = pango_glyph_string_new ();
+        pango_glyph_string_set_size (glyphs, n_glyphs);
+        for (i = 0; i < n_glyphs; i++)
+          {
+            glyphs->glyphs[i].glyph = read_uint (self);
+            glyphs->glyphs[i].geometry.width = (gint32) read_uint (self);
+            glyphs->glyphs[i].geometry.x_offset = (gint32) read_uint (self);
+            glyphs->glyphs[i].geometry.y_offset = (gint32) read_uint (self);
+            glyphs->glyphs[i].attr.is_cluster_start = read_uint (self) & 1;
+          }
+
+        if (!self->failed)
+          {
+            node = gsk_text_node_new (font, glyphs, &color, &offset);
+            /* The font on this machine may not have ink for the glyphs */
+            if (node == NULL)
+              node = gsk_container_node_new (NULL, 0);
+          }
+        pango_glyph_string_free (glyphs);
+      }
+      break;
+
+    case GSK_BLUR_NODE:
+      {
+        GskRenderNode *child = read_child (self);
+        float radius = read_float (self);
+
+        if (!self->failed)
+          node = gsk_blur_node_new (child, radius);
+      }
+      break;
+
+    case GSK_DEBUG_NODE:
+      {
+        GskRenderNode *child = read_child (self);
+        const char *message = read_string (self);
+
+        if (!self->failed)
+          node = gsk_debug_node_new (child, g_strdup (message));
+      }
+      break;
+
+    case GSK_NOT_A_RENDER_NODE:
+    default:
+      reader_error (self, GSK_SERIALIZATION_INVALID_DATA, "Unknown node type %u", type);
+      return NULL;
+    }
+
+  return node;
+}
+
+/*<private>
+ * gsk_render_node_is_binary:
+ * @bytes: serialized node data
+ *
+ * Returns: %TRUE if @bytes were created with gsk_render_node_serialize_binary()
+ *     and should be read with gsk_render_node_deserialize_binary()
+ */
+gboolean
+gsk_render_node_is_binary (GBytes *bytes)
+{
+  gsize size;
+  const guchar *data = g_bytes_get_data (bytes, &size);
+
+  return size >= GSK_BINARY_NODE_MAGIC_SIZE &&
+         memcmp (data, GSK_BINARY_NODE_MAGIC, GSK_BINARY_NODE_MAGIC_SIZE) == 0;
+}
+
+GskRenderNode *
+gsk_render_node_deserialize_binary (GBytes            *bytes,
+                                    GskParseErrorFunc  error_func,
+                                    gpointer           user_data)
+{
+  GskRenderNode *root = NULL;
+  guint32 version, nodes_offset, nodes_size;
+  Reader reader = { 0, };
+  guint i;
+
+  reader.bytes = bytes;
+  reader.data = g_bytes_get_data (bytes, &reader.size);
+  reader.error_func = error_func;
+  reader.user_data = user_data;
+
+  if (!gsk_render_node_is_binary (bytes))
+    {
+      reader_error (&reader, GSK_SERIALIZATION_UNSUPPORTED_FORMAT, "Not a binary render node file");
+      return NULL;
+    }
+
+  if (reader.size < GSK_BINARY_NODE_HEADER_SIZE)
+    {
+      reader_error (&reader, GSK_SERIALIZATION_INVALID_DATA, "File is truncated");
+      return NULL;
+    }
+
+  reader.pos = GSK_BINARY_NODE_MAGIC_SIZE;
+  reader.end = GSK_BINARY_NODE_HEADER_SIZE;
+  version = read_uint (&reader);
+  if (version > GSK_BINARY_NODE_VERSION)
+    {
+      reader_error (&reader, GSK_SERIALIZATION_UNSUPPORTED_VERSION,
+                    "Version %u is not supported, the latest supported version is %u",
+                    version, GSK_BINARY_NODE_VERSION);
+      return NULL;
+    }
+
+  reader.n_strings = read_uint (&reader);
+  reader.n_textures = read_uint (&reader);
+  reader.n_nodes = read_uint (&reader);
+  reader.strings_offset = read_uint (&reader);
+  reader.textures_offset = read_uint (&reader);
+  nodes_offset = read_uint (&reader);
+  nodes_size = read_uint (&reader);
+
+  if (reader.strings_offset > reader.size ||
+      (guint64) reader.n_strings * 8 > reader.size - reader.strings_offset ||
+      reader.textures_offset > reader.size ||
+      (guint64) reader.n_textures * 16 > reader.size - reader.textures_offset ||
+      nodes_offset > reader.size ||
+      nodes_size > reader.size - nodes_offset ||
+      (guint64) reader.n_nodes * 4 > nodes_size ||
+      reader.n_nodes == 0)
+    {
+      reader_error (&reader, GSK_SERIALIZATION_INVALID_DATA, "Invalid header");
+      return NULL;
+    }
+
+  reader.textures = g_new0 (GdkTexture *, reader.n_textures);
+  reader.fonts = g_new0 (PangoFont *, reader.n_strings);
+  reader.nodes = g_new0 (GskRenderNode *, reader.n_nodes);
+
+  /* n_nodes counts the nodes read so far, so children can only be
+   * nodes that have already been read.
+   */
+  i = reader.n_nodes;
+  reader.n_nodes = 0;
+  reader.pos = nodes_offset;
+  reader.end = (gsize) nodes_offset + nodes_size;
+
+  while (reader.n_nodes < i)
+    {
+      GskRenderNode *node = read_node (&reader);
+
+      if (node == NULL)
+        {
+          if (!reader.failed)
+            reader_error (&reader, GSK_SERIALIZATION_INVALID_DATA, "Invalid node");
+          break;
+        }
+
+      reader.nodes[reader.n_nodes++] = node;
+    }
+
+  if (!reader.failed)
+    root = gsk_render_node_ref (reader.nodes[reader.n_nodes - 1]);
+
+  for (i = 0; i < reader.n_nodes; i++)
+    gsk_render_node_unref (reader.nodes[i]);
+  for (i = 0; i < reader.n_textures; i++)
+    g_clear_object (&reader.textures[i]);
+  for (i = 0; i < reader.n_strings; i++)
+    g_clear_object (&reader.fonts[i]);
+  g_free (reader.nodes);
+  g_free (reader.textures);
+  g_free (reader.fonts);
+
+  return root;
+}
@@ -366,6 +366,574 @@ gsk_linear_gradient_node_peek_color_stops (GskRenderNode *node)
   return self->stops;
 }
 
+/*** GSK_RADIAL_GRADIENT_NODE ***/
+
+typedef struct _GskRadialGradientNode GskRadialGradientNode;
+
+struct _GskRadialGradientNode
+{
+  GskRenderNode render_node;
+
+  graphene_point_t center;
+
+  float hradius;
+  float vradius;
+  float start;
+  float end;
+
+  gsize n_stops;
+  GskColorStop stops[];
+};
+
+static gboolean
+color_stops_equal (const GskColorStop *stops1,
+                   const GskColorStop *stops2,
+                   gsize               n_stops)
+{
+  gsize i;
+
+  for (i = 0; i < n_stops; i++)
+    {
+      if (stops1[i].offset != stops2[i].offset ||
+          !gdk_rgba_equal (&stops1[i].color, &stops2[i].color))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+gsk_radial_gradient_node_finalize (GskRenderNode *node)
+{
+}
+
+static void
+gsk_radial_gradient_node_draw (GskRenderNode *node,
+                               cairo_t       *cr)
+{
+  GskRadialGradientNode *self = (GskRadialGradientNode *) node;
+  cairo_pattern_t *pattern;
+  gsize i;
+
+  pattern = cairo_pattern_create_radial (0, 0, self->hradius * self->start,
+                                         0, 0, self->hradius * self->end);
+
+  if (self->hradius != self->vradius)
+    {
+      cairo_matrix_t matrix;
+
+      cairo_matrix_init_scale (&matrix, 1.0, self->hradius / self->vradius);
+      cairo_pattern_set_matrix (pattern, &matrix);
+    }
+
+  if (gsk_render_node_get_node_type (node) == GSK_REPEATING_RADIAL_GRADIENT_NODE)
+    cairo_pattern_set_extend (pattern, CAIRO_EXTEND_REPEAT);
+  else
+    cairo_pattern_set_extend (pattern, CAIRO_EXTEND_PAD);
+
+  for (i = 0; i < self->n_stops; i++)
+    {
+      cairo_pattern_add_color_stop_rgba (pattern,
+                                         self->stops[i].offset,
+                                         self->stops[i].color.red,
+                                         self->stops[i].color.green,
+                                         self->stops[i].color.blue,
+                                         self->stops[i].color.alpha);
+    }
+
+  cairo_save (cr);
+
+  cairo_rectangle (cr,
+                   node->bounds.origin.x, node->bounds.origin.y,
+                   node->bounds.size.width, node->bounds.size.height);
+  cairo_translate (cr, self->center.x, self->center.y);
+  cairo_set_source (cr, pattern);
+  cairo_fill (cr);
+
+  cairo_restore (cr);
+
+  cairo_pattern_destroy (pattern);
+}
+
+static void
+gsk_radial_gradient_node_diff (GskRenderNode  *node1,
+                               GskRenderNode  *node2,
+                               cairo_region_t *region)
+{
+  GskRadialGradientNode *self1 = (GskRadialGradientNode *) node1;
+  GskRadialGradientNode *self2 = (GskRadialGradientNode *) node2;
+
+  if (graphene_point_equal (&self1->center, &self2->center) &&
+      self1->hradius == self2->hradius &&
+      self1->vradius == self2->vradius &&
+      self1->start == self2->start &&
+      self1->end == self2->end &&
+      self1->n_stops == self2->n_stops &&
+      color_stops_equal (self1->stops, self2->stops, self1->n_stops))
+    return;
+
+  gsk_render_node_diff_impossible (node1, node2, region);
+}
+
+static const GskRenderNodeClass GSK_RADIAL_GRADIENT_NODE_CLASS = {
+  GSK_RADIAL_GRADIENT_NODE,
+  sizeof (GskRadialGradientNode),
+  "GskRadialGradientNode",
+  gsk_radial_gradient_node_finalize,
+  gsk_radial_gradient_node_draw,
+  gsk_render_node_can_diff_true,
+  gsk_radial_gradient_node_diff,
+};
+
+static const GskRenderNodeClass GSK_REPEATING_RADIAL_GRADIENT_NODE_CLASS = {
+  GSK_REPEATING_RADIAL_GRADIENT_NODE,
+  sizeof (GskRadialGradientNode),
+  "GskRepeatingRadialGradientNode",
+  gsk_radial_gradient_node_finalize,
+  gsk_radial_gradient_node_draw,
+  gsk_render_node_can_diff_true,
+  gsk_radial_gradient_node_diff,
+};
+
+static GskRenderNode *
+gsk_radial_gradient_node_new_internal (const GskRenderNodeClass *node_class,
+                                       const graphene_rect_t    *bounds,
+                                       const graphene_point_t   *center,
+                                       float                     hradius,
+                                       float                     vradius,
+                                       float                     start,
+                                       float                     end,
+                                       const GskColorStop       *color_stops,
+                                       gsize                     n_color_stops)
+{
+  GskRadialGradientNode *self;
+  gsize i;
+
+  g_return_val_if_fail (bounds != NULL, NULL);
+  g_return_val_if_fail (center != NULL, NULL);
+  g_return_val_if_fail (hradius > 0., NULL);
+  g_return_val_if_fail (vradius > 0., NULL);
+  g_return_val_if_fail (start >= 0., NULL);
+  g_return_val_if_fail (end >= 0., NULL);
+  g_return_val_if_fail (end > start, NULL);
+  g_return_val_if_fail (color_stops != NULL, NULL);
+  g_return_val_if_fail (n_color_stops >= 2, NULL);
+  g_return_val_if_fail (color_stops[0].offset >= 0, NULL);
+  for (i = 1; i < n_color_stops; i++)
+    g_return_val_if_fail (color_stops[i].offset >= color_stops[i-1].offset, NULL);
+  g_return_val_if_fail (color_stops[n_color_stops - 1].offset <= 1, NULL);
+
+  self = (GskRadialGradientNode *) gsk_render_node_new (node_class, sizeof (GskColorStop) * n_color_stops);
+
+  graphene_rect_init_from_rect (&self->render_node.bounds, bounds);
+  graphene_point_init_from_point (&self->center, center);
+
+  self->hradius = hradius;
+  self->vradius = vradius;
+  self->start = start;
+  self->end = end;
+
+  memcpy (&self->stops, color_stops, sizeof (GskColorStop) * n_color_stops);
+  self->n_stops = n_color_stops;
+
+  return &self->render_node;
+}
+
+/**
+ * gsk_radial_gradient_node_new:
+ * @bounds: the bounds of the node
+ * @center: the center of the gradient
+ * @hradius: the horizontal radius
+ * @vradius: the vertical radius
+ * @start: a percentage >= 0 that defines the start of the gradient around @center
+ * @end: a percentage >= 0 that defines the end of the gradient around @center
+ * @color_stops: (array length=n_color_stops): a pointer to an array of #GskColorStop defining the gradient
+ * @n_color_stops: the number of elements in @color_stops
+ *
+ * Creates a #GskRenderNode that draws a radial gradient. The radial gradient
+ * starts around @center. The size of the gradient is dictated by @hradius
+ * in horizontal orientation and by @vradius in vertial orientation.
+ *
+ * Returns: A new #GskRenderNode
+ */
+GskRenderNode *
+gsk_radial_gradient_node_new (const graphene_rect_t  *bounds,
+                              const graphene_point_t *center,
+                              float                   hradius,
+                              float                   vradius,
+                              float                   start,
+                              float                   end,
+                              const GskColorStop     *color_stops,
+                              gsize                   n_color_stops)
+{
+  return gsk_radial_gradient_node_new_internal (&GSK_RADIAL_GRADIENT_NODE_CLASS,
+                                                bounds, center,
+                                                hradius, vradius,
+                                                start, end,
+                                                color_stops, n_color_stops);
+}
+
+/**
+ * gsk_repeating_radial_gradient_node_new:
+ * @bounds: the bounds of the node
+ * @center: the center of the gradient
+ * @hradius: the horizontal radius
+ * @vradius: the vertical radius
+ * @start: a percentage >= 0 that defines the start of the gradient around @center
+ * @end: a percentage >= 0 that defines the end of the gradient around @center
+ * @color_stops: (array length=n_color_stops): a pointer to an array of #GskColorStop defining the gradient
+ * @n_color_stops: the number of elements in @color_stops
+ *
+ * Creates a #GskRenderNode that draws a repeating radial gradient. The radial
+ * gradient starts around @center. The size of the gradient is dictated by
+ * @hradius in horizontal orientation and by @vradius in vertial orientation.
+ *
+ * Returns: A new #GskRenderNode
+ */
+GskRenderNode *
+gsk_repeating_radial_gradient_node_new (const graphene_rect_t  *bounds,
+                                        const graphene_point_t *center,
+                                        float                   hradius,
+                                        float                   vradius,
+                                        float                   start,
+                                        float                   end,
+                                        const GskColorStop     *color_stops,
+                                        gsize                   n_color_stops)
+{
+  return gsk_radial_gradient_node_new_internal (&GSK_REPEATING_RADIAL_GRADIENT_NODE_CLASS,
+                                                bounds, center,
+                                                hradius, vradius,
+                                                start, end,
+                                                color_stops, n_color_stops);
+}
+
+gsize
+gsk_radial_gradient_node_get_n_color_stops (GskRenderNode *node)
+{
+  GskRadialGradientNode *self = (GskRadialGradientNode *) node;
+
+  return self->n_stops;
+}
+
+const GskColorStop *
+gsk_radial_gradient_node_peek_color_stops (GskRenderNode *node)
+{
+  GskRadialGradientNode *self = (GskRadialGradientNode *) node;
+
+  return self->stops;
+}
+
+const graphene_point_t *
+gsk_radial_gradient_node_peek_center (GskRenderNode *node)
+{
+  GskRadialGradientNode *self = (GskRadialGradientNode *) node;
+
+  return &self->center;
+}
+
+float
+gsk_radial_gradient_node_get_hradius (GskRenderNode *node)
+{
+  GskRadialGradientNode *self = (GskRadialGradientNode *) node;
+
+  return self->hradius;
+}
+
+float
+gsk_radial_gradient_node_get_vradius (GskRenderNode *node)
+{
+  GskRadialGradientNode *self = (GskRadialGradientNode *) node;
+
+  return self->vradius;
+}
+
+float
+gsk_radial_gradient_node_get_start (GskRenderNode *node)
+{
+  GskRadialGradientNode *self = (GskRadialGradientNode *) node;
+
+  return self->start;
+}
+
+float
+gsk_radial_gradient_node_get_end (GskRenderNode *node)
+{
+  GskRadialGradientNode *self = (GskRadialGradientNode *) node;
+
+  return self->end;
+}
+
+/*** GSK_CONIC_GRADIENT_NODE ***/
+
+typedef struct _GskConicGradientNode GskConicGradientNode;
+
+struct _GskConicGradientNode
+{
+  GskRenderNode render_node;
+
+  graphene_point_t center;
+  float rotation;
+
+  gsize n_stops;
+  GskColorStop stops[];
+};
+
+static void
+gsk_conic_gradient_node_finalize (GskRenderNode *node)
+{
+}
+
+/* Projects the point at @angle onto the square of half size @radius
+ * around the origin, so that triangles between two such points on
+ * the same side of the square fully cover it. */
+static void
+project_onto_square (double  angle,
+                     double  radius,
+                     double *x_out,
+                     double *y_out)
+{
+  double x = cos (angle);
+  double y = sin (angle);
+  double scale = radius / MAX (fabs (x), fabs (y));
+
+  *x_out = x * scale;
+  *y_out = y * scale;
+}
+
+static void
+gsk_conic_gradient_node_add_patch (cairo_pattern_t *pattern,
+                                   float            radius,
+                                   float            start_angle,
+                                   const GdkRGBA   *start_color,
+                                   float            end_angle,
+                                   const GdkRGBA   *end_color)
+{
+  double x, y;
+
+  cairo_mesh_pattern_begin_patch (pattern);
+
+  cairo_mesh_pattern_move_to  (pattern, 0, 0);
+  project_onto_square (start_angle, radius, &x, &y);
+  cairo_mesh_pattern_line_to  (pattern, x, y);
+  project_onto_square (end_angle, radius, &x, &y);
+  cairo_mesh_pattern_line_to  (pattern, x, y);
+  cairo_mesh_pattern_line_to  (pattern, 0, 0);
+
+  cairo_mesh_pattern_set_corner_color_rgba (pattern, 0,
+                                            start_color->red, start_color->green,
+                                            start_color->blue, start_color->alpha);
+  cairo_mesh_pattern_set_corner_color_rgba (pattern, 1,
+                                            start_color->red, start_color->green,
+                                            start_color->blue, start_color->alpha);
+  cairo_mesh_pattern_set_corner_color_rgba (pattern, 2,
+                                            end_color->red, end_color->green,
+                                            end_color->blue, end_color->alpha);
+  cairo_mesh_pattern_set_corner_color_rgba (pattern, 3,
+                                            end_color->red, end_color->green,
+                                            end_color->blue, end_color->alpha);
+
+  cairo_mesh_pattern_end_patch (pattern);
+}
+
+static void
+rgba_interpolate (GdkRGBA       *dest,
+                  const GdkRGBA *src1,
+                  const GdkRGBA *src2,
+                  double         progress)
+{
+  dest->red = src1->red * (1 - progress) + src2->red * progress;
+  dest->green = src1->green * (1 - progress) + src2->green * progress;
+  dest->blue = src1->blue * (1 - progress) + src2->blue * progress;
+  dest->alpha = src1->alpha * (1 - progress) + src2->alpha * progress;
+}
+
+/* Adds patches for the part of the gradient between @start_offset and
+ * @end_offset, split so that no patch crosses a multiple of 45 degrees. */
+static void
+gsk_conic_gradient_node_add_segment (GskConicGradientNode *self,
+                                     cairo_pattern_t      *pattern,
+                                     float                 radius,
+                                     float                 start_offset,
+                                     const GdkRGBA        *start_color,
+                                     float                 end_offset,
+                                     const GdkRGBA        *end_color)
+{
+  /* CSS measures angles clockwise from the top, cairo clockwise from the right */
+  const double angle_offset = self->rotation * G_PI / 180. - G_PI / 2.;
+  double offset, next;
+  GdkRGBA color, next_color;
+
+  if (end_offset <= start_offset)
+    return;
+
+  offset = start_offset;
+  color = *start_color;
+
+  while (offset < end_offset)
+    {
+      next = MIN (end_offset, (floor (offset * 8 + 1e-6) + 1) / 8.);
+      rgba_interpolate (&next_color, start_color, end_color,
+                        (next - start_offset) / (end_offset - start_offset));
+
+      gsk_conic_gradient_node_add_patch (pattern, radius,
+                                         angle_offset + 2 * G_PI * offset, &color,
+                                         angle_offset + 2 * G_PI * next, &next_color);
+
+      offset = next;
+      color = next_color;
+    }
+}
+
+static void
+gsk_conic_gradient_node_draw (GskRenderNode *node,
+                              cairo_t       *cr)
+{
+  GskConicGradientNode *self = (GskConicGradientNode *) node;
+  cairo_pattern_t *pattern;
+  float radius;
+  gsize i;
+
+  radius = MAX (MAX (fabs (node->bounds.origin.x - self->center.x),
+                     fabs (node->bounds.origin.x + node->bounds.size.width - self->center.x)),
+                MAX (fabs (node->bounds.origin.y - self->center.y),
+                     fabs (node->bounds.origin.y + node->bounds.size.height - self->center.y)));
+
+  pattern = cairo_pattern_create_mesh ();
+
+  gsk_conic_gradient_node_add_segment (self, pattern, radius,
+                                       0, &self->stops[0].color,
+                                       self->stops[0].offset, &self->stops[0].color);
+
+  for (i = 1; i < self->n_stops; i++)
+    {
+      gsk_conic_gradient_node_add_segment (self, pattern, radius,
+                                           self->stops[i - 1].offset, &self->stops[i - 1].color,
+                                           self->stops[i].offset, &self->stops[i].color);
+    }
+
+  gsk_conic_gradient_node_add_segment (self, pattern, radius,
+                                       self->stops[self->n_stops - 1].offset, &self->stops[self->n_stops - 1].color,
+                                       1, &self->stops[self->n_stops - 1].color);
+
+  cairo_save (cr);
+
+  cairo_rectangle (cr,
+                   node->bounds.origin.x, node->bounds.origin.y,
+                   node->bounds.size.width, node->bounds.size.height);
+  cairo_translate (cr, self->center.x, self->center.y);
+  cairo_set_source (cr, pattern);
+  cairo_fill (cr);
+
+  cairo_restore (cr);
+
+  cairo_pattern_destroy (pattern);
+}
+
+static void
+gsk_conic_gradient_node_diff (GskRenderNode  *node1,
+                              GskRenderNode  *node2,
+                              cairo_region_t *region)
+{
+  GskConicGradientNode *self1 = (GskConicGradientNode *) node1;
+  GskConicGradientNode *self2 = (GskConicGradientNode *) node2;
+
+  if (graphene_point_equal (&self1->center, &self2->center) &&
+      self1->rotation == self2->rotation &&
+      self1->n_stops == self2->n_stops &&
+      color_stops_equal (self1->stops, self2->stops, self1->n_stops))
+    return;
+
+  gsk_render_node_diff_impossible (node1, node2, region);
+}
+
+static const GskRenderNodeClass GSK_CONIC_GRADIENT_NODE_CLASS = {
+  GSK_CONIC_GRADIENT_NODE,
+  sizeof (GskConicGradientNode),
+  "GskConicGradientNode",
+  gsk_conic_gradient_node_finalize,
+  gsk_conic_gradient_node_draw,
+  gsk_render_node_can_diff_true,
+  gsk_conic_gradient_node_diff,
+};
+
+/**
+ * gsk_conic_gradient_node_new:
+ * @bounds: the bounds of the node
+ * @center: the center of the gradient
+ * @rotation: the rotation of the gradient in degrees
+ * @color_stops: (array length=n_color_stops): a pointer to an array of #GskColorStop defining the gradient
+ * @n_color_stops: the number of elements in @color_stops
+ *
+ * Creates a #GskRenderNode that draws a conic gradient. The conic gradient
+ * starts around @center in the direction of @rotation. A rotation of 0 means
+ * that the gradient points up. Color stops are then added clockwise.
+ *
+ * Returns: A new #GskRenderNode
+ */
+GskRenderNode *
+gsk_conic_gradient_node_new (const graphene_rect_t  *bounds,
+                             const graphene_point_t *center,
+                             float                   rotation,
+                             const GskColorStop     *color_stops,
+                             gsize                   n_color_stops)
+{
+  GskConicGradientNode *self;
+  gsize i;
+
+  g_return_val_if_fail (bounds != NULL, NULL);
+  g_return_val_if_fail (center != NULL, NULL);
+  g_return_val_if_fail (color_stops != NULL, NULL);
+  g_return_val_if_fail (n_color_stops >= 2, NULL);
+  g_return_val_if_fail (color_stops[0].offset >= 0, NULL);
+  for (i = 1; i < n_color_stops; i++)
+    g_return_val_if_fail (color_stops[i].offset >= color_stops[i-1].offset, NULL);
+  g_return_val_if_fail (color_stops[n_color_stops - 1].offset <= 1, NULL);
+
+  self = (GskConicGradientNode *) gsk_render_node_new (&GSK_CONIC_GRADIENT_NODE_CLASS, sizeof (GskColorStop) * n_color_stops);
+
+  graphene_rect_init_from_rect (&self->render_node.bounds, bounds);
+  graphene_point_init_from_point (&self->center, center);
+
+  self->rotation = rotation;
+
+  memcpy (&self->stops, color_stops, sizeof (GskColorStop) * n_color_stops);
+  self->n_stops = n_color_stops;
+
+  return &self->render_node;
+}
+
+gsize
+gsk_conic_gradient_node_get_n_color_stops (GskRenderNode *node)
+{
+  GskConicGradientNode *self = (GskConicGradientNode *) node;
+
+  return self->n_stops;
+}
+
+const GskColorStop *
+gsk_conic_gradient_node_peek_color_stops (GskRenderNode *node)
+{
+  GskConicGradientNode *self = (GskConicGradientNode *) node;
+
+  return self->stops;
+}
+
+const graphene_point_t *
+gsk_conic_gradient_node_peek_center (GskRenderNode *node)
+{
+  GskConicGradientNode *self = (GskConicGradientNode *) node;
+
+  return &self->center;
+}
+
+float
+gsk_conic_gradient_node_get_rotation (GskRenderNode *node)
+{
+  GskConicGradientNode *self = (GskConicGradientNode *) node;
+
+  return self->rotation;
+}
+
 /*** GSK_BORDER_NODE ***/
 
 typedef struct _GskBorderNode GskBorderNode;
@@ -822,6 +1390,9 @@ corner_mask_equal (CornerMask *mask1,
     mask1->corner.height == mask2->corner.height;
 }
 
+/* Tiles of the cairo renderer draw from multiple threads */
+G_LOCK_DEFINE_STATIC (corner_mask_cache);
+
 static void
 draw_shadow_corner (cairo_t               *cr,
                     gboolean               inset,
@@ -928,6 +1499,8 @@ draw_shadow_corner (cairo_t               *cr,
    * mask, so we cache rendered masks based on the blur radius and the
    * corner radius.
    */
+  G_LOCK (corner_mask_cache);
+
   if (corner_mask_cache == NULL)
     corner_mask_cache = g_hash_table_new_full ((GHashFunc)corner_mask_hash,
                                                (GEqualFunc)corner_mask_equal,
@@ -952,6 +1525,8 @@ draw_shadow_corner (cairo_t               *cr,
       g_hash_table_insert (corner_mask_cache, g_memdup (&key, sizeof (key)), mask);
     }
 
+  G_UNLOCK (corner_mask_cache);
+
   gdk_cairo_set_source_rgba (cr, color);
   pattern = cairo_pattern_create_for_surface (mask);
   cairo_matrix_init_identity (&matrix);
@@ -1698,10 +2273,20 @@ gsk_container_node_draw (GskRenderNode *node,
                          cairo_t       *cr)
 {
   GskContainerNode *container = (GskContainerNode *) node;
+  graphene_rect_t clip;
+  double x1, y1, x2, y2;
   guint i;
 
+  /* Skip children that are clipped away entirely. This matters when
+   * the frame is drawn in many small tiles. */
+  cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+  graphene_rect_init (&clip, x1, y1, x2 - x1, y2 - y1);
+
   for (i = 0; i < container->n_children; i++)
     {
+      if (!graphene_rect_intersection (&container->children[i]->bounds, &clip, NULL))
+        continue;
+
       gsk_render_node_draw (container->children[i], cr);
     }
 }
@@ -3920,3 +4505,159 @@ gsk_blur_node_get_radius (GskRenderNode *node)
 
   return self->radius;
 }
+
+/*< private >
+ * gsk_render_node_promote_contents:
+ * @node: a byte-wise copy of a node that was allocated from an arena
+ *
+ * Acquires the references that @node needs now that it is a node
+ * of its own, and promotes its children out of the arena as well.
+ */
+void
+gsk_render_node_promote_contents (GskRenderNode *node)
+{
+  switch (node->node_class->node_type)
+    {
+    case GSK_CONTAINER_NODE:
+      {
+        GskContainerNode *self = (GskContainerNode *) node;
+        guint i;
+
+        for (i = 0; i < self->n_children; i++)
+          self->children[i] = gsk_render_node_promote (gsk_render_node_ref (self->children[i]));
+      }
+      break;
+
+    case GSK_CAIRO_NODE:
+      {
+        GskCairoNode *self = (GskCairoNode *) node;
+
+        if (self->surface)
+          cairo_surface_reference (self->surface);
+      }
+      break;
+
+    case GSK_TEXTURE_NODE:
+      {
+        GskTextureNode *self = (GskTextureNode *) node;
+
+        g_object_ref (self->texture);
+      }
+      break;
+
+    case GSK_TEXT_NODE:
+      {
+        GskTextNode *self = (GskTextNode *) node;
+
+        g_object_ref (self->font);
+      }
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      {
+        GskTransformNode *self = (GskTransformNode *) node;
+
+        self->child = gsk_render_node_promote (gsk_render_node_ref (self->child));
+        gsk_transform_ref (self->transform);
+      }
+      break;
+
+    case GSK_DEBUG_NODE:
+      {
+        GskDebugNode *self = (GskDebugNode *) node;
+
+        self->child = gsk_render_node_promote (gsk_render_node_ref (self->child));
+        self->message = g_strdup (self->message);
+      }
+      break;
+
+    case GSK_OPACITY_NODE:
+      {
+        GskOpacityNode *self = (GskOpacityNode *) node;
+
+        self->child = gsk_render_node_promote (gsk_render_node_ref (self->child));
+      }
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      {
+        GskColorMatrixNode *self = (GskColorMatrixNode *) node;
+
+        self->child = gsk_render_node_promote (gsk_render_node_ref (self->child));
+      }
+      break;
+
+    case GSK_REPEAT_NODE:
+      {
+        GskRepeatNode *self = (GskRepeatNode *) node;
+
+        self->child = gsk_render_node_promote (gsk_render_node_ref (self->child));
+      }
+      break;
+
+    case GSK_CLIP_NODE:
+      {
+        GskClipNode *self = (GskClipNode *) node;
+
+        self->child = gsk_render_node_promote (gsk_render_node_ref (self->child));
+      }
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      {
+        GskRoundedClipNode *self = (GskRoundedClipNode *) node;
+
+        self->child = gsk_render_node_promote (gsk_render_node_ref (self->child));
+      }
+      break;
+
+    case GSK_SHADOW_NODE:
+      {
+        GskShadowNode *self = (GskShadowNode *) node;
+
+        self->child = gsk_render_node_promote (gsk_render_node_ref (self->child));
+      }
+      break;
+
+    case GSK_BLUR_NODE:
+      {
+        GskBlurNode *self = (GskBlurNode *) node;
+
+        self->child = gsk_render_node_promote (gsk_render_node_ref (self->child));
+      }
+      break;
+
+    case GSK_BLEND_NODE:
+      {
+        GskBlendNode *self = (GskBlendNode *) node;
+
+        self->bottom = gsk_render_node_promote (gsk_render_node_ref (self->bottom));
+        self->top = gsk_render_node_promote (gsk_render_node_ref (self->top));
+      }
+      break;
+
+    case GSK_CROSS_FADE_NODE:
+      {
+        GskCrossFadeNode *self = (GskCrossFadeNode *) node;
+
+        self->start = gsk_render_node_promote (gsk_render_node_ref (self->start));
+        self->end = gsk_render_node_promote (gsk_render_node_ref (self->end));
+      }
+      break;
+
+    case GSK_COLOR_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+    case GSK_CONIC_GRADIENT_NODE:
+    case GSK_BORDER_NODE:
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+      break;
+
+    case GSK_NOT_A_RENDER_NODE:
+    default:
+      g_assert_not_reached ();
+    }
+}
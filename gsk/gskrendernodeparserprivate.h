@@ -8,4 +8,9 @@ GskRenderNode * gsk_render_node_deserialize_from_bytes  (GBytes            *byte
                                                          GskParseErrorFunc  error_func,
                                                          gpointer           user_data);
 
+gboolean        gsk_render_node_is_binary               (GBytes            *bytes);
+GskRenderNode * gsk_render_node_deserialize_binary      (GBytes            *bytes,
+                                                         GskParseErrorFunc  error_func,
+                                                         gpointer           user_data);
+
 #endif
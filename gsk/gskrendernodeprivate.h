@@ -7,6 +7,7 @@
 G_BEGIN_DECLS
 
 typedef struct _GskRenderNodeClass GskRenderNodeClass;
+typedef struct _GskRenderNodeArena GskRenderNodeArena;
 
 #define GSK_IS_RENDER_NODE_TYPE(node,type) (GSK_IS_RENDER_NODE (node) && (node)->node_class->node_type == (type))
 
@@ -16,6 +17,8 @@ struct _GskRenderNode
 
   volatile int ref_count;
 
+  guint in_arena : 1;
+
   graphene_rect_t bounds;
 };
 
@@ -38,6 +41,27 @@ struct _GskRenderNodeClass
 GskRenderNode * gsk_render_node_new              (const GskRenderNodeClass  *node_class,
                                                   gsize                      extra_size);
 
+/* The arena functions are exported for the tests */
+GDK_AVAILABLE_IN_ALL
+GskRenderNodeArena *
+                gsk_render_node_arena_new        (void);
+GskRenderNodeArena *
+                gsk_render_node_arena_ref        (GskRenderNodeArena        *arena);
+GDK_AVAILABLE_IN_ALL
+void            gsk_render_node_arena_unref      (GskRenderNodeArena        *arena);
+GDK_AVAILABLE_IN_ALL
+guint           gsk_render_node_arena_get_n_nodes (GskRenderNodeArena       *arena);
+GDK_AVAILABLE_IN_ALL
+void            gsk_render_node_arena_push       (GskRenderNodeArena        *arena);
+GDK_AVAILABLE_IN_ALL
+void            gsk_render_node_arena_pop        (GskRenderNodeArena        *arena);
+GDK_AVAILABLE_IN_ALL
+gboolean        gsk_render_node_arena_set_enabled (gboolean                 enabled);
+
+GDK_AVAILABLE_IN_ALL
+GskRenderNode * gsk_render_node_promote          (GskRenderNode             *node);
+void            gsk_render_node_promote_contents (GskRenderNode             *node);
+
 gboolean        gsk_render_node_can_diff         (const GskRenderNode       *node1,
                                                   const GskRenderNode       *node2) G_GNUC_PURE;
 void            gsk_render_node_diff             (GskRenderNode             *node1,
@@ -0,0 +1,205 @@
+#include "config.h"
+
+#include "gsktraceprivate.h"
+
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <string.h>
+
+/* Render node traces are a sequence of frames, as recorded with
+ * GSK_DEBUG=record and replayed by tests/rendernode-replay.
+ *
+ * The file starts with the 8 byte magic and a little-endian 32bit
+ * version plus 4 bytes of padding. Each frame then has a 16 byte
+ * header with the 32bit size of the node data, 4 bytes of padding
+ * and the 64bit monotonic time the frame was rendered at, followed
+ * by the node in the binary format of gsk_render_node_serialize_binary(),
+ * padded to 16 bytes. This keeps the node data as aligned as the
+ * binary format wants it to be when the trace is mapped.
+ */
+
+#define GSK_TRACE_MAGIC "GSKTRACE"
+#define GSK_TRACE_MAGIC_SIZE 8
+#define GSK_TRACE_VERSION 1
+#define GSK_TRACE_HEADER_SIZE 16
+#define GSK_TRACE_FRAME_HEADER_SIZE 16
+#define GSK_TRACE_ALIGNMENT 16
+
+struct _GskTraceWriter
+{
+  FILE *file;
+};
+
+struct _GskTraceReader
+{
+  GMappedFile *file;
+  GBytes *bytes;
+  gsize pos;
+};
+
+GskTraceWriter *
+gsk_trace_writer_new (const char  *filename,
+                      GError     **error)
+{
+  GskTraceWriter *self;
+  guchar header[GSK_TRACE_HEADER_SIZE] = { 0, };
+  guint32 version = GUINT32_TO_LE (GSK_TRACE_VERSION);
+  FILE *file;
+
+  file = g_fopen (filename, "wb");
+  if (file == NULL)
+    {
+      int saved_errno = errno;
+
+      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (saved_errno),
+                   "Could not open %s: %s", filename, g_strerror (saved_errno));
+      return NULL;
+    }
+
+  memcpy (header, GSK_TRACE_MAGIC, GSK_TRACE_MAGIC_SIZE);
+  memcpy (header + GSK_TRACE_MAGIC_SIZE, &version, sizeof (version));
+  fwrite (header, 1, sizeof (header), file);
+
+  self = g_slice_new (GskTraceWriter);
+  self->file = file;
+
+  return self;
+}
+
+void
+gsk_trace_writer_free (GskTraceWriter *self)
+{
+  fclose (self->file);
+  g_slice_free (GskTraceWriter, self);
+}
+
+gboolean
+gsk_trace_writer_add_frame (GskTraceWriter  *self,
+                            GskRenderNode   *node,
+                            gint64           timestamp,
+                            GError         **error)
+{
+  static const guchar padding[GSK_TRACE_ALIGNMENT] = { 0, };
+  guchar header[GSK_TRACE_FRAME_HEADER_SIZE] = { 0, };
+  GBytes *bytes;
+  guint32 size;
+  gint64 time;
+  gboolean result;
+
+  bytes = gsk_render_node_serialize_binary (node);
+
+  size = GUINT32_TO_LE (g_bytes_get_size (bytes));
+  time = GINT64_TO_LE (timestamp);
+  memcpy (header, &size, sizeof (size));
+  memcpy (header + 8, &time, sizeof (time));
+
+  fwrite (header, 1, sizeof (header), self->file);
+  fwrite (g_bytes_get_data (bytes, NULL), 1, g_bytes_get_size (bytes), self->file);
+  fwrite (padding, 1, (GSK_TRACE_ALIGNMENT - g_bytes_get_size (bytes) % GSK_TRACE_ALIGNMENT) % GSK_TRACE_ALIGNMENT, self->file);
+
+  g_bytes_unref (bytes);
+
+  /* Keep what we have if the application crashes */
+  result = fflush (self->file) == 0 && !ferror (self->file);
+  if (!result)
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_IO, "Could not write frame");
+
+  return result;
+}
+
+GskTraceReader *
+gsk_trace_reader_new (const char  *filename,
+                      GError     **error)
+{
+  GskTraceReader *self;
+  GMappedFile *file;
+  const char *data;
+  guint32 version;
+
+  file = g_mapped_file_new (filename, FALSE, error);
+  if (file == NULL)
+    return NULL;
+
+  data = g_mapped_file_get_contents (file);
+  if (g_mapped_file_get_length (file) < GSK_TRACE_HEADER_SIZE ||
+      memcmp (data, GSK_TRACE_MAGIC, GSK_TRACE_MAGIC_SIZE) != 0)
+    {
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_UNSUPPORTED_FORMAT,
+                   "%s is not a render node trace", filename);
+      g_mapped_file_unref (file);
+      return NULL;
+    }
+
+  memcpy (&version, data + GSK_TRACE_MAGIC_SIZE, sizeof (version));
+  version = GUINT32_FROM_LE (version);
+  if (version > GSK_TRACE_VERSION)
+    {
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_UNSUPPORTED_VERSION,
+                   "Trace version %u is not supported", version);
+      g_mapped_file_unref (file);
+      return NULL;
+    }
+
+  self = g_slice_new (GskTraceReader);
+  self->file = file;
+  self->bytes = g_mapped_file_get_bytes (file);
+  self->pos = GSK_TRACE_HEADER_SIZE;
+
+  return self;
+}
+
+void
+gsk_trace_reader_free (GskTraceReader *self)
+{
+  g_bytes_unref (self->bytes);
+  g_mapped_file_unref (self->file);
+  g_slice_free (GskTraceReader, self);
+}
+
+/* Returns %FALSE at the end of the trace, or on error. The node data
+ * references the mapped file.
+ */
+gboolean
+gsk_trace_reader_next_frame (GskTraceReader  *self,
+                             gint64          *timestamp,
+                             GBytes         **node_data,
+                             GError         **error)
+{
+  const guchar *data;
+  gsize length;
+  guint32 size;
+  gint64 time;
+
+  data = g_bytes_get_data (self->bytes, &length);
+
+  if (self->pos == length)
+    return FALSE;
+
+  if (length - self->pos < GSK_TRACE_FRAME_HEADER_SIZE)
+    {
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Trace is truncated");
+      return FALSE;
+    }
+
+  memcpy (&size, data + self->pos, sizeof (size));
+  memcpy (&time, data + self->pos + 8, sizeof (time));
+  size = GUINT32_FROM_LE (size);
+  self->pos += GSK_TRACE_FRAME_HEADER_SIZE;
+
+  if (length - self->pos < size)
+    {
+      g_set_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                   "Trace is truncated");
+      self->pos = length;
+      return FALSE;
+    }
+
+  *timestamp = GINT64_FROM_LE (time);
+  *node_data = g_bytes_new_from_bytes (self->bytes, self->pos, size);
+
+  self->pos += size;
+  self->pos = MIN (length, self->pos + (GSK_TRACE_ALIGNMENT - size % GSK_TRACE_ALIGNMENT) % GSK_TRACE_ALIGNMENT);
+
+  return TRUE;
+}
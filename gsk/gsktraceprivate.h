@@ -0,0 +1,29 @@
+#ifndef __GSK_TRACE_PRIVATE_H__
+#define __GSK_TRACE_PRIVATE_H__
+
+#include "gskrendernode.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GskTraceWriter GskTraceWriter;
+typedef struct _GskTraceReader GskTraceReader;
+
+GskTraceWriter *        gsk_trace_writer_new            (const char      *filename,
+                                                         GError         **error);
+void                    gsk_trace_writer_free           (GskTraceWriter  *self);
+gboolean                gsk_trace_writer_add_frame      (GskTraceWriter  *self,
+                                                         GskRenderNode   *node,
+                                                         gint64           timestamp,
+                                                         GError         **error);
+
+GskTraceReader *        gsk_trace_reader_new            (const char      *filename,
+                                                         GError         **error);
+void                    gsk_trace_reader_free           (GskTraceReader  *self);
+gboolean                gsk_trace_reader_next_frame     (GskTraceReader  *self,
+                                                         gint64          *timestamp,
+                                                         GBytes         **node_data,
+                                                         GError         **error);
+
+G_END_DECLS
+
+#endif /* __GSK_TRACE_PRIVATE_H__ */
@@ -0,0 +1,67 @@
+// VERTEX_SHADER
+uniform vec2 u_center;
+uniform float u_color_stops[8 * 5];
+uniform int u_num_color_stops;
+
+_OUT_ vec2 center;
+_OUT_ vec4 color_stops[8];
+_OUT_ float color_offsets[8];
+
+void main() {
+  gl_Position = u_projection * u_modelview * vec4(aPosition, 0.0, 1.0);
+
+  center = (u_modelview * vec4(u_center, 0, 1)).xy;
+
+  for (int i = 0; i < u_num_color_stops; i ++) {
+    color_offsets[i] = u_color_stops[(i * 5) + 0];
+    color_stops[i].r = u_color_stops[(i * 5) + 1];
+    color_stops[i].g = u_color_stops[(i * 5) + 2];
+    color_stops[i].b = u_color_stops[(i * 5) + 3];
+    color_stops[i].a = u_color_stops[(i * 5) + 4];
+  }
+}
+
+// FRAGMENT_SHADER:
+#ifdef GSK_LEGACY
+uniform int u_num_color_stops;
+#else
+uniform highp int u_num_color_stops;
+#endif
+uniform float u_rotation;
+
+_IN_ vec2 center;
+_IN_ vec4 color_stops[8];
+_IN_ float color_offsets[8];
+
+const float PI = 3.1415926535897932384626433832795;
+
+vec4 fragCoord() {
+  vec4 f = gl_FragCoord;
+  f.x += u_viewport.x;
+  f.y = (u_viewport.y + u_viewport.w) - f.y;
+  return f;
+}
+
+void main() {
+  // Position relative to the center
+  vec2 pos = fragCoord().xy - center;
+
+  // Angle of the current pixel, clockwise from the top.
+  // u_rotation is in radians.
+  float angle = atan(pos.y, pos.x) + PI / 2.0 - u_rotation;
+
+  float offset = fract(angle / (2.0 * PI));
+
+  vec4 color = color_stops[0];
+  for (int i = 1; i < u_num_color_stops; i ++) {
+    if (offset >= color_offsets[i - 1])  {
+      float o = (offset - color_offsets[i - 1]) / (color_offsets[i] - color_offsets[i - 1]);
+      color = mix(color_stops[i - 1], color_stops[i], clamp(o, 0.0, 1.0));
+    }
+  }
+
+  /* Pre-multiply */
+  color.rgb *= color.a;
+
+  setOutputColor(color * u_alpha);
+}
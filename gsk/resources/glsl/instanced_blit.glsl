@@ -0,0 +1,15 @@
+// VERTEX_SHADER:
+void main() {
+  vec2 position = aInstanceRect.xy + aPosition * aInstanceRect.zw;
+
+  gl_Position = u_projection * u_modelview * vec4(position, 0.0, 1.0);
+
+  vUv = mix(aInstanceUv.xy, aInstanceUv.zw, aUv);
+}
+
+// FRAGMENT_SHADER:
+void main() {
+  vec4 diffuse = Texture(u_source, vUv);
+
+  setOutputColor(diffuse * u_alpha);
+}
@@ -0,0 +1,25 @@
+// VERTEX_SHADER:
+_OUT_ vec4 final_color;
+
+void main() {
+  vec2 position = aInstanceRect.xy + aPosition * aInstanceRect.zw;
+
+  gl_Position = u_projection * u_modelview * vec4(position, 0.0, 1.0);
+
+  vUv = mix(aInstanceUv.xy, aInstanceUv.zw, aUv);
+
+  final_color = aInstanceColor;
+  // pre-multiply
+  final_color.rgb *= final_color.a;
+  final_color *= u_alpha;
+}
+
+// FRAGMENT_SHADER:
+
+_IN_ vec4 final_color;
+
+void main() {
+  vec4 diffuse = Texture(u_source, vUv);
+
+  setOutputColor(final_color * diffuse.a);
+}
@@ -5,10 +5,18 @@ uniform float u_alpha;
 #if defined(GSK_GLES) || defined(GSK_LEGACY)
 attribute vec2 aPosition;
 attribute vec2 aUv;
+// Per-instance data, only used by the instanced programs
+attribute vec4 aInstanceRect;
+attribute vec4 aInstanceUv;
+attribute vec4 aInstanceColor;
 _OUT_ vec2 vUv;
 #else
 _IN_ vec2 aPosition;
 _IN_ vec2 aUv;
+// Per-instance data, only used by the instanced programs
+_IN_ vec4 aInstanceRect;
+_IN_ vec4 aInstanceUv;
+_IN_ vec4 aInstanceColor;
 _OUT_ vec2 vUv;
 #endif
 
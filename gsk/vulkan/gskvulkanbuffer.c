@@ -18,7 +18,8 @@ struct _GskVulkanBuffer
 static GskVulkanBuffer *
 gsk_vulkan_buffer_new_internal (GdkVulkanContext  *context,
                                 gsize              size,
-                                VkBufferUsageFlags usage)
+                                VkBufferUsageFlags usage,
+                                gboolean           transient)
 {
   VkMemoryRequirements requirements;
   GskVulkanBuffer *self;
@@ -43,15 +44,23 @@ gsk_vulkan_buffer_new_internal (GdkVulkanContext  *context,
                                  self->vk_buffer,
                                  &requirements);
 
-  self->memory = gsk_vulkan_memory_new (context,
-                                        requirements.memoryTypeBits,
-                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                        size);
+  if (transient)
+    self->memory = gsk_vulkan_memory_new_transient (context,
+                                                    requirements.memoryTypeBits,
+                                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                    requirements.size,
+                                                    requirements.alignment);
+  else
+    self->memory = gsk_vulkan_memory_new (context,
+                                          requirements.memoryTypeBits,
+                                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                          requirements.size,
+                                          requirements.alignment);
 
   GSK_VK_CHECK (vkBindBufferMemory, gdk_vulkan_context_get_device (context),
                                     self->vk_buffer,
                                     gsk_vulkan_memory_get_device_memory (self->memory),
-                                    0);
+                                    gsk_vulkan_memory_get_offset (self->memory));
   return self;
 }
 
@@ -61,21 +70,22 @@ gsk_vulkan_buffer_new (GdkVulkanContext  *context,
 {
   return gsk_vulkan_buffer_new_internal (context, size,
                                          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
-                                         | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+                                         | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                         FALSE);
 }
 
 GskVulkanBuffer *
 gsk_vulkan_buffer_new_staging (GdkVulkanContext  *context,
                                gsize              size)
 {
-  return gsk_vulkan_buffer_new_internal (context, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+  return gsk_vulkan_buffer_new_internal (context, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, TRUE);
 }
 
 GskVulkanBuffer *
 gsk_vulkan_buffer_new_download (GdkVulkanContext  *context,
                                 gsize              size)
 {
-  return gsk_vulkan_buffer_new_internal (context, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+  return gsk_vulkan_buffer_new_internal (context, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, TRUE);
 }
 void
 gsk_vulkan_buffer_free (GskVulkanBuffer *self)
@@ -105,14 +105,14 @@ gsk_vulkan_clip_intersect_rounded_rect (GskVulkanClip        *dest,
       break;
 
     case GSK_VULKAN_CLIP_NONE:
-      dest->type = gsk_rounded_rect_is_circular (&dest->rect) ? GSK_VULKAN_CLIP_ROUNDED_CIRCULAR : GSK_VULKAN_CLIP_ROUNDED;
+      dest->type = gsk_rounded_rect_is_circular (rounded) ? GSK_VULKAN_CLIP_ROUNDED_CIRCULAR : GSK_VULKAN_CLIP_ROUNDED;
       gsk_rounded_rect_init_copy (&dest->rect, rounded);
       break;
 
     case GSK_VULKAN_CLIP_RECT:
       if (graphene_rect_contains_rect (&src->rect.bounds, &rounded->bounds))
         {
-          dest->type = gsk_rounded_rect_is_circular (&dest->rect) ? GSK_VULKAN_CLIP_ROUNDED_CIRCULAR : GSK_VULKAN_CLIP_ROUNDED;
+          dest->type = gsk_rounded_rect_is_circular (rounded) ? GSK_VULKAN_CLIP_ROUNDED_CIRCULAR : GSK_VULKAN_CLIP_ROUNDED;
           gsk_rounded_rect_init_copy (&dest->rect, rounded);
           return TRUE;
         }
@@ -159,11 +159,45 @@ gsk_vulkan_clip_transform (GskVulkanClip           *dest,
     case GSK_VULKAN_CLIP_RECT:
     case GSK_VULKAN_CLIP_ROUNDED_CIRCULAR:
     case GSK_VULKAN_CLIP_ROUNDED:
-      /* FIXME: Handle 2D operations, in particular transform and scale */
-      return FALSE;
+      {
+        double xx, yx, xy, yy, dx, dy;
+        guint i;
+
+        /* Translations and axis-aligned scales can be undone on the clip,
+         * so we can express it in the child's coordinate system.
+         * FIXME: Handle rotations
+         */
+        if (!graphene_matrix_to_2d (transform, &xx, &yx, &xy, &yy, &dx, &dy) ||
+            yx != 0.0 || xy != 0.0 || xx <= 0.0 || yy <= 0.0)
+          return FALSE;
+
+        gsk_vulkan_clip_init_copy (dest, src);
+        dest->rect.bounds.origin.x = (src->rect.bounds.origin.x - dx) / xx;
+        dest->rect.bounds.origin.y = (src->rect.bounds.origin.y - dy) / yy;
+        dest->rect.bounds.size.width = src->rect.bounds.size.width / xx;
+        dest->rect.bounds.size.height = src->rect.bounds.size.height / yy;
+
+        if (src->type != GSK_VULKAN_CLIP_RECT)
+          {
+            for (i = 0; i < 4; i++)
+              {
+                dest->rect.corner[i].width = src->rect.corner[i].width / xx;
+                dest->rect.corner[i].height = src->rect.corner[i].height / yy;
+              }
+            dest->type = gsk_rounded_rect_is_circular (&dest->rect) ? GSK_VULKAN_CLIP_ROUNDED_CIRCULAR : GSK_VULKAN_CLIP_ROUNDED;
+          }
+      }
+      return TRUE;
     }
 }
 
+gboolean
+gsk_vulkan_clip_is_rounded (const GskVulkanClip *self)
+{
+  return self->type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR ||
+         self->type == GSK_VULKAN_CLIP_ROUNDED;
+}
+
 gboolean
 gsk_vulkan_clip_contains_rect (const GskVulkanClip   *self,
                                const graphene_rect_t *rect)
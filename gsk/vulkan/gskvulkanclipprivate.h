@@ -51,6 +51,7 @@ gboolean                gsk_vulkan_clip_transform                       (GskVulk
 
 gboolean                gsk_vulkan_clip_contains_rect                   (const GskVulkanClip    *self,
                                                                          const graphene_rect_t  *rect) G_GNUC_WARN_UNUSED_RESULT;
+gboolean                gsk_vulkan_clip_is_rounded                      (const GskVulkanClip    *self);
 
 G_END_DECLS
 
@@ -248,17 +248,25 @@ add_to_cache (GskVulkanGlyphCache  *cache,
 #endif
 }
 
+typedef struct {
+  Atlas *atlas;
+  DirtyGlyph **glyphs;
+  cairo_scaled_font_t **scaled_fonts;
+  GskImageRegion *regions;
+} RenderGlyphsData;
+
+/* This runs on a worker thread for most glyphs, so it must not touch
+ * the PangoFont unless scaled_font is NULL. */
 static void
-render_glyph (Atlas          *atlas,
-              DirtyGlyph     *glyph,
-              GskImageRegion *region)
+render_glyph (Atlas               *atlas,
+              DirtyGlyph          *glyph,
+              cairo_scaled_font_t *scaled_font,
+              GskImageRegion      *region)
 {
   GlyphCacheKey *key = glyph->key;
   GskVulkanCachedGlyph *value = glyph->value;
   cairo_surface_t *surface;
   cairo_t *cr;
-  PangoGlyphString glyphs;
-  PangoGlyphInfo gi;
 
   surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
                                         value->draw_width * key->scale / 1024,
@@ -268,21 +276,39 @@ render_glyph (Atlas          *atlas,
   cr = cairo_create (surface);
   cairo_set_source_rgba (cr, 1, 1, 1, 1);
 
-  gi.glyph = key->glyph;
-  gi.geometry.width = value->draw_width * 1024;
-  if (key->glyph & PANGO_GLYPH_UNKNOWN_FLAG)
-    gi.geometry.x_offset = key->xshift * 256;
+  if (scaled_font)
+    {
+      cairo_glyph_t cg;
+
+      cg.index = key->glyph;
+      cg.x = key->xshift * 0.25 - value->draw_x;
+      cg.y = key->yshift * 0.25 - value->draw_y;
+
+      cairo_set_scaled_font (cr, scaled_font);
+      cairo_show_glyphs (cr, &cg, 1);
+    }
   else
-    gi.geometry.x_offset = key->xshift * 256 - value->draw_x * 1024;
-  gi.geometry.y_offset = key->yshift * 256 - value->draw_y * 1024;
+    {
+      PangoGlyphString glyphs;
+      PangoGlyphInfo gi;
 
-  glyphs.num_glyphs = 1;
-  glyphs.glyphs = &gi;
+      gi.glyph = key->glyph;
+      gi.geometry.width = value->draw_width * 1024;
+      if (key->glyph & PANGO_GLYPH_UNKNOWN_FLAG)
+        gi.geometry.x_offset = key->xshift * 256;
+      else
+        gi.geometry.x_offset = key->xshift * 256 - value->draw_x * 1024;
+      gi.geometry.y_offset = key->yshift * 256 - value->draw_y * 1024;
+
+      glyphs.num_glyphs = 1;
+      glyphs.glyphs = &gi;
 
-  pango_cairo_show_glyph_string (cr, key->font, &glyphs);
+      pango_cairo_show_glyph_string (cr, key->font, &glyphs);
+    }
 
   cairo_destroy (cr);
 
+  cairo_surface_flush (surface);
   glyph->surface = surface;
 
   region->data = cairo_image_surface_get_data (surface);
@@ -293,26 +319,69 @@ render_glyph (Atlas          *atlas,
   region->y = (gsize)(value->ty * atlas->height);
 }
 
+static void
+render_glyph_func (guint    index,
+                   gpointer user_data)
+{
+  RenderGlyphsData *data = user_data;
+
+  if (data->scaled_fonts[index] == NULL)
+    return;
+
+  render_glyph (data->atlas, data->glyphs[index], data->scaled_fonts[index], &data->regions[index]);
+}
+
 static void
 upload_dirty_glyphs (GskVulkanGlyphCache *cache,
                      Atlas               *atlas,
                      GskVulkanUploader   *uploader)
 {
+  RenderGlyphsData data;
   GList *l;
   guint num_regions;
-  GskImageRegion *regions;
-  int i;
+  guint i;
 
   num_regions = g_list_length (atlas->dirty_glyphs);
-  regions = alloca (sizeof (GskImageRegion) * num_regions);
 
+  data.atlas = atlas;
+  data.glyphs = g_new (DirtyGlyph *, num_regions);
+  data.scaled_fonts = g_new (cairo_scaled_font_t *, num_regions);
+  data.regions = g_new (GskImageRegion, num_regions);
+
+  /* Look up the cairo fonts here, so that the workers don't need to
+   * touch pango. Unknown glyphs are drawn by pango, on this thread. */
   for (l = atlas->dirty_glyphs, i = 0; l; l = l->next, i++)
-    render_glyph (atlas, (DirtyGlyph *)l->data, &regions[i]);
+    {
+      DirtyGlyph *glyph = l->data;
+      cairo_scaled_font_t *scaled_font = NULL;
+
+      if (!(glyph->key->glyph & PANGO_GLYPH_UNKNOWN_FLAG))
+        {
+          scaled_font = pango_cairo_font_get_scaled_font ((PangoCairoFont *)glyph->key->font);
+          if (scaled_font && cairo_scaled_font_status (scaled_font) != CAIRO_STATUS_SUCCESS)
+            scaled_font = NULL;
+        }
+
+      data.glyphs[i] = glyph;
+      data.scaled_fonts[i] = scaled_font;
+    }
+
+  gsk_parallel_for (num_regions, render_glyph_func, &data);
+
+  for (i = 0; i < num_regions; i++)
+    {
+      if (data.scaled_fonts[i] == NULL)
+        render_glyph (atlas, data.glyphs[i], NULL, &data.regions[i]);
+    }
 
   GSK_RENDERER_NOTE (cache->renderer, GLYPH_CACHE,
             g_message ("uploading %d glyphs to cache", num_regions));
 
-  gsk_vulkan_image_upload_regions (atlas->image, uploader, num_regions, regions);
+  gsk_vulkan_image_upload_regions (atlas->image, uploader, num_regions, data.regions);
+
+  g_free (data.glyphs);
+  g_free (data.scaled_fonts);
+  g_free (data.regions);
 
   g_list_free_full (atlas->dirty_glyphs, dirty_glyph_free);
   atlas->dirty_glyphs = NULL;
@@ -3,62 +3,469 @@
 #include "gskvulkanpipelineprivate.h"
 #include "gskvulkanmemoryprivate.h"
 
-struct _GskVulkanMemory
-{
-  GdkVulkanContext *vulkan;
+#include <string.h>
+
+/* Memory management
+ *
+ * Drivers limit the number of device memory allocations, and allocating
+ * is slow, so we suballocate from big blocks instead of allocating
+ * memory for every buffer and image.
+ *
+ * Every memory type gets its own list of blocks. Allocations are
+ * placed in the first free range of a block that fits (the free ranges
+ * are kept sorted, and merged again when memory gets freed).
+ *
+ * Transient memory, for staging data that only lives until the next
+ * frame, comes from a linear arena instead. Allocating just bumps an
+ * offset, and the arena starts over once everything in it is freed.
+ *
+ * Allocations that are too big for a block get their own device memory.
+ *
+ * Host visible blocks are mapped once, for as long as they exist.
+ *
+ * One empty block per memory type is kept around to be reused, as long
+ * as anything else is still allocated. Memory keeps its GdkVulkanContext
+ * alive, so this makes sure that all blocks are gone before the context
+ * drops the device.
+ */
+
+#define BLOCK_SIZE (16 * 1024 * 1024)
+#define ARENA_SIZE (4 * 1024 * 1024)
 
+#define ALIGN(x, a) (((x) + (a) - 1) / (a) * (a))
+
+typedef enum {
+  BLOCK_HEAP,
+  BLOCK_ARENA,
+  BLOCK_DEDICATED
+} BlockKind;
+
+typedef struct {
+  gsize offset;
   gsize size;
+} FreeRange;
+
+typedef struct _GskVulkanAllocator GskVulkanAllocator;
+typedef struct _GskVulkanMemoryBlock GskVulkanMemoryBlock;
+
+struct _GskVulkanMemoryBlock
+{
+  GskVulkanAllocator *allocator;
+  BlockKind kind;
+  uint32_t type;
 
   VkDeviceMemory vk_memory;
+  gsize size;
+  guchar *map;
+
+  guint n_allocations;
+  gsize used;
+
+  GArray *free_ranges; /* FreeRange, sorted by offset, for BLOCK_HEAP */
+  gsize next_offset;   /* for BLOCK_ARENA */
 };
 
-GskVulkanMemory *
-gsk_vulkan_memory_new (GdkVulkanContext      *context,
-                       uint32_t               allowed_types,
-                       VkMemoryPropertyFlags  flags,
-                       gsize                  size)
+struct _GskVulkanAllocator
 {
+  GdkVulkanContext *vulkan; /* not owned, it owns us */
+
   VkPhysicalDeviceMemoryProperties properties;
-  GskVulkanMemory *self;
-  uint32_t i;
+  gsize granularity;
 
-  self = g_slice_new0 (GskVulkanMemory);
+  GPtrArray *blocks[VK_MAX_MEMORY_TYPES];
+  GskVulkanMemoryBlock *arenas[VK_MAX_MEMORY_TYPES];
 
-  self->vulkan = g_object_ref (context);
-  self->size = size;
+  guint n_allocations;
+  guint n_blocks;
+  gsize allocated;
+  gsize used;
+};
+
+struct _GskVulkanMemory
+{
+  GdkVulkanContext *vulkan;
+
+  GskVulkanMemoryBlock *block;
+  gsize offset;
+  gsize size;
+};
+
+static void gsk_vulkan_memory_block_free (GskVulkanMemoryBlock *block);
+
+static void
+gsk_vulkan_allocator_free (gpointer data)
+{
+  GskVulkanAllocator *self = data;
+  guint i;
+
+  /* All memory holds a reference on the context, and the last
+   * free gets rid of all blocks, see gsk_vulkan_memory_free() */
+  g_assert (self->n_blocks == 0);
+
+  for (i = 0; i < VK_MAX_MEMORY_TYPES; i++)
+    g_clear_pointer (&self->blocks[i], g_ptr_array_unref);
+
+  g_slice_free (GskVulkanAllocator, self);
+}
+
+static GskVulkanAllocator *
+gsk_vulkan_allocator_get (GdkVulkanContext *context)
+{
+  GskVulkanAllocator *self;
+  VkPhysicalDeviceProperties device_properties;
+
+  self = g_object_get_data (G_OBJECT (context), "-gsk-vulkan-allocator");
+  if (self)
+    return self;
+
+  self = g_slice_new0 (GskVulkanAllocator);
+  self->vulkan = context;
 
   vkGetPhysicalDeviceMemoryProperties (gdk_vulkan_context_get_physical_device (context),
-                                       &properties);
+                                       &self->properties);
+  vkGetPhysicalDeviceProperties (gdk_vulkan_context_get_physical_device (context),
+                                 &device_properties);
+  /* Buffers and linear images share blocks with optimal images,
+   * so keep everything apart by at least this much */
+  self->granularity = MAX (device_properties.limits.bufferImageGranularity, 1);
+
+  g_object_set_data_full (G_OBJECT (context), "-gsk-vulkan-allocator",
+                          self, gsk_vulkan_allocator_free);
+
+  return self;
+}
 
-  for (i = 0; i < properties.memoryTypeCount; i++)
+static uint32_t
+gsk_vulkan_allocator_find_type (GskVulkanAllocator    *self,
+                                uint32_t               allowed_types,
+                                VkMemoryPropertyFlags  flags)
+{
+  uint32_t i;
+
+  for (i = 0; i < self->properties.memoryTypeCount; i++)
     {
       if (!(allowed_types & (1 << i)))
         continue;
 
-      if ((properties.memoryTypes[i].propertyFlags & flags) == flags)
+      if ((self->properties.memoryTypes[i].propertyFlags & flags) == flags)
         break;
   }
 
-  g_assert (i < properties.memoryTypeCount);
+  g_assert (i < self->properties.memoryTypeCount);
+
+  return i;
+}
 
-  GSK_VK_CHECK (vkAllocateMemory, gdk_vulkan_context_get_device (context),
+static GskVulkanMemoryBlock *
+gsk_vulkan_memory_block_new (GskVulkanAllocator *allocator,
+                             BlockKind           kind,
+                             uint32_t            type,
+                             gsize               size)
+{
+  VkDevice device = gdk_vulkan_context_get_device (allocator->vulkan);
+  GskVulkanMemoryBlock *block;
+
+  block = g_slice_new0 (GskVulkanMemoryBlock);
+  block->allocator = allocator;
+  block->kind = kind;
+  block->type = type;
+  block->size = size;
+
+  GSK_VK_CHECK (vkAllocateMemory, device,
                                   &(VkMemoryAllocateInfo) {
                                       .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
                                       .allocationSize = size,
-                                      .memoryTypeIndex = i
+                                      .memoryTypeIndex = type
                                   },
                                   NULL,
-                                  &self->vk_memory);
+                                  &block->vk_memory);
+
+  if (allocator->properties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    GSK_VK_CHECK (vkMapMemory, device,
+                               block->vk_memory,
+                               0,
+                               VK_WHOLE_SIZE,
+                               0,
+                               (void **) &block->map);
+
+  if (kind == BLOCK_HEAP)
+    {
+      FreeRange range = { 0, size };
+
+      block->free_ranges = g_array_new (FALSE, FALSE, sizeof (FreeRange));
+      g_array_append_val (block->free_ranges, range);
+      if (allocator->blocks[type] == NULL)
+        allocator->blocks[type] = g_ptr_array_new ();
+      g_ptr_array_add (allocator->blocks[type], block);
+    }
+
+  allocator->n_blocks++;
+  allocator->allocated += size;
+
+  return block;
+}
+
+static void
+gsk_vulkan_memory_block_free (GskVulkanMemoryBlock *block)
+{
+  GskVulkanAllocator *allocator = block->allocator;
+  VkDevice device = gdk_vulkan_context_get_device (allocator->vulkan);
+
+  g_assert (block->n_allocations == 0);
+
+  if (block->kind == BLOCK_HEAP)
+    g_ptr_array_remove_fast (allocator->blocks[block->type], block);
+  else if (allocator->arenas[block->type] == block)
+    allocator->arenas[block->type] = NULL;
+
+  if (block->map)
+    vkUnmapMemory (device, block->vk_memory);
+  vkFreeMemory (device, block->vk_memory, NULL);
+
+  allocator->n_blocks--;
+  allocator->allocated -= block->size;
+
+  g_clear_pointer (&block->free_ranges, g_array_unref);
+  g_slice_free (GskVulkanMemoryBlock, block);
+}
+
+static gboolean
+gsk_vulkan_memory_block_alloc_heap (GskVulkanMemoryBlock *block,
+                                    gsize                 size,
+                                    gsize                 alignment,
+                                    gsize                *offset)
+{
+  guint i;
+
+  for (i = 0; i < block->free_ranges->len; i++)
+    {
+      FreeRange *range = &g_array_index (block->free_ranges, FreeRange, i);
+      gsize start = ALIGN (range->offset, alignment);
+      gsize end = range->offset + range->size;
+
+      if (start + size > end)
+        continue;
+
+      /* Keep the space in front of the aligned start, if any */
+      if (start > range->offset)
+        {
+          FreeRange after = { start + size, end - start - size };
+
+          range->size = start - range->offset;
+          if (after.size > 0)
+            g_array_insert_val (block->free_ranges, i + 1, after);
+        }
+      else if (start + size < end)
+        {
+          range->offset = start + size;
+          range->size = end - start - size;
+        }
+      else
+        {
+          g_array_remove_index (block->free_ranges, i);
+        }
+
+      *offset = start;
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+gsk_vulkan_memory_block_free_heap (GskVulkanMemoryBlock *block,
+                                   gsize                 offset,
+                                   gsize                 size)
+{
+  FreeRange *prev, *next;
+  guint i;
+
+  for (i = 0; i < block->free_ranges->len; i++)
+    {
+      if (g_array_index (block->free_ranges, FreeRange, i).offset > offset)
+        break;
+    }
+
+  prev = i > 0 ? &g_array_index (block->free_ranges, FreeRange, i - 1) : NULL;
+  next = i < block->free_ranges->len ? &g_array_index (block->free_ranges, FreeRange, i) : NULL;
+
+  if (prev && prev->offset + prev->size == offset)
+    {
+      prev->size += size;
+      if (next && offset + size == next->offset)
+        {
+          prev->size += next->size;
+          g_array_remove_index (block->free_ranges, i);
+        }
+    }
+  else if (next && offset + size == next->offset)
+    {
+      next->offset = offset;
+      next->size += size;
+    }
+  else
+    {
+      FreeRange range = { offset, size };
+
+      g_array_insert_val (block->free_ranges, i, range);
+    }
+}
+
+static GskVulkanMemory *
+gsk_vulkan_memory_new_internal (GdkVulkanContext      *context,
+                                uint32_t               allowed_types,
+                                VkMemoryPropertyFlags  flags,
+                                gsize                  size,
+                                gsize                  alignment,
+                                gboolean               transient)
+{
+  GskVulkanAllocator *allocator;
+  GskVulkanMemoryBlock *block;
+  GskVulkanMemory *self;
+  uint32_t type;
+  gsize offset;
+  guint i;
+
+  allocator = gsk_vulkan_allocator_get (context);
+  type = gsk_vulkan_allocator_find_type (allocator, allowed_types, flags);
+  alignment = MAX (alignment, allocator->granularity);
+  size = ALIGN (size, allocator->granularity);
+
+  block = NULL;
+  offset = 0;
+
+  if (transient && size <= ARENA_SIZE / 2)
+    {
+      block = allocator->arenas[type];
+      if (block)
+        {
+          offset = ALIGN (block->next_offset, alignment);
+          if (offset + size > block->size)
+            {
+              /* This one goes away once everything in it is freed */
+              allocator->arenas[type] = NULL;
+              block = NULL;
+            }
+        }
+
+      if (block == NULL)
+        {
+          block = gsk_vulkan_memory_block_new (allocator, BLOCK_ARENA, type, ARENA_SIZE);
+          allocator->arenas[type] = block;
+          offset = 0;
+        }
+
+      block->next_offset = offset + size;
+    }
+  else if (size <= BLOCK_SIZE / 2)
+    {
+      GPtrArray *blocks = allocator->blocks[type];
+
+      for (i = 0; blocks && i < blocks->len; i++)
+        {
+          if (gsk_vulkan_memory_block_alloc_heap (g_ptr_array_index (blocks, i), size, alignment, &offset))
+            {
+              block = g_ptr_array_index (blocks, i);
+              break;
+            }
+        }
+
+      if (block == NULL)
+        {
+          block = gsk_vulkan_memory_block_new (allocator, BLOCK_HEAP, type, BLOCK_SIZE);
+          if (!gsk_vulkan_memory_block_alloc_heap (block, size, alignment, &offset))
+            g_assert_not_reached ();
+        }
+    }
+  else
+    {
+      block = gsk_vulkan_memory_block_new (allocator, BLOCK_DEDICATED, type, size);
+    }
+
+  block->n_allocations++;
+  block->used += size;
+  allocator->n_allocations++;
+  allocator->used += size;
+
+  self = g_slice_new0 (GskVulkanMemory);
+
+  self->vulkan = g_object_ref (context);
+  self->block = block;
+  self->offset = offset;
+  self->size = size;
 
   return self;
 }
 
+GskVulkanMemory *
+gsk_vulkan_memory_new (GdkVulkanContext      *context,
+                       uint32_t               allowed_types,
+                       VkMemoryPropertyFlags  flags,
+                       gsize                  size,
+                       gsize                  alignment)
+{
+  return gsk_vulkan_memory_new_internal (context, allowed_types, flags, size, alignment, FALSE);
+}
+
+/* For data that does not live longer than a frame or so,
+ * like staging buffers. */
+GskVulkanMemory *
+gsk_vulkan_memory_new_transient (GdkVulkanContext      *context,
+                                 uint32_t               allowed_types,
+                                 VkMemoryPropertyFlags  flags,
+                                 gsize                  size,
+                                 gsize                  alignment)
+{
+  return gsk_vulkan_memory_new_internal (context, allowed_types, flags, size, alignment, TRUE);
+}
+
 void
 gsk_vulkan_memory_free (GskVulkanMemory *self)
 {
-  vkFreeMemory (gdk_vulkan_context_get_device (self->vulkan),
-                self->vk_memory,
-                NULL);
+  GskVulkanMemoryBlock *block = self->block;
+  GskVulkanAllocator *allocator = block->allocator;
+
+  block->n_allocations--;
+  block->used -= self->size;
+  allocator->n_allocations--;
+  allocator->used -= self->size;
+
+  switch (block->kind)
+    {
+    case BLOCK_HEAP:
+      gsk_vulkan_memory_block_free_heap (block, self->offset, self->size);
+      if (block->n_allocations == 0 && allocator->blocks[block->type]->len > 1)
+        gsk_vulkan_memory_block_free (block);
+      break;
+
+    case BLOCK_ARENA:
+      if (block->n_allocations == 0)
+        {
+          block->next_offset = 0;
+          if (allocator->arenas[block->type] != block)
+            gsk_vulkan_memory_block_free (block);
+        }
+      break;
+
+    case BLOCK_DEDICATED:
+      gsk_vulkan_memory_block_free (block);
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
+
+  if (allocator->n_allocations == 0)
+    {
+      /* Nothing left, so give back the blocks we kept around */
+      for (uint32_t type = 0; type < VK_MAX_MEMORY_TYPES; type++)
+        {
+          while (allocator->blocks[type] && allocator->blocks[type]->len > 0)
+            gsk_vulkan_memory_block_free (g_ptr_array_index (allocator->blocks[type], 0));
+          if (allocator->arenas[type])
+            gsk_vulkan_memory_block_free (allocator->arenas[type]);
+        }
+    }
 
   g_object_unref (self->vulkan);
 
@@ -68,28 +475,63 @@ gsk_vulkan_memory_free (GskVulkanMemory *self)
 VkDeviceMemory
 gsk_vulkan_memory_get_device_memory (GskVulkanMemory *self)
 {
-  return self->vk_memory;
+  return self->block->vk_memory;
+}
+
+gsize
+gsk_vulkan_memory_get_offset (GskVulkanMemory *self)
+{
+  return self->offset;
 }
 
 guchar *
 gsk_vulkan_memory_map (GskVulkanMemory *self)
 {
-  void *data;
-
-  GSK_VK_CHECK (vkMapMemory, gdk_vulkan_context_get_device (self->vulkan),
-                             self->vk_memory,
-                             0,
-                             self->size,
-                             0,
-                             &data);
+  g_assert (self->block->map != NULL);
 
-  return data;
+  return self->block->map + self->offset;
 }
 
 void
 gsk_vulkan_memory_unmap (GskVulkanMemory *self)
 {
-  vkUnmapMemory (gdk_vulkan_context_get_device (self->vulkan),
-                 self->vk_memory);
+  /* Blocks stay mapped */
 }
 
+void
+gsk_vulkan_memory_get_stats (GdkVulkanContext    *context,
+                             GskVulkanMemoryStats *stats)
+{
+  GskVulkanAllocator *allocator;
+  uint32_t type;
+  guint i, j;
+
+  memset (stats, 0, sizeof (GskVulkanMemoryStats));
+
+  allocator = g_object_get_data (G_OBJECT (context), "-gsk-vulkan-allocator");
+  if (allocator == NULL)
+    return;
+
+  stats->n_blocks = allocator->n_blocks;
+  stats->n_allocations = allocator->n_allocations;
+  stats->allocated = allocator->allocated;
+  stats->used = allocator->used;
+
+  for (type = 0; type < VK_MAX_MEMORY_TYPES; type++)
+    {
+      GPtrArray *blocks = allocator->blocks[type];
+
+      for (i = 0; blocks && i < blocks->len; i++)
+        {
+          GskVulkanMemoryBlock *block = g_ptr_array_index (blocks, i);
+
+          for (j = 0; j < block->free_ranges->len; j++)
+            {
+              FreeRange *range = &g_array_index (block->free_ranges, FreeRange, j);
+
+              stats->heap_free += range->size;
+              stats->heap_largest_free = MAX (stats->heap_largest_free, range->size);
+            }
+        }
+    }
+}
@@ -7,17 +7,36 @@ G_BEGIN_DECLS
 
 typedef struct _GskVulkanMemory GskVulkanMemory;
 
+typedef struct {
+  guint n_blocks;          /* device memory allocations */
+  guint n_allocations;
+  gsize allocated;         /* bytes of device memory */
+  gsize used;
+  gsize heap_free;         /* free bytes in the blocks we suballocate from */
+  gsize heap_largest_free;
+} GskVulkanMemoryStats;
+
 GskVulkanMemory *       gsk_vulkan_memory_new                           (GdkVulkanContext       *context,
                                                                          uint32_t                allowed_types,
                                                                          VkMemoryPropertyFlags   properties,
-                                                                         gsize                   size);
+                                                                         gsize                   size,
+                                                                         gsize                   alignment);
+GskVulkanMemory *       gsk_vulkan_memory_new_transient                 (GdkVulkanContext       *context,
+                                                                         uint32_t                allowed_types,
+                                                                         VkMemoryPropertyFlags   properties,
+                                                                         gsize                   size,
+                                                                         gsize                   alignment);
 void                    gsk_vulkan_memory_free                          (GskVulkanMemory        *memory);
 
 VkDeviceMemory          gsk_vulkan_memory_get_device_memory             (GskVulkanMemory        *self);
+gsize                   gsk_vulkan_memory_get_offset                    (GskVulkanMemory        *self);
 
 guchar *                gsk_vulkan_memory_map                           (GskVulkanMemory        *self);
 void                    gsk_vulkan_memory_unmap                         (GskVulkanMemory        *self);
 
+void                    gsk_vulkan_memory_get_stats                     (GdkVulkanContext       *context,
+                                                                         GskVulkanMemoryStats   *stats);
+
 G_END_DECLS
 
 #endif /* __GSK_VULKAN_MEMORY_PRIVATE_H__ */
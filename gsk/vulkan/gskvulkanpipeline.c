@@ -7,6 +7,8 @@
 
 #include <graphene.h>
 
+#define PIPELINE_CACHE_KEY "-gsk-vulkan-pipeline-cache"
+
 typedef struct _GskVulkanPipelinePrivate GskVulkanPipelinePrivate;
 
 struct _GskVulkanPipelinePrivate
@@ -53,6 +55,159 @@ gsk_vulkan_pipeline_init (GskVulkanPipeline *self)
 {
 }
 
+typedef struct {
+  VkPipelineCache vk_cache;
+  gsize loaded_size;
+} PipelineCache;
+
+static VkPipelineCache
+gsk_vulkan_pipeline_cache_get (GdkVulkanContext *context)
+{
+  PipelineCache *cache = g_object_get_data (G_OBJECT (context), PIPELINE_CACHE_KEY);
+
+  return cache ? cache->vk_cache : VK_NULL_HANDLE;
+}
+
+/* The driver checks that the data matches the device and driver
+ * version, and ignores it otherwise, but we still keep one file
+ * per device, so that machines with several GPUs don't keep
+ * overwriting each others cache. */
+static char *
+gsk_vulkan_pipeline_cache_get_path (GdkVulkanContext *context)
+{
+  VkPhysicalDeviceProperties properties;
+  GString *basename;
+  char *dir;
+  char *path;
+  guint i;
+
+  vkGetPhysicalDeviceProperties (gdk_vulkan_context_get_physical_device (context),
+                                 &properties);
+
+  basename = g_string_new (NULL);
+  g_string_append_printf (basename, "%04x-%04x-", properties.vendorID, properties.deviceID);
+  for (i = 0; i < VK_UUID_SIZE; i++)
+    g_string_append_printf (basename, "%02x", properties.pipelineCacheUUID[i]);
+  g_string_append (basename, ".cache");
+
+  dir = g_build_filename (g_get_user_cache_dir (), "gtk-4.0", "vulkan", NULL);
+  path = g_build_filename (dir, basename->str, NULL);
+  if (g_mkdir_with_parents (dir, 0755) != 0)
+    {
+      g_warning ("Failed to mkdir %s", dir);
+      g_free (path);
+      path = NULL;
+    }
+
+  g_free (dir);
+  g_string_free (basename, TRUE);
+
+  return path;
+}
+
+/*
+ * gsk_vulkan_pipeline_cache_load:
+ * @context: a #GdkVulkanContext
+ *
+ * Creates a pipeline cache for @context, with the data that was
+ * saved by an earlier gsk_vulkan_pipeline_cache_unload(). All
+ * pipelines created for @context until then use this cache.
+ */
+void
+gsk_vulkan_pipeline_cache_load (GdkVulkanContext *context)
+{
+  PipelineCache *cache;
+  char *path;
+  char *data = NULL;
+  gsize size = 0;
+
+  g_return_if_fail (g_object_get_data (G_OBJECT (context), PIPELINE_CACHE_KEY) == NULL);
+
+  path = gsk_vulkan_pipeline_cache_get_path (context);
+  if (path)
+    {
+      GError *error = NULL;
+
+      if (!g_file_get_contents (path, &data, &size, &error))
+        {
+          if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+            g_warning ("Failed to load pipeline cache %s: %s", path, error->message);
+          g_error_free (error);
+          size = 0;
+        }
+    }
+
+  cache = g_new0 (PipelineCache, 1);
+
+  if (GSK_VK_CHECK (vkCreatePipelineCache, gdk_vulkan_context_get_device (context),
+                                           &(VkPipelineCacheCreateInfo) {
+                                               .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+                                               .initialDataSize = size,
+                                               .pInitialData = data
+                                           },
+                                           NULL,
+                                           &cache->vk_cache) != VK_SUCCESS)
+    cache->vk_cache = VK_NULL_HANDLE;
+
+  cache->loaded_size = size;
+
+  GSK_NOTE (VULKAN, g_message ("Loaded %" G_GSIZE_FORMAT " bytes of pipeline cache from %s", size, path));
+
+  g_object_set_data_full (G_OBJECT (context), PIPELINE_CACHE_KEY, cache, g_free);
+
+  g_free (data);
+  g_free (path);
+}
+
+/*
+ * gsk_vulkan_pipeline_cache_unload:
+ * @context: a #GdkVulkanContext
+ *
+ * Writes the pipeline cache for @context to disk if it has
+ * grown, and destroys it.
+ */
+void
+gsk_vulkan_pipeline_cache_unload (GdkVulkanContext *context)
+{
+  VkDevice device = gdk_vulkan_context_get_device (context);
+  PipelineCache *cache;
+  char *path;
+  char *data;
+  size_t size;
+
+  cache = g_object_get_data (G_OBJECT (context), PIPELINE_CACHE_KEY);
+  if (cache == NULL || cache->vk_cache == VK_NULL_HANDLE)
+    goto out;
+
+  if (GSK_VK_CHECK (vkGetPipelineCacheData, device, cache->vk_cache, &size, NULL) != VK_SUCCESS ||
+      size <= cache->loaded_size)
+    goto out;
+
+  data = g_malloc (size);
+  if (GSK_VK_CHECK (vkGetPipelineCacheData, device, cache->vk_cache, &size, data) == VK_SUCCESS)
+    {
+      path = gsk_vulkan_pipeline_cache_get_path (context);
+      if (path)
+        {
+          GError *error = NULL;
+
+          if (!g_file_set_contents (path, data, size, &error))
+            {
+              g_warning ("Failed to save pipeline cache %s: %s", path, error->message);
+              g_error_free (error);
+            }
+          g_free (path);
+        }
+    }
+  g_free (data);
+
+out:
+  if (cache && cache->vk_cache != VK_NULL_HANDLE)
+    vkDestroyPipelineCache (device, cache->vk_cache, NULL);
+
+  g_object_set_data (G_OBJECT (context), PIPELINE_CACHE_KEY, NULL);
+}
+
 GskVulkanPipeline *
 gsk_vulkan_pipeline_new (GType                    pipeline_type,
                          GdkVulkanContext        *context,
@@ -96,7 +251,7 @@ gsk_vulkan_pipeline_new_full (GType                    pipeline_type,
   priv->fragment_shader = gsk_vulkan_shader_new_from_resource (context, GSK_VULKAN_SHADER_FRAGMENT, shader_name, NULL);
 
   GSK_VK_CHECK (vkCreateGraphicsPipelines, device,
-                                           VK_NULL_HANDLE,
+                                           gsk_vulkan_pipeline_cache_get (context),
                                            1,
                                            &(VkGraphicsPipelineCreateInfo) {
                                                .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
@@ -48,6 +48,9 @@ GskVulkanPipeline *     gsk_vulkan_pipeline_new_full                    (GType
 VkPipeline              gsk_vulkan_pipeline_get_pipeline                (GskVulkanPipeline              *self);
 VkPipelineLayout        gsk_vulkan_pipeline_get_pipeline_layout         (GskVulkanPipeline              *self);
 
+void                    gsk_vulkan_pipeline_cache_load                  (GdkVulkanContext               *context);
+void                    gsk_vulkan_pipeline_cache_unload                (GdkVulkanContext               *context);
+
 G_END_DECLS
 
 #endif /* __GSK_VULKAN_PIPELINE_PRIVATE_H__ */
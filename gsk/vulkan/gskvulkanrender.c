@@ -26,6 +26,29 @@
 #define DESCRIPTOR_POOL_MAXSETS 128
 #define DESCRIPTOR_POOL_MAXSETS_INCREASE 128
 
+/* How many frames the CPU may prepare while the GPU is still drawing */
+#define GSK_VULKAN_MAX_FRAMES_IN_FLIGHT 2
+
+typedef struct _GskVulkanRenderFrame GskVulkanRenderFrame;
+
+/* Everything the GPU may still be using while we prepare the next frame */
+struct _GskVulkanRenderFrame
+{
+  GskVulkanCommandPool *command_pool;
+  GPtrArray *draw_pools; /* one per render pass */
+  VkFence fence;
+  GskVulkanUploader *uploader;
+
+  GHashTable *descriptor_set_indexes;
+  VkDescriptorPool descriptor_pool;
+  uint32_t descriptor_pool_maxsets;
+  VkDescriptorSet *descriptor_sets;
+  gsize n_descriptor_sets;
+
+  GList *render_passes;
+  GSList *cleanup_images;
+};
+
 struct _GskVulkanRender
 {
   GskRenderer *renderer;
@@ -36,28 +59,25 @@ struct _GskVulkanRender
   cairo_region_t *clip;
 
   GHashTable *framebuffers;
-  GskVulkanCommandPool *command_pool;
-  VkFence fence;
   VkRenderPass render_pass;
   VkDescriptorSetLayout descriptor_set_layout;
   VkPipelineLayout pipeline_layout[3]; /* indexed by number of textures */
-  GskVulkanUploader *uploader;
 
-  GHashTable *descriptor_set_indexes;
-  VkDescriptorPool descriptor_pool;
-  uint32_t descriptor_pool_maxsets;
-  VkDescriptorSet *descriptor_sets;
-  gsize n_descriptor_sets;
+  GskVulkanRenderFrame frames[GSK_VULKAN_MAX_FRAMES_IN_FLIGHT];
+  guint current_frame;
+
   GskVulkanPipeline *pipelines[GSK_VULKAN_N_PIPELINES];
+  gboolean building_pipelines[GSK_VULKAN_N_PIPELINES];
+  GMutex pipeline_lock;
+  GCond pipeline_cond;
+  GThread *warm_up_thread;
+  int cancel_warm_up;
 
   GskVulkanImage *target;
 
   VkSampler sampler;
   VkSampler repeating_sampler;
 
-  GList *render_passes;
-  GSList *cleanup_images;
-
   GQuark render_pass_counter;
   GQuark gpu_time_timer;
 };
@@ -106,46 +126,66 @@ gsk_vulkan_render_setup (GskVulkanRender       *self,
 static guint desc_set_index_hash (gconstpointer v);
 static gboolean desc_set_index_equal (gconstpointer v1, gconstpointer v2);
 
-GskVulkanRender *
-gsk_vulkan_render_new (GskRenderer      *renderer,
-                       GdkVulkanContext *context)
+static inline GskVulkanRenderFrame *
+gsk_vulkan_render_get_frame (GskVulkanRender *self)
 {
-  GskVulkanRender *self;
-  VkDevice device;
-
-  self = g_slice_new0 (GskVulkanRender);
+  return &self->frames[self->current_frame];
+}
 
-  self->vulkan = context;
-  self->renderer = renderer;
-  self->framebuffers = g_hash_table_new (g_direct_hash, g_direct_equal);
-  self->descriptor_set_indexes = g_hash_table_new_full (desc_set_index_hash, desc_set_index_equal, NULL, g_free);
+static void
+gsk_vulkan_render_frame_init (GskVulkanRender      *self,
+                              GskVulkanRenderFrame *frame)
+{
+  VkDevice device = gdk_vulkan_context_get_device (self->vulkan);
 
-  device = gdk_vulkan_context_get_device (self->vulkan);
+  frame->descriptor_set_indexes = g_hash_table_new_full (desc_set_index_hash, desc_set_index_equal, NULL, g_free);
 
-  self->command_pool = gsk_vulkan_command_pool_new (self->vulkan);
+  frame->command_pool = gsk_vulkan_command_pool_new (self->vulkan);
+  frame->draw_pools = g_ptr_array_new_with_free_func ((GDestroyNotify) gsk_vulkan_command_pool_free);
   GSK_VK_CHECK (vkCreateFence, device,
                                &(VkFenceCreateInfo) {
                                    .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
                                    .flags = VK_FENCE_CREATE_SIGNALED_BIT
                                },
                                NULL,
-                               &self->fence);
+                               &frame->fence);
 
-  self->descriptor_pool_maxsets = DESCRIPTOR_POOL_MAXSETS;
+  frame->descriptor_pool_maxsets = DESCRIPTOR_POOL_MAXSETS;
   GSK_VK_CHECK (vkCreateDescriptorPool, device,
                                         &(VkDescriptorPoolCreateInfo) {
                                             .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-                                            .maxSets = self->descriptor_pool_maxsets,
+                                            .maxSets = frame->descriptor_pool_maxsets,
                                             .poolSizeCount = 1,
                                             .pPoolSizes = (VkDescriptorPoolSize[1]) {
                                                 {
                                                     .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                                    .descriptorCount = self->descriptor_pool_maxsets
+                                                    .descriptorCount = frame->descriptor_pool_maxsets
                                                 }
                                             }
                                         },
                                         NULL,
-                                        &self->descriptor_pool);
+                                        &frame->descriptor_pool);
+
+  frame->uploader = gsk_vulkan_uploader_new (self->vulkan, frame->command_pool);
+}
+
+GskVulkanRender *
+gsk_vulkan_render_new (GskRenderer      *renderer,
+                       GdkVulkanContext *context)
+{
+  GskVulkanRender *self;
+  VkDevice device;
+
+  self = g_slice_new0 (GskVulkanRender);
+
+  self->vulkan = context;
+  self->renderer = renderer;
+  self->framebuffers = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  device = gdk_vulkan_context_get_device (self->vulkan);
+
+  for (guint i = 0; i < GSK_VULKAN_MAX_FRAMES_IN_FLIGHT; i++)
+    gsk_vulkan_render_frame_init (self, &self->frames[i]);
 
   GSK_VK_CHECK (vkCreateRenderPass, gdk_vulkan_context_get_device (self->vulkan),
                                     &(VkRenderPassCreateInfo) {
@@ -253,7 +293,8 @@ gsk_vulkan_render_new (GskRenderer      *renderer,
                                  NULL,
                                  &self->repeating_sampler);
 
-  self->uploader = gsk_vulkan_uploader_new (self->vulkan, self->command_pool);
+  g_mutex_init (&self->pipeline_lock);
+  g_cond_init (&self->pipeline_cond);
 
 #ifdef G_ENABLE_DEBUG
   self->render_pass_counter = g_quark_from_static_string ("render-passes");
@@ -319,14 +360,18 @@ void
 gsk_vulkan_render_add_cleanup_image (GskVulkanRender *self,
                                      GskVulkanImage  *image)
 {
-  self->cleanup_images = g_slist_prepend (self->cleanup_images, image);
+  GskVulkanRenderFrame *frame = gsk_vulkan_render_get_frame (self);
+
+  frame->cleanup_images = g_slist_prepend (frame->cleanup_images, image);
 }
 
 void
 gsk_vulkan_render_add_render_pass (GskVulkanRender     *self,
                                    GskVulkanRenderPass *pass)
 {
-  self->render_passes = g_list_prepend (self->render_passes, pass);
+  GskVulkanRenderFrame *frame = gsk_vulkan_render_get_frame (self);
+
+  frame->render_passes = g_list_prepend (frame->render_passes, pass);
 
 #ifdef G_ENABLE_DEBUG
   gsk_profiler_counter_inc (gsk_renderer_get_profiler (self->renderer), self->render_pass_counter);
@@ -358,86 +403,157 @@ gsk_vulkan_render_add_node (GskVulkanRender *self,
 void
 gsk_vulkan_render_upload (GskVulkanRender *self)
 {
+  GskVulkanRenderFrame *frame = gsk_vulkan_render_get_frame (self);
   GList *l;
 
   /* gsk_vulkan_render_pass_upload may call gsk_vulkan_render_add_node_for_texture,
    * prepending new render passes to the list. Therefore, we walk the list from
    * the end.
    */
-  for (l = g_list_last (self->render_passes); l; l = l->prev)
+  for (l = g_list_last (frame->render_passes); l; l = l->prev)
     {
       GskVulkanRenderPass *pass = l->data;
-      gsk_vulkan_render_pass_upload (pass, self, self->uploader);
+      gsk_vulkan_render_pass_upload (pass, self, frame->uploader);
     }
 
-  gsk_vulkan_uploader_upload (self->uploader);
+  gsk_vulkan_uploader_upload (frame->uploader);
+}
+
+static const struct {
+  const char *name;
+  guint num_textures;
+  GskVulkanPipeline * (* create_func) (GdkVulkanContext *context, VkPipelineLayout layout, const char *name, VkRenderPass render_pass);
+} pipeline_info[GSK_VULKAN_N_PIPELINES] = {
+  { "texture",                    1, gsk_vulkan_texture_pipeline_new },
+  { "texture-clip",               1, gsk_vulkan_texture_pipeline_new },
+  { "texture-clip-rounded",       1, gsk_vulkan_texture_pipeline_new },
+  { "color",                      0, gsk_vulkan_color_pipeline_new },
+  { "color-clip",                 0, gsk_vulkan_color_pipeline_new },
+  { "color-clip-rounded",         0, gsk_vulkan_color_pipeline_new },
+  { "linear",                     0, gsk_vulkan_linear_gradient_pipeline_new },
+  { "linear-clip",                0, gsk_vulkan_linear_gradient_pipeline_new },
+  { "linear-clip-rounded",        0, gsk_vulkan_linear_gradient_pipeline_new },
+  { "color-matrix",               1, gsk_vulkan_effect_pipeline_new },
+  { "color-matrix-clip",          1, gsk_vulkan_effect_pipeline_new },
+  { "color-matrix-clip-rounded",  1, gsk_vulkan_effect_pipeline_new },
+  { "border",                     0, gsk_vulkan_border_pipeline_new },
+  { "border-clip",                0, gsk_vulkan_border_pipeline_new },
+  { "border-clip-rounded",        0, gsk_vulkan_border_pipeline_new },
+  { "inset-shadow",               0, gsk_vulkan_box_shadow_pipeline_new },
+  { "inset-shadow-clip",          0, gsk_vulkan_box_shadow_pipeline_new },
+  { "inset-shadow-clip-rounded",  0, gsk_vulkan_box_shadow_pipeline_new },
+  { "outset-shadow",              0, gsk_vulkan_box_shadow_pipeline_new },
+  { "outset-shadow-clip",         0, gsk_vulkan_box_shadow_pipeline_new },
+  { "outset-shadow-clip-rounded", 0, gsk_vulkan_box_shadow_pipeline_new },
+  { "blur",                       1, gsk_vulkan_blur_pipeline_new },
+  { "blur-clip",                  1, gsk_vulkan_blur_pipeline_new },
+  { "blur-clip-rounded",          1, gsk_vulkan_blur_pipeline_new },
+  { "mask",                       1, gsk_vulkan_text_pipeline_new },
+  { "mask-clip",                  1, gsk_vulkan_text_pipeline_new },
+  { "mask-clip-rounded",          1, gsk_vulkan_text_pipeline_new },
+  { "texture",                    1, gsk_vulkan_color_text_pipeline_new },
+  { "texture-clip",               1, gsk_vulkan_color_text_pipeline_new },
+  { "texture-clip-rounded",       1, gsk_vulkan_color_text_pipeline_new },
+  { "crossfade",                  2, gsk_vulkan_cross_fade_pipeline_new },
+  { "crossfade-clip",             2, gsk_vulkan_cross_fade_pipeline_new },
+  { "crossfade-clip-rounded",     2, gsk_vulkan_cross_fade_pipeline_new },
+  { "blendmode",                  2, gsk_vulkan_blend_mode_pipeline_new },
+  { "blendmode-clip",             2, gsk_vulkan_blend_mode_pipeline_new },
+  { "blendmode-clip-rounded",     2, gsk_vulkan_blend_mode_pipeline_new },
+};
+
+/* Pipelines get built by whoever needs them first, either the warm-up
+ * thread or the render itself. Must be called with pipeline_lock held. */
+static GskVulkanPipeline *
+gsk_vulkan_render_ensure_pipeline_locked (GskVulkanRender       *self,
+                                          GskVulkanPipelineType  type)
+{
+  GskVulkanPipeline *pipeline;
+
+  while (self->pipelines[type] == NULL && self->building_pipelines[type])
+    g_cond_wait (&self->pipeline_cond, &self->pipeline_lock);
+
+  if (self->pipelines[type] != NULL)
+    return self->pipelines[type];
+
+  self->building_pipelines[type] = TRUE;
+  g_mutex_unlock (&self->pipeline_lock);
+
+  pipeline = pipeline_info[type].create_func (self->vulkan,
+                                              self->pipeline_layout[pipeline_info[type].num_textures],
+                                              pipeline_info[type].name,
+                                              self->render_pass);
+
+  g_mutex_lock (&self->pipeline_lock);
+  g_atomic_pointer_set (&self->pipelines[type], pipeline);
+  self->building_pipelines[type] = FALSE;
+  g_cond_broadcast (&self->pipeline_cond);
+
+  return pipeline;
 }
 
 GskVulkanPipeline *
 gsk_vulkan_render_get_pipeline (GskVulkanRender       *self,
                                 GskVulkanPipelineType  type)
 {
-  static const struct {
-    const char *name;
-    guint num_textures;
-    GskVulkanPipeline * (* create_func) (GdkVulkanContext *context, VkPipelineLayout layout, const char *name, VkRenderPass render_pass);
-  } pipeline_info[GSK_VULKAN_N_PIPELINES] = {
-    { "texture",                    1, gsk_vulkan_texture_pipeline_new },
-    { "texture-clip",               1, gsk_vulkan_texture_pipeline_new },
-    { "texture-clip-rounded",       1, gsk_vulkan_texture_pipeline_new },
-    { "color",                      0, gsk_vulkan_color_pipeline_new },
-    { "color-clip",                 0, gsk_vulkan_color_pipeline_new },
-    { "color-clip-rounded",         0, gsk_vulkan_color_pipeline_new },
-    { "linear",                     0, gsk_vulkan_linear_gradient_pipeline_new },
-    { "linear-clip",                0, gsk_vulkan_linear_gradient_pipeline_new },
-    { "linear-clip-rounded",        0, gsk_vulkan_linear_gradient_pipeline_new },
-    { "color-matrix",               1, gsk_vulkan_effect_pipeline_new },
-    { "color-matrix-clip",          1, gsk_vulkan_effect_pipeline_new },
-    { "color-matrix-clip-rounded",  1, gsk_vulkan_effect_pipeline_new },
-    { "border",                     0, gsk_vulkan_border_pipeline_new },
-    { "border-clip",                0, gsk_vulkan_border_pipeline_new },
-    { "border-clip-rounded",        0, gsk_vulkan_border_pipeline_new },
-    { "inset-shadow",               0, gsk_vulkan_box_shadow_pipeline_new },
-    { "inset-shadow-clip",          0, gsk_vulkan_box_shadow_pipeline_new },
-    { "inset-shadow-clip-rounded",  0, gsk_vulkan_box_shadow_pipeline_new },
-    { "outset-shadow",              0, gsk_vulkan_box_shadow_pipeline_new },
-    { "outset-shadow-clip",         0, gsk_vulkan_box_shadow_pipeline_new },
-    { "outset-shadow-clip-rounded", 0, gsk_vulkan_box_shadow_pipeline_new },
-    { "blur",                       1, gsk_vulkan_blur_pipeline_new },
-    { "blur-clip",                  1, gsk_vulkan_blur_pipeline_new },
-    { "blur-clip-rounded",          1, gsk_vulkan_blur_pipeline_new },
-    { "mask",                       1, gsk_vulkan_text_pipeline_new },
-    { "mask-clip",                  1, gsk_vulkan_text_pipeline_new },
-    { "mask-clip-rounded",          1, gsk_vulkan_text_pipeline_new },
-    { "texture",                    1, gsk_vulkan_color_text_pipeline_new },
-    { "texture-clip",               1, gsk_vulkan_color_text_pipeline_new },
-    { "texture-clip-rounded",       1, gsk_vulkan_color_text_pipeline_new },
-    { "crossfade",                  2, gsk_vulkan_cross_fade_pipeline_new },
-    { "crossfade-clip",             2, gsk_vulkan_cross_fade_pipeline_new },
-    { "crossfade-clip-rounded",     2, gsk_vulkan_cross_fade_pipeline_new },
-    { "blendmode",                  2, gsk_vulkan_blend_mode_pipeline_new },
-    { "blendmode-clip",             2, gsk_vulkan_blend_mode_pipeline_new },
-    { "blendmode-clip-rounded",     2, gsk_vulkan_blend_mode_pipeline_new },
-  };
+  GskVulkanPipeline *pipeline;
 
   g_return_val_if_fail (type < GSK_VULKAN_N_PIPELINES, NULL);
 
-  if (self->pipelines[type] == NULL)
-    self->pipelines[type] = pipeline_info[type].create_func (self->vulkan,
-                                                             self->pipeline_layout[pipeline_info[type].num_textures],
-                                                             pipeline_info[type].name,
-                                                             self->render_pass);
+  pipeline = g_atomic_pointer_get (&self->pipelines[type]);
+  if (pipeline)
+    return pipeline;
 
-  return self->pipelines[type];
+  g_mutex_lock (&self->pipeline_lock);
+  pipeline = gsk_vulkan_render_ensure_pipeline_locked (self, type);
+  g_mutex_unlock (&self->pipeline_lock);
+
+  return pipeline;
+}
+
+static gpointer
+gsk_vulkan_render_warm_up_thread (gpointer data)
+{
+  GskVulkanRender *self = data;
+  guint i;
+
+  for (i = 0; i < GSK_VULKAN_N_PIPELINES; i++)
+    {
+      if (g_atomic_int_get (&self->cancel_warm_up))
+        break;
+
+      g_mutex_lock (&self->pipeline_lock);
+      gsk_vulkan_render_ensure_pipeline_locked (self, i);
+      g_mutex_unlock (&self->pipeline_lock);
+    }
+
+  return NULL;
+}
+
+/*
+ * gsk_vulkan_render_warm_up:
+ * @self: a #GskVulkanRender
+ *
+ * Starts building all pipelines in a thread, so that they are
+ * (hopefully) ready by the time they are first needed.
+ */
+void
+gsk_vulkan_render_warm_up (GskVulkanRender *self)
+{
+  g_return_if_fail (self->warm_up_thread == NULL);
+
+  self->warm_up_thread = g_thread_new ("gsk-vulkan-warm-up", gsk_vulkan_render_warm_up_thread, self);
 }
 
 VkDescriptorSet
 gsk_vulkan_render_get_descriptor_set (GskVulkanRender *self,
                                       gsize            id)
 {
-  g_assert (id < self->n_descriptor_sets);
+  GskVulkanRenderFrame *frame = gsk_vulkan_render_get_frame (self);
 
-  return self->descriptor_sets[id];
+  g_assert (id < frame->n_descriptor_sets);
+
+  return frame->descriptor_sets[id];
 }
 
 typedef struct {
@@ -468,6 +584,7 @@ gsk_vulkan_render_reserve_descriptor_set (GskVulkanRender *self,
                                           GskVulkanImage  *source,
                                           gboolean         repeat)
 {
+  GskVulkanRenderFrame *frame = gsk_vulkan_render_get_frame (self);
   HashDescriptorSetIndexEntry lookup;
   HashDescriptorSetIndexEntry *entry;
 
@@ -476,15 +593,15 @@ gsk_vulkan_render_reserve_descriptor_set (GskVulkanRender *self,
   lookup.image = source;
   lookup.repeat = repeat;
 
-  entry = g_hash_table_lookup (self->descriptor_set_indexes, &lookup);
+  entry = g_hash_table_lookup (frame->descriptor_set_indexes, &lookup);
   if (entry)
     return entry->index;
 
   entry = g_new (HashDescriptorSetIndexEntry, 1);
   entry->image = source;
   entry->repeat = repeat;
-  entry->index = g_hash_table_size (self->descriptor_set_indexes);
-  g_hash_table_add (self->descriptor_set_indexes, entry);
+  entry->index = g_hash_table_size (frame->descriptor_set_indexes);
+  g_hash_table_add (frame->descriptor_set_indexes, entry);
 
   return entry->index;
 }
@@ -492,6 +609,7 @@ gsk_vulkan_render_reserve_descriptor_set (GskVulkanRender *self,
 static void
 gsk_vulkan_render_prepare_descriptor_sets (GskVulkanRender *self)
 {
+  GskVulkanRenderFrame *frame = gsk_vulkan_render_get_frame (self);
   GHashTableIter iter;
   gpointer key;
   VkDevice device;
@@ -500,49 +618,49 @@ gsk_vulkan_render_prepare_descriptor_sets (GskVulkanRender *self)
 
   device = gdk_vulkan_context_get_device (self->vulkan);
 
-  for (l = self->render_passes; l; l = l->next)
+  for (l = frame->render_passes; l; l = l->next)
     {
       GskVulkanRenderPass *pass = l->data;
       gsk_vulkan_render_pass_reserve_descriptor_sets (pass, self);
     }
   
-  needed_sets = g_hash_table_size (self->descriptor_set_indexes);
-  if (needed_sets > self->n_descriptor_sets)
+  needed_sets = g_hash_table_size (frame->descriptor_set_indexes);
+  if (needed_sets > frame->n_descriptor_sets)
     {
-      if (needed_sets > self->descriptor_pool_maxsets)
+      if (needed_sets > frame->descriptor_pool_maxsets)
         {
-          guint added_sets = needed_sets - self->descriptor_pool_maxsets;
+          guint added_sets = needed_sets - frame->descriptor_pool_maxsets;
           added_sets = added_sets + DESCRIPTOR_POOL_MAXSETS_INCREASE - 1;
           added_sets -= added_sets % DESCRIPTOR_POOL_MAXSETS_INCREASE;
 
           vkDestroyDescriptorPool (device,
-                                   self->descriptor_pool,
+                                   frame->descriptor_pool,
                                    NULL);
-          self->descriptor_pool_maxsets += added_sets;
+          frame->descriptor_pool_maxsets += added_sets;
           GSK_VK_CHECK (vkCreateDescriptorPool, device,
                                                 &(VkDescriptorPoolCreateInfo) {
                                                     .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-                                                    .maxSets = self->descriptor_pool_maxsets,
+                                                    .maxSets = frame->descriptor_pool_maxsets,
                                                     .poolSizeCount = 1,
                                                     .pPoolSizes = (VkDescriptorPoolSize[1]) {
                                                         {
                                                             .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                                            .descriptorCount = self->descriptor_pool_maxsets
+                                                            .descriptorCount = frame->descriptor_pool_maxsets
                                                         }
                                                     }
                                                 },
                                                 NULL,
-                                                &self->descriptor_pool);
+                                                &frame->descriptor_pool);
         }
       else
         {
           GSK_VK_CHECK (vkResetDescriptorPool, device,
-                                               self->descriptor_pool,
+                                               frame->descriptor_pool,
                                                0);
         }
 
-      self->n_descriptor_sets = needed_sets;
-      self->descriptor_sets = g_renew (VkDescriptorSet, self->descriptor_sets, needed_sets);
+      frame->n_descriptor_sets = needed_sets;
+      frame->descriptor_sets = g_renew (VkDescriptorSet, frame->descriptor_sets, needed_sets);
     }
 
   VkDescriptorSetLayout *layouts = g_newa (VkDescriptorSetLayout, needed_sets);
@@ -552,13 +670,13 @@ gsk_vulkan_render_prepare_descriptor_sets (GskVulkanRender *self)
   GSK_VK_CHECK (vkAllocateDescriptorSets, device,
                                           &(VkDescriptorSetAllocateInfo) {
                                               .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-                                              .descriptorPool = self->descriptor_pool,
+                                              .descriptorPool = frame->descriptor_pool,
                                               .descriptorSetCount = needed_sets,
                                               .pSetLayouts = layouts
                                           },
-                                          self->descriptor_sets);
+                                          frame->descriptor_sets);
 
-  g_hash_table_iter_init (&iter, self->descriptor_set_indexes);
+  g_hash_table_iter_init (&iter, frame->descriptor_set_indexes);
   while (g_hash_table_iter_next (&iter, &key, NULL))
     {
       HashDescriptorSetIndexEntry *entry = key;
@@ -571,7 +689,7 @@ gsk_vulkan_render_prepare_descriptor_sets (GskVulkanRender *self)
                               (VkWriteDescriptorSet[1]) {
                                   {
                                       .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                                      .dstSet = self->descriptor_sets[id],
+                                      .dstSet = frame->descriptor_sets[id],
                                       .dstBinding = 0,
                                       .dstArrayElement = 0,
                                       .descriptorCount = 1,
@@ -587,9 +705,34 @@ gsk_vulkan_render_prepare_descriptor_sets (GskVulkanRender *self)
     }
 }
 
+typedef struct {
+  GskVulkanRender *render;
+  GskVulkanRenderPass **passes;
+  VkCommandBuffer *command_buffers;
+} RecordPassesData;
+
+static void
+gsk_vulkan_render_record_pass (guint    index,
+                               gpointer user_data)
+{
+  RecordPassesData *data = user_data;
+
+  gsk_vulkan_render_pass_draw (data->passes[index],
+                               data->render,
+                               3,
+                               data->render->pipeline_layout,
+                               data->command_buffers[index]);
+
+  GSK_VK_CHECK (vkEndCommandBuffer, data->command_buffers[index]);
+}
+
 void
 gsk_vulkan_render_draw (GskVulkanRender *self)
 {
+  GskVulkanRenderFrame *frame = gsk_vulkan_render_get_frame (self);
+  RecordPassesData record;
+  VkSubmitInfo *submits;
+  guint n_passes, i;
   GList *l;
 
 #ifdef G_ENABLE_DEBUG
@@ -599,30 +742,60 @@ gsk_vulkan_render_draw (GskVulkanRender *self)
 
   gsk_vulkan_render_prepare_descriptor_sets (self);
 
-  for (l = self->render_passes; l; l = l->next)
+  n_passes = g_list_length (frame->render_passes);
+  record.render = self;
+  record.passes = g_newa (GskVulkanRenderPass *, n_passes);
+  record.command_buffers = g_newa (VkCommandBuffer, n_passes);
+  submits = g_newa (VkSubmitInfo, n_passes);
+
+  /* Command pools must not be used from more than one thread at a time,
+   * so every pass records into a pool of its own.
+   */
+  while (frame->draw_pools->len < n_passes)
+    g_ptr_array_add (frame->draw_pools, gsk_vulkan_command_pool_new (self->vulkan));
+
+  for (l = frame->render_passes, i = 0; l; l = l->next, i++)
     {
       GskVulkanRenderPass *pass = l->data;
-      VkCommandBuffer command_buffer;
-      gsize wait_semaphore_count;
-      gsize signal_semaphore_count;
+      VkPipelineStageFlags *wait_semaphore_flags;
       VkSemaphore *wait_semaphores;
       VkSemaphore *signal_semaphores;
+      gsize wait_semaphore_count;
+      gsize signal_semaphore_count;
+      gsize j;
+
+      gsk_vulkan_render_pass_prepare_draw (pass, self);
+
+      record.passes[i] = pass;
+      record.command_buffers[i] = gsk_vulkan_command_pool_get_buffer (g_ptr_array_index (frame->draw_pools, i));
 
       wait_semaphore_count = gsk_vulkan_render_pass_get_wait_semaphores (pass, &wait_semaphores);
       signal_semaphore_count = gsk_vulkan_render_pass_get_signal_semaphores (pass, &signal_semaphores);
 
-      command_buffer = gsk_vulkan_command_pool_get_buffer (self->command_pool);
+      wait_semaphore_flags = g_newa (VkPipelineStageFlags, MAX (wait_semaphore_count, 1));
+      for (j = 0; j < wait_semaphore_count; j++)
+        wait_semaphore_flags[j] = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+      submits[i] = (VkSubmitInfo) {
+                       .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                       .waitSemaphoreCount = wait_semaphore_count,
+                       .pWaitSemaphores = wait_semaphores,
+                       .pWaitDstStageMask = wait_semaphore_flags,
+                       .commandBufferCount = 1,
+                       .pCommandBuffers = &record.command_buffers[i],
+                       .signalSemaphoreCount = signal_semaphore_count,
+                       .pSignalSemaphores = signal_semaphores,
+                   };
+    }
 
-      gsk_vulkan_render_pass_draw (pass, self, 3, self->pipeline_layout, command_buffer);
+  gsk_parallel_for (n_passes, gsk_vulkan_render_record_pass, &record);
 
-      gsk_vulkan_command_pool_submit_buffer (self->command_pool,
-                                             command_buffer,
-                                             wait_semaphore_count,
-                                             wait_semaphores,
-                                             signal_semaphore_count,
-                                             signal_semaphores,
-                                             l->next != NULL ? VK_NULL_HANDLE : self->fence);
-    }
+  /* Passes are in dependency order and semaphores signaled by earlier
+   * batches can be waited on by later ones, so submit them all at once. */
+  GSK_VK_CHECK (vkQueueSubmit, gdk_vulkan_context_get_queue (self->vulkan),
+                               n_passes,
+                               submits,
+                               frame->fence);
 
 #ifdef G_ENABLE_DEBUG
   if (GSK_RENDERER_DEBUG_CHECK (self->renderer, SYNC))
@@ -632,7 +805,7 @@ gsk_vulkan_render_draw (GskVulkanRender *self)
 
       GSK_VK_CHECK (vkWaitForFences, gdk_vulkan_context_get_device (self->vulkan),
                                      1,
-                                     &self->fence,
+                                     &frame->fence,
                                      VK_TRUE,
                                      INT64_MAX);
 
@@ -646,41 +819,74 @@ gsk_vulkan_render_draw (GskVulkanRender *self)
 GdkTexture *
 gsk_vulkan_render_download_target (GskVulkanRender *self)
 {
-  gsk_vulkan_uploader_reset (self->uploader);
+  GskVulkanRenderFrame *frame = gsk_vulkan_render_get_frame (self);
 
-  return gsk_vulkan_image_download (self->target, self->uploader);
+  gsk_vulkan_uploader_reset (frame->uploader);
+
+  return gsk_vulkan_image_download (self->target, frame->uploader);
 }
 
+/* Waits until the GPU is done with @frame and releases everything
+ * it used, so it can be used for a new frame. */
 static void
-gsk_vulkan_render_cleanup (GskVulkanRender *self)
+gsk_vulkan_render_frame_cleanup (GskVulkanRender      *self,
+                                 GskVulkanRenderFrame *frame)
 {
   VkDevice device = gdk_vulkan_context_get_device (self->vulkan);
 
-  /* XXX: Wait for fence here or just in reset()? */
   GSK_VK_CHECK (vkWaitForFences, device,
                                  1,
-                                 &self->fence,
+                                 &frame->fence,
                                  VK_TRUE,
                                  INT64_MAX);
 
   GSK_VK_CHECK (vkResetFences, device,
                                1,
-                               &self->fence);
+                               &frame->fence);
 
-  gsk_vulkan_uploader_reset (self->uploader);
+  gsk_vulkan_uploader_reset (frame->uploader);
 
-  gsk_vulkan_command_pool_reset (self->command_pool);
+  gsk_vulkan_command_pool_reset (frame->command_pool);
+  g_ptr_array_foreach (frame->draw_pools, (GFunc) gsk_vulkan_command_pool_reset, NULL);
 
-  g_hash_table_remove_all (self->descriptor_set_indexes);
+  g_hash_table_remove_all (frame->descriptor_set_indexes);
   GSK_VK_CHECK (vkResetDescriptorPool, device,
-                                       self->descriptor_pool,
+                                       frame->descriptor_pool,
                                        0);
 
-  g_list_free_full (self->render_passes, (GDestroyNotify) gsk_vulkan_render_pass_free);
-  self->render_passes = NULL;
-  g_slist_free_full (self->cleanup_images, g_object_unref);
-  self->cleanup_images = NULL;
+  g_list_free_full (frame->render_passes, (GDestroyNotify) gsk_vulkan_render_pass_free);
+  frame->render_passes = NULL;
+  g_slist_free_full (frame->cleanup_images, g_object_unref);
+  frame->cleanup_images = NULL;
+}
+
+static void
+gsk_vulkan_render_frame_finish (GskVulkanRender      *self,
+                                GskVulkanRenderFrame *frame)
+{
+  VkDevice device = gdk_vulkan_context_get_device (self->vulkan);
+
+  gsk_vulkan_render_frame_cleanup (self, frame);
 
+  g_clear_pointer (&frame->uploader, gsk_vulkan_uploader_free);
+
+  vkDestroyDescriptorPool (device,
+                           frame->descriptor_pool,
+                           NULL);
+  g_free (frame->descriptor_sets);
+  g_hash_table_unref (frame->descriptor_set_indexes);
+
+  vkDestroyFence (device,
+                  frame->fence,
+                  NULL);
+
+  g_ptr_array_unref (frame->draw_pools);
+  gsk_vulkan_command_pool_free (frame->command_pool);
+}
+
+static void
+gsk_vulkan_render_cleanup (GskVulkanRender *self)
+{
   g_clear_pointer (&self->clip, cairo_region_destroy);
   g_clear_object (&self->target);
 }
@@ -692,7 +898,16 @@ gsk_vulkan_render_free (GskVulkanRender *self)
   gpointer key, value;
   VkDevice device;
   guint i;
-  
+
+  if (self->warm_up_thread)
+    {
+      g_atomic_int_set (&self->cancel_warm_up, TRUE);
+      g_thread_join (self->warm_up_thread);
+    }
+
+  for (i = 0; i < GSK_VULKAN_MAX_FRAMES_IN_FLIGHT; i++)
+    gsk_vulkan_render_frame_finish (self, &self->frames[i]);
+
   gsk_vulkan_render_cleanup (self);
 
   device = gdk_vulkan_context_get_device (self->vulkan);
@@ -713,8 +928,8 @@ gsk_vulkan_render_free (GskVulkanRender *self)
 
   for (i = 0; i < GSK_VULKAN_N_PIPELINES; i++)
     g_clear_object (&self->pipelines[i]);
-
-  g_clear_pointer (&self->uploader, gsk_vulkan_uploader_free);
+  g_mutex_clear (&self->pipeline_lock);
+  g_cond_clear (&self->pipeline_cond);
 
   for (i = 0; i < 3; i++)
     vkDestroyPipelineLayout (device,
@@ -725,20 +940,10 @@ gsk_vulkan_render_free (GskVulkanRender *self)
                        self->render_pass,
                        NULL);
 
-  vkDestroyDescriptorPool (device,
-                           self->descriptor_pool,
-                           NULL);
-  g_free (self->descriptor_sets);
-  g_hash_table_unref (self->descriptor_set_indexes);
-
   vkDestroyDescriptorSetLayout (device,
                                 self->descriptor_set_layout,
                                 NULL);
 
-  vkDestroyFence (device,
-                  self->fence,
-                  NULL);
-
   vkDestroySampler (device,
                     self->sampler,
                     NULL);
@@ -747,15 +952,16 @@ gsk_vulkan_render_free (GskVulkanRender *self)
                     self->repeating_sampler,
                     NULL);
 
-  gsk_vulkan_command_pool_free (self->command_pool);
-
   g_slice_free (GskVulkanRender, self);
 }
 
+/* Whether gsk_vulkan_render_reset() would have to wait for the GPU */
 gboolean
 gsk_vulkan_render_is_busy (GskVulkanRender *self)
 {
-  return vkGetFenceStatus (gdk_vulkan_context_get_device (self->vulkan), self->fence) != VK_SUCCESS;
+  GskVulkanRenderFrame *next = &self->frames[(self->current_frame + 1) % GSK_VULKAN_MAX_FRAMES_IN_FLIGHT];
+
+  return vkGetFenceStatus (gdk_vulkan_context_get_device (self->vulkan), next->fence) != VK_SUCCESS;
 }
 
 void
@@ -764,6 +970,12 @@ gsk_vulkan_render_reset (GskVulkanRender       *self,
                          const graphene_rect_t *rect,
                          const cairo_region_t  *clip)
 {
+  /* The previous frames may still be drawing, we only need to wait
+   * for the oldest one, whose resources we're going to reuse.
+   */
+  self->current_frame = (self->current_frame + 1) % GSK_VULKAN_MAX_FRAMES_IN_FLIGHT;
+  gsk_vulkan_render_frame_cleanup (self, gsk_vulkan_render_get_frame (self));
+
   gsk_vulkan_render_cleanup (self);
 
   gsk_vulkan_render_setup (self, target, rect, clip);
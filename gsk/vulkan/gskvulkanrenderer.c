@@ -8,6 +8,7 @@
 #include "gskrendernodeprivate.h"
 #include "gskvulkanbufferprivate.h"
 #include "gskvulkanimageprivate.h"
+#include "gskvulkanmemoryprivate.h"
 #include "gskvulkanpipelineprivate.h"
 #include "gskvulkanrenderprivate.h"
 #include "gskvulkanglyphcacheprivate.h"
@@ -31,6 +32,11 @@ typedef struct {
   GQuark render_passes;
   GQuark fallback_pixels;
   GQuark texture_pixels;
+  GQuark memory_blocks;
+  GQuark memory_allocations;
+  GQuark memory_allocated;
+  GQuark memory_used;
+  GQuark memory_fragmentation;
 } ProfileCounters;
 
 typedef struct {
@@ -70,6 +76,30 @@ struct _GskVulkanRendererClass
 
 G_DEFINE_TYPE (GskVulkanRenderer, gsk_vulkan_renderer, GSK_TYPE_RENDERER)
 
+#ifdef G_ENABLE_DEBUG
+static void
+gsk_vulkan_renderer_update_memory_counters (GskVulkanRenderer *self,
+                                            GskProfiler       *profiler)
+{
+  GskVulkanMemoryStats stats;
+  int fragmentation;
+
+  gsk_vulkan_memory_get_stats (self->vulkan, &stats);
+
+  /* How much of the free heap memory can't be used for a single allocation */
+  if (stats.heap_free > 0)
+    fragmentation = 100 - (int) (100 * stats.heap_largest_free / stats.heap_free);
+  else
+    fragmentation = 0;
+
+  gsk_profiler_counter_set (profiler, self->profile_counters.memory_blocks, stats.n_blocks);
+  gsk_profiler_counter_set (profiler, self->profile_counters.memory_allocations, stats.n_allocations);
+  gsk_profiler_counter_set (profiler, self->profile_counters.memory_allocated, stats.allocated / 1024);
+  gsk_profiler_counter_set (profiler, self->profile_counters.memory_used, stats.used / 1024);
+  gsk_profiler_counter_set (profiler, self->profile_counters.memory_fragmentation, fragmentation);
+}
+#endif
+
 static void
 gsk_vulkan_renderer_free_targets (GskVulkanRenderer *self)
 {
@@ -129,7 +159,10 @@ gsk_vulkan_renderer_realize (GskRenderer  *renderer,
                     self);
   gsk_vulkan_renderer_update_images_cb (self->vulkan, self);
 
+  gsk_vulkan_pipeline_cache_load (self->vulkan);
+
   self->render = gsk_vulkan_render_new (renderer, self->vulkan);
+  gsk_vulkan_render_warm_up (self->render);
 
   self->glyph_cache = gsk_vulkan_glyph_cache_new (renderer, self->vulkan);
 
@@ -155,6 +188,8 @@ gsk_vulkan_renderer_unrealize (GskRenderer *renderer)
 
   g_clear_pointer (&self->render, gsk_vulkan_render_free);
 
+  gsk_vulkan_pipeline_cache_unload (self->vulkan);
+
   gsk_vulkan_renderer_free_targets (self);
   g_signal_handlers_disconnect_by_func(self->vulkan,
                                        gsk_vulkan_renderer_update_images_cb,
@@ -205,6 +240,8 @@ gsk_vulkan_renderer_render_texture (GskRenderer           *renderer,
   gsk_vulkan_render_free (render);
 
 #ifdef G_ENABLE_DEBUG
+  gsk_vulkan_renderer_update_memory_counters (self, profiler);
+
   start_time = gsk_profiler_timer_get_start (profiler, self->profile_timers.cpu_time);
   cpu_time = gsk_profiler_timer_end (profiler, self->profile_timers.cpu_time);
   gsk_profiler_timer_set (profiler, self->profile_timers.cpu_time, cpu_time);
@@ -236,7 +273,7 @@ gsk_vulkan_renderer_render (GskRenderer          *renderer,
   const cairo_region_t *clip;
 #ifdef G_ENABLE_DEBUG
   GskProfiler *profiler;
-  gint64 cpu_time;
+  gint64 cpu_time, start_time;
 #endif
 
 #ifdef G_ENABLE_DEBUG
@@ -261,11 +298,27 @@ gsk_vulkan_renderer_render (GskRenderer          *renderer,
 
 #ifdef G_ENABLE_DEBUG
   gsk_profiler_counter_inc (profiler, self->profile_counters.frames);
+  gsk_vulkan_renderer_update_memory_counters (self, profiler);
+
+  GSK_RENDERER_NOTE (renderer, FALLBACK,
+                     g_message ("Frame uploaded %" G_GINT64_FORMAT " fallback pixels",
+                                gsk_profiler_counter_get (profiler, self->profile_counters.fallback_pixels)));
 
+  start_time = gsk_profiler_timer_get_start (profiler, self->profile_timers.cpu_time);
   cpu_time = gsk_profiler_timer_end (profiler, self->profile_timers.cpu_time);
   gsk_profiler_timer_set (profiler, self->profile_timers.cpu_time, cpu_time);
 
   gsk_profiler_push_samples (profiler);
+
+  if (gdk_profiler_is_running ())
+    {
+      gdk_profiler_set_int_counter (texture_pixels_counter,
+                                    start_time + cpu_time,
+                                    gsk_profiler_counter_get (profiler, self->profile_counters.texture_pixels));
+      gdk_profiler_set_int_counter (fallback_pixels_counter,
+                                    start_time + cpu_time,
+                                    gsk_profiler_counter_get (profiler, self->profile_counters.fallback_pixels));
+    }
 #endif
 
   gdk_draw_context_end_frame (GDK_DRAW_CONTEXT (self->vulkan));
@@ -296,6 +349,11 @@ gsk_vulkan_renderer_init (GskVulkanRenderer *self)
   self->profile_counters.render_passes = gsk_profiler_add_counter (profiler, "render-passes", "Render passes", FALSE);
   self->profile_counters.fallback_pixels = gsk_profiler_add_counter (profiler, "fallback-pixels", "Fallback pixels", TRUE);
   self->profile_counters.texture_pixels = gsk_profiler_add_counter (profiler, "texture-pixels", "Texture pixels", TRUE);
+  self->profile_counters.memory_blocks = gsk_profiler_add_counter (profiler, "memory-blocks", "Device memory allocations", FALSE);
+  self->profile_counters.memory_allocations = gsk_profiler_add_counter (profiler, "memory-allocations", "Suballocations", FALSE);
+  self->profile_counters.memory_allocated = gsk_profiler_add_counter (profiler, "memory-allocated", "Device memory (kB)", FALSE);
+  self->profile_counters.memory_used = gsk_profiler_add_counter (profiler, "memory-used", "Used device memory (kB)", FALSE);
+  self->profile_counters.memory_fragmentation = gsk_profiler_add_counter (profiler, "memory-fragmentation", "Heap fragmentation (%)", FALSE);
 
   self->profile_timers.cpu_time = gsk_profiler_add_timer (profiler, "cpu-time", "CPU time", FALSE, TRUE);
   if (GSK_RENDERER_DEBUG_CHECK (GSK_RENDERER (self), SYNC))
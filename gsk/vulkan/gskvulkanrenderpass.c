@@ -51,6 +51,7 @@ typedef enum {
   GSK_VULKAN_OP_REPEAT,
   GSK_VULKAN_OP_CROSS_FADE,
   GSK_VULKAN_OP_BLEND_MODE,
+  GSK_VULKAN_OP_OFFSCREEN,
   /* GskVulkanOpText */
   GSK_VULKAN_OP_TEXT,
   GSK_VULKAN_OP_COLOR_TEXT,
@@ -120,9 +121,11 @@ struct _GskVulkanRenderPass
   graphene_matrix_t p;
 
   VkRenderPass render_pass;
+  VkFramebuffer framebuffer;
   VkSemaphore signal_semaphore;
   GArray *wait_semaphores;
   GskVulkanBuffer *vertex_data;
+  GPtrArray *lowered_nodes; /* nodes we created to replace unsupported ones */
 
   GQuark fallback_pixels;
   GQuark texture_pixels;
@@ -203,6 +206,7 @@ gsk_vulkan_render_pass_new (GdkVulkanContext  *context,
   self->signal_semaphore = signal_semaphore;
   self->wait_semaphores = g_array_new (FALSE, FALSE, sizeof (VkSemaphore));
   self->vertex_data = NULL;
+  self->lowered_nodes = g_ptr_array_new_with_free_func ((GDestroyNotify) gsk_render_node_unref);
 
 #ifdef G_ENABLE_DEBUG
   self->fallback_pixels = g_quark_from_static_string ("fallback-pixels");
@@ -229,11 +233,69 @@ gsk_vulkan_render_pass_free (GskVulkanRenderPass *self)
                         self->signal_semaphore,
                         NULL);
   g_array_unref (self->wait_semaphores);
-
+  g_ptr_array_unref (self->lowered_nodes);
 
   g_slice_free (GskVulkanRenderPass, self);
 }
 
+/* Express a shadow node with nodes we have pipelines for:
+ * every shadow is the child recolored with a color matrix, optionally
+ * blurred and translated by the shadow offset, drawn below the child.
+ */
+static GskRenderNode *
+gsk_vulkan_render_pass_lower_shadow_node (GskRenderNode *node)
+{
+  GskRenderNode *child = gsk_shadow_node_get_child (node);
+  GskRenderNode *result;
+  GPtrArray *children;
+  gsize i;
+
+  children = g_ptr_array_new_with_free_func ((GDestroyNotify) gsk_render_node_unref);
+
+  for (i = 0; i < gsk_shadow_node_get_n_shadows (node); i++)
+    {
+      const GskShadow *shadow = gsk_shadow_node_peek_shadow (node, i);
+      graphene_matrix_t color_matrix;
+      graphene_vec4_t color_offset;
+      GskTransform *transform;
+      GskRenderNode *shadow_node, *tmp;
+
+      if (gdk_rgba_is_clear (&shadow->color))
+        continue;
+
+      graphene_matrix_init_from_float (&color_matrix,
+                                       (float[16]) {
+                                           0.0, 0.0, 0.0, 0.0,
+                                           0.0, 0.0, 0.0, 0.0,
+                                           0.0, 0.0, 0.0, 0.0,
+                                           0.0, 0.0, 0.0, shadow->color.alpha
+                                       });
+      graphene_vec4_init (&color_offset, shadow->color.red, shadow->color.green, shadow->color.blue, 0.0);
+      shadow_node = gsk_color_matrix_node_new (child, &color_matrix, &color_offset);
+
+      if (shadow->radius > 0)
+        {
+          tmp = gsk_blur_node_new (shadow_node, shadow->radius);
+          gsk_render_node_unref (shadow_node);
+          shadow_node = tmp;
+        }
+
+      transform = gsk_transform_translate (NULL, &GRAPHENE_POINT_INIT (shadow->dx, shadow->dy));
+      tmp = gsk_transform_node_new (shadow_node, transform);
+      gsk_transform_unref (transform);
+      gsk_render_node_unref (shadow_node);
+
+      g_ptr_array_add (children, tmp);
+    }
+
+  g_ptr_array_add (children, gsk_render_node_ref (child));
+
+  result = gsk_container_node_new ((GskRenderNode **) children->pdata, children->len);
+  g_ptr_array_unref (children);
+
+  return result;
+}
+
 #define FALLBACK(...) G_STMT_START { \
   GSK_RENDERER_NOTE (gsk_vulkan_render_get_renderer (render), FALLBACK, g_message (__VA_ARGS__)); \
   goto fallback; \
@@ -256,16 +318,24 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
     case GSK_NOT_A_RENDER_NODE:
       g_assert_not_reached ();
       return;
-    case GSK_SHADOW_NODE:
     default:
       FALLBACK ("Unsupported node '%s'", node->node_class->type_name);
 
+    case GSK_SHADOW_NODE:
+      {
+        GskRenderNode *lowered = gsk_vulkan_render_pass_lower_shadow_node (node);
+
+        g_ptr_array_add (self->lowered_nodes, lowered);
+        gsk_vulkan_render_pass_add_node (self, render, constants, lowered);
+      }
+      return;
+
     case GSK_REPEAT_NODE:
       if (gsk_vulkan_clip_contains_rect (&constants->clip, &node->bounds))
         pipeline_type = GSK_VULKAN_PIPELINE_TEXTURE;
       else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
         pipeline_type = GSK_VULKAN_PIPELINE_TEXTURE_CLIP;
-      else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+      else if (gsk_vulkan_clip_is_rounded (&constants->clip))
         pipeline_type = GSK_VULKAN_PIPELINE_TEXTURE_CLIP_ROUNDED;
       else
         FALLBACK ("Repeat nodes can't deal with clip type %u", constants->clip.type);
@@ -279,7 +349,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
         pipeline_type = GSK_VULKAN_PIPELINE_BLEND_MODE;
       else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
         pipeline_type = GSK_VULKAN_PIPELINE_BLEND_MODE_CLIP;
-      else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+      else if (gsk_vulkan_clip_is_rounded (&constants->clip))
         pipeline_type = GSK_VULKAN_PIPELINE_BLEND_MODE_CLIP_ROUNDED;
       else
         FALLBACK ("Blend nodes can't deal with clip type %u", constants->clip.type);
@@ -293,7 +363,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
         pipeline_type = GSK_VULKAN_PIPELINE_CROSS_FADE;
       else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
         pipeline_type = GSK_VULKAN_PIPELINE_CROSS_FADE_CLIP;
-      else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+      else if (gsk_vulkan_clip_is_rounded (&constants->clip))
         pipeline_type = GSK_VULKAN_PIPELINE_CROSS_FADE_CLIP_ROUNDED;
       else
         FALLBACK ("Cross fade nodes can't deal with clip type %u", constants->clip.type);
@@ -309,7 +379,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
         pipeline_type = GSK_VULKAN_PIPELINE_INSET_SHADOW;
       else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
         pipeline_type = GSK_VULKAN_PIPELINE_INSET_SHADOW_CLIP;
-      else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+      else if (gsk_vulkan_clip_is_rounded (&constants->clip))
         pipeline_type = GSK_VULKAN_PIPELINE_INSET_SHADOW_CLIP_ROUNDED;
       else
         FALLBACK ("Inset shadow nodes can't deal with clip type %u", constants->clip.type);
@@ -325,7 +395,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
         pipeline_type = GSK_VULKAN_PIPELINE_OUTSET_SHADOW;
       else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
         pipeline_type = GSK_VULKAN_PIPELINE_OUTSET_SHADOW_CLIP;
-      else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+      else if (gsk_vulkan_clip_is_rounded (&constants->clip))
         pipeline_type = GSK_VULKAN_PIPELINE_OUTSET_SHADOW_CLIP_ROUNDED;
       else
         FALLBACK ("Outset shadow nodes can't deal with clip type %u", constants->clip.type);
@@ -361,7 +431,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
               pipeline_type = GSK_VULKAN_PIPELINE_COLOR_TEXT;
             else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
               pipeline_type = GSK_VULKAN_PIPELINE_COLOR_TEXT_CLIP;
-            else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+            else if (gsk_vulkan_clip_is_rounded (&constants->clip))
               pipeline_type = GSK_VULKAN_PIPELINE_COLOR_TEXT_CLIP_ROUNDED;
             else
               FALLBACK ("Text nodes can't deal with clip type %u", constants->clip.type);
@@ -373,7 +443,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
               pipeline_type = GSK_VULKAN_PIPELINE_TEXT;
             else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
               pipeline_type = GSK_VULKAN_PIPELINE_TEXT_CLIP;
-            else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+            else if (gsk_vulkan_clip_is_rounded (&constants->clip))
               pipeline_type = GSK_VULKAN_PIPELINE_TEXT_CLIP_ROUNDED;
             else
               FALLBACK ("Text nodes can't deal with clip type %u", constants->clip.type);
@@ -428,7 +498,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
         pipeline_type = GSK_VULKAN_PIPELINE_TEXTURE;
       else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
         pipeline_type = GSK_VULKAN_PIPELINE_TEXTURE_CLIP;
-      else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+      else if (gsk_vulkan_clip_is_rounded (&constants->clip))
         pipeline_type = GSK_VULKAN_PIPELINE_TEXTURE_CLIP_ROUNDED;
       else
         FALLBACK ("Texture nodes can't deal with clip type %u", constants->clip.type);
@@ -442,7 +512,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
         pipeline_type = GSK_VULKAN_PIPELINE_COLOR;
       else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
         pipeline_type = GSK_VULKAN_PIPELINE_COLOR_CLIP;
-      else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+      else if (gsk_vulkan_clip_is_rounded (&constants->clip))
         pipeline_type = GSK_VULKAN_PIPELINE_COLOR_CLIP_ROUNDED;
       else
         FALLBACK ("Color nodes can't deal with clip type %u", constants->clip.type);
@@ -461,7 +531,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
         pipeline_type = GSK_VULKAN_PIPELINE_LINEAR_GRADIENT;
       else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
         pipeline_type = GSK_VULKAN_PIPELINE_LINEAR_GRADIENT_CLIP;
-      else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+      else if (gsk_vulkan_clip_is_rounded (&constants->clip))
         pipeline_type = GSK_VULKAN_PIPELINE_LINEAR_GRADIENT_CLIP_ROUNDED;
       else
         FALLBACK ("Linear gradient nodes can't deal with clip type %u", constants->clip.type);
@@ -475,7 +545,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
         pipeline_type = GSK_VULKAN_PIPELINE_COLOR_MATRIX;
       else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
         pipeline_type = GSK_VULKAN_PIPELINE_COLOR_MATRIX_CLIP;
-      else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+      else if (gsk_vulkan_clip_is_rounded (&constants->clip))
         pipeline_type = GSK_VULKAN_PIPELINE_COLOR_MATRIX_CLIP_ROUNDED;
       else
         FALLBACK ("Opacity nodes can't deal with clip type %u", constants->clip.type);
@@ -489,7 +559,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
         pipeline_type = GSK_VULKAN_PIPELINE_BLUR;
       else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
         pipeline_type = GSK_VULKAN_PIPELINE_BLUR_CLIP;
-      else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+      else if (gsk_vulkan_clip_is_rounded (&constants->clip))
         pipeline_type = GSK_VULKAN_PIPELINE_BLUR_CLIP_ROUNDED;
       else
         FALLBACK ("Blur nodes can't deal with clip type %u", constants->clip.type);
@@ -503,7 +573,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
         pipeline_type = GSK_VULKAN_PIPELINE_COLOR_MATRIX;
       else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
         pipeline_type = GSK_VULKAN_PIPELINE_COLOR_MATRIX_CLIP;
-      else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+      else if (gsk_vulkan_clip_is_rounded (&constants->clip))
         pipeline_type = GSK_VULKAN_PIPELINE_COLOR_MATRIX_CLIP_ROUNDED;
       else
         FALLBACK ("Color matrix nodes can't deal with clip type %u", constants->clip.type);
@@ -517,7 +587,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
         pipeline_type = GSK_VULKAN_PIPELINE_BORDER;
       else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
         pipeline_type = GSK_VULKAN_PIPELINE_BORDER_CLIP;
-      else if (constants->clip.type == GSK_VULKAN_CLIP_ROUNDED_CIRCULAR)
+      else if (gsk_vulkan_clip_is_rounded (&constants->clip))
         pipeline_type = GSK_VULKAN_PIPELINE_BORDER_CLIP_ROUNDED;
       else
         FALLBACK ("Border nodes can't deal with clip type %u", constants->clip.type);
@@ -556,7 +626,10 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
         graphene_matrix_init_from_matrix (&mv, &self->mv);
         graphene_matrix_multiply (&transform, &mv, &self->mv);
         if (!gsk_vulkan_push_constants_transform (&op.constants.constants, constants, &transform, &child->bounds))
-          FALLBACK ("Transform nodes can't deal with clip type %u", constants->clip.type);
+          {
+            graphene_matrix_init_from_matrix (&self->mv, &mv);
+            goto offscreen;
+          }
         op.type = GSK_VULKAN_OP_PUSH_VERTEX_CONSTANTS;
         g_array_append_val (self->render_ops, op);
 
@@ -570,7 +643,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
     case GSK_CLIP_NODE:
       {
         if (!gsk_vulkan_push_constants_intersect_rect (&op.constants.constants, constants, gsk_clip_node_peek_clip (node)))
-          FALLBACK ("Failed to find intersection between clip of type %u and rectangle", constants->clip.type);
+          goto offscreen;
         if (op.constants.constants.clip.type == GSK_VULKAN_CLIP_ALL_CLIPPED)
           return;
 
@@ -589,7 +662,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
         if (!gsk_vulkan_push_constants_intersect_rounded (&op.constants.constants,
                                                           constants,
                                                           gsk_rounded_clip_node_peek_clip (node)))
-          FALLBACK ("Failed to find intersection between clip of type %u and rounded rectangle", constants->clip.type);
+          goto offscreen;
         if (op.constants.constants.clip.type == GSK_VULKAN_CLIP_ALL_CLIPPED)
           return;
 
@@ -607,11 +680,33 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
   g_assert_not_reached ();
   return;
 
+offscreen:
+  /* We can't combine the node's clip or transform with the current clip.
+   * So render the node into an image without a clip and draw that
+   * with the current clip instead.
+   */
+  if (constants->clip.type == GSK_VULKAN_CLIP_NONE)
+    FALLBACK ("Failed to render %s node offscreen", node->node_class->type_name);
+  else if (gsk_vulkan_clip_contains_rect (&constants->clip, &node->bounds))
+    pipeline_type = GSK_VULKAN_PIPELINE_TEXTURE;
+  else if (constants->clip.type == GSK_VULKAN_CLIP_RECT)
+    pipeline_type = GSK_VULKAN_PIPELINE_TEXTURE_CLIP;
+  else if (gsk_vulkan_clip_is_rounded (&constants->clip))
+    pipeline_type = GSK_VULKAN_PIPELINE_TEXTURE_CLIP_ROUNDED;
+  else
+    FALLBACK ("Offscreen nodes can't deal with clip type %u", constants->clip.type);
+  op.type = GSK_VULKAN_OP_OFFSCREEN;
+  op.render.node = node;
+  op.render.pipeline = gsk_vulkan_render_get_pipeline (render, pipeline_type);
+  g_array_append_val (self->render_ops, op);
+  return;
+
 fallback:
   switch (constants->clip.type)
     {
       case GSK_VULKAN_CLIP_NONE:
         op.type = GSK_VULKAN_OP_FALLBACK;
+        gsk_rounded_rect_init_copy (&op.render.clip, &constants->clip.rect);
         break;
       case GSK_VULKAN_CLIP_RECT:
         op.type = GSK_VULKAN_OP_FALLBACK_CLIP;
@@ -809,33 +904,47 @@ gsk_vulkan_render_pass_upload_fallback (GskVulkanRenderPass  *self,
 {
   GskRenderNode *node;
   cairo_surface_t *surface;
+  graphene_rect_t area;
   cairo_t *cr;
+  int width, height;
 
   node = op->node;
 
+  /* Only upload the part of the node that ends up being visible */
+  if (!graphene_rect_intersection (&node->bounds, &op->clip.bounds, &area))
+    {
+      op->source = NULL;
+      return;
+    }
+  area.size.width = ceil (area.origin.x + area.size.width) - floor (area.origin.x);
+  area.size.height = ceil (area.origin.y + area.size.height) - floor (area.origin.y);
+  area.origin.x = floor (area.origin.x);
+  area.origin.y = floor (area.origin.y);
+
+  width = ceil (area.size.width * self->scale_factor);
+  height = ceil (area.size.height * self->scale_factor);
+
   GSK_RENDERER_NOTE (gsk_vulkan_render_get_renderer (render), FALLBACK,
-            g_message ("Upload op=%s, node %s[%p], bounds %gx%g",
+            g_message ("Upload op=%s, node %s[%p], bounds %gx%g, uploading %dx%d",
                      op->type == GSK_VULKAN_OP_FALLBACK_CLIP ? "fallback-clip" :
                      (op->type == GSK_VULKAN_OP_FALLBACK_ROUNDED_CLIP ? "fallback-rounded-clip" : "fallback"),
                      node->node_class->type_name, node,
                      ceil (node->bounds.size.width),
-                     ceil (node->bounds.size.height)));
+                     ceil (node->bounds.size.height),
+                     width, height));
 #ifdef G_ENABLE_DEBUG
   {
     GskProfiler *profiler = gsk_renderer_get_profiler (gsk_vulkan_render_get_renderer (render));
     gsk_profiler_counter_add (profiler,
                               self->fallback_pixels,
-                              ceil (node->bounds.size.width) * ceil (node->bounds.size.height));
+                              width * height);
   }
 #endif
 
-  /* XXX: We could intersect bounds with clip bounds here */
-  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-                                        ceil (node->bounds.size.width * self->scale_factor),
-                                        ceil (node->bounds.size.height * self->scale_factor));
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
   cairo_surface_set_device_scale (surface, self->scale_factor, self->scale_factor);
   cr = cairo_create (surface);
-  cairo_translate (cr, -node->bounds.origin.x, -node->bounds.origin.y);
+  cairo_translate (cr, -area.origin.x, -area.origin.y);
 
   if (op->type == GSK_VULKAN_OP_FALLBACK_CLIP)
     {
@@ -864,7 +973,11 @@ gsk_vulkan_render_pass_upload_fallback (GskVulkanRenderPass  *self,
                                                cairo_image_surface_get_height (surface),
                                                cairo_image_surface_get_stride (surface));
 
-  op->source_rect = GRAPHENE_RECT_INIT(0, 0, 1, 1);
+  /* the vertices cover the node's bounds, map them into the uploaded area */
+  op->source_rect.origin.x = (node->bounds.origin.x - area.origin.x) / area.size.width;
+  op->source_rect.origin.y = (node->bounds.origin.y - area.origin.y) / area.size.height;
+  op->source_rect.size.width = node->bounds.size.width / area.size.width;
+  op->source_rect.size.height = node->bounds.size.height / area.size.height;
 
   cairo_surface_destroy (surface);
 
@@ -947,6 +1060,18 @@ gsk_vulkan_render_pass_upload (GskVulkanRenderPass  *self,
           }
           break;
 
+        case GSK_VULKAN_OP_OFFSCREEN:
+          {
+            op->render.source = gsk_vulkan_render_pass_get_node_as_texture (self,
+                                                                            render,
+                                                                            uploader,
+                                                                            op->render.node,
+                                                                            &op->render.node->bounds,
+                                                                            clip,
+                                                                            &op->render.source_rect);
+          }
+          break;
+
         case GSK_VULKAN_OP_BLUR:
           {
             GskRenderNode *child = gsk_blur_node_get_child (op->render.node);
@@ -1073,6 +1198,7 @@ gsk_vulkan_render_pass_count_vertex_data (GskVulkanRenderPass *self)
         case GSK_VULKAN_OP_FALLBACK_CLIP:
         case GSK_VULKAN_OP_FALLBACK_ROUNDED_CLIP:
         case GSK_VULKAN_OP_TEXTURE:
+        case GSK_VULKAN_OP_OFFSCREEN:
         case GSK_VULKAN_OP_REPEAT:
           op->render.vertex_count = gsk_vulkan_texture_pipeline_count_vertex_data (GSK_VULKAN_TEXTURE_PIPELINE (op->render.pipeline));
           n_bytes += op->render.vertex_count;
@@ -1165,6 +1291,7 @@ gsk_vulkan_render_pass_collect_vertex_data (GskVulkanRenderPass *self,
         case GSK_VULKAN_OP_FALLBACK_CLIP:
         case GSK_VULKAN_OP_FALLBACK_ROUNDED_CLIP:
         case GSK_VULKAN_OP_TEXTURE:
+        case GSK_VULKAN_OP_OFFSCREEN:
           {
             op->render.vertex_offset = offset + n_bytes;
             gsk_vulkan_texture_pipeline_collect_vertex_data (GSK_VULKAN_TEXTURE_PIPELINE (op->render.pipeline),
@@ -1398,6 +1525,24 @@ gsk_vulkan_render_pass_get_vertex_data (GskVulkanRenderPass *self,
   return self->vertex_data;
 }
 
+/*
+ * gsk_vulkan_render_pass_prepare_draw:
+ * @self: a #GskVulkanRenderPass
+ * @render: the render @self belongs to
+ *
+ * Does the parts of drawing that touch shared state, like filling
+ * the vertex buffer and looking up the framebuffer.
+ * After this, gsk_vulkan_render_pass_draw() may be called from
+ * any thread.
+ */
+void
+gsk_vulkan_render_pass_prepare_draw (GskVulkanRenderPass *self,
+                                     GskVulkanRender     *render)
+{
+  gsk_vulkan_render_pass_get_vertex_data (self, render);
+  self->framebuffer = gsk_vulkan_render_get_framebuffer (render, self->target);
+}
+
 gsize
 gsk_vulkan_render_pass_get_wait_semaphores (GskVulkanRenderPass  *self,
                                             VkSemaphore         **semaphores)
@@ -1431,6 +1576,7 @@ gsk_vulkan_render_pass_reserve_descriptor_sets (GskVulkanRenderPass *self,
         case GSK_VULKAN_OP_FALLBACK_CLIP:
         case GSK_VULKAN_OP_FALLBACK_ROUNDED_CLIP:
         case GSK_VULKAN_OP_TEXTURE:
+        case GSK_VULKAN_OP_OFFSCREEN:
         case GSK_VULKAN_OP_OPACITY:
         case GSK_VULKAN_OP_BLUR:
         case GSK_VULKAN_OP_COLOR_MATRIX:
@@ -1497,6 +1643,7 @@ gsk_vulkan_render_pass_draw_rect (GskVulkanRenderPass     *self,
         case GSK_VULKAN_OP_FALLBACK_CLIP:
         case GSK_VULKAN_OP_FALLBACK_ROUNDED_CLIP:
         case GSK_VULKAN_OP_TEXTURE:
+        case GSK_VULKAN_OP_OFFSCREEN:
         case GSK_VULKAN_OP_REPEAT:
           if (!op->render.source)
             continue;
@@ -1887,7 +2034,7 @@ gsk_vulkan_render_pass_draw (GskVulkanRenderPass     *self,
                             &(VkRenderPassBeginInfo) {
                                 .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
                                 .renderPass = self->render_pass,
-                                .framebuffer = gsk_vulkan_render_get_framebuffer (render, self->target),
+                                .framebuffer = self->framebuffer,
                                 .renderArea = { 
                                     { rect.x * self->scale_factor, rect.y * self->scale_factor },
                                     { rect.width * self->scale_factor, rect.height * self->scale_factor }
@@ -30,6 +30,8 @@ void                    gsk_vulkan_render_pass_upload                   (GskVulk
                                                                          GskVulkanUploader      *uploader);
 void                    gsk_vulkan_render_pass_reserve_descriptor_sets  (GskVulkanRenderPass    *self,
                                                                          GskVulkanRender        *render);
+void                    gsk_vulkan_render_pass_prepare_draw             (GskVulkanRenderPass    *self,
+                                                                         GskVulkanRender        *render);
 void                    gsk_vulkan_render_pass_draw                     (GskVulkanRenderPass    *self,
                                                                          GskVulkanRender        *render,
                                                                          guint                   layout_count,
@@ -56,6 +56,8 @@ GskVulkanRender *       gsk_vulkan_render_new                           (GskRend
                                                                          GdkVulkanContext       *context);
 void                    gsk_vulkan_render_free                          (GskVulkanRender        *self);
 
+void                    gsk_vulkan_render_warm_up                       (GskVulkanRender        *self);
+
 gboolean                gsk_vulkan_render_is_busy                       (GskVulkanRender        *self);
 void                    gsk_vulkan_render_reset                         (GskVulkanRender        *self,
                                                                          GskVulkanImage         *target,
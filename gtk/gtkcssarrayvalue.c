@@ -368,6 +368,25 @@ gtk_css_value_array_print (const GtkCssValue *value,
     }
 }
 
+static guint
+gtk_css_value_array_hash (const GtkCssValue *value)
+{
+  guint i, hash, part;
+
+  hash = value->n_values;
+
+  for (i = 0; i < value->n_values; i++)
+    {
+      /* Only intern arrays of values that can be interned */
+      part = gtk_css_value_hash (value->values[i]);
+      if (part == 0)
+        return 0;
+      hash = hash * 31 + part;
+    }
+
+  return hash ? hash : 1;
+}
+
 static const GtkCssValueClass GTK_CSS_VALUE_ARRAY = {
   "GtkCssArrayValue",
   gtk_css_value_array_free,
@@ -376,7 +395,8 @@ static const GtkCssValueClass GTK_CSS_VALUE_ARRAY = {
   gtk_css_value_array_transition,
   gtk_css_value_array_is_dynamic,
   gtk_css_value_array_get_dynamic_value,
-  gtk_css_value_array_print
+  gtk_css_value_array_print,
+  gtk_css_value_array_hash
 };
 
 GtkCssValue *
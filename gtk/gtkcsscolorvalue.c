@@ -283,6 +283,16 @@ gtk_css_value_color_print (const GtkCssValue *value,
     }
 }
 
+static guint
+gtk_css_value_color_hash (const GtkCssValue *value)
+{
+  /* Only literals are computed */
+  if (value->type != COLOR_TYPE_LITERAL)
+    return 0;
+
+  return gdk_rgba_hash (&value->sym_col.rgba);
+}
+
 static const GtkCssValueClass GTK_CSS_VALUE_COLOR = {
   "GtkCssColorValue",
   gtk_css_value_color_free,
@@ -291,7 +301,8 @@ static const GtkCssValueClass GTK_CSS_VALUE_COLOR = {
   gtk_css_value_color_transition,
   NULL,
   NULL,
-  gtk_css_value_color_print
+  gtk_css_value_color_print,
+  gtk_css_value_color_hash
 };
 
 static void
@@ -255,6 +255,15 @@ gtk_css_value_dimension_transition (GtkCssValue *start,
   return gtk_css_dimension_value_new (start->value + (end->value - start->value) * progress, start->unit);
 }
 
+static guint
+gtk_css_value_dimension_hash (const GtkCssValue *value)
+{
+  /* 0 and -0 are equal */
+  double d = value->value == 0 ? 0 : value->value;
+
+  return g_double_hash (&d) * 31 + value->unit + 1;
+}
+
 static const GtkCssNumberValueClass GTK_CSS_VALUE_DIMENSION = {
   {
     "GtkCssDimensionValue",
@@ -264,7 +273,8 @@ static const GtkCssNumberValueClass GTK_CSS_VALUE_DIMENSION = {
     gtk_css_value_dimension_transition,
     NULL,
     NULL,
-    gtk_css_value_dimension_print
+    gtk_css_value_dimension_print,
+    gtk_css_value_dimension_hash
   },
   gtk_css_value_dimension_get,
   gtk_css_value_dimension_get_dimension,
@@ -24,6 +24,8 @@
 
 G_BEGIN_DECLS
 
+/* exported for the tests */
+GDK_AVAILABLE_IN_ALL
 GtkCssValue *   gtk_css_dimension_value_new         (double                  value,
                                                      GtkCssUnit              unit);
 
@@ -80,24 +80,21 @@ gtk_css_image_radial_snapshot (GtkCssImage *image,
                                double       height)
 {
   GtkCssImageRadial *radial = GTK_CSS_IMAGE_RADIAL (image);
-  cairo_pattern_t *pattern;
-  cairo_matrix_t matrix;
+  GskColorStop *stops;
   double x, y;
-  double radius, yscale;
+  double hradius, vradius;
   double start, end;
   double r1, r2, r3, r4, r;
   double offset;
   int i, last;
-  cairo_t *cr;
-
-  cr = gtk_snapshot_append_cairo (snapshot,
-                                  &GRAPHENE_RECT_INIT (0, 0, width, height));
 
   x = _gtk_css_position_value_get_x (radial->position, width);
   y = _gtk_css_position_value_get_y (radial->position, height);
 
   if (radial->circle)
     {
+      double radius;
+
       switch (radial->size)
         {
         case GTK_CSS_EXPLICIT_SIZE:
@@ -125,13 +122,10 @@ gtk_css_image_radial_snapshot (GtkCssImage *image,
           g_assert_not_reached ();
         }
 
-      radius = MAX (1.0, radius);
-      yscale = 1.0;
+      hradius = vradius = MAX (1.0, radius);
     }
   else
     {
-      double hradius, vradius;
-
       switch (radial->size)
         {
         case GTK_CSS_EXPLICIT_SIZE:
@@ -160,27 +154,14 @@ gtk_css_image_radial_snapshot (GtkCssImage *image,
 
       hradius = MAX (1.0, hradius);
       vradius = MAX (1.0, vradius);
-
-      radius = hradius;
-      yscale = vradius / hradius;
     }
 
-  gtk_css_image_radial_get_start_end (radial, radius, &start, &end);
-
-  pattern = cairo_pattern_create_radial (0, 0, radius * start, 0, 0, radius * end);
-  if (yscale != 1.0)
-    {
-      cairo_matrix_init_scale (&matrix, 1.0, 1.0 / yscale);
-      cairo_pattern_set_matrix (pattern, &matrix);
-    }
-
- if (radial->repeating)
-    cairo_pattern_set_extend (pattern, CAIRO_EXTEND_REPEAT);
-  else
-    cairo_pattern_set_extend (pattern, CAIRO_EXTEND_PAD);
+  gtk_css_image_radial_get_start_end (radial, hradius, &start, &end);
 
   offset = start;
   last = -1;
+  stops = g_newa (GskColorStop, radial->n_stops);
+
   for (i = 0; i < radial->n_stops; i++)
     {
       const GtkCssImageRadialColorStop *stop = &radial->color_stops[i];
@@ -196,39 +177,63 @@ gtk_css_image_radial_snapshot (GtkCssImage *image,
             continue;
         }
       else
-        pos = _gtk_css_number_value_get (stop->offset, radius) / radius;
+        pos = _gtk_css_number_value_get (stop->offset, hradius) / hradius;
 
-      pos = MAX (pos, 0);
+      pos = MAX (pos, offset);
       step = (pos - offset) / (i - last);
       for (last = last + 1; last <= i; last++)
         {
-          const GdkRGBA *rgba;
-
           stop = &radial->color_stops[last];
 
-          rgba = gtk_css_color_value_get_rgba (stop->color);
           offset += step;
 
-          cairo_pattern_add_color_stop_rgba (pattern,
-                                             (offset - start) / (end - start),
-                                             rgba->red,
-                                             rgba->green,
-                                             rgba->blue,
-                                             rgba->alpha);
+          stops[last].offset = CLAMP ((offset - start) / (end - start), 0.0, 1.0);
+          stops[last].color = *gtk_css_color_value_get_rgba (stop->color);
         }
 
       offset = pos;
       last = i;
     }
 
-  cairo_rectangle (cr, 0, 0, width, height);
-  cairo_translate (cr, x, y);
-  cairo_set_source (cr, pattern);
-  cairo_fill (cr);
+  if (end <= start)
+    {
+      /* A repeating gradient without extent, draw its last color */
+      gtk_snapshot_append_color (snapshot,
+                                 &stops[radial->n_stops - 1].color,
+                                 &GRAPHENE_RECT_INIT (0, 0, width, height));
+      return;
+    }
 
-  cairo_pattern_destroy (pattern);
+  if (start < 0)
+    {
+      /* Gradient nodes can't start inside the center, but a repeating
+       * gradient looks the same when moved outward by whole periods. */
+      double shift = ceil (-start / (end - start)) * (end - start);
 
-  cairo_destroy (cr);
+      start += shift;
+      end += shift;
+    }
+
+  if (radial->repeating)
+    gtk_snapshot_append_repeating_radial_gradient (snapshot,
+                                                   &GRAPHENE_RECT_INIT (0, 0, width, height),
+                                                   &GRAPHENE_POINT_INIT (x, y),
+                                                   hradius,
+                                                   vradius,
+                                                   start,
+                                                   end,
+                                                   stops,
+                                                   radial->n_stops);
+  else
+    gtk_snapshot_append_radial_gradient (snapshot,
+                                         &GRAPHENE_RECT_INIT (0, 0, width, height),
+                                         &GRAPHENE_POINT_INIT (x, y),
+                                         hradius,
+                                         vradius,
+                                         start,
+                                         end,
+                                         stops,
+                                         radial->n_stops);
 }
 
 static guint
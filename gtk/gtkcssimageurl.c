@@ -25,6 +25,7 @@
 
 #include "gtkcssimageinvalidprivate.h"
 #include "gtkcssimagepaintableprivate.h"
+#include "gtkcssparserprivate.h"
 #include "gtkstyleproviderprivate.h"
 
 #include "gtk/css/gtkcssdataurlprivate.h"
@@ -212,6 +213,7 @@ gtk_css_image_url_parse (GtkCssImage  *image,
   else
     {
       self->file = gtk_css_parser_resolve_url (parser, url);
+      self->url = g_strdup (url);
     }
 
   g_free (url);
@@ -226,7 +228,17 @@ gtk_css_image_url_print (GtkCssImage *image,
 {
   GtkCssImageUrl *url = GTK_CSS_IMAGE_URL (image);
 
-  _gtk_css_image_print (gtk_css_image_url_load_image (url, NULL), string);
+  /* Print the url as it was written, so that the output
+   * parses back to the same image relative to the same file.
+   */
+  if (url->url)
+    {
+      g_string_append (string, "url(");
+      _gtk_css_print_string (string, url->url);
+      g_string_append (string, ")");
+    }
+  else
+    _gtk_css_image_print (gtk_css_image_url_load_image (url, NULL), string);
 }
 
 static void
@@ -235,6 +247,7 @@ gtk_css_image_url_dispose (GObject *object)
   GtkCssImageUrl *url = GTK_CSS_IMAGE_URL (object);
 
   g_clear_object (&url->file);
+  g_clear_pointer (&url->url, g_free);
   g_clear_object (&url->loaded_image);
 
   G_OBJECT_CLASS (_gtk_css_image_url_parent_class)->dispose (object);
@@ -39,6 +39,7 @@ struct _GtkCssImageUrl
   GtkCssImage parent;
 
   GFile           *file;                /* the file we're loading from */
+  char            *url;                 /* the url as written in the source */
   GtkCssImage     *loaded_image;        /* the actual image we render */
 };
 
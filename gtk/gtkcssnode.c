@@ -21,13 +21,17 @@
 
 #include "gtkcssstaticstyleprivate.h"
 #include "gtkcssanimatedstyleprivate.h"
+#include "gtkcsslookupprivate.h"
+#include "gtkcssselectorprivate.h"
 #include "gtkcssstylepropertyprivate.h"
 #include "gtkintl.h"
 #include "gtkmarshalers.h"
 #include "gtksettingsprivate.h"
 #include "gtktypebuiltins.h"
 #include "gtkprivate.h"
+#include "gtkdebug.h"
 #include "gdkprofilerprivate.h"
+#include "gsk/gskprivate.h"
 
 /*
  * CSS nodes are the backbone of the GtkStyleContext implementation and
@@ -129,6 +133,26 @@ static int created_styles;
 static guint invalidated_nodes_counter;
 static guint created_styles_counter;
 
+/* Counts changes to names, classes, states and the tree structure,
+ * which invalidate the results of selector matching */
+static guint match_serial;
+
+/* The result of matching the selectors against a node ahead of
+ * validation, see gtk_css_node_prepare_lookups() */
+typedef struct _GtkCssPreparedLookup GtkCssPreparedLookup;
+
+struct _GtkCssPreparedLookup
+{
+  GtkCssNode *node;
+  GtkStyleProvider *provider;
+  guint match_serial;
+  GtkCssChange change;
+  GtkCssLookup lookup;
+};
+
+static void gtk_css_node_invalidate_internal (GtkCssNode   *cssnode,
+                                              GtkCssChange  change);
+
 static void
 gtk_css_node_set_invalid (GtkCssNode *node,
                           gboolean    invalid)
@@ -361,6 +385,8 @@ gtk_css_node_create_style (GtkCssNode                   *cssnode,
                            GtkCssChange                  change)
 {
   const GtkCssNodeDeclaration *decl;
+  GtkCssPreparedLookup *prepared;
+  GtkStyleProvider *provider;
   GtkCssStyle *style;
   GtkCssChange style_change;
 
@@ -382,10 +408,26 @@ gtk_css_node_create_style (GtkCssNode                   *cssnode,
       style_change = gtk_css_static_style_get_change (gtk_css_style_get_static_style (cssnode->style));
     }
 
-  style = gtk_css_static_style_new_compute (gtk_css_node_get_style_provider (cssnode),
-                                            filter,
-                                            cssnode,
-                                            style_change);
+  prepared = cssnode->prepared_lookup;
+  cssnode->prepared_lookup = NULL;
+  provider = gtk_css_node_get_style_provider (cssnode);
+
+  if (prepared &&
+      prepared->provider == provider &&
+      prepared->match_serial == match_serial)
+    {
+      style = gtk_css_static_style_new_for_lookup (provider,
+                                                   &prepared->lookup,
+                                                   cssnode,
+                                                   style_change ? style_change : prepared->change);
+    }
+  else
+    {
+      style = gtk_css_static_style_new_compute (provider,
+                                                filter,
+                                                cssnode,
+                                                style_change);
+    }
 
   store_in_global_parent_cache (cssnode, decl, style);
 
@@ -934,7 +976,7 @@ gtk_css_node_propagate_pending_changes (GtkCssNode *cssnode,
        child = gtk_css_node_get_next_sibling (child))
     {
       child_change = child->pending_changes;
-      gtk_css_node_invalidate (child, change);
+      gtk_css_node_invalidate_internal (child, change);
       if (child->visible)
         change |= _gtk_css_change_for_sibling (child_change);
     }
@@ -1281,9 +1323,9 @@ gtk_css_node_invalidate_frame_clock (GtkCssNode *cssnode,
     gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_ANIMATIONS);
 }
 
-void
-gtk_css_node_invalidate (GtkCssNode   *cssnode,
-                         GtkCssChange  change)
+static void
+gtk_css_node_invalidate_internal (GtkCssNode   *cssnode,
+                                  GtkCssChange  change)
 {
   if (!cssnode->invalid)
     change &= ~GTK_CSS_CHANGE_TIMESTAMP;
@@ -1298,6 +1340,200 @@ gtk_css_node_invalidate (GtkCssNode   *cssnode,
   gtk_css_node_invalidate_style (cssnode);
 }
 
+void
+gtk_css_node_invalidate (GtkCssNode   *cssnode,
+                         GtkCssChange  change)
+{
+  if (change & ~(GTK_CSS_CHANGE_SOURCE | GTK_CSS_CHANGE_PARENT_STYLE |
+                 GTK_CSS_CHANGE_TIMESTAMP | GTK_CSS_CHANGE_ANIMATIONS))
+    match_serial++;
+
+  gtk_css_node_invalidate_internal (cssnode, change);
+}
+
+/* Parallel validation
+ *
+ * When a lot of nodes need their style recomputed from scratch, like
+ * after a theme change, matching the selectors against each node is
+ * the bulk of the work. That part only reads the node tree, so it is
+ * done on multiple threads before the validation walk. The walk, which
+ * creates the styles and emits the signals, stays on the main thread
+ * and uses the prepared lookups.
+ *
+ * The nodes are split into chunks in tree order, so that consecutive
+ * nodes of a chunk mostly share their ancestors. Each chunk keeps its
+ * own bloom filter of the ancestors of the node it is matching.
+ */
+#define PARALLEL_MIN_NODES 128
+#define PARALLEL_CHUNK_SIZE 16
+
+typedef struct {
+  GtkCssPreparedLookup *lookups;
+  guint n_lookups;
+} PrepareJob;
+
+static void
+gtk_css_node_collect_prepared (GtkCssNode *cssnode,
+                               GPtrArray  *nodes)
+{
+  GtkCssNode *child;
+
+  if (!cssnode->invalid)
+    return;
+
+  if (cssnode->style_is_invalid &&
+      (cssnode->pending_changes & GTK_CSS_CHANGE_NEEDS_RECOMPUTE))
+    g_ptr_array_add (nodes, cssnode);
+
+  for (child = gtk_css_node_get_first_child (cssnode);
+       child;
+       child = gtk_css_node_get_next_sibling (child))
+    {
+      if (child->visible)
+        gtk_css_node_collect_prepared (child, nodes);
+    }
+}
+
+/* Makes @filter contain the declarations of exactly the ancestors
+ * of @node, given that it contains those in @bloomed. */
+static void
+update_ancestor_filter (GtkCountingBloomFilter *filter,
+                        GPtrArray              *bloomed,
+                        GPtrArray              *ancestors,
+                        GtkCssNode             *node)
+{
+  GtkCssNode *iter;
+  guint depth, i;
+
+  depth = 0;
+  for (iter = node->parent; iter; iter = iter->parent)
+    depth++;
+
+  g_ptr_array_set_size (ancestors, depth);
+  for (iter = node->parent, i = depth; iter; iter = iter->parent)
+    g_ptr_array_index (ancestors, --i) = iter;
+
+  for (i = 0; i < MIN (bloomed->len, ancestors->len); i++)
+    {
+      if (g_ptr_array_index (bloomed, i) != g_ptr_array_index (ancestors, i))
+        break;
+    }
+
+  while (bloomed->len > i)
+    {
+      iter = g_ptr_array_index (bloomed, bloomed->len - 1);
+      gtk_css_node_declaration_remove_bloom_hashes (iter->decl, filter);
+      g_ptr_array_set_size (bloomed, bloomed->len - 1);
+    }
+
+  for (; i < ancestors->len; i++)
+    {
+      iter = g_ptr_array_index (ancestors, i);
+      gtk_css_node_declaration_add_bloom_hashes (iter->decl, filter);
+      g_ptr_array_add (bloomed, iter);
+    }
+}
+
+static void
+gtk_css_node_prepare_chunk (guint    chunk,
+                            gpointer user_data)
+{
+  PrepareJob *job = user_data;
+  GtkCountingBloomFilter filter = GTK_COUNTING_BLOOM_FILTER_INIT;
+  GPtrArray *bloomed, *ancestors;
+  guint i, end;
+
+  bloomed = g_ptr_array_new ();
+  ancestors = g_ptr_array_new ();
+
+  end = MIN ((chunk + 1) * PARALLEL_CHUNK_SIZE, job->n_lookups);
+  for (i = chunk * PARALLEL_CHUNK_SIZE; i < end; i++)
+    {
+      GtkCssPreparedLookup *prepared = &job->lookups[i];
+
+      update_ancestor_filter (&filter, bloomed, ancestors, prepared->node);
+
+      gtk_style_provider_lookup (prepared->provider,
+                                 &filter,
+                                 prepared->node,
+                                 &prepared->lookup,
+                                 &prepared->change);
+    }
+
+  g_ptr_array_unref (bloomed);
+  g_ptr_array_unref (ancestors);
+}
+
+static PrepareJob *
+gtk_css_node_prepare_lookups (GtkCssNode *cssnode)
+{
+  PrepareJob *job;
+  GPtrArray *nodes;
+  guint i;
+
+#ifdef G_ENABLE_DEBUG
+  if (GTK_DEBUG_CHECK (NO_CSS_THREADS))
+    return NULL;
+#endif
+
+  if (g_get_num_processors () < 2)
+    return NULL;
+
+  nodes = g_ptr_array_new ();
+  gtk_css_node_collect_prepared (cssnode, nodes);
+
+  if (nodes->len < PARALLEL_MIN_NODES)
+    {
+      g_ptr_array_unref (nodes);
+      return NULL;
+    }
+
+  job = g_new (PrepareJob, 1);
+  job->n_lookups = nodes->len;
+  job->lookups = g_new (GtkCssPreparedLookup, nodes->len);
+
+  /* Everything that is not thread-safe is looked up here */
+  for (i = 0; i < nodes->len; i++)
+    {
+      GtkCssPreparedLookup *prepared = &job->lookups[i];
+
+      prepared->node = g_object_ref (g_ptr_array_index (nodes, i));
+      prepared->provider = gtk_css_node_get_style_provider (prepared->node);
+      prepared->match_serial = match_serial;
+      _gtk_css_lookup_init (&prepared->lookup);
+
+      prepared->node->prepared_lookup = prepared;
+    }
+
+  g_ptr_array_unref (nodes);
+
+  gsk_parallel_for ((job->n_lookups + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE,
+                    gtk_css_node_prepare_chunk,
+                    job);
+
+  return job;
+}
+
+static void
+gtk_css_node_free_prepared_lookups (PrepareJob *job)
+{
+  guint i;
+
+  for (i = 0; i < job->n_lookups; i++)
+    {
+      GtkCssPreparedLookup *prepared = &job->lookups[i];
+
+      if (prepared->node->prepared_lookup == prepared)
+        prepared->node->prepared_lookup = NULL;
+
+      _gtk_css_lookup_destroy (&prepared->lookup);
+      g_object_unref (prepared->node);
+    }
+
+  g_free (job->lookups);
+  g_free (job);
+}
+
 static void
 gtk_css_node_validate_internal (GtkCssNode             *cssnode,
                                 GtkCountingBloomFilter *filter,
@@ -1342,6 +1578,7 @@ void
 gtk_css_node_validate (GtkCssNode *cssnode)
 {
   GtkCountingBloomFilter filter = GTK_COUNTING_BLOOM_FILTER_INIT;
+  PrepareJob *prepared;
   gint64 timestamp;
   gint64 before = g_get_monotonic_time ();
 
@@ -1349,8 +1586,13 @@ gtk_css_node_validate (GtkCssNode *cssnode)
 
   timestamp = gtk_css_node_get_timestamp (cssnode);
 
+  prepared = gtk_css_node_prepare_lookups (cssnode);
+
   gtk_css_node_validate_internal (cssnode, &filter, timestamp);
 
+  if (prepared)
+    gtk_css_node_free_prepared_lookups (prepared);
+
   if (gdk_profiler_is_running ())
     {
       gint64 after = g_get_monotonic_time ();
@@ -1360,6 +1602,11 @@ gtk_css_node_validate (GtkCssNode *cssnode)
       invalidated_nodes = 0;
       created_styles = 0;
     }
+
+#ifdef G_ENABLE_DEBUG
+  if (GTK_DEBUG_CHECK (CSS_STATS))
+    gtk_css_selector_tree_print_stats ();
+#endif
 }
 
 GtkStyleProvider *
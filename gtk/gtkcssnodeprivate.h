@@ -50,6 +50,7 @@ struct _GtkCssNode
   GtkCssNodeDeclaration *decl;
   GtkCssStyle           *style;
   GtkCssNodeStyleCache  *cache;                 /* cache for children to look up styles */
+  struct _GtkCssPreparedLookup *prepared_lookup; /* selector matches done ahead of validation */
 
   GtkCssChange           pending_changes;       /* changes that accumulated since the style was last computed */
 
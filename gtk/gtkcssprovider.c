@@ -26,6 +26,7 @@
 #include "gtkcssparserprivate.h"
 #include "gtkcssselectorprivate.h"
 #include "gtkcssshorthandpropertyprivate.h"
+#include "gtkcssstylepropertyprivate.h"
 #include "gtksettingsprivate.h"
 #include "gtkstyleprovider.h"
 #include "gtkstylecontextprivate.h"
@@ -40,6 +41,8 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include <glib/gstdio.h>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include "gdk/gdkprofilerprivate.h"
 #include <cairo-gobject.h>
@@ -121,8 +124,12 @@ struct _GtkCssProviderPrivate
 
   GArray *rulesets;
   GtkCssSelectorTree *tree;
+  GtkCssSelectorTreeIndex *tree_index;
   GResource *resource;
   gchar *path;
+
+  GPtrArray *imports; /* uri and checksum of every imported file */
+  guint cacheable : 1;
 };
 
 enum {
@@ -146,6 +153,15 @@ gtk_css_provider_load_internal (GtkCssProvider *css_provider,
                                 GFile          *file,
                                 GBytes         *bytes);
 
+static char *   gtk_css_provider_get_cache_path (GFile          *file,
+                                                 GBytes         *bytes);
+static gboolean gtk_css_provider_load_cache     (GtkCssProvider *self,
+                                                 GFile          *file,
+                                                 const char     *path);
+static void     gtk_css_provider_save_cache     (GtkCssProvider *self,
+                                                 GFile          *file,
+                                                 const char     *path);
+
 G_DEFINE_TYPE_EXTENDED (GtkCssProvider, gtk_css_provider, G_TYPE_OBJECT, 0,
                         G_ADD_PRIVATE (GtkCssProvider)
                         G_IMPLEMENT_INTERFACE (GTK_TYPE_STYLE_PROVIDER,
@@ -324,8 +340,12 @@ gtk_css_scanner_parser_error (GtkCssParser         *parser,
                               gpointer              user_data)
 {
   GtkCssScanner *scanner = user_data;
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (scanner->provider);
   GtkCssSection *section;
 
+  /* The theme cache can't reproduce errors, so only cache files without */
+  priv->cacheable = FALSE;
+
   section = gtk_css_section_new (gtk_css_parser_get_file (parser),
                                  start,
                                  end);
@@ -388,6 +408,9 @@ gtk_css_provider_init (GtkCssProvider *css_provider)
   priv->keyframes = g_hash_table_new_full (g_str_hash, g_str_equal,
                                            (GDestroyNotify) g_free,
                                            (GDestroyNotify) _gtk_css_keyframes_unref);
+
+  priv->imports = g_ptr_array_new_with_free_func (g_free);
+  priv->cacheable = TRUE;
 }
 
 static void
@@ -464,7 +487,7 @@ gtk_css_style_provider_lookup (GtkStyleProvider             *provider,
   if (_gtk_css_selector_tree_is_empty (priv->tree))
     return;
 
-  tree_rules = _gtk_css_selector_tree_match_all (priv->tree, filter, node);
+  tree_rules = gtk_css_selector_tree_index_match_all (priv->tree_index, filter, node);
   if (tree_rules)
     {
       verify_tree_match_results (css_provider, node, tree_rules);
@@ -495,7 +518,7 @@ gtk_css_style_provider_lookup (GtkStyleProvider             *provider,
     }
 
   if (change)
-    *change = gtk_css_selector_tree_get_change_all (priv->tree, filter, node);
+    *change = gtk_css_selector_tree_index_get_change_all (priv->tree_index, filter, node);
 }
 
 static void
@@ -518,10 +541,12 @@ gtk_css_provider_finalize (GObject *object)
     gtk_css_ruleset_clear (&g_array_index (priv->rulesets, GtkCssRuleset, i));
 
   g_array_free (priv->rulesets, TRUE);
+  gtk_css_selector_tree_index_free (priv->tree_index);
   _gtk_css_selector_tree_free (priv->tree);
 
   g_hash_table_destroy (priv->symbolic_colors);
   g_hash_table_destroy (priv->keyframes);
+  g_ptr_array_unref (priv->imports);
 
   if (priv->resource)
     {
@@ -598,8 +623,12 @@ gtk_css_provider_reset (GtkCssProvider *css_provider)
   for (i = 0; i < priv->rulesets->len; i++)
     gtk_css_ruleset_clear (&g_array_index (priv->rulesets, GtkCssRuleset, i));
   g_array_set_size (priv->rulesets, 0);
+  g_clear_pointer (&priv->tree_index, gtk_css_selector_tree_index_free);
   _gtk_css_selector_tree_free (priv->tree);
   priv->tree = NULL;
+
+  g_ptr_array_set_size (priv->imports, 0);
+  priv->cacheable = TRUE;
 }
 
 static gboolean
@@ -997,6 +1026,7 @@ gtk_css_provider_postprocess (GtkCssProvider *css_provider)
 
   priv->tree = _gtk_css_selector_tree_builder_build (builder);
   _gtk_css_selector_tree_builder_free (builder);
+  priv->tree_index = gtk_css_selector_tree_index_new (priv->tree);
 
 #ifndef VERIFY_TREE
   for (i = 0; i < priv->rulesets->len; i++)
@@ -1014,6 +1044,20 @@ gtk_css_provider_postprocess (GtkCssProvider *css_provider)
     gdk_profiler_add_mark (before * 1000, (g_get_monotonic_time () - before) * 1000, "create selector tree", NULL);
 }
 
+/* Remembers imported files, so the theme cache can check that
+ * they didn't change.
+ */
+static void
+gtk_css_provider_add_import (GtkCssProvider *self,
+                             GFile          *file,
+                             GBytes         *bytes)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (self);
+
+  g_ptr_array_add (priv->imports, g_file_get_uri (file));
+  g_ptr_array_add (priv->imports, g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, bytes));
+}
+
 static void
 gtk_css_provider_load_internal (GtkCssProvider *self,
                                 GtkCssScanner  *parent,
@@ -1050,22 +1094,49 @@ gtk_css_provider_load_internal (GtkCssProvider *self,
         }
     }
 
-  if (bytes)
+  if (bytes == NULL)
+    {
+      GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (self);
+
+      priv->cacheable = FALSE;
+    }
+  else
     {
       GtkCssScanner *scanner;
+      char *cache_path = NULL;
 
-      scanner = gtk_css_scanner_new (self,
-                                     parent,
-                                     file,
-                                     bytes);
+      if (parent == NULL)
+        cache_path = gtk_css_provider_get_cache_path (file, bytes);
+      else
+        gtk_css_provider_add_import (self, file, bytes);
 
-      parse_stylesheet (scanner);
+      if (cache_path && gtk_css_provider_load_cache (self, file, cache_path))
+        {
+          /* Everything was loaded from the theme cache */
+        }
+      else
+        {
+          scanner = gtk_css_scanner_new (self,
+                                         parent,
+                                         file,
+                                         bytes);
 
-      gtk_css_scanner_destroy (scanner);
+          parse_stylesheet (scanner);
 
-      if (parent == NULL)
-        gtk_css_provider_postprocess (self);
+          gtk_css_scanner_destroy (scanner);
+
+          if (parent == NULL)
+            {
+              GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (self);
+
+              gtk_css_provider_postprocess (self);
 
+              if (cache_path && priv->cacheable)
+                gtk_css_provider_save_cache (self, file, cache_path);
+            }
+        }
+
+      g_free (cache_path);
       g_bytes_unref (bytes);
     }
 
@@ -1527,3 +1598,664 @@ gtk_css_provider_to_string (GtkCssProvider *provider)
   return g_string_free (str, FALSE);
 }
 
+
+/* THEME CACHE
+ *
+ * Parsing a theme takes a noticeable part of application startup,
+ * so the result of loading a file is cached below the user cache
+ * dir. The cache file is named by a checksum over the uri and the
+ * contents of the file and the GTK version, and it additionally
+ * stores the checksums of all imported files.
+ *
+ * The cache contains:
+ *  - the symbolic colors and keyframes, in CSS syntax
+ *  - every distinct value in the rulesets, in CSS syntax. These are
+ *    parsed once and shared by all rulesets that use them.
+ *  - the rulesets as lists of value indexes, in tree order
+ *  - the selector tree, see gtk_css_selector_tree_save()
+ *
+ * Files that caused parsing errors are not cached, so that the
+ * errors are reported every time.
+ *
+ * The files are only meant to be read on the same machine, so all
+ * numbers are stored in host byte order.
+ *
+ * Every change to a theme creates a new file, so loading a file
+ * updates its modification time, and once per process the files
+ * that haven't been used for a month are removed, and then the least
+ * recently used ones until all of them fit into CACHE_MAX_SIZE.
+ *
+ * Setting GTK_CSS_CACHE=0 in the environment turns the cache off.
+ */
+
+#define GTK_CSS_CACHE_MAGIC "GtkCssCache"
+#define GTK_CSS_CACHE_VERSION 1
+#define GTK_CSS_CACHE_BYTE_ORDER 0x01020304
+
+#define CACHE_MAX_SIZE (16 * 1024 * 1024)
+#define CACHE_MAX_UNUSED_TIME (30 * 24 * 60 * 60) /* in seconds */
+
+typedef struct {
+  char magic[16];
+  guint32 version;
+  guint32 byte_order;
+} CacheHeader;
+
+typedef struct {
+  const guint8 *data;
+  gsize size;
+  gsize pos;
+} CacheReader;
+
+static gboolean
+cache_is_enabled (void)
+{
+  static int enabled = -1;
+
+#ifdef VERIFY_TREE
+  /* Verifying needs the selectors, which the cache doesn't keep */
+  return FALSE;
+#endif
+
+  if (gtk_keep_css_sections)
+    return FALSE;
+
+  if (enabled < 0)
+    {
+      const char *env = g_getenv ("GTK_CSS_CACHE");
+
+      enabled = env == NULL || strcmp (env, "0") != 0;
+    }
+
+  return enabled;
+}
+
+typedef struct {
+  char *path;
+  gint64 mtime;
+  gint64 size;
+} CacheFile;
+
+static int
+compare_cache_files (gconstpointer a,
+                     gconstpointer b)
+{
+  const CacheFile *file1 = a;
+  const CacheFile *file2 = b;
+
+  return file1->mtime < file2->mtime ? -1 : (file1->mtime > file2->mtime ? 1 : 0);
+}
+
+static void
+cache_remove_stale (const char *dir)
+{
+  GArray *files;
+  const char *name;
+  gint64 now, total_size;
+  GDir *gdir;
+  guint i;
+
+  gdir = g_dir_open (dir, 0, NULL);
+  if (gdir == NULL)
+    return;
+
+  files = g_array_new (FALSE, FALSE, sizeof (CacheFile));
+  now = g_get_real_time () / G_USEC_PER_SEC;
+  total_size = 0;
+
+  while ((name = g_dir_read_name (gdir)))
+    {
+      CacheFile file;
+      GStatBuf buf;
+
+      if (!g_str_has_suffix (name, ".cache"))
+        continue;
+
+      file.path = g_build_filename (dir, name, NULL);
+      if (g_stat (file.path, &buf) != 0)
+        {
+          g_free (file.path);
+          continue;
+        }
+
+      if (now - (gint64) buf.st_mtime > CACHE_MAX_UNUSED_TIME)
+        {
+          g_remove (file.path);
+          g_free (file.path);
+          continue;
+        }
+
+      file.mtime = buf.st_mtime;
+      file.size = buf.st_size;
+      total_size += file.size;
+      g_array_append_val (files, file);
+    }
+
+  g_array_sort (files, compare_cache_files);
+
+  for (i = 0; i < files->len; i++)
+    {
+      CacheFile *file = &g_array_index (files, CacheFile, i);
+
+      if (total_size > CACHE_MAX_SIZE)
+        {
+          g_remove (file->path);
+          total_size -= file->size;
+        }
+
+      g_free (file->path);
+    }
+
+  g_array_free (files, TRUE);
+  g_dir_close (gdir);
+}
+
+static char *
+gtk_css_provider_get_cache_path (GFile  *file,
+                                 GBytes *bytes)
+{
+  static gsize stale_removed = 0;
+  GChecksum *checksum;
+  char *id;
+  char *uri;
+  char *dir;
+  char *basename;
+  char *path;
+
+  if (file == NULL || !cache_is_enabled ())
+    return NULL;
+
+  uri = g_file_get_uri (file);
+  id = g_strdup_printf ("%s|%d.%d.%d|%u|%u",
+                        uri,
+                        GTK_MAJOR_VERSION, GTK_MINOR_VERSION, GTK_MICRO_VERSION,
+                        (guint) sizeof (gpointer),
+                        _gtk_css_style_property_get_n_properties ());
+  g_free (uri);
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA256);
+  g_checksum_update (checksum, (const guchar *) id, -1);
+  g_checksum_update (checksum, g_bytes_get_data (bytes, NULL), g_bytes_get_size (bytes));
+  basename = g_strdup_printf ("%s.cache", g_checksum_get_string (checksum));
+  g_checksum_free (checksum);
+  g_free (id);
+
+  dir = g_build_filename (g_get_user_cache_dir (), "gtk-4.0", "css", NULL);
+  path = g_build_filename (dir, basename, NULL);
+  if (g_mkdir_with_parents (dir, 0755) != 0)
+    {
+      g_debug ("Failed to mkdir %s", dir);
+      g_free (path);
+      path = NULL;
+    }
+  else if (g_once_init_enter (&stale_removed))
+    {
+      cache_remove_stale (dir);
+      g_once_init_leave (&stale_removed, 1);
+    }
+
+  g_free (dir);
+  g_free (basename);
+
+  return path;
+}
+
+static void
+cache_append_uint (GByteArray *array,
+                   guint32     value)
+{
+  g_byte_array_append (array, (const guint8 *) &value, sizeof (guint32));
+}
+
+static void
+cache_append_data (GByteArray   *array,
+                   const guint8 *data,
+                   gsize         size)
+{
+  cache_append_uint (array, size);
+  g_byte_array_append (array, data, size);
+}
+
+static void
+cache_append_string (GByteArray *array,
+                     const char *s)
+{
+  cache_append_data (array, (const guint8 *) s, strlen (s) + 1);
+}
+
+static gboolean
+cache_read_uint (CacheReader *reader,
+                 guint32     *value)
+{
+  if (reader->size - reader->pos < sizeof (guint32))
+    return FALSE;
+
+  memcpy (value, reader->data + reader->pos, sizeof (guint32));
+  reader->pos += sizeof (guint32);
+
+  return TRUE;
+}
+
+static const guint8 *
+cache_read_data (CacheReader *reader,
+                 gsize       *size)
+{
+  const guint8 *data;
+  guint32 n;
+
+  if (!cache_read_uint (reader, &n) ||
+      reader->size - reader->pos < n)
+    return NULL;
+
+  data = reader->data + reader->pos;
+  reader->pos += n;
+  *size = n;
+
+  return data;
+}
+
+static const char *
+cache_read_string (CacheReader *reader)
+{
+  const char *s;
+  gsize size;
+
+  s = (const char *) cache_read_data (reader, &size);
+  if (s == NULL || size == 0 || s[size - 1] != '\0')
+    return NULL;
+
+  return s;
+}
+
+static void
+cache_parser_error (GtkCssParser         *parser,
+                    const GtkCssLocation *start,
+                    const GtkCssLocation *end,
+                    const GError         *error,
+                    gpointer              user_data)
+{
+  gboolean *failed = user_data;
+
+  *failed = TRUE;
+}
+
+static gboolean
+parse_cached_at_rules (GtkCssProvider *self,
+                       GFile          *file,
+                       const char     *text)
+{
+  GtkCssScanner scanner = { NULL, };
+  gboolean failed = FALSE;
+  GBytes *bytes;
+
+  bytes = g_bytes_new_static (text, strlen (text));
+
+  scanner.provider = self;
+  scanner.parser = gtk_css_parser_new_for_bytes (bytes, file, NULL,
+                                                 cache_parser_error, &failed,
+                                                 NULL);
+  parse_stylesheet (&scanner);
+
+  gtk_css_parser_unref (scanner.parser);
+  g_bytes_unref (bytes);
+
+  return !failed;
+}
+
+/* Parses the values in @text, which are separated by semicolons,
+ * like the values of declarations.
+ */
+static GPtrArray *
+parse_cached_values (GFile         *file,
+                     const guint32 *ids,
+                     guint          n_values,
+                     const char    *text)
+{
+  GtkCssParser *parser;
+  GPtrArray *values;
+  gboolean failed = FALSE;
+  GBytes *bytes;
+  guint i;
+
+  bytes = g_bytes_new_static (text, strlen (text));
+  parser = gtk_css_parser_new_for_bytes (bytes, file, NULL,
+                                         cache_parser_error, &failed,
+                                         NULL);
+  values = g_ptr_array_new_with_free_func ((GDestroyNotify) _gtk_css_value_unref);
+
+  for (i = 0; i < n_values && !failed; i++)
+    {
+      GtkCssStyleProperty *property;
+      GtkCssValue *value;
+
+      if (ids[i] >= _gtk_css_style_property_get_n_properties ())
+        {
+          failed = TRUE;
+          break;
+        }
+
+      property = _gtk_css_style_property_lookup_by_id (ids[i]);
+
+      gtk_css_parser_start_semicolon_block (parser, GTK_CSS_TOKEN_EOF);
+
+      value = _gtk_style_property_parse_value (GTK_STYLE_PROPERTY (property), parser);
+      if (value == NULL)
+        failed = TRUE;
+      else
+        g_ptr_array_add (values, value);
+
+      if (!gtk_css_parser_has_token (parser, GTK_CSS_TOKEN_EOF))
+        failed = TRUE;
+
+      gtk_css_parser_end_block (parser);
+    }
+
+  if (!gtk_css_parser_has_token (parser, GTK_CSS_TOKEN_EOF))
+    failed = TRUE;
+
+  gtk_css_parser_unref (parser);
+  g_bytes_unref (bytes);
+
+  if (failed)
+    {
+      g_ptr_array_unref (values);
+      return NULL;
+    }
+
+  return values;
+}
+
+static gboolean
+check_cached_import (const char *uri,
+                     const char *checksum)
+{
+  GFile *file;
+  GBytes *bytes;
+  gboolean result = FALSE;
+
+  file = g_file_new_for_uri (uri);
+  bytes = g_file_load_bytes (file, NULL, NULL, NULL);
+  if (bytes)
+    {
+      char *s = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, bytes);
+
+      result = strcmp (s, checksum) == 0;
+
+      g_free (s);
+      g_bytes_unref (bytes);
+    }
+
+  g_object_unref (file);
+
+  return result;
+}
+
+static gboolean
+gtk_css_provider_load_cache (GtkCssProvider *self,
+                             GFile          *file,
+                             const char     *path)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (self);
+  GMappedFile *mapped;
+  CacheReader reader;
+  CacheHeader header;
+  GStatBuf buf;
+  GPtrArray *values = NULL;
+  guint32 *ids = NULL;
+  gpointer *matches = NULL;
+  GtkCssSelectorTree **selector_matches = NULL;
+  const guint8 *tree_data;
+  const char *s;
+  gsize tree_size;
+  guint32 n, n_rulesets;
+  gboolean result = FALSE;
+  guint i, j;
+
+  mapped = g_mapped_file_new (path, FALSE, NULL);
+  if (mapped == NULL)
+    return FALSE;
+
+  /* Mark the file as used, see cache_remove_stale() */
+  if (g_stat (path, &buf) == 0 &&
+      g_get_real_time () / G_USEC_PER_SEC - (gint64) buf.st_mtime > 24 * 60 * 60)
+    g_utime (path, NULL);
+
+  reader.data = (const guint8 *) g_mapped_file_get_contents (mapped);
+  reader.size = g_mapped_file_get_length (mapped);
+  reader.pos = sizeof (CacheHeader);
+
+  if (reader.size < sizeof (CacheHeader))
+    goto out;
+
+  memcpy (&header, reader.data, sizeof (CacheHeader));
+  if (strncmp (header.magic, GTK_CSS_CACHE_MAGIC, sizeof (header.magic)) != 0 ||
+      header.version != GTK_CSS_CACHE_VERSION ||
+      header.byte_order != GTK_CSS_CACHE_BYTE_ORDER)
+    goto out;
+
+  if (!cache_read_uint (&reader, &n))
+    goto out;
+
+  for (i = 0; i < n; i++)
+    {
+      const char *uri = cache_read_string (&reader);
+      const char *checksum = cache_read_string (&reader);
+
+      if (uri == NULL || checksum == NULL ||
+          !check_cached_import (uri, checksum))
+        goto out;
+    }
+
+  s = cache_read_string (&reader);
+  if (s == NULL || !parse_cached_at_rules (self, file, s))
+    goto out;
+
+  if (!cache_read_uint (&reader, &n) ||
+      n > (reader.size - reader.pos) / sizeof (guint32))
+    goto out;
+
+  ids = g_new (guint32, n);
+  for (i = 0; i < n; i++)
+    cache_read_uint (&reader, &ids[i]);
+
+  s = cache_read_string (&reader);
+  if (s == NULL)
+    goto out;
+
+  values = parse_cached_values (file, ids, n, s);
+  if (values == NULL)
+    goto out;
+
+  if (!cache_read_uint (&reader, &n_rulesets) ||
+      n_rulesets > (reader.size - reader.pos) / sizeof (guint32))
+    goto out;
+
+  g_array_set_size (priv->rulesets, n_rulesets);
+  memset (priv->rulesets->data, 0, n_rulesets * sizeof (GtkCssRuleset));
+
+  for (i = 0; i < n_rulesets; i++)
+    {
+      GtkCssRuleset *ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+      guint32 n_styles;
+
+      if (!cache_read_uint (&reader, &n_styles) ||
+          n_styles == 0 ||
+          n_styles > (reader.size - reader.pos) / sizeof (guint32))
+        goto out;
+
+      ruleset->styles = g_new (PropertyValue, n_styles);
+      ruleset->owns_styles = TRUE;
+
+      for (j = 0; j < n_styles; j++)
+        {
+          guint32 index;
+
+          cache_read_uint (&reader, &index);
+          if (index >= values->len)
+            goto out;
+
+          ruleset->styles[j].property = _gtk_css_style_property_lookup_by_id (ids[index]);
+          ruleset->styles[j].value = _gtk_css_value_ref (g_ptr_array_index (values, index));
+          ruleset->styles[j].section = NULL;
+          ruleset->n_styles = j + 1;
+        }
+    }
+
+  tree_data = cache_read_data (&reader, &tree_size);
+  if (tree_data == NULL || reader.pos != reader.size)
+    goto out;
+
+  matches = g_new (gpointer, n_rulesets);
+  for (i = 0; i < n_rulesets; i++)
+    matches[i] = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+  selector_matches = g_new (GtkCssSelectorTree *, n_rulesets);
+
+  if (!gtk_css_selector_tree_load (tree_data, tree_size,
+                                   matches, selector_matches, n_rulesets,
+                                   &priv->tree))
+    goto out;
+
+  for (i = 0; i < n_rulesets; i++)
+    g_array_index (priv->rulesets, GtkCssRuleset, i).selector_match = selector_matches[i];
+
+  priv->tree_index = gtk_css_selector_tree_index_new (priv->tree);
+  result = TRUE;
+
+out:
+  if (!result)
+    {
+      g_hash_table_remove_all (priv->symbolic_colors);
+      g_hash_table_remove_all (priv->keyframes);
+
+      for (i = 0; i < priv->rulesets->len; i++)
+        gtk_css_ruleset_clear (&g_array_index (priv->rulesets, GtkCssRuleset, i));
+      g_array_set_size (priv->rulesets, 0);
+    }
+
+  g_free (matches);
+  g_free (selector_matches);
+  g_free (ids);
+  if (values)
+    g_ptr_array_unref (values);
+  g_mapped_file_unref (mapped);
+
+  return result;
+}
+
+static void
+gtk_css_provider_save_cache (GtkCssProvider *self,
+                             GFile          *file,
+                             const char     *path)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (self);
+  CacheHeader header = { { 0, }, };
+  GByteArray *array, *rules;
+  GHashTable *value_indexes, *match_indexes;
+  GPtrArray *originals, *values;
+  GArray *ids;
+  GString *key, *text;
+  GBytes *tree;
+  GError *error = NULL;
+  guint i, j;
+
+  ids = g_array_new (FALSE, FALSE, sizeof (guint32));
+  originals = g_ptr_array_new ();
+  value_indexes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  match_indexes = g_hash_table_new (NULL, NULL);
+  key = g_string_new (NULL);
+  text = g_string_new (NULL);
+  rules = g_byte_array_new ();
+
+  cache_append_uint (rules, priv->rulesets->len);
+
+  for (i = 0; i < priv->rulesets->len; i++)
+    {
+      GtkCssRuleset *ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+
+      g_hash_table_insert (match_indexes, ruleset, GUINT_TO_POINTER (i + 1));
+
+      cache_append_uint (rules, ruleset->n_styles);
+
+      for (j = 0; j < ruleset->n_styles; j++)
+        {
+          guint32 id = _gtk_css_style_property_get_id (ruleset->styles[j].property);
+          gsize prefix;
+          gpointer index;
+
+          g_string_printf (key, "%u ", id);
+          prefix = key->len;
+          _gtk_css_value_print (ruleset->styles[j].value, key);
+
+          if (!g_hash_table_lookup_extended (value_indexes, key->str, NULL, &index))
+            {
+              index = GUINT_TO_POINTER (ids->len);
+              g_hash_table_insert (value_indexes, g_strdup (key->str), index);
+              g_array_append_val (ids, id);
+              g_ptr_array_add (originals, ruleset->styles[j].value);
+              g_string_append (text, key->str + prefix);
+              g_string_append (text, ";\n");
+            }
+
+          cache_append_uint (rules, GPOINTER_TO_UINT (index));
+        }
+    }
+
+  /* Not every value prints in a way that parses back to the same
+   * value, so check that before we rely on it.
+   */
+  values = parse_cached_values (file, (const guint32 *) ids->data, ids->len, text->str);
+  if (values == NULL)
+    goto out;
+
+  for (i = 0; i < values->len; i++)
+    {
+      if (!_gtk_css_value_equal (g_ptr_array_index (values, i), g_ptr_array_index (originals, i)))
+        break;
+    }
+  g_ptr_array_unref (values);
+  if (i < originals->len)
+    goto out;
+
+  array = g_byte_array_new ();
+
+  strncpy (header.magic, GTK_CSS_CACHE_MAGIC, sizeof (header.magic));
+  header.version = GTK_CSS_CACHE_VERSION;
+  header.byte_order = GTK_CSS_CACHE_BYTE_ORDER;
+  g_byte_array_append (array, (const guint8 *) &header, sizeof (CacheHeader));
+
+  cache_append_uint (array, priv->imports->len / 2);
+  for (i = 0; i < priv->imports->len; i++)
+    cache_append_string (array, g_ptr_array_index (priv->imports, i));
+
+  g_string_truncate (key, 0);
+  gtk_css_provider_print_colors (priv->symbolic_colors, key);
+  gtk_css_provider_print_keyframes (priv->keyframes, key);
+  cache_append_string (array, key->str);
+
+  cache_append_uint (array, ids->len);
+  g_byte_array_append (array, (const guint8 *) ids->data, ids->len * sizeof (guint32));
+  cache_append_string (array, text->str);
+
+  g_byte_array_append (array, rules->data, rules->len);
+
+  tree = gtk_css_selector_tree_save (priv->tree, match_indexes);
+  cache_append_data (array, g_bytes_get_data (tree, NULL), g_bytes_get_size (tree));
+  g_bytes_unref (tree);
+
+  if (!g_file_set_contents (path, (const char *) array->data, array->len, &error))
+    {
+      g_debug ("Failed to save theme cache %s: %s", path, error->message);
+      g_error_free (error);
+    }
+
+  g_byte_array_unref (array);
+
+out:
+  g_byte_array_unref (rules);
+  g_string_free (text, TRUE);
+  g_string_free (key, TRUE);
+  g_hash_table_unref (match_indexes);
+  g_hash_table_unref (value_indexes);
+  g_ptr_array_unref (originals);
+  g_array_unref (ids);
+}
@@ -23,6 +23,7 @@
 #include <string.h>
 
 #include "gtkcssprovider.h"
+#include "gtkdebug.h"
 #include "gtkstylecontextprivate.h"
 
 #include <errno.h>
@@ -1906,11 +1907,14 @@ gtk_css_selector_tree_match (const GtkCssSelectorTree      *tree,
                              const GtkCountingBloomFilter  *filter,
                              gboolean                       match_filter,
                              GtkCssNode                    *node,
-                             GPtrArray                    **results)
+                             GPtrArray                    **results,
+                             guint                         *n_visited)
 {
   const GtkCssSelectorTree *prev;
   GtkCssNode *child;
 
+  (*n_visited)++;
+
   if (match_filter && tree->selector.class->category == GTK_CSS_SELECTOR_CATEGORY_SIMPLE_RADICAL &&
       !gtk_counting_bloom_filter_may_contain (filter, gtk_css_selector_hash_one (&tree->selector)))
     return FALSE;
@@ -1931,7 +1935,7 @@ gtk_css_selector_tree_match (const GtkCssSelectorTree      *tree,
            child;
            child = gtk_css_selector_iterator (&tree->selector, node, child))
         {
-          if (!gtk_css_selector_tree_match (prev, filter, match_filter, child, results))
+          if (!gtk_css_selector_tree_match (prev, filter, match_filter, child, results, n_visited))
             break;
         }
     }
@@ -1939,41 +1943,222 @@ gtk_css_selector_tree_match (const GtkCssSelectorTree      *tree,
   return TRUE;
 }
 
-GPtrArray *
-_gtk_css_selector_tree_match_all (const GtkCssSelectorTree     *tree,
-                                  const GtkCountingBloomFilter *filter,
-                                  GtkCssNode                   *node)
+gboolean
+_gtk_css_selector_tree_is_empty (const GtkCssSelectorTree *tree)
 {
-  const GtkCssSelectorTree *iter;
-  GPtrArray *results = NULL;
+  return tree == NULL;
+}
+
+/* The builder puts the name, id and class selectors of the right-most
+ * compound selector at the top level of the tree where it can. An index
+ * maps these to their subtrees, so that lookups only need to visit the
+ * subtrees that can match the node's name, id and classes, plus the
+ * subtrees of the rules that don't have such a key.
+ *
+ * This works for any tree: subtrees with a name, id or class at the top
+ * can't match, or contribute to the change, for nodes that don't have it.
+ */
+struct _GtkCssSelectorTreeIndex
+{
+  GHashTable *names;      /* GQuark => subtree */
+  GHashTable *ids;        /* GQuark => subtree */
+  GHashTable *classes;    /* GQuark => subtree */
+  GPtrArray *universal;   /* subtrees that need to be checked for all nodes */
+  guint n_selectors;      /* in the whole tree, for statistics */
+};
 
-  for (iter = tree;
-       iter != NULL;
-       iter = gtk_css_selector_tree_get_sibling (iter))
+static guint
+gtk_css_selector_tree_count (const GtkCssSelectorTree *tree)
+{
+  guint count = 0;
+
+  for (; tree != NULL; tree = gtk_css_selector_tree_get_sibling (tree))
+    count += 1 + gtk_css_selector_tree_count (gtk_css_selector_tree_get_previous (tree));
+
+  return count;
+}
+
+GtkCssSelectorTreeIndex *
+gtk_css_selector_tree_index_new (const GtkCssSelectorTree *tree)
+{
+  GtkCssSelectorTreeIndex *tree_index;
+
+  tree_index = g_new0 (GtkCssSelectorTreeIndex, 1);
+  tree_index->names = g_hash_table_new (NULL, NULL);
+  tree_index->ids = g_hash_table_new (NULL, NULL);
+  tree_index->classes = g_hash_table_new (NULL, NULL);
+  tree_index->universal = g_ptr_array_new ();
+  tree_index->n_selectors = gtk_css_selector_tree_count (tree);
+
+  for (; tree != NULL; tree = gtk_css_selector_tree_get_sibling (tree))
     {
-      gtk_css_selector_tree_match (iter, filter, FALSE, node, &results);
+      const GtkCssSelector *selector = &tree->selector;
+      GHashTable *table;
+      GQuark key;
+
+      if (selector->class == &GTK_CSS_SELECTOR_NAME)
+        {
+          table = tree_index->names;
+          key = selector->name.name;
+        }
+      else if (selector->class == &GTK_CSS_SELECTOR_ID)
+        {
+          table = tree_index->ids;
+          key = selector->id.name;
+        }
+      else if (selector->class == &GTK_CSS_SELECTOR_CLASS)
+        {
+          table = tree_index->classes;
+          key = selector->style_class.style_class;
+        }
+      else
+        {
+          g_ptr_array_add (tree_index->universal, (gpointer) tree);
+          continue;
+        }
+
+      if (g_hash_table_contains (table, GUINT_TO_POINTER (key)))
+        g_ptr_array_add (tree_index->universal, (gpointer) tree);
+      else
+        g_hash_table_insert (table, GUINT_TO_POINTER (key), (gpointer) tree);
     }
 
-  return results;
+  return tree_index;
 }
 
-gboolean
-_gtk_css_selector_tree_is_empty (const GtkCssSelectorTree *tree)
+void
+gtk_css_selector_tree_index_free (GtkCssSelectorTreeIndex *tree_index)
 {
-  return tree == NULL;
+  if (tree_index == NULL)
+    return;
+
+  g_hash_table_unref (tree_index->names);
+  g_hash_table_unref (tree_index->ids);
+  g_hash_table_unref (tree_index->classes);
+  g_ptr_array_unref (tree_index->universal);
+  g_free (tree_index);
+}
+
+/* Statistics for GTK_DEBUG=css-stats. Lookups happen on multiple
+ * threads, so these are updated atomically.
+ */
+static int stats_lookups;
+static int stats_visited;
+static int stats_available;
+static int stats_matched;
+
+static inline void
+gtk_css_selector_tree_index_add_stats (const GtkCssSelectorTreeIndex *tree_index,
+                                       guint                          n_visited,
+                                       GPtrArray                     *results)
+{
+#ifdef G_ENABLE_DEBUG
+  if (GTK_DEBUG_CHECK (CSS_STATS))
+    {
+      g_atomic_int_inc (&stats_lookups);
+      g_atomic_int_add (&stats_visited, n_visited);
+      g_atomic_int_add (&stats_available, tree_index->n_selectors);
+      g_atomic_int_add (&stats_matched, results ? results->len : 0);
+    }
+#endif
+}
+
+/*
+ * gtk_css_selector_tree_print_stats:
+ *
+ * Prints how many selectors the lookups since the last call visited
+ * and matched, and resets the counts.
+ */
+void
+gtk_css_selector_tree_print_stats (void)
+{
+  int lookups, visited, available, matched;
+
+  lookups = g_atomic_int_and (&stats_lookups, 0);
+  visited = g_atomic_int_and (&stats_visited, 0);
+  available = g_atomic_int_and (&stats_available, 0);
+  matched = g_atomic_int_and (&stats_matched, 0);
+
+  if (lookups == 0)
+    return;
+
+  g_message ("%d style lookups: visited %.1f selectors per lookup (%.1f%% of all), matched %.1f rules per lookup",
+             lookups,
+             (double) visited / lookups,
+             available ? 100.0 * visited / available : 0.0,
+             (double) matched / lookups);
+}
+
+GPtrArray *
+gtk_css_selector_tree_index_match_all (const GtkCssSelectorTreeIndex *tree_index,
+                                       const GtkCountingBloomFilter  *filter,
+                                       GtkCssNode                    *node)
+{
+  const GtkCssSelectorTree *tree;
+  GPtrArray *results = NULL;
+  const GQuark *classes;
+  guint n_visited = 0;
+  guint i, n_classes;
+
+  tree = g_hash_table_lookup (tree_index->names, GUINT_TO_POINTER (gtk_css_node_get_name (node)));
+  if (tree)
+    gtk_css_selector_tree_match (tree, filter, FALSE, node, &results, &n_visited);
+
+  tree = g_hash_table_lookup (tree_index->ids, GUINT_TO_POINTER (gtk_css_node_get_id (node)));
+  if (tree)
+    gtk_css_selector_tree_match (tree, filter, FALSE, node, &results, &n_visited);
+
+  classes = gtk_css_node_list_classes (node, &n_classes);
+  for (i = 0; i < n_classes; i++)
+    {
+      tree = g_hash_table_lookup (tree_index->classes, GUINT_TO_POINTER (classes[i]));
+      if (tree)
+        gtk_css_selector_tree_match (tree, filter, FALSE, node, &results, &n_visited);
+    }
+
+  for (i = 0; i < tree_index->universal->len; i++)
+    {
+      tree = g_ptr_array_index (tree_index->universal, i);
+      gtk_css_selector_tree_match (tree, filter, FALSE, node, &results, &n_visited);
+    }
+
+  gtk_css_selector_tree_index_add_stats (tree_index, n_visited, results);
+
+  return results;
 }
 
 GtkCssChange
-gtk_css_selector_tree_get_change_all (const GtkCssSelectorTree     *tree,
-                                      const GtkCountingBloomFilter *filter,
-				      GtkCssNode                   *node)
+gtk_css_selector_tree_index_get_change_all (const GtkCssSelectorTreeIndex *tree_index,
+                                            const GtkCountingBloomFilter  *filter,
+                                            GtkCssNode                    *node)
 {
+  const GtkCssSelectorTree *tree;
   GtkCssChange change = 0;
+  const GQuark *classes;
+  guint i, n_classes;
+
+  tree = g_hash_table_lookup (tree_index->names, GUINT_TO_POINTER (gtk_css_node_get_name (node)));
+  if (tree)
+    change |= gtk_css_selector_tree_get_change (tree, filter, node, FALSE);
 
-  for (; tree != NULL;
-       tree = gtk_css_selector_tree_get_sibling (tree))
+  tree = g_hash_table_lookup (tree_index->ids, GUINT_TO_POINTER (gtk_css_node_get_id (node)));
+  if (tree)
     change |= gtk_css_selector_tree_get_change (tree, filter, node, FALSE);
 
+  classes = gtk_css_node_list_classes (node, &n_classes);
+  for (i = 0; i < n_classes; i++)
+    {
+      tree = g_hash_table_lookup (tree_index->classes, GUINT_TO_POINTER (classes[i]));
+      if (tree)
+        change |= gtk_css_selector_tree_get_change (tree, filter, node, FALSE);
+    }
+
+  for (i = 0; i < tree_index->universal->len; i++)
+    {
+      tree = g_ptr_array_index (tree_index->universal, i);
+      change |= gtk_css_selector_tree_get_change (tree, filter, node, FALSE);
+    }
+
   /* Never return reserved bit set */
   return change & ~GTK_CSS_CHANGE_RESERVED_BIT;
 }
@@ -2097,6 +2282,14 @@ typedef struct {
   GtkCssSelectorTree **selector_match;
 } GtkCssSelectorRuleSetInfo;
 
+static gboolean
+gtk_css_selector_is_index_key (const GtkCssSelector *selector)
+{
+  return selector->class == &GTK_CSS_SELECTOR_NAME ||
+         selector->class == &GTK_CSS_SELECTOR_ID ||
+         selector->class == &GTK_CSS_SELECTOR_CLASS;
+}
+
 static GtkCssSelectorTree *
 get_tree (GByteArray *array, gint32 offset)
 {
@@ -2128,6 +2321,7 @@ subdivide_infos (GByteArray *array, GList *infos, gint32 parent_offset)
   guint max_count;
   gpointer key, value;
   GPtrArray *exact_matches;
+  gboolean keys_only;
   gint32 res;
 
   if (infos == NULL)
@@ -2141,6 +2335,22 @@ subdivide_infos (GByteArray *array, GList *infos, gint32 parent_offset)
       gtk_css_selectors_count_initial (info->current_selector, ht);
     }
 
+  /* On the top level, split by name, id and class first, as long as
+     there are rules with one of those, for GtkCssSelectorTreeIndex */
+  keys_only = FALSE;
+  if (parent_offset == GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET)
+    {
+      g_hash_table_iter_init (&iter, ht);
+      while (g_hash_table_iter_next (&iter, &key, NULL))
+        {
+          if (gtk_css_selector_is_index_key (key))
+            {
+              keys_only = TRUE;
+              break;
+            }
+        }
+    }
+
   /* Pick the selector with highest count, and use as decision on this level
      as that makes it possible to skip the largest amount of checks later */
 
@@ -2150,6 +2360,8 @@ subdivide_infos (GByteArray *array, GList *infos, gint32 parent_offset)
   while (g_hash_table_iter_next (&iter, &key, &value))
     {
       GtkCssSelector *selector = key;
+      if (keys_only && !gtk_css_selector_is_index_key (selector))
+        continue;
       if (GPOINTER_TO_UINT (value) > max_count ||
 	  (GPOINTER_TO_UINT (value) == max_count &&
 	  gtk_css_selector_compare_one (selector, &max_selector) < 0))
@@ -2314,3 +2526,377 @@ _gtk_css_selector_tree_builder_build (GtkCssSelectorTreeBuilder *builder)
 
   return tree;
 }
+
+/* Saving and loading trees, for the theme cache in gtkcssprovider.c.
+ *
+ * A saved tree is a copy of the tree's memory, followed by a string
+ * table. Everything that isn't valid in another process is replaced
+ * by an index: the class of each selector by its index in
+ * selector_classes, quarks by their index in the string table and
+ * matches by their index in the array passed to the load function,
+ * plus one.
+ */
+
+typedef struct {
+  guint32 tree_size;
+  guint32 n_quarks;
+} SavedTreeHeader;
+
+static const GtkCssSelectorClass *selector_classes[] = {
+  &GTK_CSS_SELECTOR_DESCENDANT,
+  &GTK_CSS_SELECTOR_CHILD,
+  &GTK_CSS_SELECTOR_SIBLING,
+  &GTK_CSS_SELECTOR_ADJACENT,
+  &GTK_CSS_SELECTOR_ANY,
+  &GTK_CSS_SELECTOR_NOT_ANY,
+  &GTK_CSS_SELECTOR_NAME,
+  &GTK_CSS_SELECTOR_NOT_NAME,
+  &GTK_CSS_SELECTOR_CLASS,
+  &GTK_CSS_SELECTOR_NOT_CLASS,
+  &GTK_CSS_SELECTOR_ID,
+  &GTK_CSS_SELECTOR_NOT_ID,
+  &GTK_CSS_SELECTOR_PSEUDOCLASS_STATE,
+  &GTK_CSS_SELECTOR_NOT_PSEUDOCLASS_STATE,
+  &GTK_CSS_SELECTOR_PSEUDOCLASS_POSITION,
+  &GTK_CSS_SELECTOR_NOT_PSEUDOCLASS_POSITION,
+};
+
+static GQuark *
+gtk_css_selector_get_quark (GtkCssSelector *selector)
+{
+  if (selector->class == &GTK_CSS_SELECTOR_NAME ||
+      selector->class == &GTK_CSS_SELECTOR_NOT_NAME)
+    return &selector->name.name;
+  else if (selector->class == &GTK_CSS_SELECTOR_CLASS ||
+           selector->class == &GTK_CSS_SELECTOR_NOT_CLASS)
+    return &selector->style_class.style_class;
+  else if (selector->class == &GTK_CSS_SELECTOR_ID ||
+           selector->class == &GTK_CSS_SELECTOR_NOT_ID)
+    return &selector->id.name;
+  else
+    return NULL;
+}
+
+static gsize
+gtk_css_selector_tree_get_size (const GtkCssSelectorTree *tree,
+                                const GtkCssSelectorTree *root)
+{
+  gsize size = 0;
+
+  while (tree != NULL)
+    {
+      gpointer *matches = gtk_css_selector_tree_get_matches (tree);
+
+      size = MAX (size, (const guint8 *) (tree + 1) - (const guint8 *) root);
+
+      if (matches)
+        {
+          guint i;
+
+          for (i = 0; matches[i]; i++)
+            ;
+          size = MAX (size, (const guint8 *) (matches + i + 1) - (const guint8 *) root);
+        }
+
+      size = MAX (size, gtk_css_selector_tree_get_size (gtk_css_selector_tree_get_previous (tree), root));
+
+      tree = gtk_css_selector_tree_get_sibling (tree);
+    }
+
+  return size;
+}
+
+static void
+save_tree (GtkCssSelectorTree *tree,
+           GHashTable         *match_indexes,
+           GHashTable         *quarks,
+           GPtrArray          *strings)
+{
+  while (tree != NULL)
+    {
+      gpointer *matches = gtk_css_selector_tree_get_matches (tree);
+      GQuark *quark = gtk_css_selector_get_quark (&tree->selector);
+      guint i;
+
+      if (quark)
+        {
+          gpointer index;
+
+          if (!g_hash_table_lookup_extended (quarks, GUINT_TO_POINTER (*quark), NULL, &index))
+            {
+              index = GUINT_TO_POINTER (strings->len);
+              g_hash_table_insert (quarks, GUINT_TO_POINTER (*quark), index);
+              g_ptr_array_add (strings, (gpointer) g_quark_to_string (*quark));
+            }
+          *quark = GPOINTER_TO_UINT (index);
+        }
+
+      for (i = 0; i < G_N_ELEMENTS (selector_classes); i++)
+        {
+          if (tree->selector.class == selector_classes[i])
+            break;
+        }
+      g_assert (i < G_N_ELEMENTS (selector_classes));
+      tree->selector.class = GUINT_TO_POINTER (i);
+
+      if (matches)
+        {
+          for (i = 0; matches[i]; i++)
+            {
+              matches[i] = g_hash_table_lookup (match_indexes, matches[i]);
+              g_assert (matches[i] != NULL);
+            }
+        }
+
+      save_tree ((GtkCssSelectorTree *) gtk_css_selector_tree_get_previous (tree), match_indexes, quarks, strings);
+
+      tree = (GtkCssSelectorTree *) gtk_css_selector_tree_get_sibling (tree);
+    }
+}
+
+/*
+ * gtk_css_selector_tree_save:
+ * @tree: (nullable): the tree to save
+ * @match_indexes: maps the matches in @tree to their index plus one
+ *
+ * Saves @tree so that it can be loaded by another process with
+ * gtk_css_selector_tree_load(). The data is only valid on the same
+ * machine and with the same version of GTK.
+ *
+ * Returns: the saved tree
+ */
+GBytes *
+gtk_css_selector_tree_save (const GtkCssSelectorTree *tree,
+                            GHashTable               *match_indexes)
+{
+  SavedTreeHeader header;
+  GByteArray *array;
+  GHashTable *quarks;
+  GPtrArray *strings;
+  gsize size;
+  guint i;
+
+  size = tree ? gtk_css_selector_tree_get_size (tree, tree) : 0;
+
+  array = g_byte_array_sized_new (sizeof (SavedTreeHeader) + size);
+  g_byte_array_set_size (array, sizeof (SavedTreeHeader));
+  g_byte_array_append (array, (const guint8 *) tree, size);
+
+  quarks = g_hash_table_new (NULL, NULL);
+  strings = g_ptr_array_new ();
+
+  if (tree)
+    save_tree ((GtkCssSelectorTree *) (array->data + sizeof (SavedTreeHeader)), match_indexes, quarks, strings);
+
+  header.tree_size = size;
+  header.n_quarks = strings->len;
+  memcpy (array->data, &header, sizeof (SavedTreeHeader));
+
+  for (i = 0; i < strings->len; i++)
+    {
+      const char *s = g_ptr_array_index (strings, i);
+
+      g_byte_array_append (array, (const guint8 *) s, strlen (s) + 1);
+    }
+
+  g_ptr_array_free (strings, TRUE);
+  g_hash_table_unref (quarks);
+
+  return g_byte_array_free_to_bytes (array);
+}
+
+#define NO_PARENT G_MAXSIZE
+
+typedef struct {
+  guint8 *data;
+  gsize size;
+  const GQuark *quarks;
+  guint n_quarks;
+  gpointer *matches;
+  GtkCssSelectorTree **selector_matches;
+  guint n_matches;
+} TreeLoader;
+
+/* Every offset is checked before it is used, so broken files are
+ * detected instead of crashing. The builder always puts children
+ * and siblings after a node, which makes sure we never loop.
+ */
+static gboolean
+load_tree (TreeLoader *loader,
+           gsize       offset,
+           gsize       parent)
+{
+  while (TRUE)
+    {
+      GtkCssSelectorTree *tree;
+      GQuark *quark;
+      guint class_index;
+
+      if (offset % sizeof (gpointer) != 0 ||
+          offset > loader->size ||
+          loader->size - offset < sizeof (GtkCssSelectorTree))
+        return FALSE;
+
+      tree = (GtkCssSelectorTree *) (loader->data + offset);
+
+      if (parent == NO_PARENT
+          ? tree->parent_offset != GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET
+          : tree->parent_offset != (gint64) parent - (gint64) offset)
+        return FALSE;
+
+      class_index = GPOINTER_TO_UINT (tree->selector.class);
+      if (class_index >= G_N_ELEMENTS (selector_classes))
+        return FALSE;
+      tree->selector.class = selector_classes[class_index];
+
+      quark = gtk_css_selector_get_quark (&tree->selector);
+      if (quark)
+        {
+          if (*quark >= loader->n_quarks)
+            return FALSE;
+          *quark = loader->quarks[*quark];
+        }
+
+      if (tree->matches_offset != GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET)
+        {
+          gsize matches_offset;
+          gpointer *matches;
+          guint i;
+
+          if (tree->matches_offset <= 0)
+            return FALSE;
+
+          matches_offset = offset + tree->matches_offset;
+          if (matches_offset % sizeof (gpointer) != 0)
+            return FALSE;
+
+          matches = (gpointer *) (loader->data + matches_offset);
+          for (i = 0; ; i++)
+            {
+              gsize index;
+
+              if (matches_offset + (i + 1) * sizeof (gpointer) > loader->size)
+                return FALSE;
+
+              if (matches[i] == NULL)
+                break;
+
+              index = GPOINTER_TO_SIZE (matches[i]);
+              if (index > loader->n_matches)
+                return FALSE;
+
+              matches[i] = loader->matches[index - 1];
+              loader->selector_matches[index - 1] = tree;
+            }
+        }
+
+      if (tree->previous_offset != GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET)
+        {
+          if (tree->previous_offset <= 0 ||
+              !load_tree (loader, offset + tree->previous_offset, offset))
+            return FALSE;
+        }
+
+      if (tree->sibling_offset == GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET)
+        return TRUE;
+
+      if (tree->sibling_offset <= 0)
+        return FALSE;
+
+      offset += tree->sibling_offset;
+    }
+}
+
+/*
+ * gtk_css_selector_tree_load:
+ * @data: a tree saved with gtk_css_selector_tree_save()
+ * @size: the size of @data
+ * @matches: the matches, in the order of the indexes that were
+ *   used when saving
+ * @selector_matches: (out caller-allocates): return location for
+ *   the tree node that each of the @matches belongs to
+ * @n_matches: the number of @matches
+ * @out_tree: (out): return location for the tree
+ *
+ * Loads a tree that was saved with gtk_css_selector_tree_save().
+ *
+ * Returns: %FALSE if @data is not a valid tree
+ */
+gboolean
+gtk_css_selector_tree_load (const guint8         *data,
+                            gsize                 size,
+                            gpointer             *matches,
+                            GtkCssSelectorTree  **selector_matches,
+                            guint                 n_matches,
+                            GtkCssSelectorTree  **out_tree)
+{
+  SavedTreeHeader header;
+  TreeLoader loader;
+  const char *s, *end;
+  GQuark *quarks;
+  gboolean result;
+  guint i;
+
+  if (size < sizeof (SavedTreeHeader))
+    return FALSE;
+
+  memcpy (&header, data, sizeof (SavedTreeHeader));
+  if (header.tree_size > size - sizeof (SavedTreeHeader))
+    return FALSE;
+
+  if (header.tree_size == 0)
+    {
+      *out_tree = NULL;
+      return n_matches == 0;
+    }
+
+  s = (const char *) data + sizeof (SavedTreeHeader) + header.tree_size;
+  end = (const char *) data + size;
+  if (header.n_quarks > (gsize) (end - s))
+    return FALSE;
+
+  quarks = g_new (GQuark, header.n_quarks);
+  for (i = 0; i < header.n_quarks; i++)
+    {
+      const char *nul = memchr (s, '\0', end - s);
+
+      if (nul == NULL)
+        {
+          g_free (quarks);
+          return FALSE;
+        }
+
+      quarks[i] = g_quark_from_string (s);
+      s = nul + 1;
+    }
+
+  loader.data = g_memdup (data + sizeof (SavedTreeHeader), header.tree_size);
+  loader.size = header.tree_size;
+  loader.quarks = quarks;
+  loader.n_quarks = header.n_quarks;
+  loader.matches = matches;
+  loader.selector_matches = selector_matches;
+  loader.n_matches = n_matches;
+
+  memset (selector_matches, 0, sizeof (GtkCssSelectorTree *) * n_matches);
+
+  result = load_tree (&loader, 0, NO_PARENT);
+
+  for (i = 0; result && i < n_matches; i++)
+    {
+      if (selector_matches[i] == NULL)
+        result = FALSE;
+    }
+
+  g_free (quarks);
+
+  if (!result)
+    {
+      g_free (loader.data);
+      return FALSE;
+    }
+
+  *out_tree = (GtkCssSelectorTree *) loader.data;
+
+  return TRUE;
+}
@@ -27,6 +27,7 @@ G_BEGIN_DECLS
 typedef union _GtkCssSelector GtkCssSelector;
 typedef struct _GtkCssSelectorTree GtkCssSelectorTree;
 typedef struct _GtkCssSelectorTreeBuilder GtkCssSelectorTreeBuilder;
+typedef struct _GtkCssSelectorTreeIndex GtkCssSelectorTreeIndex;
 
 GtkCssSelector *  _gtk_css_selector_parse           (GtkCssParser           *parser);
 void              _gtk_css_selector_free            (GtkCssSelector         *selector);
@@ -42,16 +43,30 @@ int               _gtk_css_selector_compare         (const GtkCssSelector   *a,
                                                      const GtkCssSelector   *b);
 
 void         _gtk_css_selector_tree_free             (GtkCssSelectorTree       *tree);
-GPtrArray *  _gtk_css_selector_tree_match_all        (const GtkCssSelectorTree *tree,
-                                                      const GtkCountingBloomFilter *filter,
-						      GtkCssNode               *node);
-GtkCssChange gtk_css_selector_tree_get_change_all    (const GtkCssSelectorTree *tree,
-                                                      const GtkCountingBloomFilter *filter,
-						      GtkCssNode               *node);
 void         _gtk_css_selector_tree_match_print      (const GtkCssSelectorTree *tree,
 						      GString                  *str);
 gboolean     _gtk_css_selector_tree_is_empty         (const GtkCssSelectorTree *tree) G_GNUC_CONST;
 
+GBytes *     gtk_css_selector_tree_save              (const GtkCssSelectorTree *tree,
+                                                      GHashTable               *match_indexes);
+gboolean     gtk_css_selector_tree_load              (const guint8             *data,
+                                                      gsize                     size,
+                                                      gpointer                 *matches,
+                                                      GtkCssSelectorTree      **selector_matches,
+                                                      guint                     n_matches,
+                                                      GtkCssSelectorTree      **out_tree);
+
+GtkCssSelectorTreeIndex *
+             gtk_css_selector_tree_index_new         (const GtkCssSelectorTree *tree);
+void         gtk_css_selector_tree_index_free        (GtkCssSelectorTreeIndex  *tree_index);
+GPtrArray *  gtk_css_selector_tree_index_match_all   (const GtkCssSelectorTreeIndex *tree_index,
+                                                      const GtkCountingBloomFilter  *filter,
+                                                      GtkCssNode                    *node);
+GtkCssChange gtk_css_selector_tree_index_get_change_all (const GtkCssSelectorTreeIndex *tree_index,
+                                                      const GtkCountingBloomFilter  *filter,
+                                                      GtkCssNode                    *node);
+void         gtk_css_selector_tree_print_stats       (void);
+
 
 
 GtkCssSelectorTreeBuilder *_gtk_css_selector_tree_builder_new   (void);
@@ -152,11 +152,11 @@ gtk_css_value_shadow_equal (const GtkCssValue *value1,
       const ShadowValue *shadow2 = &value2->shadows[i];
 
       if (shadow1->inset != shadow2->inset ||
-          _gtk_css_value_equal (shadow1->hoffset, shadow2->hoffset) ||
-          _gtk_css_value_equal (shadow1->voffset, shadow2->voffset) ||
-          _gtk_css_value_equal (shadow1->radius, shadow2->radius) ||
-          _gtk_css_value_equal (shadow1->spread, shadow2->spread) ||
-          _gtk_css_value_equal (shadow1->color, shadow2->color))
+          !_gtk_css_value_equal (shadow1->hoffset, shadow2->hoffset) ||
+          !_gtk_css_value_equal (shadow1->voffset, shadow2->voffset) ||
+          !_gtk_css_value_equal (shadow1->radius, shadow2->radius) ||
+          !_gtk_css_value_equal (shadow1->spread, shadow2->spread) ||
+          !_gtk_css_value_equal (shadow1->color, shadow2->color))
         return FALSE;
     }
 
@@ -277,6 +277,32 @@ gtk_css_value_shadow_print (const GtkCssValue *value,
     }
 }
 
+static guint
+gtk_css_value_shadow_hash (const GtkCssValue *value)
+{
+  guint i, hash, part;
+
+  hash = value->n_shadows + 1;
+
+  for (i = 0; i < value->n_shadows; i++)
+    {
+      const ShadowValue *shadow = &value->shadows[i];
+      GtkCssValue *parts[] = { shadow->hoffset, shadow->voffset, shadow->radius, shadow->spread, shadow->color };
+      guint j;
+
+      hash = hash * 31 + shadow->inset;
+      for (j = 0; j < G_N_ELEMENTS (parts); j++)
+        {
+          part = gtk_css_value_hash (parts[j]);
+          if (part == 0)
+            return 0;
+          hash = hash * 31 + part;
+        }
+    }
+
+  return hash ? hash : 1;
+}
+
 static const GtkCssValueClass GTK_CSS_VALUE_SHADOW = {
   "GtkCssShadowValue",
   gtk_css_value_shadow_free,
@@ -285,7 +311,8 @@ static const GtkCssValueClass GTK_CSS_VALUE_SHADOW = {
   gtk_css_value_shadow_transition,
   NULL,
   NULL,
-  gtk_css_value_shadow_print
+  gtk_css_value_shadow_print,
+  gtk_css_value_shadow_hash
 };
 
 static GtkCssValue none_singleton = { &GTK_CSS_VALUE_SHADOW, 1, TRUE, 0 };
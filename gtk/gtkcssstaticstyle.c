@@ -31,6 +31,7 @@
 #include "gtkcssstringvalueprivate.h"
 #include "gtkcssstylepropertyprivate.h"
 #include "gtkcsstransitionprivate.h"
+#include "gtkdebug.h"
 #include "gtkprivate.h"
 #include "gtkintl.h"
 #include "gtksettings.h"
@@ -1006,15 +1007,249 @@ gtk_css_lookup_resolve (GtkCssLookup      *lookup,
     gtk_css_other_values_new_compute (sstyle, provider, parent_style, lookup);
 }
 
+/* Styles are shared process-wide between all nodes whose cascade
+ * has the same inputs: the winning declarations of the lookup, the
+ * parent style and the provider the values are computed with.
+ *
+ * The declarations are compared by identity, which is what the
+ * sorted list of matched rules boils down to. As the values are
+ * owned by the providers, the cache is cleared whenever any style
+ * provider changes.
+ */
+#define MAX_SHARED_STYLES 1024
+
+typedef struct {
+  guint id;
+  GtkCssValue *value;
+  GtkCssSection *section;
+} SharedStyleValue;
+
+typedef struct {
+  GtkStyleProvider *provider;
+  GtkCssStyle *parent;
+  GtkCssChange change;
+  guint hash;
+  guint n_values;
+  SharedStyleValue *values;
+} SharedStyleKey;
+
+/* A key pointing to the values of a lookup on the stack */
+typedef struct {
+  SharedStyleKey key;
+  SharedStyleValue values[GTK_CSS_PROPERTY_N_PROPERTIES];
+} SharedStyleProbe;
+
+static GHashTable *shared_styles;
+static guint shared_styles_generation;
+
+static guint
+shared_style_key_hash (gconstpointer data)
+{
+  const SharedStyleKey *key = data;
+
+  return key->hash;
+}
+
+static gboolean
+shared_style_key_equal (gconstpointer data1,
+                        gconstpointer data2)
+{
+  const SharedStyleKey *key1 = data1;
+  const SharedStyleKey *key2 = data2;
+  guint i;
+
+  if (key1->hash != key2->hash ||
+      key1->provider != key2->provider ||
+      key1->parent != key2->parent ||
+      key1->change != key2->change ||
+      key1->n_values != key2->n_values)
+    return FALSE;
+
+  for (i = 0; i < key1->n_values; i++)
+    {
+      if (key1->values[i].id != key2->values[i].id ||
+          key1->values[i].value != key2->values[i].value ||
+          key1->values[i].section != key2->values[i].section)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+shared_style_key_free (gpointer data)
+{
+  SharedStyleKey *key = data;
+  guint i;
+
+  for (i = 0; i < key->n_values; i++)
+    {
+      gtk_css_value_unref (key->values[i].value);
+      if (key->values[i].section)
+        gtk_css_section_unref (key->values[i].section);
+    }
+
+  g_object_unref (key->provider);
+  g_clear_object (&key->parent);
+
+  g_free (key);
+}
+
+static void
+shared_style_probe_init (SharedStyleProbe   *probe,
+                         GtkStyleProvider   *provider,
+                         const GtkCssLookup *lookup,
+                         GtkCssStyle        *parent,
+                         GtkCssChange        change)
+{
+  SharedStyleKey *key = &probe->key;
+  guint hash, i;
+
+  key->provider = provider;
+  key->parent = parent;
+  key->change = change;
+  key->n_values = 0;
+  key->values = probe->values;
+
+  hash = g_direct_hash (provider) ^ g_direct_hash (parent) ^ g_int64_hash (&change);
+
+  for (i = 0; i < GTK_CSS_PROPERTY_N_PROPERTIES; i++)
+    {
+      if (lookup->values[i].value == NULL)
+        continue;
+
+      probe->values[key->n_values].id = i;
+      probe->values[key->n_values].value = lookup->values[i].value;
+      probe->values[key->n_values].section = lookup->values[i].section;
+      key->n_values++;
+
+      hash = (hash << 5) - hash + i;
+      hash = (hash << 5) - hash + g_direct_hash (lookup->values[i].value);
+    }
+
+  key->hash = hash;
+}
+
+static GtkCssStyle *
+shared_style_lookup (const SharedStyleProbe *probe)
+{
+#ifdef G_ENABLE_DEBUG
+  if (GTK_DEBUG_CHECK (NO_CSS_CACHE))
+    return NULL;
+#endif
+
+  if (shared_styles == NULL)
+    return NULL;
+
+  if (shared_styles_generation != gtk_style_provider_get_generation ())
+    {
+      g_hash_table_remove_all (shared_styles);
+      return NULL;
+    }
+
+  return g_hash_table_lookup (shared_styles, &probe->key);
+}
+
+static void
+shared_style_insert (const SharedStyleProbe *probe,
+                     GtkCssStyle            *style)
+{
+  SharedStyleKey *key;
+  guint i;
+
+#ifdef G_ENABLE_DEBUG
+  if (GTK_DEBUG_CHECK (NO_CSS_CACHE))
+    return;
+#endif
+
+  if (shared_styles == NULL)
+    shared_styles = g_hash_table_new_full (shared_style_key_hash,
+                                           shared_style_key_equal,
+                                           shared_style_key_free,
+                                           g_object_unref);
+
+  if (shared_styles_generation != gtk_style_provider_get_generation () ||
+      g_hash_table_size (shared_styles) >= MAX_SHARED_STYLES)
+    {
+      g_hash_table_remove_all (shared_styles);
+      shared_styles_generation = gtk_style_provider_get_generation ();
+    }
+
+  key = g_malloc (sizeof (SharedStyleKey) + probe->key.n_values * sizeof (SharedStyleValue));
+  *key = probe->key;
+  key->values = (SharedStyleValue *) (key + 1);
+  memcpy (key->values, probe->values, probe->key.n_values * sizeof (SharedStyleValue));
+
+  g_object_ref (key->provider);
+  if (key->parent)
+    g_object_ref (key->parent);
+  for (i = 0; i < key->n_values; i++)
+    {
+      gtk_css_value_ref (key->values[i].value);
+      if (key->values[i].section)
+        gtk_css_section_ref (key->values[i].section);
+    }
+
+  g_hash_table_insert (shared_styles, key, g_object_ref (style));
+}
+
+/*
+ * gtk_css_static_style_new_for_lookup:
+ * @provider: the provider the style is computed with
+ * @lookup: the winning declarations for @node
+ * @node: (nullable): the node to compute the style for
+ * @change: the change flags of @node
+ *
+ * Computes the style from a lookup that was already done, like
+ * gtk_css_static_style_new_compute() does after its lookup.
+ *
+ * Returns: (transfer full): the new style
+ */
+GtkCssStyle *
+gtk_css_static_style_new_for_lookup (GtkStyleProvider *provider,
+                                     GtkCssLookup     *lookup,
+                                     GtkCssNode       *node,
+                                     GtkCssChange      change)
+{
+  GtkCssStaticStyle *result;
+  GtkCssNode *parent;
+  GtkCssStyle *parent_style, *shared;
+  SharedStyleProbe probe;
+
+  if (node)
+    parent = gtk_css_node_get_parent (node);
+  else
+    parent = NULL;
+
+  parent_style = parent ? gtk_css_node_get_style (parent) : NULL;
+
+  shared_style_probe_init (&probe, provider, lookup, parent_style, change);
+  shared = shared_style_lookup (&probe);
+  if (shared)
+    return g_object_ref (shared);
+
+  result = g_object_new (GTK_TYPE_CSS_STATIC_STYLE, NULL);
+
+  result->change = change;
+
+  gtk_css_lookup_resolve (lookup,
+                          provider,
+                          result,
+                          parent_style);
+
+  shared_style_insert (&probe, GTK_CSS_STYLE (result));
+
+  return GTK_CSS_STYLE (result);
+}
+
 GtkCssStyle *
 gtk_css_static_style_new_compute (GtkStyleProvider             *provider,
                                   const GtkCountingBloomFilter *filter,
                                   GtkCssNode                   *node,
                                   GtkCssChange                  change)
 {
-  GtkCssStaticStyle *result;
+  GtkCssStyle *result;
   GtkCssLookup lookup;
-  GtkCssNode *parent;
 
   _gtk_css_lookup_init (&lookup);
 
@@ -1025,23 +1260,11 @@ gtk_css_static_style_new_compute (GtkStyleProvider             *provider,
                                &lookup,
                                change == 0 ? &change : NULL);
 
-  result = g_object_new (GTK_TYPE_CSS_STATIC_STYLE, NULL);
-
-  result->change = change;
-
-  if (node)
-    parent = gtk_css_node_get_parent (node);
-  else
-    parent = NULL;
-
-  gtk_css_lookup_resolve (&lookup,
-                          provider,
-                          result,
-                          parent ? gtk_css_node_get_style (parent) : NULL);
+  result = gtk_css_static_style_new_for_lookup (provider, &lookup, node, change);
 
   _gtk_css_lookup_destroy (&lookup);
 
-  return GTK_CSS_STYLE (result);
+  return result;
 }
 
 G_STATIC_ASSERT (GTK_CSS_PROPERTY_BORDER_TOP_STYLE == GTK_CSS_PROPERTY_BORDER_TOP_WIDTH - 1);
@@ -1097,6 +1320,7 @@ gtk_css_static_style_compute_value (GtkCssStaticStyle *style,
   if (specified)
     {
       value = _gtk_css_value_compute (specified, id, provider, (GtkCssStyle *)style, parent_style);
+      value = gtk_css_value_intern (value);
     }
   else if (parent_style && _gtk_css_style_property_is_inherit (_gtk_css_style_property_lookup_by_id (id)))
     {
@@ -1106,6 +1330,7 @@ gtk_css_static_style_compute_value (GtkCssStaticStyle *style,
   else
     {
       value = _gtk_css_initial_value_new_compute (id, provider, (GtkCssStyle *)style, parent_style);
+      value = gtk_css_value_intern (value);
     }
 
   gtk_css_static_style_set_value (style, id, value, section);
@@ -116,6 +116,15 @@ out:
   ;
 }
 
+static guint
+gtk_css_value_string_hash (const GtkCssValue *value)
+{
+  if (value->string == NULL)
+    return 1;
+
+  return g_str_hash (value->string);
+}
+
 static const GtkCssValueClass GTK_CSS_VALUE_STRING = {
   "GtkCssStringValue",
   gtk_css_value_string_free,
@@ -124,7 +133,8 @@ static const GtkCssValueClass GTK_CSS_VALUE_STRING = {
   gtk_css_value_string_transition,
   NULL,
   NULL,
-  gtk_css_value_string_print
+  gtk_css_value_string_print,
+  gtk_css_value_string_hash
 };
 
 static const GtkCssValueClass GTK_CSS_VALUE_IDENT = {
@@ -135,7 +145,8 @@ static const GtkCssValueClass GTK_CSS_VALUE_IDENT = {
   gtk_css_value_string_transition,
   NULL,
   NULL,
-  gtk_css_value_ident_print
+  gtk_css_value_ident_print,
+  gtk_css_value_string_hash
 };
 
 GtkCssValue *
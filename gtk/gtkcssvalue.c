@@ -160,6 +160,38 @@ _gtk_css_value_alloc (const GtkCssValueClass *klass,
   return value;
 }
 
+/* Computed values that are equal share one GtkCssValue, so that
+ * styles need less memory and comparing them mostly compares
+ * pointers. See gtk_css_value_intern().
+ *
+ * The table doesn't hold a reference, values remove themselves
+ * when they are freed.
+ */
+static GHashTable *interned_values;
+
+static guint
+interned_value_hash (gconstpointer value)
+{
+  return gtk_css_value_hash (value);
+}
+
+static gboolean
+interned_value_equal (gconstpointer value1,
+                      gconstpointer value2)
+{
+  return _gtk_css_value_equal (value1, value2);
+}
+
+static void
+gtk_css_value_unintern (GtkCssValue *value)
+{
+  gpointer interned;
+
+  if (g_hash_table_lookup_extended (interned_values, value, &interned, NULL) &&
+      interned == value)
+    g_hash_table_remove (interned_values, value);
+}
+
 GtkCssValue *
 gtk_css_value_ref (GtkCssValue *value)
 {
@@ -189,6 +221,9 @@ gtk_css_value_unref (GtkCssValue *value)
   }
 #endif
 
+  if (interned_values && value->is_computed && value->class->hash)
+    gtk_css_value_unintern (value);
+
   value->class->free (value);
 }
 
@@ -254,6 +289,72 @@ _gtk_css_value_equal0 (const GtkCssValue *value1,
   return _gtk_css_value_equal (value1, value2);
 }
 
+/**
+ * gtk_css_value_hash:
+ * @value: a #GtkCssValue
+ *
+ * Computes a hash for @value that is the same for all values that
+ * are equal according to _gtk_css_value_equal().
+ *
+ * Returns: the hash, or 0 if @value can't be interned
+ **/
+guint
+gtk_css_value_hash (const GtkCssValue *value)
+{
+  gtk_internal_return_val_if_fail (value != NULL, 0);
+
+  if (!value->class->hash)
+    return 0;
+
+  return value->class->hash (value);
+}
+
+/**
+ * gtk_css_value_intern:
+ * @value: (transfer full): a #GtkCssValue
+ *
+ * Looks for a computed value that is equal to @value and returns it
+ * instead, so that equal values share one allocation and comparing
+ * them is a pointer compare. If there is none, @value becomes the
+ * value that is returned for all values equal to it.
+ *
+ * Values that are not computed or that don't support hashing are
+ * returned unchanged.
+ *
+ * Returns: (transfer full): the interned value
+ **/
+GtkCssValue *
+gtk_css_value_intern (GtkCssValue *value)
+{
+  GtkCssValue *interned;
+
+  gtk_internal_return_val_if_fail (value != NULL, NULL);
+
+  if (!value->is_computed || gtk_css_value_hash (value) == 0)
+    return value;
+
+  if (G_UNLIKELY (interned_values == NULL))
+    interned_values = g_hash_table_new (interned_value_hash, interned_value_equal);
+
+  interned = g_hash_table_lookup (interned_values, value);
+  if (interned)
+    {
+      if (interned != value)
+        {
+          _gtk_css_value_ref (interned);
+          _gtk_css_value_unref (value);
+        }
+      return interned;
+    }
+
+  /* Values that aren't equal to themselves, like NaN numbers,
+   * could never be found again */
+  if (value->class->equal (value, value))
+    g_hash_table_add (interned_values, value);
+
+  return value;
+}
+
 GtkCssValue *
 _gtk_css_value_transition (GtkCssValue *start,
                            GtkCssValue *end,
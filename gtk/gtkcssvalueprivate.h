@@ -60,6 +60,8 @@ struct _GtkCssValueClass {
                                                        gint64                      monotonic_time);
   void          (* print)                             (const GtkCssValue          *value,
                                                        GString                    *string);
+  /* optional, returns 0 if the value can't be interned */
+  guint         (* hash)                              (const GtkCssValue          *value);
 };
 
 GType        _gtk_css_value_get_type                  (void) G_GNUC_CONST;
@@ -71,6 +73,8 @@ GtkCssValue *_gtk_css_value_alloc                     (const GtkCssValueClass
 #define _gtk_css_value_ref gtk_css_value_ref
 GtkCssValue *   gtk_css_value_ref                     (GtkCssValue                *value);
 #define _gtk_css_value_unref gtk_css_value_unref
+/* exported for the tests */
+GDK_AVAILABLE_IN_ALL
 void            gtk_css_value_unref                   (GtkCssValue                *value);
 
 GtkCssValue *_gtk_css_value_compute                   (GtkCssValue                *value,
@@ -78,10 +82,14 @@ GtkCssValue *_gtk_css_value_compute                   (GtkCssValue
                                                        GtkStyleProvider           *provider,
                                                        GtkCssStyle                *style,
                                                        GtkCssStyle                *parent_style) G_GNUC_PURE;
+GDK_AVAILABLE_IN_ALL
 gboolean     _gtk_css_value_equal                     (const GtkCssValue          *value1,
                                                        const GtkCssValue          *value2) G_GNUC_PURE;
 gboolean     _gtk_css_value_equal0                    (const GtkCssValue          *value1,
                                                        const GtkCssValue          *value2) G_GNUC_PURE;
+guint           gtk_css_value_hash                    (const GtkCssValue          *value) G_GNUC_PURE;
+GDK_AVAILABLE_IN_ALL
+GtkCssValue *   gtk_css_value_intern                  (GtkCssValue                *value);
 GtkCssValue *_gtk_css_value_transition                (GtkCssValue                *start,
                                                        GtkCssValue                *end,
                                                        guint                       property_id,
@@ -53,6 +53,8 @@ typedef enum {
   GTK_DEBUG_LAYOUT          = 1 << 15,
   GTK_DEBUG_SNAPSHOT        = 1 << 16,
   GTK_DEBUG_CONSTRAINTS     = 1 << 17,
+  GTK_DEBUG_NO_CSS_THREADS  = 1 << 18,
+  GTK_DEBUG_CSS_STATS       = 1 << 19,
 } GtkDebugFlag;
 
 #ifdef G_ENABLE_DEBUG
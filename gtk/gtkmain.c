@@ -180,6 +180,8 @@ static const GDebugKey gtk_debug_keys[] = {
   { "layout", GTK_DEBUG_LAYOUT },
   { "snapshot", GTK_DEBUG_SNAPSHOT },
   { "constraints", GTK_DEBUG_CONSTRAINTS },
+  { "no-css-threads", GTK_DEBUG_NO_CSS_THREADS },
+  { "css-stats", GTK_DEBUG_CSS_STATS },
 };
 #endif /* G_ENABLE_DEBUG */
 
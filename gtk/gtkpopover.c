@@ -126,6 +126,7 @@
 #include "gtkrender.h"
 #include "gtkstylecontextprivate.h"
 #include "gtkroundedboxprivate.h"
+#include "gsk/gskrendernodeprivate.h"
 #include "gsk/gskroundedrectprivate.h"
 
 #ifdef GDK_WINDOWING_WAYLAND
@@ -1188,7 +1189,7 @@ create_arrow_render_node (GtkPopover *popover)
 
   gtk_style_context_restore (context);
 
-  priv->arrow_render_node = gtk_snapshot_free_to_node (snapshot);
+  priv->arrow_render_node = gsk_render_node_promote (gtk_snapshot_free_to_node (snapshot));
 }
 
 static void
@@ -23,6 +23,8 @@
 
 #include "gtksnapshot.h"
 
+#include "gsk/gskrendernodeprivate.h"
+
 struct _GtkRenderNodePaintable
 {
   GObject parent_instance;
@@ -134,7 +136,7 @@ gtk_render_node_paintable_new (GskRenderNode         *node,
 
   self = g_object_new (GTK_TYPE_RENDER_NODE_PAINTABLE, NULL);
 
-  self->node = gsk_render_node_ref (node);
+  self->node = gsk_render_node_promote (gsk_render_node_ref (node));
   self->bounds = *bounds;
 
   return GDK_PAINTABLE (self);
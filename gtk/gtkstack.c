@@ -34,6 +34,7 @@
 #include "gtklistlistmodelprivate.h"
 #include "a11y/gtkstackaccessible.h"
 #include "a11y/gtkstackaccessibleprivate.h"
+#include "gsk/gskrendernodeprivate.h"
 #include <math.h>
 #include <string.h>
 
@@ -2363,12 +2364,16 @@ gtk_stack_snapshot (GtkWidget   *widget,
               priv->last_visible_child != NULL)
             {
               GtkSnapshot *last_visible_snapshot;
+              gboolean arena_enabled;
 
+              /* This node is kept for the whole transition */
+              arena_enabled = gsk_render_node_arena_set_enabled (FALSE);
               gtk_widget_get_allocation (priv->last_visible_child->widget,
                                          &priv->last_visible_surface_allocation);
               last_visible_snapshot = gtk_snapshot_new ();
               gtk_widget_snapshot (priv->last_visible_child->widget, last_visible_snapshot);
               priv->last_visible_node = gtk_snapshot_free_to_node (last_visible_snapshot);
+              gsk_render_node_arena_set_enabled (arena_enabled);
             }
 
           gtk_snapshot_push_clip (snapshot,
@@ -431,6 +431,11 @@ gtk_style_context_reset_widgets (GdkDisplay *display)
 {
   GList *list, *toplevels;
 
+  /* Computed values depend on the settings, so styles that were
+   * shared before the change must not be reused.
+   */
+  gtk_style_provider_invalidate_generation ();
+
   toplevels = gtk_window_list_toplevels ();
   g_list_foreach (toplevels, (GFunc) g_object_ref, NULL);
 
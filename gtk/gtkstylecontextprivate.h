@@ -44,7 +44,10 @@ void            gtk_style_context_save_named                 (GtkStyleContext *c
 void            gtk_style_context_save_to_node               (GtkStyleContext *context,
                                                               GtkCssNode      *node);
 
+/* exported for the tests */
+GDK_AVAILABLE_IN_ALL
 GtkCssStyle *   gtk_style_context_lookup_style               (GtkStyleContext *context);
+GDK_AVAILABLE_IN_ALL
 GtkCssValue   * _gtk_style_context_peek_property             (GtkStyleContext *context,
                                                               guint            property_id);
 gboolean       _gtk_style_context_check_region_name          (const gchar     *str);
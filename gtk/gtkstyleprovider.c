@@ -115,14 +115,45 @@ gtk_style_provider_lookup (GtkStyleProvider             *provider,
   iface->lookup (provider, filter, node, lookup, out_change);
 }
 
+static guint generation;
+
 void
 gtk_style_provider_changed (GtkStyleProvider *provider)
 {
   gtk_internal_return_if_fail (GTK_IS_STYLE_PROVIDER (provider));
 
+  generation++;
+
   g_signal_emit (provider, signals[CHANGED], 0);
 }
 
+/*
+ * gtk_style_provider_get_generation:
+ *
+ * Returns a number that changes whenever any style provider
+ * changes, for caches that depend on the contents of providers.
+ *
+ * Returns: the current generation
+ */
+guint
+gtk_style_provider_get_generation (void)
+{
+  return generation;
+}
+
+/*
+ * gtk_style_provider_invalidate_generation:
+ *
+ * Changes the generation without any provider having changed.
+ * This is used when global state that computed values depend on,
+ * like the settings for DPI or fonts, has changed.
+ */
+void
+gtk_style_provider_invalidate_generation (void)
+{
+  generation++;
+}
+
 GtkSettings *
 gtk_style_provider_get_settings (GtkStyleProvider *provider)
 {
@@ -79,6 +79,7 @@
 #include "gdk/gdkprofilerprivate.h"
 #include "gsk/gskdebugprivate.h"
 #include "gsk/gskrendererprivate.h"
+#include "gsk/gskrendernodeprivate.h"
 
 #include <cairo-gobject.h>
 #include <gobject/gobjectnotifyqueue.c>
@@ -12165,9 +12166,20 @@ gtk_widget_snapshot (GtkWidget   *widget,
       return;
     }
 
-  if (priv->draw_needed)
+  /* Only widgets that are redrawn every frame get their nodes from
+   * the frame's arena, the nodes of other widgets are likely to be
+   * reused in later frames and would keep the arena alive. When a
+   * widget stops being redrawn, its nodes from the last frame's arena
+   * are replaced by drawing it once more outside of the arena.
+   */
+  if (priv->draw_needed ||
+      (priv->render_node && priv->render_node->in_arena))
     {
       GskRenderNode *render_node;
+      gboolean arena_enabled;
+
+      arena_enabled = gsk_render_node_arena_set_enabled (priv->draw_needed && priv->draw_in_arena);
+      priv->draw_in_arena = priv->draw_needed;
 
       gtk_widget_push_paintables (widget);
 
@@ -12181,6 +12193,12 @@ gtk_widget_snapshot (GtkWidget   *widget,
 
       gtk_widget_pop_paintables (widget);
       gtk_widget_update_paintables (widget);
+
+      gsk_render_node_arena_set_enabled (arena_enabled);
+    }
+  else
+    {
+      priv->draw_in_arena = FALSE;
     }
 
   if (priv->render_node)
@@ -12194,6 +12212,7 @@ gtk_widget_render (GtkWidget            *widget,
 {
   GtkSnapshot *snapshot;
   GskRenderer *renderer;
+  GskRenderNodeArena *arena;
   GskRenderNode *root;
   int x, y;
   gint64 before = g_get_monotonic_time ();
@@ -12206,12 +12225,18 @@ gtk_widget_render (GtkWidget            *widget,
   if (renderer == NULL)
     return;
 
+  arena = gsk_render_node_arena_new ();
+  gsk_render_node_arena_push (arena);
+
   snapshot = gtk_snapshot_new ();
   gtk_native_get_surface_transform (GTK_NATIVE (widget), &x, &y);
   gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (x, y));
   gtk_widget_snapshot (widget, snapshot);
   root = gtk_snapshot_free_to_node (snapshot);
 
+  gsk_render_node_arena_pop (arena);
+  gsk_render_node_arena_unref (arena);
+
   if (gdk_profiler_is_running ())
     {
       after = g_get_monotonic_time ();
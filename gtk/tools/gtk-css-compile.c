@@ -0,0 +1,105 @@
+/* GTK is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * GLib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GTK; see the file COPYING.  If not,
+ * see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <gtk/gtk.h>
+
+/* Loading a CSS file writes it to the theme cache, so all we need
+ * to do is to load the files, and to report errors, since files
+ * with errors are not cached.
+ */
+
+static gboolean had_errors;
+
+static void
+parsing_error (GtkCssProvider *provider,
+               GtkCssSection  *section,
+               const GError   *error,
+               gpointer        user_data)
+{
+  char *location = gtk_css_section_to_string (section);
+
+  g_printerr ("%s: %s\n", location, error->message);
+  had_errors = TRUE;
+
+  g_free (location);
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *context;
+  char **filenames = NULL;
+  const GOptionEntry entries[] = {
+    { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &filenames, NULL, "FILE…" },
+    { NULL, }
+  };
+  GError *error = NULL;
+  int status = 0;
+  int i;
+
+  g_set_prgname ("gtk4-css-compile");
+
+  /* That's what we are here for */
+  g_setenv ("GTK_CSS_CACHE", "1", TRUE);
+
+  context = g_option_context_new (NULL);
+  g_option_context_set_summary (context, "Compile CSS files into the theme cache.");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  if (filenames == NULL)
+    {
+      g_printerr ("No CSS file specified\n");
+      return 1;
+    }
+
+  /* Parsing CSS doesn't need a display, so don't insist on one */
+  gtk_init_check ();
+
+  for (i = 0; filenames[i]; i++)
+    {
+      GtkCssProvider *provider;
+      GFile *file;
+
+      provider = gtk_css_provider_new ();
+      g_signal_connect (provider, "parsing-error", G_CALLBACK (parsing_error), NULL);
+
+      had_errors = FALSE;
+      file = g_file_new_for_commandline_arg (filenames[i]);
+      gtk_css_provider_load_from_file (provider, file);
+
+      if (had_errors)
+        {
+          g_printerr ("%s: Not cached because of errors\n", filenames[i]);
+          status = 1;
+        }
+
+      g_object_unref (file);
+      g_object_unref (provider);
+    }
+
+  g_strfreev (filenames);
+
+  return status;
+}
@@ -2,6 +2,10 @@
 
 #include <gsk/gskcairoblurprivate.h>
 
+#include <string.h>
+
+static const int radii[] = { 2, 4, 8, 16, 32, 64 };
+
 static void
 init_surface (cairo_t *cr)
 {
@@ -16,13 +20,67 @@ init_surface (cairo_t *cr)
   cairo_fill (cr);
 }
 
+static void
+run_blur (cairo_surface_t *surface,
+          cairo_t         *cr,
+          const char      *name,
+          gboolean         threaded,
+          GTimer          *timer)
+{
+  int size = cairo_image_surface_get_height (surface);
+  double msec;
+  guint i;
+  int j;
+
+  gsk_cairo_blur_set_implementation (name, threaded);
+
+  g_print ("%s%s:\n", name, threaded ? " (threaded)" : "");
+
+  /* We do everything twice, first as warmup */
+  for (j = 0; j < 2; j++)
+    {
+      for (i = 0; i < G_N_ELEMENTS (radii); i++)
+        {
+          init_surface (cr);
+          g_timer_start (timer);
+          gsk_cairo_blur_surface (surface, radii[i], GSK_BLUR_X | GSK_BLUR_Y);
+          msec = g_timer_elapsed (timer, NULL) * 1000;
+          if (j == 1)
+            g_print ("  Radius %2d: %.2f msec, %.2f kpixels/msec\n", radii[i], msec, size*size/(msec*1000));
+        }
+    }
+}
+
+static gboolean
+check_blur (cairo_surface_t *surface,
+            cairo_t         *cr,
+            const char      *name,
+            gboolean         threaded,
+            int              radius,
+            guchar          *expected)
+{
+  int size = cairo_image_surface_get_height (surface);
+  int stride = cairo_image_surface_get_stride (surface);
+
+  gsk_cairo_blur_set_implementation (name, threaded);
+
+  init_surface (cr);
+  gsk_cairo_blur_surface (surface, radius, GSK_BLUR_X | GSK_BLUR_Y);
+  cairo_surface_flush (surface);
+
+  return memcmp (cairo_image_surface_get_data (surface), expected, stride * size) == 0;
+}
+
 int
 main (int argc, char **argv)
 {
   cairo_surface_t *surface;
   cairo_t *cr;
   GTimer *timer;
-  double msec;
+  const char **names;
+  guchar *expected;
+  int status = 0;
+  guint r;
   int i, j;
   int size;
 
@@ -34,21 +92,45 @@ main (int argc, char **argv)
 
   cr = cairo_create (surface);
 
-  /* We do everything three times, first two as warmup */
-  for (j = 0; j < 2; j++)
+  names = gsk_cairo_blur_list_implementations ();
+
+  /* All implementations must produce the same result as the scalar
+   * one, threaded or not. The radii give both odd and even box sizes. */
+  for (r = 0; r < G_N_ELEMENTS (radii); r++)
+    {
+      gsk_cairo_blur_set_implementation ("scalar", FALSE);
+      init_surface (cr);
+      gsk_cairo_blur_surface (surface, radii[r], GSK_BLUR_X | GSK_BLUR_Y);
+      cairo_surface_flush (surface);
+      expected = g_memdup (cairo_image_surface_get_data (surface),
+                           cairo_image_surface_get_stride (surface) * size);
+
+      for (i = 0; names[i] != NULL; i++)
+        {
+          for (j = 0; j < 2; j++)
+            {
+              if (!check_blur (surface, cr, names[i], j, radii[r], expected))
+                {
+                  g_print ("%s%s: result differs from scalar blur for radius %d\n",
+                           names[i], j ? " (threaded)" : "", radii[r]);
+                  status = 1;
+                }
+            }
+        }
+
+      g_free (expected);
+    }
+
+  for (i = 0; names[i] != NULL; i++)
     {
-      for (i = 1; i < 16; i++)
-	{
-	  init_surface (cr);
-	  g_timer_start (timer);
-	  gsk_cairo_blur_surface (surface, i, GSK_BLUR_X | GSK_BLUR_Y);
-	  msec = g_timer_elapsed (timer, NULL) * 1000;
-	  if (j == 1)
-	    g_print ("Radius %2d: %.2f msec, %.2f kpixels/msec:\n", i, msec, size*size/(msec*1000));
-	}
+      run_blur (surface, cr, names[i], FALSE, timer);
+      run_blur (surface, cr, names[i], TRUE, timer);
     }
 
+  g_free (names);
+  cairo_destroy (cr);
+  cairo_surface_destroy (surface);
   g_timer_destroy (timer);
 
-  return 0;
+  return status;
 }
@@ -0,0 +1,272 @@
+/* Replays a render node trace, as recorded with GSK_DEBUG=record,
+ * against the different renderers and reports how long the frames
+ * took.
+ *
+ * For every frame, three times are measured:
+ *  - cpu: the CPU time used by the process in render_texture()
+ *  - render: the wall clock time until render_texture() returns
+ *  - complete: the wall clock time until the pixels are available,
+ *    which includes waiting for the GPU and reading the result back.
+ *    The difference to render approximates the GPU time.
+ */
+
+#include <gtk/gtk.h>
+#include <gsk/gsktraceprivate.h>
+
+#include <stdlib.h>
+#include <time.h>
+
+static char **renderer_names = NULL;
+static int runs = 1;
+static int warmup = 1;
+
+static GOptionEntry options[] = {
+  { "renderer", '\0', 0, G_OPTION_ARG_STRING_ARRAY, &renderer_names, "Only replay with the given renderer", "NAME" },
+  { "runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Replay the trace N times", "N" },
+  { "warmup", 'w', 0, G_OPTION_ARG_INT, &warmup, "Replay the trace N times before measuring", "N" },
+  { NULL }
+};
+
+static const struct {
+  const char *name;
+  GskRenderer * (* create) (void);
+} renderers[] = {
+  { "gl", gsk_gl_renderer_new },
+#ifdef GDK_RENDERING_VULKAN
+  { "vulkan", gsk_vulkan_renderer_new },
+#endif
+  { "cairo", gsk_cairo_renderer_new },
+};
+
+static gint64
+get_cpu_time (void)
+{
+#ifdef CLOCK_PROCESS_CPUTIME_ID
+  struct timespec ts;
+
+  if (clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &ts) == 0)
+    return (gint64) ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+#endif
+
+  return g_get_monotonic_time ();
+}
+
+static void
+deserialize_error_func (const GtkCssSection *section,
+                        const GError        *error,
+                        gpointer             user_data)
+{
+  char *section_str = gtk_css_section_to_string (section);
+
+  g_warning ("Error at %s: %s", section_str, error->message);
+
+  g_free (section_str);
+}
+
+static GPtrArray *
+load_trace (const char *filename)
+{
+  GskTraceReader *reader;
+  GError *error = NULL;
+  GPtrArray *nodes;
+  GBytes *bytes;
+  gint64 timestamp;
+
+  reader = gsk_trace_reader_new (filename, &error);
+  if (reader == NULL)
+    {
+      g_printerr ("Could not open trace: %s\n", error->message);
+      g_error_free (error);
+      return NULL;
+    }
+
+  nodes = g_ptr_array_new_with_free_func ((GDestroyNotify) gsk_render_node_unref);
+
+  while (gsk_trace_reader_next_frame (reader, &timestamp, &bytes, &error))
+    {
+      GskRenderNode *node = gsk_render_node_deserialize (bytes, deserialize_error_func, NULL);
+
+      if (node)
+        g_ptr_array_add (nodes, node);
+      g_bytes_unref (bytes);
+    }
+
+  if (error)
+    {
+      g_printerr ("Could not read trace: %s\n", error->message);
+      g_error_free (error);
+    }
+
+  gsk_trace_reader_free (reader);
+
+  return nodes;
+}
+
+static int
+compare_times (gconstpointer a,
+               gconstpointer b)
+{
+  gint64 t1 = *(const gint64 *) a;
+  gint64 t2 = *(const gint64 *) b;
+
+  return t1 < t2 ? -1 : (t1 > t2 ? 1 : 0);
+}
+
+static void
+print_percentiles (const char *name,
+                   gint64     *times,
+                   guint       n_times)
+{
+  static const int percentiles[] = { 50, 90, 99 };
+  guint i;
+
+  qsort (times, n_times, sizeof (gint64), compare_times);
+
+  g_print ("  %-10s", name);
+  for (i = 0; i < G_N_ELEMENTS (percentiles); i++)
+    g_print (" %9.3f", times[(n_times - 1) * percentiles[i] / 100] / 1000.0);
+  g_print (" %9.3f\n", times[n_times - 1] / 1000.0);
+}
+
+static void
+replay (const char  *name,
+        GskRenderer *renderer,
+        GPtrArray   *nodes)
+{
+  gint64 *cpu_times, *render_times, *complete_times;
+  guint n_times = 0;
+  guchar *pixels = NULL;
+  gsize pixels_size = 0;
+  int run;
+  guint i;
+
+  cpu_times = g_new (gint64, nodes->len * runs);
+  render_times = g_new (gint64, nodes->len * runs);
+  complete_times = g_new (gint64, nodes->len * runs);
+
+  for (run = - warmup; run < runs; run++)
+    {
+      for (i = 0; i < nodes->len; i++)
+        {
+          GskRenderNode *node = g_ptr_array_index (nodes, i);
+          GdkTexture *texture;
+          gint64 start, cpu_start, render, cpu;
+          gsize size;
+          int width, height;
+
+          cpu_start = get_cpu_time ();
+          start = g_get_monotonic_time ();
+
+          texture = gsk_renderer_render_texture (renderer, node, NULL);
+
+          render = g_get_monotonic_time () - start;
+          cpu = get_cpu_time () - cpu_start;
+
+          width = gdk_texture_get_width (texture);
+          height = gdk_texture_get_height (texture);
+          size = (gsize) width * height * 4;
+          if (size > pixels_size)
+            {
+              pixels = g_realloc (pixels, size);
+              pixels_size = size;
+            }
+          gdk_texture_download (texture, pixels, width * 4);
+
+          if (run >= 0)
+            {
+              cpu_times[n_times] = cpu;
+              render_times[n_times] = render;
+              complete_times[n_times] = g_get_monotonic_time () - start;
+              n_times++;
+            }
+
+          g_object_unref (texture);
+        }
+    }
+
+  g_print ("%s: %u frames\n", name, n_times);
+  if (n_times > 0)
+    {
+      g_print ("  %-10s %9s %9s %9s %9s\n", "msec", "p50", "p90", "p99", "max");
+      print_percentiles ("cpu", cpu_times, n_times);
+      print_percentiles ("render", render_times, n_times);
+      print_percentiles ("complete", complete_times, n_times);
+    }
+
+  g_free (pixels);
+  g_free (cpu_times);
+  g_free (render_times);
+  g_free (complete_times);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GdkSurface *surface;
+  GPtrArray *nodes;
+  guint i;
+
+  context = g_option_context_new ("TRACE-FILE");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+
+  gtk_init ();
+
+  if (argc != 2)
+    {
+      g_printerr ("Usage: %s [OPTIONS] TRACE-FILE\n", argv[0]);
+      return 1;
+    }
+
+  if (runs < 1 || warmup < 0)
+    {
+      g_printerr ("Need at least 1 run and no negative number of warmup runs.\n");
+      return 1;
+    }
+
+  nodes = load_trace (argv[1]);
+  if (nodes == NULL)
+    return 1;
+
+  if (nodes->len == 0)
+    {
+      g_printerr ("Trace contains no frames.\n");
+      g_ptr_array_unref (nodes);
+      return 1;
+    }
+
+  surface = gdk_surface_new_toplevel (gdk_display_get_default (), 10, 10);
+
+  for (i = 0; i < G_N_ELEMENTS (renderers); i++)
+    {
+      GskRenderer *renderer;
+
+      if (renderer_names && !g_strv_contains ((const char * const *) renderer_names, renderers[i].name))
+        continue;
+
+      renderer = renderers[i].create ();
+      if (!gsk_renderer_realize (renderer, surface, &error))
+        {
+          g_print ("%s: not available: %s\n", renderers[i].name, error->message);
+          g_clear_error (&error);
+          g_object_unref (renderer);
+          continue;
+        }
+
+      replay (renderers[i].name, renderer, nodes);
+
+      gsk_renderer_unrealize (renderer);
+      g_object_unref (renderer);
+    }
+
+  g_object_unref (surface);
+  g_ptr_array_unref (nodes);
+
+  return 0;
+}
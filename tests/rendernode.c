@@ -4,12 +4,14 @@ static gboolean benchmark = FALSE;
 static gboolean dump_variant = FALSE;
 static gboolean fallback = FALSE;
 static int runs = 1;
+static char *binary_file = NULL;
 
 static GOptionEntry options[] = {
   { "benchmark", 'b', 0, G_OPTION_ARG_NONE, &benchmark, "Time operations", NULL },
   { "dump-variant", 'd', 0, G_OPTION_ARG_NONE, &dump_variant, "Dump GVariant structure", NULL },
   { "fallback", '\0', 0, G_OPTION_ARG_NONE, &fallback, "Draw node without a renderer", NULL },
   { "runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Render the test N times", "N" },
+  { "write-binary", '\0', 0, G_OPTION_ARG_FILENAME, &binary_file, "Save the node in the binary format", "FILE" },
   { NULL }
 };
 
@@ -54,7 +56,7 @@ main(int argc, char **argv)
       g_printerr ("Number of runs given with -r/--runs must be at least 1 and not %d.\n", runs);
       return 1;
     }
-  if (!(argc == 3 || (argc == 2 && (dump_variant || benchmark))))
+  if (!(argc == 3 || (argc == 2 && (dump_variant || benchmark || binary_file))))
     {
       g_printerr ("Usage: %s [OPTIONS] NODE-FILE PNG-FILE\n", argv[0]);
       return 1;
@@ -94,6 +96,35 @@ main(int argc, char **argv)
       return 1;
     }
 
+  if (binary_file)
+    {
+      start = g_get_monotonic_time ();
+      bytes = gsk_render_node_serialize_binary (node);
+      end = g_get_monotonic_time ();
+      if (benchmark)
+        {
+          char *bytes_string = g_format_size (g_bytes_get_size (bytes));
+          g_print ("Serialized %s in %.4gs\n", bytes_string, (double) (end - start) / G_USEC_PER_SEC);
+          g_free (bytes_string);
+        }
+
+      if (!g_file_set_contents (binary_file,
+                                g_bytes_get_data (bytes, NULL),
+                                g_bytes_get_size (bytes),
+                                &error))
+        {
+          g_printerr ("Could not save binary node file: %s\n", error->message);
+          return 1;
+        }
+      g_bytes_unref (bytes);
+
+      if (argc == 2 && !benchmark)
+        {
+          gsk_render_node_unref (node);
+          return 0;
+        }
+    }
+
   if (fallback)
     {
       graphene_rect_t bounds;
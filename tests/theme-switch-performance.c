@@ -0,0 +1,192 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Toggles between the light and dark variant of the theme on a window
+ * filled with copies of the widget-factory contents, and reports how
+ * long it took until the restyled frame was painted.
+ *
+ * Run with GTK_DEBUG=no-css-threads to compare with matching the
+ * selectors on the main thread only.
+ */
+
+#include <gtk/gtk.h>
+#include <stdlib.h>
+
+/* Stub definition of MyTextView which is used in the
+ * widget-factory.ui file. We just need this so the
+ * test keeps working
+ */
+typedef struct
+{
+  GtkTextView tv;
+} MyTextView;
+
+typedef GtkTextViewClass MyTextViewClass;
+
+G_DEFINE_TYPE (MyTextView, my_text_view, GTK_TYPE_TEXT_VIEW)
+
+static void
+my_text_view_init (MyTextView *tv) {}
+
+static void
+my_text_view_class_init (MyTextViewClass *tv_class) {}
+
+static int copies = 16;
+static int switches = 20;
+
+static GOptionEntry options[] = {
+  { "copies", 'c', 0, G_OPTION_ARG_INT, &copies, "Number of copies of the widget-factory contents", "N" },
+  { "switches", 's', 0, G_OPTION_ARG_INT, &switches, "Number of theme switches to measure", "N" },
+  { NULL }
+};
+
+static gint64 *times;
+static int n_times;
+static gint64 switch_time;
+
+static GtkWidget *
+create_widget_factory_content (void)
+{
+  GError *error = NULL;
+  GtkBuilder *builder;
+  GtkWidget *result;
+
+  g_type_ensure (my_text_view_get_type ());
+  builder = gtk_builder_new ();
+  gtk_builder_add_from_file (builder,
+                             "../demos/widget-factory/widget-factory.ui",
+                             &error);
+  if (error != NULL)
+    g_error ("Failed to create widgets: %s", error->message);
+
+  result = GTK_WIDGET (gtk_builder_get_object (builder, "box1"));
+  g_object_ref (result);
+  gtk_container_remove (GTK_CONTAINER (gtk_widget_get_parent (result)),
+                        result);
+  g_object_unref (builder);
+
+  return result;
+}
+
+static int
+compare_times (gconstpointer a,
+               gconstpointer b)
+{
+  gint64 t1 = *(const gint64 *) a;
+  gint64 t2 = *(const gint64 *) b;
+
+  return t1 < t2 ? -1 : (t1 > t2 ? 1 : 0);
+}
+
+static void
+print_times (void)
+{
+  qsort (times, n_times, sizeof (gint64), compare_times);
+
+  g_print ("%d theme switches on %d copies\n", n_times, copies);
+  g_print ("  min    %9.3f ms\n", times[0] / 1000.0);
+  g_print ("  median %9.3f ms\n", times[n_times / 2] / 1000.0);
+  g_print ("  max    %9.3f ms\n", times[n_times - 1] / 1000.0);
+}
+
+static gboolean
+switch_theme (GtkWidget     *widget,
+              GdkFrameClock *frame_clock,
+              gpointer       user_data)
+{
+  GtkSettings *settings = gtk_widget_get_settings (widget);
+  gboolean dark;
+
+  /* Wait until the previous switch has been painted */
+  if (switch_time != 0)
+    return G_SOURCE_CONTINUE;
+
+  if (n_times == switches)
+    {
+      print_times ();
+      gtk_main_quit ();
+      return G_SOURCE_REMOVE;
+    }
+
+  g_object_get (settings, "gtk-application-prefer-dark-theme", &dark, NULL);
+
+  switch_time = g_get_monotonic_time ();
+  g_object_set (settings, "gtk-application-prefer-dark-theme", !dark, NULL);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+after_paint (GdkFrameClock *frame_clock,
+             gpointer       user_data)
+{
+  if (switch_time == 0)
+    return;
+
+  times[n_times++] = g_get_monotonic_time () - switch_time;
+  switch_time = 0;
+}
+
+static void
+window_realized (GtkWidget *window)
+{
+  g_signal_connect (gtk_widget_get_frame_clock (window), "after-paint",
+                    G_CALLBACK (after_paint), NULL);
+}
+
+int
+main (int argc, char **argv)
+{
+  GtkWidget *window;
+  GtkWidget *scrolled_window;
+  GtkWidget *grid;
+  GError *error = NULL;
+  int i;
+
+  GOptionContext *context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, options, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+
+  if (copies < 1 || switches < 1)
+    {
+      g_printerr ("Need at least 1 copy and 1 switch.\n");
+      return 1;
+    }
+
+  gtk_init ();
+
+  times = g_new (gint64, switches);
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  gtk_window_set_default_size (GTK_WINDOW (window), 800, 600);
+  g_signal_connect (window, "realize", G_CALLBACK (window_realized), NULL);
+
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_container_add (GTK_CONTAINER (window), scrolled_window);
+
+  grid = gtk_grid_new ();
+  gtk_container_add (GTK_CONTAINER (scrolled_window), grid);
+
+  for (i = 0; i < copies; i++)
+    {
+      GtkWidget *content = create_widget_factory_content ();
+      gtk_grid_attach (GTK_GRID (grid), content,
+                       i % 4, i / 4, 1, 1);
+      g_object_unref (content);
+    }
+
+  gtk_widget_add_tick_callback (window, switch_theme, NULL, NULL);
+
+  gtk_widget_show (window);
+  g_signal_connect (window, "destroy",
+                    G_CALLBACK (gtk_main_quit), NULL);
+  gtk_main ();
+
+  g_free (times);
+
+  return 0;
+}
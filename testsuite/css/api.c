@@ -19,6 +19,9 @@
  */
 
 #include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <utime.h>
 
 static void
 gtk_css_provider_load_data_not_null_terminated (void)
@@ -33,15 +36,178 @@ gtk_css_provider_load_data_not_null_terminated (void)
   g_object_unref (p);
 }
 
+static char *
+load_to_string (GFile *file)
+{
+  GtkCssProvider *p;
+  char *result;
+
+  p = gtk_css_provider_new ();
+  gtk_css_provider_load_from_file (p, file);
+  result = gtk_css_provider_to_string (p);
+  g_object_unref (p);
+
+  return result;
+}
+
+static GHashTable *
+list_cache_files (void)
+{
+  GHashTable *result;
+  char *cache_dir;
+  const char *name;
+  GDir *dir;
+
+  result = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  cache_dir = g_build_filename (g_get_user_cache_dir (), "gtk-4.0", "css", NULL);
+  dir = g_dir_open (cache_dir, 0, NULL);
+  if (dir)
+    {
+      while ((name = g_dir_read_name (dir)))
+        g_hash_table_add (result, g_build_filename (cache_dir, name, NULL));
+      g_dir_close (dir);
+    }
+  g_free (cache_dir);
+
+  return result;
+}
+
+/* Returns the one cache file that is not in @before */
+static char *
+find_new_cache_file (GHashTable *before)
+{
+  GHashTable *after;
+  GHashTableIter iter;
+  gpointer key;
+  char *result = NULL;
+
+  after = list_cache_files ();
+  g_hash_table_iter_init (&iter, after);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      if (g_hash_table_contains (before, key))
+        continue;
+
+      g_assert_null (result);
+      result = g_strdup (key);
+    }
+  g_hash_table_unref (after);
+
+  g_assert_nonnull (result);
+
+  return result;
+}
+
+static void
+gtk_css_provider_theme_cache (void)
+{
+  const char *css =
+    "@define-color fg red;\n"
+    "@keyframes blink { from { opacity: 0; } to { opacity: 1; } }\n"
+    "button, label.title { color: @fg; margin: 2px 3px; }\n"
+    "#id > .a:hover { padding: 1px; }\n"
+    "box:not(.b) ~ *:nth-child(2n+1) { animation-name: blink; color: blue; }\n";
+  char *path, *cache_path;
+  char *parsed, *cached, *corrupt, *changed;
+  struct utimbuf times;
+  GStatBuf before, after;
+  GHashTable *files;
+  GFile *file;
+
+  path = g_build_filename (g_get_user_cache_dir (), "test.css", NULL);
+  g_assert_true (g_file_set_contents (path, css, -1, NULL));
+  file = g_file_new_for_path (path);
+
+  files = list_cache_files ();
+  parsed = load_to_string (file);
+  cache_path = find_new_cache_file (files);
+  g_hash_table_unref (files);
+
+  /* Loading the cache marks it as used, while a miss would parse
+   * again and write a new file in its place.
+   */
+  times.actime = times.modtime = g_get_real_time () / G_USEC_PER_SEC - 2 * 24 * 60 * 60;
+  g_assert_cmpint (g_utime (cache_path, &times), ==, 0);
+  g_assert_cmpint (g_stat (cache_path, &before), ==, 0);
+
+  cached = load_to_string (file);
+  g_assert_cmpstr (parsed, ==, cached);
+
+  g_assert_cmpint (g_stat (cache_path, &after), ==, 0);
+  g_assert_cmpint (before.st_ino, ==, after.st_ino);
+  g_assert_cmpint (after.st_mtime, >, times.modtime);
+
+  /* A broken cache falls back to parsing and gets replaced */
+  g_assert_true (g_file_set_contents (cache_path, "GTKCSS garbage", -1, NULL));
+  corrupt = load_to_string (file);
+  g_assert_cmpstr (parsed, ==, corrupt);
+  g_assert_cmpint (g_stat (cache_path, &after), ==, 0);
+  g_assert_cmpint (after.st_size, >, strlen ("GTKCSS garbage"));
+
+  g_assert_true (g_file_set_contents (path, "button { color: green; }", -1, NULL));
+  changed = load_to_string (file);
+  g_assert_nonnull (strstr (changed, "green"));
+  g_assert_null (strstr (changed, "blink"));
+
+  g_free (parsed);
+  g_free (cached);
+  g_free (corrupt);
+  g_free (changed);
+  g_free (cache_path);
+  g_object_unref (file);
+  g_free (path);
+}
+
+static void
+remove_dir (const char *path)
+{
+  const char *name;
+  GDir *dir;
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir)))
+    {
+      char *child = g_build_filename (path, name, NULL);
+
+      if (g_file_test (child, G_FILE_TEST_IS_DIR))
+        remove_dir (child);
+      else
+        g_remove (child);
+
+      g_free (child);
+    }
+
+  g_dir_close (dir);
+  g_rmdir (path);
+}
 
 int
 main (int argc, char *argv[])
 {
+  char *cache_home;
+  int result;
+
+  /* Don't touch the real theme cache */
+  cache_home = g_dir_make_tmp ("gtk-css-api-XXXXXX", NULL);
+  g_setenv ("XDG_CACHE_HOME", cache_home, TRUE);
+  g_setenv ("GTK_CSS_CACHE", "1", TRUE);
+
   gtk_test_init (&argc, &argv, NULL);
 
   g_test_add_func ("/gtk_css_provider_load_data/not_null_terminated",
       gtk_css_provider_load_data_not_null_terminated);
+  g_test_add_func ("/gtk_css_provider/theme_cache",
+      gtk_css_provider_theme_cache);
+
+  result = g_test_run ();
+
+  remove_dir (cache_home);
+  g_free (cache_home);
 
-  return g_test_run ();
+  return result;
 }
 
@@ -0,0 +1,147 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+
+#include "gtk/gtkcssdimensionvalueprivate.h"
+#include "gtk/gtkstylecontextprivate.h"
+
+/* Both rules set the same values, but each has its own copy of the
+ * specified values, and the nodes don't share a style.
+ */
+static const char *css =
+  "label.a {\n"
+  "  color: rgb(1,2,3);\n"
+  "  margin-left: 2em;\n"
+  "  box-shadow: 1px 2px 3px 4px rgb(5,6,7);\n"
+  "  font-family: \"Intern Test\", sans-serif;\n"
+  "  padding-left: 1px;\n"
+  "}\n"
+  "label.b {\n"
+  "  color: rgb(1,2,3);\n"
+  "  margin-left: 2em;\n"
+  "  box-shadow: 1px 2px 3px 4px rgb(5,6,7);\n"
+  "  font-family: \"Intern Test\", sans-serif;\n"
+  "  padding-left: 2px;\n"
+  "}\n"
+  "label.c {\n"
+  "  box-shadow: 1px 2px 3px 4px rgb(5,6,7) inset;\n"
+  "}\n";
+
+static GtkWidget *
+create_label (GtkWidget  *box,
+              const char *class)
+{
+  GtkWidget *label;
+
+  label = gtk_label_new (class);
+  gtk_style_context_add_class (gtk_widget_get_style_context (label), class);
+  gtk_container_add (GTK_CONTAINER (box), label);
+
+  return label;
+}
+
+static GtkCssValue *
+peek_value (GtkWidget *widget,
+            guint      property_id)
+{
+  return _gtk_style_context_peek_property (gtk_widget_get_style_context (widget), property_id);
+}
+
+static void
+test_intern_nodes (void)
+{
+  GtkCssProvider *provider;
+  GtkWidget *window, *box, *a, *b, *c;
+  guint properties[] = {
+    GTK_CSS_PROPERTY_COLOR,
+    GTK_CSS_PROPERTY_MARGIN_LEFT,
+    GTK_CSS_PROPERTY_BOX_SHADOW,
+    GTK_CSS_PROPERTY_FONT_FAMILY,
+  };
+  guint i;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider, css, -1);
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  gtk_container_add (GTK_CONTAINER (window), box);
+  a = create_label (box, "a");
+  b = create_label (box, "b");
+  c = create_label (box, "c");
+
+  g_assert_true (gtk_style_context_lookup_style (gtk_widget_get_style_context (a)) !=
+                 gtk_style_context_lookup_style (gtk_widget_get_style_context (b)));
+
+  for (i = 0; i < G_N_ELEMENTS (properties); i++)
+    g_assert_true (peek_value (a, properties[i]) == peek_value (b, properties[i]));
+
+  g_assert_true (peek_value (a, GTK_CSS_PROPERTY_PADDING_LEFT) !=
+                 peek_value (b, GTK_CSS_PROPERTY_PADDING_LEFT));
+
+  /* Equal shadows are only found if they compare equal */
+  g_assert_true (_gtk_css_value_equal (peek_value (a, GTK_CSS_PROPERTY_BOX_SHADOW),
+                                       peek_value (b, GTK_CSS_PROPERTY_BOX_SHADOW)));
+  g_assert_false (_gtk_css_value_equal (peek_value (a, GTK_CSS_PROPERTY_BOX_SHADOW),
+                                        peek_value (c, GTK_CSS_PROPERTY_BOX_SHADOW)));
+
+  gtk_widget_destroy (window);
+  gtk_style_context_remove_provider_for_display (gdk_display_get_default (),
+                                                 GTK_STYLE_PROVIDER (provider));
+  g_object_unref (provider);
+}
+
+static void
+test_intern_free (void)
+{
+  GtkCssValue *a, *b, *c;
+
+  a = gtk_css_value_intern (gtk_css_dimension_value_new (4321, GTK_CSS_PX));
+  b = gtk_css_value_intern (gtk_css_dimension_value_new (4321, GTK_CSS_PX));
+  g_assert_true (a == b);
+  gtk_css_value_unref (b);
+
+  /* a still has a user, so equal values keep finding it */
+  b = gtk_css_value_intern (gtk_css_dimension_value_new (4321, GTK_CSS_PX));
+  g_assert_true (a == b);
+  gtk_css_value_unref (b);
+
+  /* Create c while a is alive, so it can't reuse its memory */
+  c = gtk_css_dimension_value_new (4321, GTK_CSS_PX);
+  g_assert_true (a != c);
+
+  /* Freeing the last user removes a, so c is interned afresh */
+  gtk_css_value_unref (a);
+  b = gtk_css_value_intern (c);
+  g_assert_true (b == c);
+  gtk_css_value_unref (b);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/css/intern/nodes", test_intern_nodes);
+  g_test_add_func ("/css/intern/free", test_intern_free);
+
+  return g_test_run ();
+}
@@ -315,6 +315,9 @@ add_tests_for_files_in_directory (GFile *dir)
 int
 main (int argc, char **argv)
 {
+  /* Don't touch the real theme cache */
+  g_setenv ("GTK_CSS_CACHE", "0", TRUE);
+
   gtk_test_init (&argc, &argv);
 
   if (argc < 2)
@@ -0,0 +1,152 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+
+#include "gtk/gtkstylecontextprivate.h"
+
+static GtkCssProvider *
+add_provider (const char *css)
+{
+  GtkCssProvider *provider;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider, css, -1);
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+  return provider;
+}
+
+static void
+remove_provider (GtkCssProvider *provider)
+{
+  gtk_style_context_remove_provider_for_display (gdk_display_get_default (),
+                                                 GTK_STYLE_PROVIDER (provider));
+  g_object_unref (provider);
+}
+
+/* window > box > label, with the given class on the box */
+static GtkWidget *
+create_label (const char *box_class)
+{
+  GtkWidget *window, *box, *label;
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  if (box_class)
+    gtk_style_context_add_class (gtk_widget_get_style_context (box), box_class);
+  gtk_container_add (GTK_CONTAINER (window), box);
+  label = gtk_label_new ("probe");
+  gtk_style_context_add_class (gtk_widget_get_style_context (label), "probe");
+  gtk_container_add (GTK_CONTAINER (box), label);
+
+  return label;
+}
+
+static GtkCssStyle *
+lookup_style (GtkWidget *widget)
+{
+  return gtk_style_context_lookup_style (gtk_widget_get_style_context (widget));
+}
+
+static void
+test_sharing_parents (void)
+{
+  GtkCssProvider *provider;
+  GtkWidget *label1, *label2, *label3;
+  GdkRGBA color2, color3;
+
+  provider = add_provider ("label.probe { padding: 3px; }\n"
+                           "box.red { color: rgb(255,0,0); }\n");
+
+  label1 = create_label (NULL);
+  label2 = create_label (NULL);
+  label3 = create_label ("red");
+
+  /* Different parent nodes, but equal parent styles */
+  g_assert_true (lookup_style (label1) == lookup_style (label2));
+
+  /* Same cascade, but a different parent style */
+  g_assert_true (lookup_style (label1) != lookup_style (label3));
+
+  gtk_style_context_get_color (gtk_widget_get_style_context (label2), &color2);
+  gtk_style_context_get_color (gtk_widget_get_style_context (label3), &color3);
+  g_assert_false (gdk_rgba_equal (&color2, &color3));
+  g_assert_cmpfloat (color3.red, ==, 1.0);
+  g_assert_cmpfloat (color3.green, ==, 0.0);
+
+  gtk_widget_destroy (GTK_WIDGET (gtk_widget_get_root (label1)));
+  gtk_widget_destroy (GTK_WIDGET (gtk_widget_get_root (label2)));
+  gtk_widget_destroy (GTK_WIDGET (gtk_widget_get_root (label3)));
+  remove_provider (provider);
+}
+
+static int
+get_padding_left (GtkWidget *widget)
+{
+  GtkBorder padding;
+
+  gtk_style_context_get_padding (gtk_widget_get_style_context (widget), &padding);
+
+  return padding.left;
+}
+
+static void
+test_sharing_settings (void)
+{
+  GtkSettings *settings;
+  GtkCssProvider *provider;
+  GtkWidget *label1, *label2;
+  int dpi;
+
+  settings = gtk_settings_get_default ();
+  g_object_get (settings, "gtk-xft-dpi", &dpi, NULL);
+  g_object_set (settings, "gtk-xft-dpi", 96 * 1024, NULL);
+
+  provider = add_provider ("label.probe { padding: 1in; }");
+
+  label1 = create_label (NULL);
+  g_assert_cmpint (get_padding_left (label1), ==, 96);
+
+  /* The root's style must be recomputed from the new settings,
+   * not reused from before the change.
+   */
+  g_object_set (settings, "gtk-xft-dpi", 192 * 1024, NULL);
+  g_assert_cmpint (get_padding_left (label1), ==, 192);
+
+  label2 = create_label (NULL);
+  g_assert_cmpint (get_padding_left (label2), ==, 192);
+  g_assert_true (lookup_style (label1) == lookup_style (label2));
+
+  gtk_widget_destroy (GTK_WIDGET (gtk_widget_get_root (label1)));
+  gtk_widget_destroy (GTK_WIDGET (gtk_widget_get_root (label2)));
+  remove_provider (provider);
+  g_object_set (settings, "gtk-xft-dpi", dpi, NULL);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/css/sharing/parents", test_sharing_parents);
+  g_test_add_func ("/css/sharing/settings", test_sharing_settings);
+
+  return g_test_run ();
+}
@@ -0,0 +1,202 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+
+#include "gsk/gskrendernodeprivate.h"
+
+static GskRenderNode *
+create_frame (void)
+{
+  GdkRGBA red = { 1, 0, 0, 1 };
+  GdkRGBA blue = { 0, 0, 1, 0.5 };
+  GskRenderNode *nodes[2];
+  GskRenderNode *clip, *result;
+
+  nodes[0] = gsk_color_node_new (&red, &GRAPHENE_RECT_INIT (0, 0, 20, 20));
+  nodes[1] = gsk_color_node_new (&blue, &GRAPHENE_RECT_INIT (10, 10, 20, 20));
+  clip = gsk_clip_node_new (nodes[1], &GRAPHENE_RECT_INIT (15, 15, 10, 10));
+  result = gsk_container_node_new ((GskRenderNode *[]) { nodes[0], clip }, 2);
+
+  gsk_render_node_unref (clip);
+  gsk_render_node_unref (nodes[1]);
+  gsk_render_node_unref (nodes[0]);
+
+  return result;
+}
+
+static char *
+serialize (GskRenderNode *node)
+{
+  GBytes *bytes = gsk_render_node_serialize (node);
+  char *result = g_strndup (g_bytes_get_data (bytes, NULL), g_bytes_get_size (bytes));
+
+  g_bytes_unref (bytes);
+
+  return result;
+}
+
+static void
+test_frame (void)
+{
+  GskRenderNodeArena *arena;
+  GskRenderNode *node;
+
+  arena = gsk_render_node_arena_new ();
+  gsk_render_node_arena_push (arena);
+  node = create_frame ();
+  gsk_render_node_arena_pop (arena);
+
+  g_assert_cmpuint (gsk_render_node_arena_get_n_nodes (arena), ==, 4);
+
+  /* Nodes created after the pop are not in the arena */
+  gsk_render_node_unref (create_frame ());
+  g_assert_cmpuint (gsk_render_node_arena_get_n_nodes (arena), ==, 4);
+
+  gsk_render_node_unref (node);
+  g_assert_cmpuint (gsk_render_node_arena_get_n_nodes (arena), ==, 0);
+
+  gsk_render_node_arena_unref (arena);
+}
+
+static void
+test_disabled (void)
+{
+  GskRenderNodeArena *arena;
+  GskRenderNode *node;
+
+  arena = gsk_render_node_arena_new ();
+  gsk_render_node_arena_push (arena);
+
+  g_assert_true (gsk_render_node_arena_set_enabled (FALSE));
+  node = create_frame ();
+  g_assert_false (gsk_render_node_arena_set_enabled (TRUE));
+  g_assert_cmpuint (gsk_render_node_arena_get_n_nodes (arena), ==, 0);
+
+  gsk_render_node_unref (node);
+  node = create_frame ();
+  g_assert_cmpuint (gsk_render_node_arena_get_n_nodes (arena), ==, 4);
+
+  gsk_render_node_arena_pop (arena);
+  gsk_render_node_unref (node);
+  gsk_render_node_arena_unref (arena);
+}
+
+static void
+test_promote (void)
+{
+  GskRenderNodeArena *arena;
+  GskRenderNode *node, *promoted;
+  char *expected, *text;
+
+  arena = gsk_render_node_arena_new ();
+  gsk_render_node_arena_push (arena);
+  node = create_frame ();
+  gsk_render_node_arena_pop (arena);
+
+  promoted = gsk_render_node_promote (gsk_render_node_ref (node));
+  g_assert_true (promoted != node);
+  g_assert_cmpint (gsk_render_node_get_node_type (promoted), ==, gsk_render_node_get_node_type (node));
+  g_assert_true (graphene_rect_equal (&promoted->bounds, &node->bounds));
+
+  expected = serialize (node);
+  text = serialize (promoted);
+  g_assert_cmpstr (text, ==, expected);
+  g_free (text);
+  g_free (expected);
+
+  /* Dropping the frame frees the arena, the promoted node doesn't keep it */
+  gsk_render_node_unref (node);
+  g_assert_cmpuint (gsk_render_node_arena_get_n_nodes (arena), ==, 0);
+  gsk_render_node_arena_unref (arena);
+
+  /* Promoting nodes that are not in an arena does nothing */
+  node = gsk_render_node_promote (gsk_render_node_ref (promoted));
+  g_assert_true (node == promoted);
+  gsk_render_node_unref (node);
+
+  gsk_render_node_unref (promoted);
+}
+
+/* Snapshots @widget like a frame does, and returns the frame's arena */
+static GskRenderNodeArena *
+snapshot_frame (GtkWidget *widget,
+                gboolean   redraw)
+{
+  GskRenderNodeArena *arena;
+  GtkSnapshot *snapshot;
+  GskRenderNode *node;
+
+  arena = gsk_render_node_arena_new ();
+  gsk_render_node_arena_push (arena);
+
+  if (redraw)
+    gtk_widget_queue_draw (widget);
+
+  snapshot = gtk_snapshot_new ();
+  gtk_widget_snapshot_child (gtk_widget_get_parent (widget), widget, snapshot);
+  node = gtk_snapshot_free_to_node (snapshot);
+  g_assert_nonnull (node);
+
+  gsk_render_node_arena_pop (arena);
+  gsk_render_node_unref (node);
+
+  return arena;
+}
+
+static void
+test_idle_widget (void)
+{
+  GskRenderNodeArena *arena;
+  GtkWidget *window, *label;
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  label = gtk_label_new ("Animated");
+  gtk_container_add (GTK_CONTAINER (window), label);
+  gtk_widget_show (window);
+
+  while (!gtk_widget_get_mapped (label) ||
+         gtk_widget_get_width (label) == 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  /* Drawn in two frames in a row, so the label's nodes come from the
+   * second frame's arena and keep it alive */
+  gsk_render_node_arena_unref (snapshot_frame (label, TRUE));
+  arena = snapshot_frame (label, TRUE);
+  g_assert_cmpuint (gsk_render_node_arena_get_n_nodes (arena), >, 0);
+
+  /* Not redrawn in the next frame, so the label lets go of them */
+  gsk_render_node_arena_unref (snapshot_frame (label, FALSE));
+  g_assert_cmpuint (gsk_render_node_arena_get_n_nodes (arena), ==, 0);
+
+  gsk_render_node_arena_unref (arena);
+  gtk_widget_destroy (window);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/arena/frame", test_frame);
+  g_test_add_func ("/arena/disabled", test_disabled);
+  g_test_add_func ("/arena/promote", test_promote);
+  g_test_add_func ("/arena/idle-widget", test_idle_widget);
+
+  return g_test_run ();
+}
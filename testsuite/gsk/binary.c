@@ -0,0 +1,476 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+#include <string.h>
+
+/* Words of the header of the binary format, see gskrendernodebinary.c */
+#define MAGIC "\211GSKNODE"
+#define HEADER_SIZE (8 + 8 * 4)
+
+static void
+ignore_error (const GtkCssSection *section,
+              const GError        *error,
+              gpointer             user_data)
+{
+}
+
+static void
+count_error (const GtkCssSection *section,
+             const GError        *error,
+             gpointer             user_data)
+{
+  guint *n_errors = user_data;
+
+  g_assert_error (error, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA);
+  (*n_errors)++;
+}
+
+static char *
+serialize_text (GskRenderNode *node)
+{
+  GBytes *bytes = gsk_render_node_serialize (node);
+  char *result = g_strndup (g_bytes_get_data (bytes, NULL), g_bytes_get_size (bytes));
+
+  g_bytes_unref (bytes);
+
+  return result;
+}
+
+static GskRenderNode *
+round_trip (GskRenderNode *node)
+{
+  GskRenderNode *result;
+  GBytes *bytes;
+  guint n_errors = 0;
+
+  bytes = gsk_render_node_serialize_binary (node);
+  result = gsk_render_node_deserialize (bytes, count_error, &n_errors);
+  g_bytes_unref (bytes);
+
+  g_assert_cmpuint (n_errors, ==, 0);
+  g_assert_nonnull (result);
+
+  return result;
+}
+
+/* Reading back the binary format must give the same node */
+static void
+test_round_trip (gconstpointer data)
+{
+  const char *path = data;
+  GskRenderNode *node, *copy;
+  char *contents;
+  gsize length;
+  GBytes *bytes;
+  char *expected, *text;
+
+  g_assert_true (g_file_get_contents (path, &contents, &length, NULL));
+  bytes = g_bytes_new_take (contents, length);
+  node = gsk_render_node_deserialize (bytes, ignore_error, NULL);
+  g_bytes_unref (bytes);
+
+  if (node == NULL)
+    {
+      g_test_skip ("File does not contain a node");
+      return;
+    }
+
+  copy = round_trip (node);
+
+  expected = serialize_text (node);
+  text = serialize_text (copy);
+  g_assert_cmpstr (text, ==, expected);
+
+  g_free (text);
+  g_free (expected);
+  gsk_render_node_unref (copy);
+  gsk_render_node_unref (node);
+}
+
+static GskRenderNode *
+create_node (void)
+{
+  GdkRGBA red = { 1, 0, 0, 1 };
+  GdkRGBA blue = { 0, 0, 1, 0.5 };
+  GskRenderNode *nodes[2];
+  GskRenderNode *blend, *transform, *result;
+  GskTransform *scale;
+
+  nodes[0] = gsk_color_node_new (&red, &GRAPHENE_RECT_INIT (0, 0, 20, 20));
+  nodes[1] = gsk_color_node_new (&blue, &GRAPHENE_RECT_INIT (10, 10, 20, 20));
+  blend = gsk_blend_node_new (nodes[0], nodes[1], GSK_BLEND_MODE_MULTIPLY);
+  scale = gsk_transform_scale (NULL, 2, 3);
+  transform = gsk_transform_node_new (blend, scale);
+  gsk_transform_unref (scale);
+  /* Uses the color nodes a second time */
+  result = gsk_container_node_new ((GskRenderNode *[]) { transform, nodes[0], nodes[1] }, 3);
+
+  gsk_render_node_unref (transform);
+  gsk_render_node_unref (blend);
+  gsk_render_node_unref (nodes[1]);
+  gsk_render_node_unref (nodes[0]);
+
+  return result;
+}
+
+static void
+test_shared_children (void)
+{
+  GskRenderNode *node, *copy;
+  char *expected, *text;
+
+  node = create_node ();
+  copy = round_trip (node);
+
+  expected = serialize_text (node);
+  text = serialize_text (copy);
+  g_assert_cmpstr (text, ==, expected);
+
+  g_free (text);
+  g_free (expected);
+  gsk_render_node_unref (copy);
+  gsk_render_node_unref (node);
+}
+
+/* The node above uses no strings and textures, so the file ends with
+ * the last node and every byte of it is needed.
+ */
+static void
+test_truncated (void)
+{
+  GskRenderNode *node;
+  GBytes *bytes;
+  gsize i, size;
+
+  node = create_node ();
+  bytes = gsk_render_node_serialize_binary (node);
+  size = g_bytes_get_size (bytes);
+
+  for (i = strlen (MAGIC); i < size; i++)
+    {
+      GBytes *truncated = g_bytes_new_from_bytes (bytes, 0, i);
+      guint n_errors = 0;
+
+      g_assert_null (gsk_render_node_deserialize (truncated, count_error, &n_errors));
+      g_assert_cmpuint (n_errors, >, 0);
+      g_bytes_unref (truncated);
+    }
+
+  g_bytes_unref (bytes);
+  gsk_render_node_unref (node);
+}
+
+static guint32
+read_uint (GBytes *bytes,
+           gsize   offset)
+{
+  const guchar *data = g_bytes_get_data (bytes, NULL);
+  guint32 value;
+
+  g_assert_cmpuint (offset + 4, <=, g_bytes_get_size (bytes));
+  memcpy (&value, data + offset, 4);
+
+  return GUINT32_FROM_LE (value);
+}
+
+static GskRenderNode *
+create_texture_node (int width,
+                     int height)
+{
+  GskRenderNode *node;
+  GdkTexture *texture;
+  GBytes *bytes;
+
+  bytes = g_bytes_new_take (g_malloc0 (width * height * 4), width * height * 4);
+  texture = gdk_memory_texture_new (width, height, GDK_MEMORY_DEFAULT, bytes, width * 4);
+  node = gsk_texture_node_new (texture, &GRAPHENE_RECT_INIT (0, 0, width, height));
+
+  g_object_unref (texture);
+  g_bytes_unref (bytes);
+
+  return node;
+}
+
+/* Texture data must be aligned in the file, no matter the size of
+ * the strings and textures stored before it */
+static void
+test_texture_alignment (void)
+{
+  GskRenderNode *children[4];
+  GskRenderNode *node, *texture;
+  GBytes *bytes;
+  guint32 n_textures, textures_offset;
+  guint i;
+
+  texture = create_texture_node (3, 3);
+  children[0] = gsk_debug_node_new (texture, g_strdup ("a"));
+  gsk_render_node_unref (texture);
+  children[1] = create_texture_node (5, 1);
+  texture = create_texture_node (1, 7);
+  children[2] = gsk_debug_node_new (texture, g_strdup ("bcdefgh"));
+  gsk_render_node_unref (texture);
+  children[3] = create_texture_node (2, 2);
+  node = gsk_container_node_new (children, G_N_ELEMENTS (children));
+  for (i = 0; i < G_N_ELEMENTS (children); i++)
+    gsk_render_node_unref (children[i]);
+
+  bytes = gsk_render_node_serialize_binary (node);
+
+  n_textures = read_uint (bytes, strlen (MAGIC) + 2 * 4);
+  textures_offset = read_uint (bytes, strlen (MAGIC) + 5 * 4);
+  g_assert_cmpuint (n_textures, ==, 4);
+
+  for (i = 0; i < n_textures; i++)
+    {
+      guint32 offset = read_uint (bytes, textures_offset + i * 4 * 4 + 3 * 4);
+
+      g_assert_cmpuint (offset % 16, ==, 0);
+    }
+
+  g_bytes_unref (bytes);
+  gsk_render_node_unref (node);
+}
+
+static void
+append_uint (GByteArray *array,
+             guint32     value)
+{
+  value = GUINT32_TO_LE (value);
+  g_byte_array_append (array, (const guchar *) &value, sizeof (value));
+}
+
+static void
+append_float (GByteArray *array,
+              float       value)
+{
+  union { float f; guint32 u; } u = { value };
+
+  append_uint (array, u.u);
+}
+
+static void
+append_color_node (GByteArray *array)
+{
+  guint i;
+
+  append_uint (array, GSK_COLOR_NODE);
+  for (i = 0; i < 4; i++)
+    append_float (array, 10);
+  for (i = 0; i < 4; i++)
+    append_float (array, 1);
+}
+
+/* Creates a file without strings and textures */
+static GBytes *
+create_file (guint       n_nodes,
+             GByteArray *nodes)
+{
+  GByteArray *array = g_byte_array_new ();
+
+  g_byte_array_append (array, (const guchar *) MAGIC, strlen (MAGIC));
+  append_uint (array, 1); /* version */
+  append_uint (array, 0); /* n_strings */
+  append_uint (array, 0); /* n_textures */
+  append_uint (array, n_nodes);
+  append_uint (array, HEADER_SIZE); /* strings_offset */
+  append_uint (array, HEADER_SIZE); /* textures_offset */
+  append_uint (array, HEADER_SIZE); /* nodes_offset */
+  append_uint (array, nodes->len);
+  g_byte_array_append (array, nodes->data, nodes->len);
+
+  g_byte_array_unref (nodes);
+
+  return g_byte_array_free_to_bytes (array);
+}
+
+static void
+assert_invalid (guint       n_nodes,
+                GByteArray *nodes)
+{
+  GBytes *bytes = create_file (n_nodes, nodes);
+  guint n_errors = 0;
+
+  g_assert_null (gsk_render_node_deserialize (bytes, count_error, &n_errors));
+  g_assert_cmpuint (n_errors, >, 0);
+  g_bytes_unref (bytes);
+}
+
+static void
+test_valid (void)
+{
+  GByteArray *nodes = g_byte_array_new ();
+  GskRenderNode *node;
+  GBytes *bytes;
+  guint n_errors = 0;
+
+  append_color_node (nodes);
+  append_uint (nodes, GSK_OPACITY_NODE);
+  append_uint (nodes, 0);
+  append_float (nodes, 0.5);
+
+  bytes = create_file (2, nodes);
+  node = gsk_render_node_deserialize (bytes, count_error, &n_errors);
+  g_assert_cmpuint (n_errors, ==, 0);
+  g_assert_nonnull (node);
+  g_assert_cmpint (gsk_render_node_get_node_type (node), ==, GSK_OPACITY_NODE);
+
+  gsk_render_node_unref (node);
+  g_bytes_unref (bytes);
+}
+
+static void
+test_bad_index (void)
+{
+  GByteArray *nodes;
+
+  /* A child that doesn't exist */
+  nodes = g_byte_array_new ();
+  append_color_node (nodes);
+  append_uint (nodes, GSK_OPACITY_NODE);
+  append_uint (nodes, 5);
+  append_float (nodes, 0.5);
+  assert_invalid (2, nodes);
+
+  /* A node that is its own child */
+  nodes = g_byte_array_new ();
+  append_color_node (nodes);
+  append_uint (nodes, GSK_OPACITY_NODE);
+  append_uint (nodes, 1);
+  append_float (nodes, 0.5);
+  assert_invalid (2, nodes);
+
+  /* More children than the file could contain */
+  nodes = g_byte_array_new ();
+  append_color_node (nodes);
+  append_uint (nodes, GSK_CONTAINER_NODE);
+  append_uint (nodes, G_MAXINT32);
+  append_uint (nodes, 0);
+  assert_invalid (2, nodes);
+
+  /* A string that doesn't exist */
+  nodes = g_byte_array_new ();
+  append_color_node (nodes);
+  append_uint (nodes, GSK_DEBUG_NODE);
+  append_uint (nodes, 0);
+  append_uint (nodes, 3);
+  assert_invalid (2, nodes);
+
+  /* A texture that doesn't exist */
+  nodes = g_byte_array_new ();
+  append_uint (nodes, GSK_TEXTURE_NODE);
+  append_float (nodes, 0);
+  append_float (nodes, 0);
+  append_float (nodes, 10);
+  append_float (nodes, 10);
+  append_uint (nodes, 0);
+  assert_invalid (1, nodes);
+
+  /* More nodes than the file contains */
+  nodes = g_byte_array_new ();
+  append_color_node (nodes);
+  assert_invalid (2, nodes);
+}
+
+static void
+test_bad_enum (void)
+{
+  GByteArray *nodes;
+
+  /* Node type */
+  nodes = g_byte_array_new ();
+  append_uint (nodes, GSK_NOT_A_RENDER_NODE);
+  assert_invalid (1, nodes);
+
+  nodes = g_byte_array_new ();
+  append_uint (nodes, 1000);
+  assert_invalid (1, nodes);
+
+  /* Blend mode */
+  nodes = g_byte_array_new ();
+  append_color_node (nodes);
+  append_uint (nodes, GSK_BLEND_NODE);
+  append_uint (nodes, 0);
+  append_uint (nodes, 0);
+  append_uint (nodes, GSK_BLEND_MODE_LUMINOSITY + 1);
+  assert_invalid (2, nodes);
+
+  nodes = g_byte_array_new ();
+  append_color_node (nodes);
+  append_uint (nodes, GSK_BLEND_NODE);
+  append_uint (nodes, 0);
+  append_uint (nodes, 0);
+  append_uint (nodes, G_MAXUINT32);
+  assert_invalid (2, nodes);
+
+  /* Transform kind */
+  nodes = g_byte_array_new ();
+  append_color_node (nodes);
+  append_uint (nodes, GSK_TRANSFORM_NODE);
+  append_uint (nodes, 0);
+  append_uint (nodes, 42);
+  assert_invalid (2, nodes);
+}
+
+static void
+add_round_trip_tests (void)
+{
+  const char *name;
+  char *dirname;
+  GDir *dir;
+
+  dirname = g_test_build_filename (G_TEST_DIST, "nodeparser", NULL);
+  dir = g_dir_open (dirname, 0, NULL);
+  if (dir == NULL)
+    {
+      g_free (dirname);
+      return;
+    }
+
+  while ((name = g_dir_read_name (dir)))
+    {
+      char *path, *testname;
+
+      if (!g_str_has_suffix (name, ".node") || g_str_has_suffix (name, ".ref.node"))
+        continue;
+
+      path = g_build_filename (dirname, name, NULL);
+      testname = g_strconcat ("/binary/round-trip/", name, NULL);
+      g_test_add_data_func_full (testname, path, test_round_trip, g_free);
+      g_free (testname);
+    }
+
+  g_dir_close (dir);
+  g_free (dirname);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  add_round_trip_tests ();
+  g_test_add_func ("/binary/shared-children", test_shared_children);
+  g_test_add_func ("/binary/truncated", test_truncated);
+  g_test_add_func ("/binary/texture-alignment", test_texture_alignment);
+  g_test_add_func ("/binary/valid", test_valid);
+  g_test_add_func ("/binary/bad-index", test_bad_index);
+  g_test_add_func ("/binary/bad-enum", test_bad_enum);
+
+  return g_test_run ();
+}
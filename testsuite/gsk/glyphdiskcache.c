@@ -0,0 +1,260 @@
+#include "config.h"
+
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <utime.h>
+
+#include "gsk/gskglyphdiskcacheprivate.h"
+
+#define GLYPH_SIZE 8
+
+static char *cache_dir;
+
+static PangoFont *
+get_font (void)
+{
+  static PangoFont *font;
+
+  if (font == NULL)
+    {
+      PangoFontMap *fontmap;
+      PangoContext *context;
+      PangoFontDescription *desc;
+
+      fontmap = pango_cairo_font_map_get_default ();
+      context = pango_font_map_create_context (fontmap);
+      desc = pango_font_description_from_string ("Sans 10");
+      font = pango_font_map_load_font (fontmap, context, desc);
+      pango_font_description_free (desc);
+      g_object_unref (context);
+    }
+
+  return font;
+}
+
+static GskGlyphDiskCache *
+open_cache (void)
+{
+  PangoFont *font = get_font ();
+  GskGlyphDiskCache *cache;
+
+  cache = gsk_glyph_disk_cache_new (font, pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (font)), 1024);
+  g_assert_nonnull (cache);
+
+  return cache;
+}
+
+/* The cache for our one font is the only file in the dir */
+static char *
+get_cache_file (void)
+{
+  char *path = NULL;
+  const char *name;
+  GDir *dir;
+
+  dir = g_dir_open (cache_dir, 0, NULL);
+  g_assert_nonnull (dir);
+
+  while ((name = g_dir_read_name (dir)))
+    {
+      if (g_str_has_suffix (name, ".cache"))
+        {
+          g_assert_null (path);
+          path = g_build_filename (cache_dir, name, NULL);
+        }
+    }
+
+  g_dir_close (dir);
+  g_assert_nonnull (path);
+
+  return path;
+}
+
+static void
+fill_glyph (guchar *data,
+            guint   seed)
+{
+  guint i;
+
+  for (i = 0; i < GLYPH_SIZE * GLYPH_SIZE * 4; i++)
+    data[i] = (i * 7 + seed) & 0xff;
+}
+
+/* Writes a cache file that contains glyph 1 */
+static void
+write_cache (void)
+{
+  GskGlyphDiskCache *cache;
+  guchar data[GLYPH_SIZE * GLYPH_SIZE * 4];
+
+  fill_glyph (data, 1);
+
+  cache = open_cache ();
+  gsk_glyph_disk_cache_add (cache, 1, 0, 0, GLYPH_SIZE, GLYPH_SIZE, data, GLYPH_SIZE * 4);
+  g_assert_true (gsk_glyph_disk_cache_is_dirty (cache));
+  gsk_glyph_disk_cache_save (cache);
+  g_assert_false (gsk_glyph_disk_cache_is_dirty (cache));
+  gsk_glyph_disk_cache_free (cache);
+}
+
+static gboolean
+has_glyph (void)
+{
+  GskGlyphDiskCache *cache;
+  const guchar *data;
+  gsize stride;
+  gboolean result;
+
+  cache = open_cache ();
+  result = gsk_glyph_disk_cache_lookup (cache, 1, 0, 0, GLYPH_SIZE, GLYPH_SIZE, &data, &stride);
+  gsk_glyph_disk_cache_free (cache);
+
+  return result;
+}
+
+static void
+test_reload (void)
+{
+  GskGlyphDiskCache *cache;
+  guchar expected[GLYPH_SIZE * GLYPH_SIZE * 4];
+  const guchar *data;
+  gsize stride;
+
+  write_cache ();
+  fill_glyph (expected, 1);
+
+  cache = open_cache ();
+  g_assert_false (gsk_glyph_disk_cache_is_dirty (cache));
+  g_assert_true (gsk_glyph_disk_cache_lookup (cache, 1, 0, 0, GLYPH_SIZE, GLYPH_SIZE, &data, &stride));
+  g_assert_cmpuint (stride, ==, GLYPH_SIZE * 4);
+  g_assert_cmpmem (data, sizeof (expected), expected, sizeof (expected));
+
+  /* Other glyphs, shifts or sizes are not in the cache */
+  g_assert_false (gsk_glyph_disk_cache_lookup (cache, 2, 0, 0, GLYPH_SIZE, GLYPH_SIZE, &data, &stride));
+  g_assert_false (gsk_glyph_disk_cache_lookup (cache, 1, 1, 0, GLYPH_SIZE, GLYPH_SIZE, &data, &stride));
+  g_assert_false (gsk_glyph_disk_cache_lookup (cache, 1, 0, 0, GLYPH_SIZE + 1, GLYPH_SIZE, &data, &stride));
+  gsk_glyph_disk_cache_free (cache);
+}
+
+static void
+test_truncated (void)
+{
+  char *path;
+  char *contents;
+  gsize length;
+  gsize i;
+
+  write_cache ();
+  path = get_cache_file ();
+  g_assert_true (g_file_get_contents (path, &contents, &length, NULL));
+
+  for (i = 0; i < length; i += 7)
+    {
+      g_assert_true (g_file_set_contents (path, contents, i, NULL));
+      g_assert_false (has_glyph ());
+    }
+
+  g_free (contents);
+  g_free (path);
+}
+
+static void
+test_corrupt (void)
+{
+  /* Offsets into the header and the first entry */
+  const struct {
+    gsize offset;
+    gsize size;
+  } fields[] = {
+    { 0, 1 },   /* magic */
+    { 16, 4 },  /* version */
+    { 20, 4 },  /* byte order */
+    { 24, 4 },  /* number of entries */
+    { 40, 4 },  /* width */
+    { 44, 4 },  /* height */
+    { 48, 8 },  /* offset */
+  };
+  char *path;
+  char *contents;
+  gsize length;
+  guint i;
+
+  write_cache ();
+  path = get_cache_file ();
+  g_assert_true (g_file_get_contents (path, &contents, &length, NULL));
+
+  for (i = 0; i < G_N_ELEMENTS (fields); i++)
+    {
+      char *corrupt = g_memdup (contents, length);
+
+      memset (corrupt + fields[i].offset, 0xff, fields[i].size);
+      g_assert_true (g_file_set_contents (path, corrupt, length, NULL));
+      g_assert_false (has_glyph ());
+      g_free (corrupt);
+    }
+
+  g_free (contents);
+  g_free (path);
+}
+
+static void
+test_remove_stale (void)
+{
+  char *path;
+  char *unused_path;
+  char *other_path;
+  struct utimbuf times;
+
+  write_cache ();
+  path = get_cache_file ();
+
+  unused_path = g_build_filename (cache_dir, "unused.cache", NULL);
+  g_assert_true (g_file_set_contents (unused_path, "", 0, NULL));
+  times.actime = times.modtime = g_get_real_time () / G_USEC_PER_SEC - 60 * 24 * 60 * 60;
+  g_assert_cmpint (g_utime (unused_path, &times), ==, 0);
+
+  other_path = g_build_filename (cache_dir, "other", NULL);
+  g_assert_true (g_file_set_contents (other_path, "", 0, NULL));
+  g_assert_cmpint (g_utime (other_path, &times), ==, 0);
+
+  gsk_glyph_disk_cache_remove_stale ();
+
+  g_assert_true (g_file_test (path, G_FILE_TEST_EXISTS));
+  g_assert_false (g_file_test (unused_path, G_FILE_TEST_EXISTS));
+  /* Not ours */
+  g_assert_true (g_file_test (other_path, G_FILE_TEST_EXISTS));
+
+  g_remove (other_path);
+  g_free (other_path);
+  g_free (unused_path);
+  g_free (path);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  char *cache_home;
+  int result;
+
+  /* Don't touch the real glyph cache */
+  cache_home = g_dir_make_tmp ("gsk-glyph-disk-cache-XXXXXX", NULL);
+  g_setenv ("XDG_CACHE_HOME", cache_home, TRUE);
+  g_setenv ("GSK_GLYPH_DISK_CACHE", "1", TRUE);
+  cache_dir = g_build_filename (cache_home, "gtk-4.0", "glyphs", NULL);
+
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/glyphdiskcache/reload", test_reload);
+  g_test_add_func ("/glyphdiskcache/truncated", test_truncated);
+  g_test_add_func ("/glyphdiskcache/corrupt", test_corrupt);
+  g_test_add_func ("/glyphdiskcache/remove-stale", test_remove_stale);
+
+  result = g_test_run ();
+
+  g_free (cache_dir);
+  g_free (cache_home);
+
+  return result;
+}
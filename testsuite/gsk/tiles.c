@@ -0,0 +1,213 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gtk/gtk.h>
+#include <math.h>
+
+#include "reftest-compare.h"
+
+/* The cairo renderer draws large frames in tiles from multiple
+ * threads. That must give the same pixels as drawing the frame in
+ * one go, which is what gsk_render_node_draw() does, and what the
+ * renderer does with GSK_DEBUG=no-tiles.
+ */
+
+/* Large enough for a few tiles in each direction */
+#define MIN_SIZE 768
+#define MAX_SCALE 16
+
+static GskRenderer *renderer;
+
+static void
+ignore_error (const GtkCssSection *section,
+              const GError        *error,
+              gpointer             user_data)
+{
+}
+
+static cairo_surface_t *
+render_tiled (GskRenderNode         *node,
+              const graphene_rect_t *viewport)
+{
+  cairo_surface_t *surface;
+  GdkTexture *texture;
+
+  texture = gsk_renderer_render_texture (renderer, node, viewport);
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                        gdk_texture_get_width (texture),
+                                        gdk_texture_get_height (texture));
+  gdk_texture_download (texture,
+                        cairo_image_surface_get_data (surface),
+                        cairo_image_surface_get_stride (surface));
+  cairo_surface_mark_dirty (surface);
+  g_object_unref (texture);
+
+  return surface;
+}
+
+static cairo_surface_t *
+render_untiled (GskRenderNode         *node,
+                const graphene_rect_t *viewport)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                        ceil (viewport->size.width),
+                                        ceil (viewport->size.height));
+  cr = cairo_create (surface);
+  cairo_translate (cr, - viewport->origin.x, - viewport->origin.y);
+  gsk_render_node_draw (node, cr);
+  cairo_destroy (cr);
+
+  return surface;
+}
+
+static void
+test_tiles (gconstpointer data)
+{
+  const char *path = data;
+  GskRenderNode *node, *scaled;
+  cairo_surface_t *tiled, *untiled, *diff;
+  GskTransform *transform;
+  graphene_rect_t bounds, viewport;
+  char *contents;
+  gsize length;
+  GBytes *bytes;
+  float scale;
+
+  if (g_get_num_processors () < 2)
+    {
+      g_test_skip ("Frames are only drawn in tiles with multiple processors");
+      return;
+    }
+
+  g_assert_true (g_file_get_contents (path, &contents, &length, NULL));
+  bytes = g_bytes_new_take (contents, length);
+  node = gsk_render_node_deserialize (bytes, ignore_error, NULL);
+  g_bytes_unref (bytes);
+
+  if (node == NULL)
+    {
+      g_test_skip ("File does not contain a node");
+      return;
+    }
+
+  gsk_render_node_get_bounds (node, &bounds);
+  if (bounds.size.width < 1 || bounds.size.height < 1)
+    {
+      g_test_skip ("Nothing to draw");
+      gsk_render_node_unref (node);
+      return;
+    }
+
+  /* Scale the node up, so it covers multiple tiles and the
+   * edges of the tiles go through its contents */
+  scale = ceilf (MIN_SIZE / MAX (bounds.size.width, bounds.size.height));
+  scale = CLAMP (scale, 1, MAX_SCALE);
+  transform = gsk_transform_scale (NULL, scale, scale);
+  scaled = gsk_transform_node_new (node, transform);
+  gsk_transform_unref (transform);
+
+  gsk_render_node_get_bounds (scaled, &bounds);
+  viewport = GRAPHENE_RECT_INIT (floorf (bounds.origin.x),
+                                 floorf (bounds.origin.y),
+                                 ceilf (bounds.origin.x + bounds.size.width) - floorf (bounds.origin.x),
+                                 ceilf (bounds.origin.y + bounds.size.height) - floorf (bounds.origin.y));
+
+  tiled = render_tiled (scaled, &viewport);
+  untiled = render_untiled (scaled, &viewport);
+
+  diff = reftest_compare_surfaces (tiled, untiled);
+  if (diff)
+    {
+      char *basename = g_path_get_basename (path);
+      char *filename = g_strconcat (g_get_tmp_dir (), G_DIR_SEPARATOR_S, basename, ".tiles.diff.png", NULL);
+
+      cairo_surface_write_to_png (diff, filename);
+      g_test_message ("Tiled drawing differs, diff stored at %s", filename);
+      g_test_fail ();
+
+      g_free (filename);
+      g_free (basename);
+      cairo_surface_destroy (diff);
+    }
+
+  cairo_surface_destroy (untiled);
+  cairo_surface_destroy (tiled);
+  gsk_render_node_unref (scaled);
+  gsk_render_node_unref (node);
+}
+
+static void
+add_tests (const char *subdir)
+{
+  const char *name;
+  char *dirname;
+  GDir *dir;
+
+  dirname = g_test_build_filename (G_TEST_DIST, subdir, NULL);
+  dir = g_dir_open (dirname, 0, NULL);
+  if (dir == NULL)
+    {
+      g_free (dirname);
+      return;
+    }
+
+  while ((name = g_dir_read_name (dir)))
+    {
+      char *path, *testname;
+
+      if (!g_str_has_suffix (name, ".node") || g_str_has_suffix (name, ".ref.node"))
+        continue;
+
+      path = g_build_filename (dirname, name, NULL);
+      testname = g_strconcat ("/tiles/", subdir, "/", name, NULL);
+      g_test_add_data_func_full (testname, path, test_tiles, g_free);
+      g_free (testname);
+    }
+
+  g_dir_close (dir);
+  g_free (dirname);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  GdkSurface *surface;
+  GError *error = NULL;
+  int result;
+
+  gtk_test_init (&argc, &argv, NULL);
+
+  surface = gdk_surface_new_toplevel (gdk_display_get_default (), 10, 10);
+  renderer = gsk_cairo_renderer_new ();
+  if (!gsk_renderer_realize (renderer, surface, &error))
+    g_error ("Failed to realize the cairo renderer: %s", error->message);
+
+  add_tests ("compare");
+  add_tests ("nodeparser");
+
+  result = g_test_run ();
+
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+  gdk_surface_destroy (surface);
+
+  return result;
+}